@@ -1,2 +1,8 @@
 /usr/bin/glslc shaders/shader.vert -o shaders/shader.vert.spv
-/usr/bin/glslc shaders/shader.frag -o shaders/shader.frag.spv
\ No newline at end of file
+/usr/bin/glslc shaders/shader.frag -o shaders/shader.frag.spv
+/usr/bin/glslc shaders/cull.comp -o shaders/cull.comp.spv
+/usr/bin/glslc shaders/prefixSum.comp -o shaders/prefixSum.comp.spv
+/usr/bin/glslc shaders/prefixSumAdd.comp -o shaders/prefixSumAdd.comp.spv
+/usr/bin/glslc shaders/particles.comp -o shaders/particles.comp.spv
+/usr/bin/glslc shaders/sprite.vert -o shaders/sprite.vert.spv
+/usr/bin/glslc shaders/sprite.frag -o shaders/sprite.frag.spv
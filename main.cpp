@@ -1,54 +1,342 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <cstring>
 #include <fstream>
+#include <cmath>
+#include <algorithm>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <vulkan/vulkan.h>
 #include "src/app.h"
 #include "src/window.h"
+#include "src/imageWriter.h"
+#include "src/frameCapture.h"
+#include "src/log.h"
 
-std::vector<char> readShader(std::string path)
+struct Options {
+    bool headless = false;
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t frames = 1;
+    uint32_t framesInFlight = 2;
+    std::string output; //пусто - кадр не сохраняется
+    std::string pipelineCacheDirectory; //пусто - текущая директория
+    std::string shaderDirectory = "../shaders";
+    std::string mesh; //.vmesh, пусто - встроенный треугольник
+    std::vector<std::string> textures; //.ktx2; первая накладывается на сцену, остальные только загружаются и вытесняются
+    uint32_t textureBudget = 0; //МБ, 0 - по бюджету кучи устройства
+    uint32_t sprites = 0; //квадов HUD за кадр, 0 - без прохода спрайтов
+    double dynamicResolution = 0.0; //цель времени GPU на кадр в мс, 0 - сцена в разрешении окна
+    uint32_t msaa = 1;
+    uint32_t draws = 1;
+    uint32_t threads = 0; //0 - по числу аппаратных потоков
+    bool benchRecording = false;
+    CullingMode culling = CullingMode::Auto;
+    float zoom = 1.0f; //>1 - часть объектов за пределами экрана отсекается
+    bool hotReload = false;
+    bool pipelineStatistics = false;
+    std::string trace; //Chrome trace JSON, пусто - не сохраняется
+    PresentPolicy presentPolicy = PresentPolicy::Throughput;
+    double fpsCap = 30.0; //для --present=power
+    bool allowTearing = false;
+    bool dumpRenderGraph = false;
+    DescriptorModel descriptors = DescriptorModel::Bindless; //pooled - наборы по слотам кадра без descriptor indexing
+    bool computeSamples = false; //примеры вычислений с проверкой на CPU, код выхода 1 при расхождении
+    std::string capture; //.vcap для vulkanproject_replay, пусто - без захвата
+    uint32_t captureStart = 0; //кадры до него сохраняются без команд и не замеряются при воспроизведении
+    uint32_t captureFrames = 1;
+};
+
+Options parseOptions(int argc, char **argv)
 {
-    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&arg](const char* prefix) { return arg.substr(std::strlen(prefix)); };
 
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
+        if(arg == "--headless")
+            options.headless = true;
+        else if(arg == "--verbose")
+            utils::setVerbosity(utils::Verbosity::Verbose);
+        else if(arg == "--quiet")
+            utils::setVerbosity(utils::Verbosity::Quiet);
+        else if(arg.rfind("--width=", 0) == 0)
+            options.width = static_cast<uint32_t>(std::stoul(value("--width=")));
+        else if(arg.rfind("--height=", 0) == 0)
+            options.height = static_cast<uint32_t>(std::stoul(value("--height=")));
+        else if(arg.rfind("--frames=", 0) == 0)
+            options.frames = static_cast<uint32_t>(std::stoul(value("--frames=")));
+        else if(arg.rfind("--frames-in-flight=", 0) == 0)
+            options.framesInFlight = static_cast<uint32_t>(std::stoul(value("--frames-in-flight=")));
+        else if(arg.rfind("--pipeline-cache=", 0) == 0)
+            options.pipelineCacheDirectory = value("--pipeline-cache=");
+        else if(arg.rfind("--shaders=", 0) == 0)
+            options.shaderDirectory = value("--shaders=");
+        else if(arg.rfind("--mesh=", 0) == 0)
+            options.mesh = value("--mesh=");
+        else if(arg.rfind("--texture=", 0) == 0)
+            options.textures.push_back(value("--texture="));
+        else if(arg.rfind("--texture-budget=", 0) == 0)
+            options.textureBudget = static_cast<uint32_t>(std::stoul(value("--texture-budget=")));
+        else if(arg.rfind("--sprites=", 0) == 0)
+            options.sprites = static_cast<uint32_t>(std::stoul(value("--sprites=")));
+        else if(arg.rfind("--dynamic-resolution=", 0) == 0)
+            options.dynamicResolution = std::stod(value("--dynamic-resolution="));
+        else if(arg.rfind("--msaa=", 0) == 0)
+            options.msaa = static_cast<uint32_t>(std::stoul(value("--msaa=")));
+        else if(arg.rfind("--draws=", 0) == 0)
+            options.draws = static_cast<uint32_t>(std::stoul(value("--draws=")));
+        else if(arg.rfind("--threads=", 0) == 0)
+            options.threads = static_cast<uint32_t>(std::stoul(value("--threads=")));
+        else if(arg == "--culling=gpu")
+            options.culling = CullingMode::Gpu;
+        else if(arg == "--culling=cpu")
+            options.culling = CullingMode::Cpu;
+        else if(arg == "--culling=auto")
+            options.culling = CullingMode::Auto;
+        else if(arg.rfind("--zoom=", 0) == 0)
+            options.zoom = std::stof(value("--zoom="));
+        else if(arg == "--bench-recording")
+            options.benchRecording = true;
+        else if(arg == "--hot-reload")
+            options.hotReload = true;
+        else if(arg == "--pipeline-stats")
+            options.pipelineStatistics = true;
+        else if(arg.rfind("--trace=", 0) == 0)
+            options.trace = value("--trace=");
+        else if(arg == "--present=latency")
+            options.presentPolicy = PresentPolicy::LowLatency;
+        else if(arg == "--present=throughput")
+            options.presentPolicy = PresentPolicy::Throughput;
+        else if(arg == "--present=power")
+            options.presentPolicy = PresentPolicy::PowerSaving;
+        else if(arg.rfind("--fps-cap=", 0) == 0)
+            options.fpsCap = std::stod(value("--fps-cap="));
+        else if(arg == "--allow-tearing")
+            options.allowTearing = true;
+        else if(arg == "--dump-render-graph")
+            options.dumpRenderGraph = true;
+        else if(arg == "--descriptors=bindless")
+            options.descriptors = DescriptorModel::Bindless;
+        else if(arg == "--descriptors=pooled")
+            options.descriptors = DescriptorModel::Pooled;
+        else if(arg == "--compute-samples")
+            options.computeSamples = true;
+        else if(arg.rfind("--capture=", 0) == 0)
+            options.capture = value("--capture=");
+        else if(arg.rfind("--capture-start=", 0) == 0)
+            options.captureStart = static_cast<uint32_t>(std::stoul(value("--capture-start=")));
+        else if(arg.rfind("--capture-frames=", 0) == 0)
+            options.captureFrames = static_cast<uint32_t>(std::stoul(value("--capture-frames=")));
+        else if(arg.rfind("--output=", 0) == 0)
+            options.output = value("--output=");
+        else
+            std::cerr << "Неизвестный аргумент: " << arg << std::endl;
+    }
+    return options;
+}
+
+void printCullStats(const Application& app)
+{
+    CullStats stats = app.getCullStats();
+    std::cout << "Объектов видно: " << stats.visible << ", отсечено: " << stats.culled
+              << " (" << (app.isGpuCulling() ? "GPU" : "CPU") << ")" << std::endl;
+}
 
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+//нагрузка для прохода спрайтов: сетка плиток в двух слоях, каждая восьмая аддитивная, глубина перемешана
+//внутри слоя, текстуры сцены чередуются. Позиции сдвигаются по кадрам, чтобы вершины писались заново
+void submitHudSprites(Application& app, uint32_t count, uint32_t frame)
+{
+    VkExtent2D extent = app.getExtent();
+    const uint32_t columns = std::max(1u, static_cast<uint32_t>(std::sqrt(static_cast<float>(count) * extent.width / std::max(extent.height, 1u))));
+    const glm::vec2 cell(static_cast<float>(extent.width) / columns,
+                         static_cast<float>(extent.height) / ((count + columns - 1) / columns));
+    const uint32_t textureCount = static_cast<uint32_t>(app.getTextures().getTextureCount());
 
-    file.close();
-    return buffer;
+    SpriteBatch& sprites = app.getSprites();
+    for(uint32_t i = 0; i < count; i++) {
+        Sprite sprite;
+        sprite.position = glm::vec2(static_cast<float>(i % columns), static_cast<float>(i / columns)) * cell;
+        sprite.position.x += static_cast<float>((frame + i) % 8);
+        sprite.size = cell * 0.8f;
+        sprite.color = 0x80000000u | ((i * 2654435761u) & 0x00FFFFFFu);
+        sprite.depth = static_cast<float>((i * 7919u) % 1000u);
+        sprite.layer = static_cast<uint8_t>(i % 2);
+        sprite.blend = i % 8 == 0 ? SpriteBlend::Additive : SpriteBlend::Alpha;
+        if(textureCount > 0 && i % 3 == 0)
+            sprite.texture = app.getTextures().getDescriptorIndex(i % textureCount);
+        sprites.draw(sprite);
+    }
 }
 
+void configureCapture(Application& app, FrameCapture& capture, const Options& options)
+{
+    if(options.capture.empty())
+        return;
 
-int main(int argc, char **argv) 
+    FrameCapture::Config config;
+    config.firstFrame = options.captureStart;
+    config.frameCount = options.captureFrames;
+    capture.configure(config);
+    app.setCapture(&capture);
+}
+
+//кадры, которые не успели завершиться, сохраняются без времени GPU
+void saveCapture(const FrameCapture& capture, const Options& options)
 {
+    if(options.capture.empty())
+        return;
+
+    capture.save(options.capture);
+    capture.printReport(std::cout);
+    std::cout << "Захват сохранён в " << options.capture << std::endl;
+}
+
+void printProfile(const Application& app, const Options& options)
+{
+    app.getProfiler().printSummary(std::cout);
+    if(options.trace.empty())
+        return;
+
+    std::ofstream trace(options.trace);
+    app.getProfiler().writeChromeTrace(trace);
+    std::cout << "Трасса сохранена в " << options.trace << " (chrome://tracing, ui.perfetto.dev)" << std::endl;
+}
+
+int runHeadless(const Options& options)
+{
+    FrameCapture capture;
     Application app{};
-    Window window{};
+    app.setFramesInFlight(options.framesInFlight);
+    app.setPipelineCacheDirectory(options.pipelineCacheDirectory);
+    app.setShaderDirectory(options.shaderDirectory);
+    app.setMeshPath(options.mesh);
+    for(const auto& texture : options.textures)
+        app.addTexture(texture);
+    app.setTextureBudget(static_cast<VkDeviceSize>(options.textureBudget) << 20);
+    if(options.sprites > 0)
+        app.enableSprites(options.sprites);
+    if(options.dynamicResolution > 0.0)
+        app.setDynamicResolution(options.dynamicResolution);
+    app.setMsaaSamples(options.msaa);
+    app.setDrawCount(options.draws);
+    app.setWorkerThreads(options.threads);
+    app.setCullingMode(options.culling);
+    app.setDescriptorModel(options.descriptors);
+    app.setViewProjection(glm::scale(glm::mat4(1.0f), glm::vec3(options.zoom, options.zoom, 1.0f)));
+    if(options.pipelineStatistics)
+        app.enablePipelineStatistics();
+    configureCapture(app, capture, options);
+    app.initHeadless(options.width, options.height);
+    if(options.dumpRenderGraph)
+        app.getRenderGraph().printDebug(std::cout);
 
-    window.init();
-    app.init(window);
+    if(options.benchRecording)
+        app.benchmarkRecording(100, std::cout);
+    int exitCode = 0;
+    if(options.computeSamples && !app.runComputeSamples(std::cout))
+        exitCode = 1;
+
+    for(uint32_t i = 0; i < options.frames; i++) {
+        if(options.sprites > 0)
+            submitHudSprites(app, options.sprites, i);
+        app.drawFrame();
+    }
+
+    app.getFrameStats().print(std::cout);
+    printCullStats(app);
+    if(app.getTextures().getTextureCount() > 0)
+        app.getTextures().printReport(std::cout);
+    if(options.sprites > 0)
+        app.getSprites().printReport(std::cout);
+    if(options.dynamicResolution > 0.0)
+        app.getDynamicResolution().printReport(std::cout);
+    app.getPipelines().printReport(std::cout);
+    printProfile(app, options);
+    saveCapture(capture, options);
+
+    if(!options.output.empty() && options.frames == 0) {
+        std::cerr << "--frames=0: кадр не нарисован, " << options.output << " не сохраняется" << std::endl;
+        exitCode = 1;
+    } else if(!options.output.empty()) {
+        std::vector<uint8_t> pixels;
+        app.readbackFrame(pixels);
+
+        VkExtent2D extent = app.getExtent();
+        utils::writeImage(options.output, extent.width, extent.height, pixels);
+        std::cout << "Кадр сохранён в " << options.output << std::endl;
+    }
 
+    return exitCode;
+}
 
-    std::cout << "Hello, world!" << std::endl;
 
-    auto vertCode = readShader("../shaders/shader.vert.spv");
-    auto fragCode = readShader("../shaders/shader.frag.spv");
+int main(int argc, char **argv) 
+{
+    Options options = parseOptions(argc, argv);
+    if(options.headless)
+        return runHeadless(options);
 
-    std::cout << vertCode.size() << std::endl;
-    std::cout << fragCode.size() << std::endl;
+    FrameCapture capture;
+    Application app{};
+    Window window{};
 
-    glm::mat4 matrix;
-    glm::vec4 vec;
-    auto test = matrix * vec;
+    window.init();
+    app.setFramesInFlight(options.framesInFlight);
+    app.setPipelineCacheDirectory(options.pipelineCacheDirectory);
+    app.setShaderDirectory(options.shaderDirectory);
+    app.setMeshPath(options.mesh);
+    for(const auto& texture : options.textures)
+        app.addTexture(texture);
+    app.setTextureBudget(static_cast<VkDeviceSize>(options.textureBudget) << 20);
+    if(options.sprites > 0)
+        app.enableSprites(options.sprites);
+    if(options.dynamicResolution > 0.0)
+        app.setDynamicResolution(options.dynamicResolution);
+    app.setMsaaSamples(options.msaa);
+    app.setDrawCount(options.draws);
+    app.setWorkerThreads(options.threads);
+    app.setCullingMode(options.culling);
+    app.setDescriptorModel(options.descriptors);
+    app.setViewProjection(glm::scale(glm::mat4(1.0f), glm::vec3(options.zoom, options.zoom, 1.0f)));
+    if(options.pipelineStatistics)
+        app.enablePipelineStatistics();
+    if(options.hotReload)
+        app.enableShaderHotReload();
+    app.setPresentPolicy(options.presentPolicy, options.fpsCap, options.allowTearing);
+    configureCapture(app, capture, options);
+    app.init(window);
+    if(options.dumpRenderGraph)
+        app.getRenderGraph().printDebug(std::cout);
 
+    uint32_t frame = 0;
     while(!window.isShouldClose()) {
+        app.waitForNextFrame();
         window.pollEvents();
+        if(window.isMinimized()) { //свёрнутое окно: спим до событий вместо холостого цикла
+            window.waitEvents();
+            continue;
+        }
 
-        window.swapBuffers();
+        if(options.sprites > 0)
+            submitHudSprites(app, options.sprites, frame++);
+        app.drawFrame();
     }
 
+    app.getFrameStats().print(std::cout);
+    app.getFramePacer().print(std::cout);
+    printCullStats(app);
+    if(app.getTextures().getTextureCount() > 0)
+        app.getTextures().printReport(std::cout);
+    if(options.sprites > 0)
+        app.getSprites().printReport(std::cout);
+    if(options.dynamicResolution > 0.0)
+        app.getDynamicResolution().printReport(std::cout);
+    app.getPipelines().printReport(std::cout);
+    printProfile(app, options);
+    saveCapture(capture, options);
+
     return 0;
 }
@@ -1,9 +1,25 @@
 #version 450
 
+//размер массива задаёт приложение (src/bindlessDescriptors.h)
+layout(constant_id = 1) const uint bindlessTextureCount = 1;
+//вариант конвейера сцены без текстур: выборка из белой заглушки не нужна (Application::sceneTexturedConstant)
+layout(constant_id = 2) const bool sceneTextured = true;
+
+//все текстуры приложения; текстура сцены - по индексу из push constants
+layout(set = 0, binding = 1) uniform sampler2D textures[bindlessTextureCount];
+
+layout(push_constant) uniform Draw { //DrawConstants
+    uint objects;
+    uint texture;
+} draw;
+
 layout(location=0) in vec3 fragColor;
+layout(location=1) in vec2 fragUv;
 layout(location=0) out vec4 outColor;
 
 void main()
 {
     outColor = vec4(fragColor, 1.0);
-}
\ No newline at end of file
+    if(sceneTextured)
+        outColor *= texture(textures[draw.texture], fragUv);
+}
@@ -1,20 +1,40 @@
 #version 450
 
-layout(location=0) out vec3 fragColor;
+//номера location совпадают с битами VertexAttribute (src/vertexLayout.h)
+layout(location=0) in vec3 inPosition;
+layout(location=2) in vec3 inColor;
+
+struct DrawItem { //src/app.h
+    vec2 offset;
+    float scale;
+    float padding;
+    vec4 sphere;
+};
+
+//размер массива задаёт приложение (src/bindlessDescriptors.h): в режиме bindless он большой и заполнен частично
+layout(constant_id = 0) const uint bindlessBufferCount = 1;
+
+//все буферы хранения приложения; объекты сцены - по индексу из push constants
+layout(set = 0, binding = 0) readonly buffer Objects { DrawItem items[]; } buffers[bindlessBufferCount];
 
-vec2 positions[3] = vec2[] (
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
-vec3 colors[3] = vec3[](
-vec3(1.0, 0.0, 0.0),
-vec3(0.0, 1.0, 0.0),
-vec3(0.0, 0.0, 1.0)
-);
+layout(set = 1, binding = 0) uniform Frame { //FrameUniforms
+    mat4 viewProjection;
+} frame;
+
+//объект выбирается через firstInstance: и прямые, и косвенные отрисовки обходятся без смены push constants
+layout(push_constant) uniform Draw { //DrawConstants
+    uint objects;
+    uint texture;
+} draw;
+
+layout(location=0) out vec3 fragColor;
+layout(location=1) out vec2 fragUv;
 
 void main()
 {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+    DrawItem item = buffers[draw.objects].items[gl_InstanceIndex];
+    vec3 position = inPosition * item.scale + vec3(item.offset, 0.0);
+    gl_Position = frame.viewProjection * vec4(position, 1.0);
+    fragColor = inColor;
+    fragUv = inPosition.xy * 0.5 + 0.5; //у мешей нет текстурных координат: проекция на плоскость XY
+}
@@ -0,0 +1,21 @@
+#version 450
+
+//размер массива задаёт приложение (src/bindlessDescriptors.h)
+layout(constant_id = 1) const uint bindlessTextureCount = 1;
+
+layout(set = 0, binding = 1) uniform sampler2D textures[bindlessTextureCount];
+
+//раскладка сцены: текстуру пакета SpriteBatch кладёт в поле texture
+layout(push_constant) uniform Draw { //DrawConstants
+    uint objects;
+    uint texture;
+} draw;
+
+layout(location=0) in vec4 fragColor;
+layout(location=1) in vec2 fragUv;
+layout(location=0) out vec4 outColor;
+
+void main()
+{
+    outColor = fragColor * texture(textures[draw.texture], fragUv);
+}
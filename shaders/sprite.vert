@@ -0,0 +1,16 @@
+#version 450
+
+//SpriteVertex (src/spriteBatch.h): позиция уже в клип-пространстве
+layout(location=0) in vec2 inPosition;
+layout(location=1) in vec2 inUv;
+layout(location=2) in vec4 inColor;
+
+layout(location=0) out vec4 fragColor;
+layout(location=1) out vec2 fragUv;
+
+void main()
+{
+    gl_Position = vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor;
+    fragUv = inUv;
+}
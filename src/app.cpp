@@ -1,5 +1,6 @@
 #include "app.h"
-#include "loadBinFile.h"
+#include "log.h"
+#include "computeSamples.h"
 
 #include <iostream>
 #include <stdexcept>
@@ -10,11 +11,17 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
 
 
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> transferFamily; //только передача: DMA движок, копирует параллельно с рендером
+    std::optional<uint32_t> computeFamily;  //вычисления без графики (async compute)
+    uint32_t graphicsQueueCount = 0;
 
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -28,26 +35,13 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> presentModes; //Доступные режимы презентации
 };
 
-VkShaderModule createShaderModule(VkDevice& device, std::vector<char>& code) {
-    VkShaderModuleCreateInfo createInfo {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    VkShaderModule shaderModule;
-    if(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-        throw std::runtime_error("Не удалось создать шейдерный модуль!");
-
-    return shaderModule;
-}
-
-SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice &device, VkSurfaceKHR &surface) {
+SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice &device, VkSurfaceKHR surface) {
     SwapChainSupportDetails details;
 
     //базовые возможности
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-    std::cout << "Максимальное количество изображений в цепочке: " << details.capabilities.maxImageCount << std::endl;
-    std::cout << "Минимальное количество изображений в цепочке: " << details.capabilities.minImageCount << std::endl;
+    utils::log(utils::Verbosity::Verbose) << "Максимальное количество изображений в цепочке: " << details.capabilities.maxImageCount << std::endl;
+    utils::log(utils::Verbosity::Verbose) << "Минимальное количество изображений в цепочке: " << details.capabilities.minImageCount << std::endl;
 
     //формат поверхности
     uint32_t formatCount;
@@ -66,6 +60,19 @@ SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice &device, VkSurfac
     return details;
 }
 
+bool hasDeviceExtension(VkPhysicalDevice device, const char* name) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for(const auto& extension : availableExtensions)
+        if(std::strcmp(extension.extensionName, name) == 0)
+            return true;
+    return false;
+}
+
 bool checkDeviceExtensionSupport(VkPhysicalDevice &device, std::vector<const char*> requiredExtensions) {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -73,9 +80,10 @@ bool checkDeviceExtensionSupport(VkPhysicalDevice &device, std::vector<const cha
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::cout << "Доступные расширения:\n";
+    std::ostream& verbose = utils::log(utils::Verbosity::Verbose);
+    verbose << "Доступные расширения:\n";
     for(const auto& extension : availableExtensions)
-        std::cout << extension.extensionName << " " << extension.specVersion << std::endl;
+        verbose << extension.extensionName << " " << extension.specVersion << std::endl;
 
     unsigned int requiredExtensionCount = requiredExtensions.size();
 
@@ -98,12 +106,28 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
     return availableFormats[0]; //первый попавшийся формат
 }
 
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-    for(const auto& availablePresentMode : availablePresentModes) {
-        if(availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) //тройная буферизация
-            return availablePresentMode;
+VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, PresentPolicy policy, bool allowTearing) {
+    std::vector<VkPresentModeKHR> preferred;
+    switch(policy) {
+        case PresentPolicy::LowLatency: //без очереди на vblank; без разрешения на разрывы - MAILBOX, кадр заменяет ожидающий
+            if(allowTearing)
+                preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+            else
+                preferred = { VK_PRESENT_MODE_MAILBOX_KHR };
+            break;
+        case PresentPolicy::Throughput:
+            preferred = { VK_PRESENT_MODE_MAILBOX_KHR }; //тройная буферизация
+            if(allowTearing)
+                preferred.push_back(VK_PRESENT_MODE_IMMEDIATE_KHR);
+            break;
+        case PresentPolicy::PowerSaving:
+            break; //FIFO: не больше кадра на vblank
     }
-    return VK_PRESENT_MODE_FIFO_KHR; //двойная буферизация
+
+    for(VkPresentModeKHR mode : preferred)
+        if(std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end())
+            return mode;
+    return VK_PRESENT_MODE_FIFO_KHR; //двойная буферизация, поддерживается всегда
 }
 
 VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilitiesKhr, int &width, int &height) { //размеры фреймбуфера окна
@@ -119,19 +143,20 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilitiesKhr, int
     return actualExtent;
 }
 
-bool isDeviceSuitable (VkPhysicalDevice &device) {
-    VkPhysicalDeviceProperties props;
-    VkPhysicalDeviceFeatures features;
+const std::vector<const char*> deviceExtensions = {
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME
+};
 
-    vkGetPhysicalDeviceProperties(device, &props);
-    vkGetPhysicalDeviceFeatures(device, &features);
-    std::cout << "Имя устройства: " << props.deviceName << std::endl;
-    std::cout << "Производитель: " << props.vendorID << std::endl;
+const VkDeviceSize stagingRingSize = 16ull << 20; //кусками по половине: пока GPU копирует один, CPU заполняет другой
 
-    return props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU && features.geometryShader;
-}
+//push constants cull.comp
+struct CullingConstants {
+    float planes[6][4];
+    uint32_t objectCount;
+    uint32_t submeshCount;
+};
 
-QueueFamilyIndices findQueueFamilies(VkPhysicalDevice &device, VkSurfaceKHR &surface) {
+QueueFamilyIndices findQueueFamilies(VkPhysicalDevice &device, VkSurfaceKHR surface) {
     QueueFamilyIndices indices;
 
     uint32_t queueFamilyCount = 0;
@@ -140,41 +165,121 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice &device, VkSurfaceKHR &sur
     std::vector <VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyProperties.data());
 
-    int i = 0;
-    for (const auto& queueFamilyProperty : queueFamilyProperties) {
+    //проходим все семейства: выделенные семейства передачи и вычислений обычно идут после графического
+    for(uint32_t i = 0; i < queueFamilyCount; i++) {
+        const VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+
+        if((flags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
+            indices.graphicsFamily = i;
+            indices.graphicsQueueCount = queueFamilyProperties[i].queueCount;
+        }
+
+        if((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+           && !indices.transferFamily.has_value())
+            indices.transferFamily = i;
+
+        if((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && !indices.computeFamily.has_value())
+            indices.computeFamily = i;
+
+        if(surface == VK_NULL_HANDLE)
+            continue;
+
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-        if(presentSupport)
+        //презентация из семейства графики не требует передачи владения изображениями
+        if(presentSupport && (!indices.presentFamily.has_value() || indices.graphicsFamily == i))
             indices.presentFamily = i;
+    }
 
-        if(queueFamilyProperty.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
-        }
-        if(indices.isComplete())
-            break;
+    //без surface (headless) презентация не нужна, очередь графики выполняет всё
+    if(surface == VK_NULL_HANDLE)
+        indices.presentFamily = indices.graphicsFamily;
+
+    return indices;
+}
+
+//оценка устройства по возможностям: 0 - устройство непригодно, иначе чем больше, тем лучше.
+//CPU реализации (lavapipe, swiftshader) тоже проходят, но с наименьшим приоритетом, если их тип не предпочтён явно
+uint32_t rateDeviceSuitability(VkPhysicalDevice &device, VkSurfaceKHR surface, std::optional<VkPhysicalDeviceType> preferredType) {
+    VkPhysicalDeviceProperties props;
+    VkPhysicalDeviceFeatures features;
+
+    vkGetPhysicalDeviceProperties(device, &props);
+    vkGetPhysicalDeviceFeatures(device, &features);
+    utils::log(utils::Verbosity::Verbose) << "Имя устройства: " << props.deviceName << std::endl;
+    utils::log(utils::Verbosity::Verbose) << "Производитель: " << props.vendorID << std::endl;
+
+    QueueFamilyIndices indices = findQueueFamilies(device, surface);
+    if(!indices.isComplete())
+        return 0;
 
-        i++;
+    if(surface != VK_NULL_HANDLE) {
+        if(!checkDeviceExtensionSupport(device, deviceExtensions))
+            return 0;
+
+        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
+        if(swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty())
+            return 0;
     }
 
-    return indices;
+    uint32_t score = 1;
+    switch(props.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   score += 10000; break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score += 5000;  break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    score += 2000;  break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:            score += 100;   break;
+        default: break;
+    }
+    if(preferredType == props.deviceType)
+        score += 100000;
+
+    //при равном типе предпочитаем устройство с большими изображениями и геометрическим шейдером
+    score += props.limits.maxImageDimension2D / 1024;
+    if(features.geometryShader)
+        score += 10;
+
+    return score;
 }
 
 void Application::baseInit()
 {
     uint32_t glfwExCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExCount);
-    std::cout << glfwExCount << " glfwExCount\n";
-    for(int i = 0; i < glfwExCount; i++)
-        std::cout << glfwExtensions[i] << std::endl;
+    const char** glfwExtensions = nullptr;
+    if(!_headless) { //без окна расширения surface не нужны
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExCount);
+        std::ostream& verbose = utils::log(utils::Verbosity::Verbose);
+        verbose << glfwExCount << " glfwExCount\n";
+        for(int i = 0; i < glfwExCount; i++)
+            verbose << glfwExtensions[i] << std::endl;
+    }
+
+    VkApplicationInfo appInfo {};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "vulkanproject";
+    //1.2 нужен для timeline семафоров; загрузчик 1.0 не знает vkEnumerateInstanceVersion и отвергает версию выше 1.0
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+        vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+    if(enumerateInstanceVersion)
+        enumerateInstanceVersion(&loaderVersion);
+    appInfo.apiVersion = std::min(loaderVersion, static_cast<uint32_t>(VK_API_VERSION_1_2));
+    _instanceApiVersion = appInfo.apiVersion;
 
     VkInstanceCreateInfo instanceInfo {};
     instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
     instanceInfo.enabledExtensionCount = glfwExCount;
     instanceInfo.ppEnabledExtensionNames = glfwExtensions;
 
-    if(vkCreateInstance(&instanceInfo, nullptr, &_instance) != VK_SUCCESS)
+    VkInstance instance;
+    if(vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS)
         throw std::runtime_error("Невозможно создать экземпляр");
+    _instance = UniqueInstance(nullptr, instance);
+
+    //список расширений нужен только для вывода: без подробного режима не опрашиваем загрузчик
+    if(utils::getVerbosity() < utils::Verbosity::Verbose)
+        return;
 
     uint32_t extensionCount = 0;
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
@@ -192,17 +297,19 @@ void Application::physicalDeviceInit()
     VkPhysicalDevice phDevice = nullptr;
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(_instance, &deviceCount, nullptr);
-    std::cout << deviceCount << " устройств\n";
+    utils::log(utils::Verbosity::Verbose) << deviceCount << " устройств\n";
 
     std::vector<VkPhysicalDevice> phDevices(deviceCount);
     vkEnumeratePhysicalDevices(_instance, &deviceCount, phDevices.data());
 
+    uint32_t bestScore = 0;
     for(auto& dev : phDevices)
     {
-        if(isDeviceSuitable(dev))
+        uint32_t score = rateDeviceSuitability(dev, _surface, _preferredDeviceType);
+        if(score > bestScore)
         {
+            bestScore = score;
             phDevice = dev;
-            break;
         }
     }
     if(phDevice == nullptr)
@@ -210,31 +317,111 @@ void Application::physicalDeviceInit()
 
     _physicalDevice = phDevice;
 }
+
+VkPhysicalDeviceProperties Application::getDeviceProperties() const {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+    return properties;
+}
 void Application::logicalDeviceInit() {
     QueueFamilyIndices indices = findQueueFamilies(_physicalDevice, _surface);
 
+    //загрузки идут через семейство только для передачи; без него - через вторую очередь графики, если она есть
+    _graphicsFamily = indices.graphicsFamily.value();
+    _transferFamily = indices.transferFamily.value_or(_graphicsFamily);
+    _computeFamily = indices.computeFamily.value_or(_graphicsFamily);
+    const bool secondGraphicsQueue = !indices.transferFamily.has_value() && indices.graphicsQueueCount > 1;
+
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set <uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    std::set <uint32_t> uniqueQueueFamilies = { _graphicsFamily, indices.presentFamily.value(), _transferFamily, _computeFamily };
 
-    float queuePriority = 1.0f;
+    float queuePriorities[] = { 1.0f, 1.0f };
     for(uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo {};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
-        queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.queueCount = (queueFamily == _graphicsFamily && secondGraphicsQueue) ? 2 : 1;
+        queueCreateInfo.pQueuePriorities = queuePriorities;
 
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    //косвенные отрисовки со счётчиком для отсечения на GPU; без них остаётся отсечение на CPU
+    VkPhysicalDeviceFeatures supportedFeatures {};
+    vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures physicalDeviceFeatures {};
+    physicalDeviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    physicalDeviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
 
-    const std::vector<const char*> deviceExtensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    //статистика конвейера активна и во время vkCmdExecuteCommands, поэтому нужны оба свойства
+    if(_pipelineStatistics && !(supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries)) {
+        utils::log() << "Статистика конвейера не поддерживается устройством" << std::endl;
+        _pipelineStatistics = false;
+    }
+    physicalDeviceFeatures.pipelineStatisticsQuery = _pipelineStatistics;
+    physicalDeviceFeatures.inheritedQueries = _pipelineStatistics;
+    //индексы ресурсов приходят из push constants: индекс динамически однородный, non-uniform индексация не нужна
+    physicalDeviceFeatures.shaderStorageBufferArrayDynamicIndexing = supportedFeatures.shaderStorageBufferArrayDynamicIndexing;
+    physicalDeviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+    //текстуры KTX2 в форматах BCn; без возможности TextureStreamer отказывается их загружать
+    physicalDeviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+    std::vector<const char*> enabledExtensions;
+    if(!_headless)
+        enabledExtensions = deviceExtensions;
+    _indirectCountSupported = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance
+                              && hasDeviceExtension(_physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if(_indirectCountSupported)
+        enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+    //timeline семафоры - в ядре 1.2; запрашиваются через цепочку pNext вместе с остальными возможностями 1.2
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
+
+    //бюджет кучи для вытеснения текстур; vkGetPhysicalDeviceMemoryProperties2 - в ядре 1.1
+    _memoryBudgetSupported = _instanceApiVersion >= VK_API_VERSION_1_1 && deviceProperties.apiVersion >= VK_API_VERSION_1_1
+                             && hasDeviceExtension(_physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if(_memoryBudgetSupported)
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    bool vulkan12 = _instanceApiVersion >= VK_API_VERSION_1_2 && deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+    if(vulkan12) {
+        VkPhysicalDeviceFeatures2 features2 {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(_physicalDevice, &features2);
+
+        const VkPhysicalDeviceVulkan12Features supported12 = vulkan12Features;
+        vulkan12Features = {};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12Features.timelineSemaphore = supported12.timelineSemaphore;
+
+        //массивы дескрипторов, заполненные частично и дополняемые без ожидания кадров в полёте
+        _bindlessSupported = supported12.descriptorBindingPartiallyBound && supported12.descriptorBindingUpdateUnusedWhilePending
+                             && supported12.descriptorBindingStorageBufferUpdateAfterBind
+                             && supported12.descriptorBindingSampledImageUpdateAfterBind
+                             && supportedFeatures.shaderStorageBufferArrayDynamicIndexing
+                             && supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+        if(_bindlessSupported && _descriptorModel == DescriptorModel::Bindless) {
+            vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+            vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        }
+    }
+    _timelineSemaphores = vulkan12 && vulkan12Features.timelineSemaphore;
+    if(_descriptorModel == DescriptorModel::Bindless && !_bindlessSupported) {
+        utils::log() << "Descriptor indexing не поддерживается устройством: наборы дескрипторов по слотам кадра" << std::endl;
+        _descriptorModel = DescriptorModel::Pooled;
+    }
 
     VkDeviceCreateInfo deviceCreateInfo {};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    if(vulkan12)
+        deviceCreateInfo.pNext = &vulkan12Features;
 
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data(); //сообщаем логическому устройству об очередях
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
@@ -242,34 +429,53 @@ void Application::logicalDeviceInit() {
 
     deviceCreateInfo.enabledLayerCount = 0; //мы не используем слои проверки
 
-    if(!checkDeviceExtensionSupport(_physicalDevice, deviceExtensions))
-        throw std::runtime_error("Не найдено расширение swap chain");
+    if(!_headless) {
+        if(!checkDeviceExtensionSupport(_physicalDevice, deviceExtensions))
+            throw std::runtime_error("Не найдено расширение swap chain");
 
-    bool swapChainAdequate = false;
-    SwapChainSupportDetails swapChainSupport = querySwapChainSupport(_physicalDevice, _surface);
-    swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+        bool swapChainAdequate = false;
+        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(_physicalDevice, _surface);
+        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 
-    if(!swapChainAdequate)
-        throw std::runtime_error("Нету поддержки цепочки обмена");
+        if(!swapChainAdequate)
+            throw std::runtime_error("Нету поддержки цепочки обмена");
 
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    }
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
-    if(vkCreateDevice(_physicalDevice, &deviceCreateInfo, nullptr, &_device) != VK_SUCCESS)
+    VkDevice device;
+    if(vkCreateDevice(_physicalDevice, &deviceCreateInfo, nullptr, &device) != VK_SUCCESS)
         throw std::runtime_error("Не удалось создать логическое устройство!");
+    _device = UniqueDevice(nullptr, device);
 
     vkGetDeviceQueue(_device, indices.graphicsFamily.value(), 0, &_graphicsQueue);
-    vkGetDeviceQueue(_device, indices.presentFamily.value(), 0, &_presentQueue);
+    _presentFamily = indices.presentFamily.value();
+    vkGetDeviceQueue(_device, _presentFamily, 0, &_presentQueue);
+    vkGetDeviceQueue(_device, _transferFamily, secondGraphicsQueue ? 1 : 0, &_transferQueue);
+    vkGetDeviceQueue(_device, _computeFamily, 0, &_computeQueue);
+
+    utils::log(utils::Verbosity::Verbose) << "Очереди: графика " << _graphicsFamily << ", передача " << _transferFamily
+              << (indices.transferFamily.has_value() ? " (выделенная)" : secondGraphicsQueue ? " (вторая очередь графики)" : " (общая)")
+              << ", вычисления " << _computeFamily << ", timeline семафоры: " << (_timelineSemaphores ? "да" : "нет") << std::endl;
+
+    if(_indirectCountSupported)
+        _cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(_device, "vkCmdDrawIndexedIndirectCountKHR"));
+    _indirectCountSupported = _cmdDrawIndexedIndirectCount != nullptr;
 }
 
 void Application::swapChainInit() {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(_physicalDevice, _surface);
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes, _pacer.getPolicy(), _allowTearing);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities, extentWidth, extentHeight);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    //лишнее изображение даёт GPU начать следующий кадр, пока предыдущий ждёт вывода, но добавляет кадр задержки
+    uint32_t imageCount = swapChainSupport.capabilities.minImageCount;
+    if(_pacer.getPolicy() == PresentPolicy::Throughput || presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+        imageCount++; //MAILBOX без запасного изображения вырождается в FIFO
     // 0 - специальное число, означающее, что максимального количества изображений в swap chain нету
     if(swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
         imageCount = swapChainSupport.capabilities.minImageCount;
@@ -283,6 +489,9 @@ void Application::swapChainInit() {
     swapchainCreateInfo.imageColorSpace = surfaceFormat.colorSpace;
     swapchainCreateInfo.minImageCount = imageCount;
     swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    chooseSceneTarget(surfaceFormat.format, swapChainSupport.capabilities.supportedUsageFlags);
+    if(usesSceneTarget()) //resolve или blit сцены в изображение цепочки
+        swapchainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
     QueueFamilyIndices indices = findQueueFamilies(_physicalDevice, _surface);
     uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
@@ -301,11 +510,18 @@ void Application::swapChainInit() {
     swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR; //не используем альфа канал для смешивания с другими окнами
 
     swapchainCreateInfo.presentMode = presentMode;
+    utils::log(utils::Verbosity::Verbose) << "Политика вывода: " << toString(_pacer.getPolicy()) << ", режим " << presentMode
+                                          << ", изображений не меньше " << imageCount << std::endl;
     swapchainCreateInfo.clipped = true; //нас не волнует цвет затемненных пикселей другим окном
-    swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE; //ссылка на предыдущий общект цепочки обмена
+    //при пересоздании драйвер может переиспользовать ресурсы старой цепочки; она живёт, пока её изображения
+    //могут использовать кадры в полёте
+    swapchainCreateInfo.oldSwapchain = _swapchain;
 
-    if(vkCreateSwapchainKHR(_device, &swapchainCreateInfo, nullptr, &_swapchain) != VK_SUCCESS)
+    VkSwapchainKHR swapchain;
+    if(vkCreateSwapchainKHR(_device, &swapchainCreateInfo, nullptr, &swapchain) != VK_SUCCESS)
         throw std::runtime_error("Не удалось создать swapchain");
+    _deletionQueue.retire(_frameNumber, std::move(_swapchain));
+    _swapchain = UniqueSwapchainKHR(_device, swapchain);
 
     //получаем дескрипторы изображений цепочки обмена
     vkGetSwapchainImagesKHR(_device, _swapchain, &imageCount, nullptr);
@@ -316,6 +532,79 @@ void Application::swapChainInit() {
     _swapchainExtent = extent;
 }
 
+//изображения, принадлежащие устройству, вместо изображений цепочки обмена
+void Application::offscreenInit() {
+    const uint32_t imageCount = _framesInFlight; //по изображению на слот кадра, слоты не ждут друг друга
+
+    _swapchainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    _swapchainExtent = { static_cast<uint32_t>(extentWidth), static_cast<uint32_t>(extentHeight) };
+    chooseSceneTarget(_swapchainImageFormat, VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+    _swapchainImages.resize(imageCount);
+    _offscreenImages.resize(imageCount);
+    _offscreenImageAllocations.resize(imageCount);
+    for(uint32_t i = 0; i < imageCount; i++) {
+        VkImageCreateInfo imageCreateInfo {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = _swapchainImageFormat;
+        imageCreateInfo.extent = { _swapchainExtent.width, _swapchainExtent.height, 1 };
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        //рисуем, принимаем resolve или blit сцены и копируем в буфер для чтения
+        imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if(vkCreateImage(_device, &imageCreateInfo, nullptr, &_swapchainImages[i]) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать offscreen изображение!");
+        _offscreenImages[i] = UniqueImage(_device, _swapchainImages[i]);
+
+        _offscreenImageAllocations[i] = UniqueAllocation(&_allocator, _allocator.allocateForImage(
+            _swapchainImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, imageCreateInfo.tiling));
+    }
+}
+
+//при пересоздании цепочки решение повторяется для нового формата; сообщения - только об изменениях
+void Application::chooseSceneTarget(VkFormat format, VkImageUsageFlags backbufferUsage) {
+    const bool initial = _renderPass == VK_NULL_HANDLE;
+    const VkSampleCountFlagBits previousSamples = _sceneSamples;
+    const bool previousScaling = _sceneScaling;
+    const bool transferDst = (backbufferUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0;
+
+    //биты framebufferColorSampleCounts равны числу выборок
+    const VkSampleCountFlags supportedSamples = getDeviceProperties().limits.framebufferColorSampleCounts;
+    _sceneSamples = VK_SAMPLE_COUNT_1_BIT;
+    for(uint32_t samples = VK_SAMPLE_COUNT_64_BIT; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1)
+        if(samples <= _requestedSamples && (supportedSamples & samples)) {
+            _sceneSamples = static_cast<VkSampleCountFlagBits>(samples);
+            break;
+        }
+    if(_sceneSamples != VK_SAMPLE_COUNT_1_BIT && !transferDst) {
+        if(initial)
+            utils::log() << "MSAA выключено: изображения кадра не принимают resolve" << std::endl;
+        _sceneSamples = VK_SAMPLE_COUNT_1_BIT;
+    }
+
+    //растяжение сцены - blit с линейной фильтрацией между изображениями формата кадра
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &formatProperties);
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+                                            | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    const bool blitSupported = transferDst && (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+    _sceneScaling = _dynamicResolution && blitSupported;
+    if(_dynamicResolution && !blitSupported && initial)
+        utils::log() << "Динамическое разрешение выключено: формат кадра не поддерживает blit с фильтрацией" << std::endl;
+    if(_sceneScaling && !_resolution.isEnabled())
+        _resolution.configure(_resolutionConfig);
+
+    if((initial && usesSceneTarget()) || _sceneSamples != previousSamples || _sceneScaling != previousScaling)
+        utils::log() << "Сцена: MSAA " << _sceneSamples << "x, динамическое разрешение "
+                     << (_sceneScaling ? "включено" : "выключено") << std::endl;
+}
+
 void Application::imageViewsInit() {
     _swapchainImageViews.resize(_swapchainImages.size());
     for(size_t i = 0; i < _swapchainImages.size(); i++) {
@@ -336,148 +625,173 @@ void Application::imageViewsInit() {
         createInfo.subresourceRange.baseMipLevel = 0;
         createInfo.subresourceRange.levelCount = 1;
         createInfo.subresourceRange.baseArrayLayer = 0;
-        createInfo.subresourceRange.levelCount = 1;
+        createInfo.subresourceRange.layerCount = 1;
 
-        if(vkCreateImageView(_device, &createInfo, nullptr, &_swapchainImageViews[i]) != VK_SUCCESS)
+        VkImageView imageView;
+        if(vkCreateImageView(_device, &createInfo, nullptr, &imageView) != VK_SUCCESS)
             throw std::runtime_error("не удалось создать представление изображения цепочки обмена");
+        _swapchainImageViews[i] = UniqueImageView(_device, imageView);
     }
 }
 
-void Application::graphicsPipelineInit() {
-    auto vertShaderCode = utils::readFile("../shaders/shader.vert");
-    auto fragShaderCode = utils::readFile("../shaders/shader.frag");
-
-    std::cout << vertShaderCode.size() << " байт (вершинный шейдер)" << std::endl;
-    std::cout << fragShaderCode.size() << " байт (фрагментный шейдер)" << std::endl;
-
-    VkShaderModule vertShaderModule = createShaderModule(_device, vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(_device, fragShaderCode);
-
-    //вершинный шейдер
-    VkPipelineShaderStageCreateInfo vertShaderCreateInfo {};
-    vertShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderCreateInfo.module = vertShaderModule;
-    vertShaderCreateInfo.pName = "main"; //определяем точку входа
-
+//модули живут в кэше до уничтожения устройства и переиспользуются другими конвейерами. Загруженный модуль
+//запоминается по имени: задачи конвейеров получают то, что прочитала (или скомпилировала) задача шейдера
+VkShaderModule Application::loadShader(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(_loadedShadersMutex);
+        auto found = _loadedShaders.find(name);
+        if(found != _loadedShaders.end())
+            return found->second;
+    }
 
-    //фрагментный шейдер
-    VkPipelineShaderStageCreateInfo fragShaderCreateInfo {};
-    vertShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    vertShaderCreateInfo.module = fragShaderModule;
-    vertShaderCreateInfo.pName = "main"; //определяем точку входа
+    VkShaderModule shaderModule;
+    if(_shaderHotReload) { //компилируем исходник GLSL прямо в процессе, .spv не нужен
+        std::vector<uint32_t> spirv = _shaderCompiler.compileFile(_shaderDirectory + "/" + name);
+        shaderModule = _shaderModules.get({ spirv.data(), spirv.size() * sizeof(uint32_t) });
+    } else {
+        shaderModule = _shaderModules.load(_shaderDirectory + "/" + name + ".spv");
+    }
 
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderCreateInfo, fragShaderCreateInfo };
+    std::lock_guard<std::mutex> lock(_loadedShadersMutex);
+    _loadedShaders.emplace(name, shaderModule);
+    return shaderModule;
+}
 
-    //описываем входные вершины с учётом того, что передавать их не будем
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 0; //вершины
-    vertexInputInfo.pVertexBindingDescriptions = nullptr;
-    vertexInputInfo.vertexAttributeDescriptionCount = 0; //аттрибуты вершин
-    vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+//наборы дескрипторов и кольцо uniform данных кадра; ресурсы регистрируются в них по мере создания
+void Application::descriptorsInit() {
+    _descriptors.init(_physicalDevice, _device, _descriptorModel, _framesInFlight);
+    _uniforms.init(_physicalDevice, _device, _allocator, 256 * 1024, _framesInFlight);
+    _descriptors.setFrameUniforms(_uniforms.getBuffer(), _uniforms.getRange());
 
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo {};
-    inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; //без переиспользования вершин (EBO)
-    inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+    utils::log() << "Дескрипторы: " << toString(_descriptorModel) << ", буферов " << _descriptors.getBufferCapacity()
+                 << ", текстур " << _descriptors.getTextureCapacity() << std::endl;
+}
 
+void Application::texturesInit() {
+    TextureStreamer::Config config;
+    config.physicalDevice = _physicalDevice;
+    config.device = _device;
+    config.frameSlots = _framesInFlight;
+    config.memoryBudget = _memoryBudgetSupported;
+    config.budget = _textureBudget;
+    _textures.init(config, _allocator, _descriptors, _deletionQueue);
+
+    for(const auto& path : _texturePaths)
+        _sceneTextures.push_back(_textures.load(path));
+    if(!_sceneTextures.empty())
+        utils::log() << "Текстур: " << _sceneTextures.size() << ", бюджет " << (_textures.getBudget() >> 20) << " МБ"
+                     << (_memoryBudgetSupported ? " (VK_EXT_memory_budget)" : "") << std::endl;
+}
 
-    VkViewport viewport {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(_swapchainExtent.width);
-    viewport.height = static_cast<float>(_swapchainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
+//белая заглушка спрайтов без текстуры - первая текстура TextureStreamer
+void Application::spritesInit() {
+    SpriteBatch::Config config;
+    config.device = _device;
+    config.frameSlots = _framesInFlight;
+    config.capacity = _spriteCapacity;
+    config.fallbackTexture = _textures.getFallbackDescriptorIndex();
+    config.textureConstantOffset = offsetof(DrawConstants, texture);
+    config.constantStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; //диапазон DrawConstants
+    _sprites.init(config, _allocator);
+    spritePipelinesInit();
+}
 
-    //обрезает часть фреймбуфера (настроен по размеру на весь холст, без обрезки)
-    VkRect2D scissor {}; //ножницы
-    scissor.offset = {0, 0};
-    scissor.extent = _swapchainExtent;
+void Application::spritePipelinesInit() {
+    VkShaderModule vertShaderModule = loadShader("sprite.vert");
+    VkShaderModule fragShaderModule = loadShader("sprite.frag");
+    for(uint32_t blend = 0; blend < static_cast<uint32_t>(SpriteBlend::Count); blend++)
+        _spritePipelines[blend] = _pipelines.request(spritePipelineKey(vertShaderModule, fragShaderModule,
+                                                                        static_cast<SpriteBlend>(blend)));
+}
 
-    //настраиваем параметры, которые не будут статичными
-    std::vector<VkDynamicState> dynamicStates = {
-            VK_DYNAMIC_STATE_VIEWPORT, //динамическое изменение вьюпорта
-            VK_DYNAMIC_STATE_SCISSOR   //динамическое изменение обрезки вьюпорта
-    };
-    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo {};
-    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
-
-    VkPipelineViewportStateCreateInfo viewportState {};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    //viewportState.pViewports = &viewport; /* ----- раскомментировать для не динамического использования ----- */
-    viewportState.scissorCount = 1;
-    //viewportState.pScissors = &scissor;   /* ----- раскомментировать для не динамического использования ----- */
-
-    VkPipelineRasterizationStateCreateInfo rasterizer {}; //преобразовывает данные из вершинного шейдера во фрагменты
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = false; //прикрепление фрагмента к плоскости обрезания, не отбрасываение
-    rasterizer.rasterizerDiscardEnable = false; //геометрия не передается через растеризатор (отключает вывод в фреймбуфер)
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    //rasterizer.lineWidth = 1.0f; /* для любого режима, кроме заполнения (fill) */
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT; //отбраковываем задние грани
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE; //лицевая сторона по часовой стрелке
-
-    rasterizer.depthBiasEnable = false;
-    rasterizer.depthBiasConstantFactor = 0.0f; //опционально (2 поля ниже тоже)
-    rasterizer.depthBiasClamp = 0.0f;
-    rasterizer.depthBiasSlopeFactor = 0.0f;
-
-    VkPipelineMultisampleStateCreateInfo multisampling {}; //мультисемплинг отключён
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = false;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading = 1.0; //опционально (3 поля ниже тоже)
-    multisampling.pSampleMask = nullptr;
-    multisampling.alphaToCoverageEnable = false;
-    multisampling.alphaToOneEnable = false;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment {}; //смешивание цветов (что есть в фреймбуфере + цвет фрагмента)
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA; //опционально если смешивание выключено (5 полей ниже тоже)
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA; //коэффициент смешивания равен 1 - альфа канал
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; //альфу не меняем В)
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo {};
-    colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlendCreateInfo.logicOpEnable = VK_FALSE;
-    colorBlendCreateInfo.logicOp = VK_LOGIC_OP_COPY;
-    colorBlendCreateInfo.attachmentCount = 1;
-    colorBlendCreateInfo.pAttachments = &colorBlendAttachment;
-    colorBlendCreateInfo.blendConstants[0] = 0.0f; //опционально (3 поля ниже тоже)
-    colorBlendCreateInfo.blendConstants[1] = 0.0f;
-    colorBlendCreateInfo.blendConstants[2] = 0.0f;
-    colorBlendCreateInfo.blendConstants[3] = 0.0f;
+void Application::computeInit() {
+    _compute.init(_physicalDevice, _device, _computeFamily, _computeQueue, _allocator, _pipelineCache.get());
+}
 
+void Application::pipelineLayoutInit() {
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo {};
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.setLayoutCount = 0; //опционально (3 поля ниже тоже)
-    pipelineLayoutCreateInfo.pSetLayouts = nullptr;
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
-
-    if(vkCreatePipelineLayout(_device, &pipelineLayoutCreateInfo, nullptr, &_pipelineLayout) != VK_SUCCESS)
+    VkPushConstantRange drawRange {}; //DrawConstants
+    drawRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    drawRange.offset = 0;
+    drawRange.size = sizeof(DrawConstants);
+
+    pipelineLayoutCreateInfo.setLayoutCount = BindlessDescriptors::getSetLayoutCount(); //массивы ресурсов и данные кадра
+    pipelineLayoutCreateInfo.pSetLayouts = _descriptors.getSetLayouts();
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &drawRange;
+
+    VkPipelineLayout pipelineLayout;
+    if(vkCreatePipelineLayout(_device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
         throw std::runtime_error("Не удалось создать VkPipelineLayout!");
+    _pipelineLayout = UniquePipelineLayout(_device, pipelineLayout);
+}
 
+//базовые specialization constants всех вариантов - размеры массивов дескрипторов
+void Application::pipelineLibraryInit() {
+    PipelineLibrary::Config config;
+    config.device = _device;
+    config.cache = _pipelineCache.get();
+    config.baseSpecialization = _descriptors.getSpecializationInfo();
+    _pipelines.init(config);
+}
+
+void Application::graphicsPipelineInit() {
+    //модули уже загружены задачами шейдеров, от которых зависит эта задача: GLSL не компилируется повторно
+    VkShaderModule vertShaderModule = loadShader("shader.vert");
+    VkShaderModule fragShaderModule = loadShader("shader.frag");
+    _scenePipeline = _pipelines.request(scenePipelineKey(vertShaderModule, fragShaderModule));
+}
+
+void Application::pipelinesInit() {
+    auto pipelineStart = std::chrono::steady_clock::now();
+    _pipelines.prewarm(&_jobs);
+    if(_spriteCapacity > 0)
+        for(uint32_t blend = 0; blend < static_cast<uint32_t>(SpriteBlend::Count); blend++)
+            _sprites.setPipeline(static_cast<SpriteBlend>(blend), _pipelines.get(_spritePipelines[blend]));
 
+    utils::log() << "Графические конвейеры (" << _pipelines.getStats().created << ") созданы за "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count()
+              << " мс (кэш " << (_pipelineCache.isWarm() ? "тёплый" : "холодный") << ")" << std::endl;
+}
 
-    vkDestroyShaderModule(_device, vertShaderModule, nullptr);
-    vkDestroyShaderModule(_device, fragShaderModule, nullptr);
+//вариант без текстур не делает выборку из заглушки; набор текстур сцены задаётся до init
+PipelineKey Application::scenePipelineKey(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule) {
+    PipelineKey key;
+    key.vertexShader = vertShaderModule;
+    key.fragmentShader = fragShaderModule;
+    key.layout = _pipelineLayout;
+    key.renderPass = _renderPass;
+    //привязки и атрибуты вершин выводятся из расположения вершин меша
+    key.vertexInput = _pipelines.addVertexInput(_mesh.layout.inputDescription(sceneAttributes));
+    key.state = pipelineStates::scene.withSamples(_sceneSamples);
+    key.constants.set(sceneTexturedConstant, _texturePaths.empty() ? 0 : 1);
+    return key;
 }
 
+//раскладка сцены, вершины SpriteVertex; режимы различаются только смешиванием
+PipelineKey Application::spritePipelineKey(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, SpriteBlend blend) {
+    PipelineKey key;
+    key.vertexShader = vertShaderModule;
+    key.fragmentShader = fragShaderModule;
+    key.layout = _pipelineLayout;
+    key.renderPass = _overlayRenderPass; //совместим с проходом "sprites": отличается только loadOp
+    key.vertexInput = _pipelines.addVertexInput(SpriteBatch::inputDescription());
+    key.state = blend == SpriteBlend::Additive ? pipelineStates::additiveOverlay : pipelineStates::overlay;
+    return key;
+}
+
+//прототипы проходов "scene" и "sprites" для создания конвейеров: совместимость проходов определяют только
+//форматы и число выборок вложений. Без MSAA проходы совместимы, но создаются оба
 void Application::renderPassInit() {
+    _renderPass = UniqueRenderPass(_device, createColorRenderPass(_sceneSamples));
+    _overlayRenderPass = UniqueRenderPass(_device, createColorRenderPass(VK_SAMPLE_COUNT_1_BIT));
+}
+
+VkRenderPass Application::createColorRenderPass(VkSampleCountFlagBits samples) {
     VkAttachmentDescription colorAttachment {};
     colorAttachment.format = _swapchainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.samples = samples;
 
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -486,7 +800,8 @@ void Application::renderPassInit() {
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    //в headless режиме после прохода изображение копируется в буфер для чтения
+    colorAttachment.finalLayout = _headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentReference {};
     colorAttachmentReference.attachment = 0;
@@ -504,41 +819,1599 @@ void Application::renderPassInit() {
     renderPassCreateInfo.subpassCount = 1;
     renderPassCreateInfo.pSubpasses = &subpass;
 
-    if(vkCreateRenderPass(_device, &renderPassCreateInfo, nullptr, &_renderPass) != VK_SUCCESS)
+    VkRenderPass renderPass;
+    if(vkCreateRenderPass(_device, &renderPassCreateInfo, nullptr, &renderPass) != VK_SUCCESS)
         throw std::runtime_error("Не удалось создать проход рендеринга!");
+    return renderPass;
 }
 
-void Application::init(Window& window)
-{
-    baseInit();
-    physicalDeviceInit();
+//кадр целиком: отсечение на GPU и сцена в изображение кадра. В режиме отсечения на CPU сцена не читает
+//косвенные команды, и граф сам отбрасывает проход отсечения
+void Application::renderGraphInit() {
+    auto graph = std::make_unique<RenderGraph>(_device, _allocator);
+    const bool gpuCulling = usesGpuCulling();
+
+    ResourceState backbufferInitial {};
+    ResourceState backbufferFinal {};
+    if(_headless) { //после кадра изображение копируется в буфер для чтения
+        backbufferFinal.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        backbufferFinal.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        backbufferFinal.access = VK_ACCESS_TRANSFER_READ_BIT;
+    } else {
+        //отправка кадра ждёт imageAvailable на этой стадии, переход layout должен идти после ожидания
+        backbufferInitial.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        backbufferFinal.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        backbufferFinal.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    }
+    _backbuffer = graph->importImage("backbuffer", _swapchainImageFormat, _swapchainExtent, backbufferInitial, backbufferFinal);
+
+    //буферы слота кадра: прошлое использование слота завершено до ожидания его забора
+    RenderResource drawCommands = graph->importBuffer("drawCommands");
+    RenderResource drawCount = graph->importBuffer("drawCount");
+
+    if(_gpuCulling)
+        graph->addPass("culling", [&](RenderGraph::PassBuilder& pass) {
+            pass.writeBuffer(drawCommands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            pass.writeBuffer(drawCount, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+        }, [this](VkCommandBuffer commandBuffer, const RenderGraph::PassContext&) {
+            uint32_t zone = _profiler.beginGpuZone(commandBuffer, "culling");
+            recordCulling(*_recording.frame, commandBuffer);
+            _profiler.endGpuZone(commandBuffer, zone);
+        });
+
+    //с MSAA или динамическим разрешением сцена рисуется в своё изображение размера кадра
+    //и переносится в изображение кадра до спрайтов: они всегда в полном разрешении и без MSAA
+    RenderResource sceneColor = _backbuffer;
+    if(usesSceneTarget())
+        sceneColor = graph->createImage("sceneColor", { _swapchainImageFormat, _swapchainExtent, _sceneSamples });
+
+    graph->addPass("scene", [&](RenderGraph::PassBuilder& pass) {
+        pass.writeColor(sceneColor);
+        if(gpuCulling) {
+            pass.readBuffer(drawCommands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+            pass.readBuffer(drawCount, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+        }
+    }, [this](VkCommandBuffer commandBuffer, const RenderGraph::PassContext& context) {
+        recordScene(commandBuffer, context);
+    });
+
+    RenderResource scaledColor = sceneColor; //одна выборка, разрешение сцены
+    if(_sceneSamples != VK_SAMPLE_COUNT_1_BIT) {
+        //без масштабирования resolve сразу в изображение кадра
+        RenderResource resolved = _sceneScaling
+            ? graph->createImage("sceneResolved", { _swapchainImageFormat, _swapchainExtent, VK_SAMPLE_COUNT_1_BIT })
+            : _backbuffer;
+        graph->addPass("resolve", [&](RenderGraph::PassBuilder& pass) {
+            pass.readImage(sceneColor, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            pass.writeImage(resolved, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        }, [this, sceneColor, resolved](VkCommandBuffer commandBuffer, const RenderGraph::PassContext&) {
+            recordResolve(commandBuffer, sceneColor, resolved);
+        });
+        scaledColor = resolved;
+    }
+    if(_sceneScaling)
+        graph->addPass("upscale", [&](RenderGraph::PassBuilder& pass) {
+            pass.readImage(scaledColor, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            pass.writeImage(_backbuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        }, [this, scaledColor](VkCommandBuffer commandBuffer, const RenderGraph::PassContext&) {
+            recordUpscale(commandBuffer, scaledColor);
+        });
+
+    //отдельным проходом: сцена может записываться во вторичные буферы, спрайты - всегда в первичный
+    if(_spriteCapacity > 0)
+        graph->addPass("sprites", [&](RenderGraph::PassBuilder& pass) {
+            pass.writeColor(_backbuffer, VK_ATTACHMENT_LOAD_OP_LOAD);
+        }, [this](VkCommandBuffer commandBuffer, const RenderGraph::PassContext& context) {
+            recordSprites(commandBuffer, context);
+        });
+
+    graph->compile();
+    graph->printDebug(utils::log(utils::Verbosity::Verbose));
+    _renderGraph = std::move(graph);
+    _graphGpuCulling = gpuCulling;
+    //размер, заданный setSceneExtent, сохраняется, пока помещается в кадр
+    if(_sceneExtentPinned)
+        _sceneExtent = { std::min(_sceneExtent.width, _swapchainExtent.width), std::min(_sceneExtent.height, _swapchainExtent.height) };
+    else
+        _sceneExtent = _sceneScaling ? _resolution.scaleExtent(_swapchainExtent) : _swapchainExtent;
+}
 
-    if(!glfwVulkanSupported())
-    throw std::runtime_error("glfw не поддерживает Vulkan");
+//граф может использоваться кадрами в полёте: уничтожается вместе с ними
+void Application::retireRenderGraph() {
+    _deletionQueue.retire(_frameNumber, std::move(_renderGraph));
+}
 
-    if(glfwCreateWindowSurface(_instance, window.getWindow(), nullptr, &_surface) != VK_SUCCESS)
-        throw std::runtime_error("Невозможно получить поверхность окна");
+void Application::commandPoolInit() {
+    QueueFamilyIndices indices = findQueueFamilies(_physicalDevice, _surface);
+
+    VkCommandPoolCreateInfo poolCreateInfo {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; //буферы команд перезаписываются каждый кадр
+    poolCreateInfo.queueFamilyIndex = indices.graphicsFamily.value();
+
+    VkCommandPool commandPool;
+    if(vkCreateCommandPool(_device, &poolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать пул команд!");
+    _commandPool = UniqueCommandPool(_device, commandPool);
+}
+
+void Application::readbackInit() {
+    VkDeviceSize size = static_cast<VkDeviceSize>(_swapchainExtent.width) * _swapchainExtent.height * 4;
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать буфер для чтения кадра!");
+    _readbackBuffer.buffer = UniqueBuffer(_device, buffer);
+
+    //блоки host visible памяти отображены аллокатором постоянно
+    _readbackBuffer.allocation = UniqueAllocation(&_allocator, _allocator.allocateForBuffer(
+        buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+
+    VkCommandBufferAllocateInfo allocateInfo {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = _commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+
+    if(vkAllocateCommandBuffers(_device, &allocateInfo, &_readbackCommandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось выделить буфер команд!");
+
+    VkFenceCreateInfo fenceCreateInfo {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    if(vkCreateFence(_device, &fenceCreateInfo, nullptr, &fence) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать забор!");
+    _readbackFence = UniqueFence(_device, fence);
+}
+
+void Application::uploadsInit() {
+    UploadQueue::Config config;
+    config.device = _device;
+    config.queue = _transferQueue;
+    config.queueFamily = _transferFamily;
+    config.graphicsFamily = _graphicsFamily;
+    config.timelineSemaphores = _timelineSemaphores;
+    config.stagingSize = stagingRingSize;
+    _uploads.init(config, _allocator);
+}
+
+void Application::immediateSubmit(const std::function<void(VkCommandBuffer)>& record) {
+    VkCommandBufferAllocateInfo allocateInfo {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = _commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if(vkAllocateCommandBuffers(_device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось выделить буфер команд!");
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    record(commandBuffer);
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось записать буфер команд!");
+
+    VkFenceCreateInfo fenceCreateInfo {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if(vkCreateFence(_device, &fenceCreateInfo, nullptr, &fence) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать забор!");
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    VkResult result = vkQueueSubmit(_graphicsQueue, 1, &submitInfo, fence);
+    if(result == VK_SUCCESS)
+        vkWaitForFences(_device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+    vkDestroyFence(_device, fence, nullptr);
+    vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+    if(result != VK_SUCCESS)
+        throw std::runtime_error("Не удалось отправить буфер команд!");
+}
+
+UploadTicket Application::uploadToBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size,
+                                         VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    //копирование идёт на очереди передачи; очередь графики захватывает буфер в первом кадре после завершения
+    UploadTicket ticket = _uploads.uploadBuffer(buffer, offset, data, size, dstStage, dstAccess);
+    _lastUpload = std::max(_lastUpload, ticket.value);
+    return ticket;
+}
+
+void Application::finishUploads() {
+    //сцена загружается параллельно на очереди передачи; первый кадр должен видеть её целиком
+    _uploads.wait(UploadTicket { _lastUpload });
+    immediateSubmit([&](VkCommandBuffer commandBuffer) {
+        _uploads.recordAcquires(commandBuffer);
+    });
+}
+
+GpuMesh Application::uploadMesh(const MeshData& mesh) {
+    GpuMesh gpuMesh;
+    gpuMesh.layout = mesh.layout;
+    gpuMesh.vertexCount = mesh.vertexCount;
+    gpuMesh.indexCount = mesh.indexCount;
+    gpuMesh.indexType = mesh.indexType;
+    gpuMesh.submeshes = mesh.submeshes;
+    std::copy(mesh.boundsMin, mesh.boundsMin + 3, gpuMesh.boundsMin);
+    std::copy(mesh.boundsMax, mesh.boundsMax + 3, gpuMesh.boundsMax);
+    gpuMesh.indexOffset = (mesh.verticesSize + 15) / 16 * 16;
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = gpuMesh.indexOffset + mesh.indicesSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать буфер меша!");
+    gpuMesh.buffer.buffer = UniqueBuffer(_device, buffer);
+    gpuMesh.buffer.allocation = UniqueAllocation(&_allocator, _allocator.allocateForBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+
+    const VkAccessFlags vertexAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+    uploadToBuffer(gpuMesh.buffer, 0, mesh.vertices, mesh.verticesSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, vertexAccess);
+    uploadToBuffer(gpuMesh.buffer, gpuMesh.indexOffset, mesh.indices, mesh.indicesSize, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, vertexAccess);
+    return gpuMesh;
+}
+
+//треугольник, раньше зашитый в shader.vert: позиция и цвет вперемешку
+const float triangleVertices[] = {
+     0.0f, -0.5f, 0.0f,   1.0f, 0.0f, 0.0f,
+     0.5f,  0.5f, 0.0f,   0.0f, 1.0f, 0.0f,
+    -0.5f,  0.5f, 0.0f,   0.0f, 0.0f, 1.0f,
+};
+const uint16_t triangleIndices[] = { 0, 1, 2 };
+
+void Application::meshInit() {
+    auto loadStart = std::chrono::steady_clock::now();
+
+    MeshFile file;
+    MeshData triangle;
+    const MeshData* mesh = &triangle;
+    if(_meshPath.empty()) {
+        triangle.layout = VertexLayout(VertexPosition | VertexColor, true);
+        triangle.vertexCount = 3;
+        triangle.indexCount = 3;
+        triangle.indexType = VK_INDEX_TYPE_UINT16;
+        triangle.vertices = triangleVertices;
+        triangle.verticesSize = sizeof(triangleVertices);
+        triangle.indices = triangleIndices;
+        triangle.indicesSize = sizeof(triangleIndices);
+        triangle.boundsMin[0] = -0.5f; triangle.boundsMin[1] = -0.5f;
+        triangle.boundsMax[0] = 0.5f; triangle.boundsMax[1] = 0.5f;
+    } else {
+        file.open(_meshPath);
+        mesh = &file.data();
+    }
+
+    if(!mesh->layout.has(sceneAttributes))
+        throw std::runtime_error("В меше нет позиций и цветов, которые читает shader.vert: " + _meshPath);
+
+    _mesh = uploadMesh(*mesh);
+
+    if(!_meshPath.empty())
+        utils::log() << "Меш " << _meshPath << " (" << _mesh.vertexCount << " вершин, " << _mesh.indexCount / 3
+                  << " треугольников) загружен за "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count()
+                  << " мс" << std::endl;
+}
+
+//копии меша сеткой g x g, каждая уменьшена до своей ячейки; одна отрисовка - исходный размер
+void Application::drawListInit() {
+    const uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(_drawCount))));
+    const float cell = 2.0f / static_cast<float>(gridSize);
+
+    //сфера вокруг границ меша; у копии она смещается и масштабируется так же, как вершины в shader.vert
+    float center[3], radius = 0.0f;
+    for(int axis = 0; axis < 3; axis++) {
+        center[axis] = (_mesh.boundsMin[axis] + _mesh.boundsMax[axis]) * 0.5f;
+        float half = (_mesh.boundsMax[axis] - _mesh.boundsMin[axis]) * 0.5f;
+        radius += half * half;
+    }
+    radius = std::sqrt(radius);
+
+    _drawList.resize(_drawCount);
+    _objectSpheres.resize(_drawCount);
+    for(uint32_t i = 0; i < _drawCount; i++) {
+        DrawItem& item = _drawList[i];
+        item.offset[0] = -1.0f + cell * (static_cast<float>(i % gridSize) + 0.5f);
+        item.offset[1] = -1.0f + cell * (static_cast<float>(i / gridSize) + 0.5f);
+        item.scale = 1.0f / static_cast<float>(gridSize);
+        item.padding = 0.0f;
+        item.sphere[0] = center[0] * item.scale + item.offset[0];
+        item.sphere[1] = center[1] * item.scale + item.offset[1];
+        item.sphere[2] = center[2] * item.scale;
+        item.sphere[3] = radius * item.scale;
+        _objectSpheres.set(i, item.sphere[0], item.sphere[1], item.sphere[2], item.sphere[3]);
+    }
+}
+
+//буфер объектов нужен обоим путям (шейдер читает DrawItem по gl_InstanceIndex), остальное - только отсечению на GPU
+void Application::cullingInit() {
+    if(_cullingMode == CullingMode::Gpu && !_indirectCountSupported)
+        throw std::runtime_error("Отсечение на GPU недоступно: нет VK_KHR_draw_indirect_count, multiDrawIndirect или drawIndirectFirstInstance");
+    _gpuCulling = _cullingMode != CullingMode::Cpu && _indirectCountSupported;
+
+    const uint32_t objectCount = static_cast<uint32_t>(_drawList.size());
+    auto createBuffer = [this](VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                               AllocationStrategy strategy = AllocationStrategy::General) {
+        VkBufferCreateInfo bufferCreateInfo {};
+        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferCreateInfo.size = size;
+        bufferCreateInfo.usage = usage;
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer;
+        if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать буфер отсечения!");
+        AllocatedBuffer allocated;
+        allocated.buffer = UniqueBuffer(_device, buffer);
+        allocated.allocation = UniqueAllocation(&_allocator, _allocator.allocateForBuffer(buffer, properties, strategy));
+        return allocated;
+    };
+
+    //подсетки в виде, удобном шейдеру; меш без подсеток рисуется одной
+    struct GpuSubmesh {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+        uint32_t padding;
+    };
+    std::vector<GpuSubmesh> submeshes;
+    for(const auto& submesh : _mesh.submeshes)
+        submeshes.push_back({ submesh.firstIndex, submesh.indexCount, submesh.vertexOffset, 0 });
+    if(submeshes.empty())
+        submeshes.push_back({ 0, _mesh.indexCount, 0, 0 });
+    _submeshCount = static_cast<uint32_t>(submeshes.size());
+
+    VkDeviceSize objectsSize = sizeof(DrawItem) * objectCount;
+    _objectBuffer = createBuffer(objectsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    uploadToBuffer(_objectBuffer, 0, _drawList.data(), objectsSize,
+                   VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    _objectBufferIndex = _descriptors.registerBuffer(_objectBuffer); //шейдер сцены читает его по индексу из DrawConstants
+
+    VkDeviceSize submeshesSize = sizeof(GpuSubmesh) * submeshes.size();
+    //мелкие буферы на всё время работы - в пуле, а не отдельными участками TLSF
+    _submeshBuffer = createBuffer(submeshesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationStrategy::Pool);
+    uploadToBuffer(_submeshBuffer, 0, submeshes.data(), submeshesSize,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    //0 - объекты, 1 - подсетки, 2 - команды, 3 - счётчик отрисовок
+    VkDescriptorSetLayoutBinding bindings[4] {};
+    for(uint32_t i = 0; i < 4; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo {};
+    setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutCreateInfo.bindingCount = 4;
+    setLayoutCreateInfo.pBindings = bindings;
+
+    VkDescriptorSetLayout setLayout;
+    if(vkCreateDescriptorSetLayout(_device, &setLayoutCreateInfo, nullptr, &setLayout) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать раскладку набора дескрипторов!");
+    _sceneSetLayout = UniqueDescriptorSetLayout(_device, setLayout);
+
+    VkDescriptorPoolSize poolSize {};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 4 * _framesInFlight;
+
+    VkDescriptorPoolCreateInfo poolCreateInfo {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.maxSets = _framesInFlight;
+    poolCreateInfo.poolSizeCount = 1;
+    poolCreateInfo.pPoolSizes = &poolSize;
+
+    VkDescriptorPool descriptorPool;
+    if(vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать пул дескрипторов!");
+    _descriptorPool = UniqueDescriptorPool(_device, descriptorPool);
+
+    const VkDeviceSize commandsSize = sizeof(VkDrawIndexedIndirectCommand) * objectCount * _submeshCount;
+    for(auto& frame : _frames) {
+        CullingFrame& culling = frame.culling;
+
+        VkDescriptorSetAllocateInfo allocateInfo {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = _descriptorPool;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = _sceneSetLayout.address();
+
+        if(vkAllocateDescriptorSets(_device, &allocateInfo, &culling.descriptorSet) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось выделить набор дескрипторов!");
+
+        //при отсечении на CPU буферы команд не нужны: привязки 1-3 указывают на буфер подсеток, чтобы набор был полным
+        VkDescriptorBufferInfo bufferInfos[4] {};
+        bufferInfos[0] = { _objectBuffer, 0, VK_WHOLE_SIZE };
+        bufferInfos[1] = { _submeshBuffer, 0, VK_WHOLE_SIZE };
+        bufferInfos[2] = bufferInfos[1];
+        bufferInfos[3] = bufferInfos[1];
+
+        if(_gpuCulling) {
+            culling.drawCommands = createBuffer(commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            culling.drawCount = createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+                                                               | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationStrategy::Pool);
+            culling.statsReadback = createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                 AllocationStrategy::Pool);
+
+            bufferInfos[2] = { culling.drawCommands, 0, VK_WHOLE_SIZE };
+            bufferInfos[3] = { culling.drawCount, 0, VK_WHOLE_SIZE };
+        }
+
+        VkWriteDescriptorSet writes[4] {};
+        for(uint32_t i = 0; i < 4; i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = culling.descriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo = &bufferInfos[i];
+        }
+        vkUpdateDescriptorSets(_device, 4, writes, 0, nullptr);
+    }
+
+    utils::log() << (_gpuCulling ? "Отсечение объектов на GPU, косвенные отрисовки со счётчиком" : "Отсечение объектов на CPU") << std::endl;
+}
+
+//отложенная задача: пока конвейер компилируется, кадры отсекаются на CPU
+void Application::cullPipelineInit() {
+    if(!_gpuCulling)
+        return;
+
+    VkPushConstantRange cullingRange {}; //CullingConstants
+    cullingRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    cullingRange.offset = 0;
+    cullingRange.size = sizeof(CullingConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = _sceneSetLayout.address();
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &cullingRange;
+
+    VkPipelineLayout pipelineLayout;
+    if(vkCreatePipelineLayout(_device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать VkPipelineLayout отсечения!");
+    _cullPipelineLayout = UniquePipelineLayout(_device, pipelineLayout);
+
+    VkComputePipelineCreateInfo pipelineCreateInfo {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineCreateInfo.stage.module = loadShader("cull.comp");
+    pipelineCreateInfo.stage.pName = "main";
+    pipelineCreateInfo.layout = _cullPipelineLayout;
+
+    VkPipeline pipeline;
+    if(vkCreateComputePipelines(_device, _pipelineCache.get(), 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать конвейер отсечения!");
+    _cullPipeline = UniquePipeline(_device, pipeline);
+
+    _cullPipelineReady.store(true, std::memory_order_release);
+    utils::log(utils::Verbosity::Verbose) << "Конвейер отсечения готов" << std::endl;
+}
+
+void Application::syncObjectsInit() {
+    _frames.resize(_framesInFlight);
+
+    std::vector<VkCommandBuffer> commandBuffers(_framesInFlight);
 
-    glfwGetFramebufferSize(window.getWindow(), &extentWidth, &extentHeight);
+    VkCommandBufferAllocateInfo allocateInfo {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = _commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = _framesInFlight;
+
+    if(vkAllocateCommandBuffers(_device, &allocateInfo, commandBuffers.data()) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось выделить буферы команд кадров!");
+
+    VkSemaphoreCreateInfo semaphoreCreateInfo {};
+    semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkFenceCreateInfo fenceCreateInfo {};
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; //первое ожидание каждого слота не должно блокироваться
+
+    QueueFamilyIndices indices = findQueueFamilies(_physicalDevice, _surface);
+
+    VkCommandPoolCreateInfo poolCreateInfo {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; //сбрасываются целиком каждый кадр
+    poolCreateInfo.queueFamilyIndex = indices.graphicsFamily.value();
+
+    for(uint32_t i = 0; i < _framesInFlight; i++) {
+        _frames[i].commandBuffer = commandBuffers[i];
+
+        _frames[i].workers.resize(_jobs.getWorkerCount());
+        for(auto& commands : _frames[i].workers) {
+            VkCommandPool pool;
+            if(vkCreateCommandPool(_device, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+                throw std::runtime_error("Не удалось создать пул команд исполнителя!");
+            commands.pool = UniqueCommandPool(_device, pool);
+        }
+
+        VkFence fence;
+        if(vkCreateFence(_device, &fenceCreateInfo, nullptr, &fence) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать забор кадра!");
+        _frames[i].inFlight = UniqueFence(_device, fence);
+
+        if(!_headless) {
+            VkSemaphore semaphore;
+            if(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &semaphore) != VK_SUCCESS)
+                throw std::runtime_error("Не удалось создать семафор кадра!");
+            _frames[i].imageAvailable = UniqueSemaphore(_device, semaphore);
+        }
+    }
+
+    imageSyncInit();
+}
+
+//по изображению swapchain: пересоздаются вместе с цепочкой
+void Application::imageSyncInit() {
+    if(!_headless) {
+        VkSemaphoreCreateInfo semaphoreCreateInfo {};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        _renderFinished.resize(_swapchainImages.size());
+        for(auto& renderFinished : _renderFinished) {
+            VkSemaphore semaphore;
+            if(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &semaphore) != VK_SUCCESS)
+                throw std::runtime_error("Не удалось создать семафор кадра!");
+            renderFinished = UniqueSemaphore(_device, semaphore);
+        }
+    }
+
+    _imagesInFlight.assign(_swapchainImages.size(), VK_NULL_HANDLE);
+}
+
+//без vkDeviceWaitIdle: новая цепочка создаётся из старой (oldSwapchain), а старые изображения, их представления,
+//фреймбуферы и семафоры уничтожаются, когда завершатся все кадры, которые могли их использовать
+bool Application::recreateSwapchain() {
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(_window->getWindow(), &width, &height);
+    if(width == 0 || height == 0) //окно свёрнуто: рисовать некуда, пересоздадим после разворачивания
+        return false;
+    extentWidth = width;
+    extentHeight = height;
+
+    if(_surfaceLost)
+        recreateSurface();
+
+    const VkExtent2D previousExtent = _swapchainExtent;
+    const VkFormat previousFormat = _swapchainImageFormat;
+    const VkSampleCountFlagBits previousSamples = _sceneSamples;
+
+    //в порядке уничтожения: фреймбуферы графа ссылаются на представления, представления - на изображения цепочки.
+    //Саму цепочку swapChainInit выводит из работы после создания новой
+    retireRenderGraph();
+    _deletionQueue.retire(_frameNumber, std::move(_swapchainImageViews));
+    _deletionQueue.retire(_frameNumber, std::move(_renderFinished));
+    _swapchainImageViews.clear();
+    _renderFinished.clear();
 
-    logicalDeviceInit();
     swapChainInit();
+
+    if(_swapchainImageFormat != previousFormat || _sceneSamples != previousSamples) {
+        //формат меняется только вместе с устройством вывода, а с ним и поддержка MSAA: проходы рендера
+        //и конвейеры зависят от них, старые дорабатывают в кадрах в полёте
+        _deletionQueue.retire(_frameNumber, _pipelines.takeAll());
+        _deletionQueue.retire(_frameNumber, std::move(_renderPass));
+        _deletionQueue.retire(_frameNumber, std::move(_overlayRenderPass));
+        renderPassInit();
+        graphicsPipelineInit();
+        if(_spriteCapacity > 0)
+            spritePipelinesInit();
+        pipelinesInit();
+        if(_hotReload)
+            setReloadTargets();
+    }
+
     imageViewsInit();
-    renderPassInit();
-    graphicsPipelineInit();
+    renderGraphInit();
+    imageSyncInit();
+    _swapchainDirty = false;
+
+    //viewport и scissor динамические, поэтому от размера зависят только граф кадра и его фреймбуферы
+    if(_swapchainExtent.width != previousExtent.width || _swapchainExtent.height != previousExtent.height)
+        utils::log(utils::Verbosity::Verbose) << "Swapchain пересоздан: " << _swapchainExtent.width << "x"
+                                              << _swapchainExtent.height << std::endl;
+    return true;
+}
+
+//surface потерян (сменился дисплей, перезапуск композитора): старые цепочки держат surface, поэтому без ожидания не обойтись
+void Application::recreateSurface() {
+    vkDeviceWaitIdle(_device);
+
+    _deletionQueue.flush();
+    _renderGraph.reset(); //фреймбуферы графа ссылаются на представления изображений
+    _swapchainImageViews.clear();
+    _renderFinished.clear();
+    _swapchain.reset();
+    _surface.reset();
+
+    VkSurfaceKHR surface;
+    if(glfwCreateWindowSurface(_instance, _window->getWindow(), nullptr, &surface) != VK_SUCCESS)
+        throw std::runtime_error("Невозможно получить поверхность окна");
+    _surface = UniqueSurfaceKHR(_instance, surface);
+
+    VkBool32 presentSupport = false;
+    vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, _presentFamily, _surface, &presentSupport);
+    if(!presentSupport)
+        throw std::runtime_error("Новая поверхность окна не поддерживает презентацию из выбранной очереди");
+
+    _surfaceLost = false;
+}
+
+void Application::recordCommandBuffer(FrameData& frame, uint32_t imageIndex, uint32_t rangeCount) {
+    VkCommandBuffer commandBuffer = frame.commandBuffer;
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; //буфер перезаписывается каждый кадр
+
+    if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось начать запись буфера команд!");
+
+    //буферы, загруженные через очередь передачи с прошлого кадра, переходят во владение очереди графики
+    frame.uploadWait = _uploads.recordAcquires(commandBuffer);
+    _profiler.resetQueries(commandBuffer);
+    _textures.record(commandBuffer); //копирования уровней текстур до проходов, которые их читают
+
+    //барьеры между проходами и переходы layout изображения кадра расставляет граф
+    _recording.frame = &frame;
+    _recording.rangeCount = rangeCount;
+    _recording.frameUniforms = _uniforms.push(FrameUniforms { _viewProjection }).offset;
+    _recording.sceneTexture = _sceneTextures.empty() ? _textures.getFallbackDescriptorIndex()
+                                                     : _textures.getDescriptorIndex(_sceneTextures.front());
+    _renderGraph->setImportedImage(_backbuffer, _swapchainImages[imageIndex], _swapchainImageViews[imageIndex]);
+    _renderGraph->execute(commandBuffer);
+
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось записать буфер команд!");
+}
+
+void Application::recordScene(VkCommandBuffer commandBuffer, const RenderGraph::PassContext& graphContext) {
+    FrameData& frame = *_recording.frame;
+    //при динамическом разрешении проход рисует и очищает только угол изображения сцены
+    RenderGraph::PassContext context = graphContext;
+    context.beginInfo.renderArea.extent = _sceneExtent;
+
+    if(_graphGpuCulling) {
+        //число вызовов CPU не зависит от числа объектов: отсечение и команды отрисовки целиком на GPU
+        uint32_t sceneZone = _profiler.beginGpuZone(commandBuffer, "scene");
+        _profiler.beginStatistics(commandBuffer);
+        vkCmdBeginRenderPass(commandBuffer, &context.beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        bindScene(commandBuffer);
+        const uint32_t maxDraws = static_cast<uint32_t>(_drawList.size()) * _submeshCount;
+        _cmdDrawIndexedIndirectCount(commandBuffer, frame.culling.drawCommands, 0, frame.culling.drawCount, 0,
+                                     maxDraws, sizeof(VkDrawIndexedIndirectCommand));
+        if(_capture)
+            _capture->addCommand(CaptureCommandType::DrawIndirectCount, _scenePipeline, maxDraws);
+        vkCmdEndRenderPass(commandBuffer);
+        _profiler.endStatistics(commandBuffer);
+        _profiler.endGpuZone(commandBuffer, sceneZone);
+        return;
+    }
+
+    _profiler.beginCpuZone("cpu culling");
+    _visibleObjects.clear();
+    utils::cullSpheres(_objectSpheres, utils::extractFrustum(_viewProjection), _visibleObjects);
+    _profiler.endCpuZone();
+    _cullStats.visible = static_cast<uint32_t>(_visibleObjects.size());
+    _cullStats.culled = static_cast<uint32_t>(_drawList.size()) - _cullStats.visible;
+
+    const uint32_t drawCount = static_cast<uint32_t>(_visibleObjects.size());
+    const uint32_t rangeCount = std::min(_recording.rangeCount, drawCount);
+    if(_capture) //от разбиения на диапазоны по потокам команды не зависят
+        _capture->addInstances(_scenePipeline, _visibleObjects, _submeshCount);
+
+    //метки времени нельзя писать в первичный буфер внутри прохода со вторичными буферами - зона снаружи прохода
+    uint32_t sceneZone = _profiler.beginGpuZone(commandBuffer, "scene");
+    _profiler.beginStatistics(commandBuffer);
+    if(rangeCount <= 1 || drawCount < parallelRecordingThreshold) {
+        vkCmdBeginRenderPass(commandBuffer, &context.beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        recordDraws(commandBuffer, 0, drawCount);
+    } else {
+        //каждый диапазон отрисовок записывается во вторичный буфер своим исполнителем,
+        //первичный буфер выполняет их в исходном порядке
+        vkCmdBeginRenderPass(commandBuffer, &context.beginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        std::vector<VkCommandBuffer> secondary(rangeCount);
+        _jobs.parallelFor(drawCount, rangeCount, [&](uint32_t begin, uint32_t end, uint32_t range, uint32_t worker) {
+            Profiler::CpuScope zone(_profiler, "record draws");
+            secondary[range] = beginSecondary(frame.workers[worker], context);
+            recordDraws(secondary[range], begin, end);
+            vkEndCommandBuffer(secondary[range]);
+        });
+        vkCmdExecuteCommands(commandBuffer, rangeCount, secondary.data());
+    }
+    vkCmdEndRenderPass(commandBuffer);
+    _profiler.endStatistics(commandBuffer);
+    _profiler.endGpuZone(commandBuffer, sceneZone);
+}
+
+void Application::recordSprites(VkCommandBuffer commandBuffer, const RenderGraph::PassContext& context) {
+    uint32_t zone = _profiler.beginGpuZone(commandBuffer, "sprites");
+    vkCmdBeginRenderPass(commandBuffer, &context.beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    _descriptors.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, _recording.frameUniforms);
+
+    VkViewport viewport {};
+    viewport.width = static_cast<float>(_swapchainExtent.width);
+    viewport.height = static_cast<float>(_swapchainExtent.height);
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor {};
+    scissor.extent = _swapchainExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    _sprites.record(commandBuffer, _pipelineLayout);
+    vkCmdEndRenderPass(commandBuffer);
+    if(_capture) {
+        const SpriteStats& stats = _sprites.getStats();
+        _capture->addCommand(CaptureCommandType::Sprites, stats.sprites, stats.batches, stats.pipelineBinds);
+    }
+    _profiler.endGpuZone(commandBuffer, zone);
+}
+
+//MSAA: усреднение выборок занятого угла сцены; без масштабирования target - изображение кадра того же размера
+void Application::recordResolve(VkCommandBuffer commandBuffer, RenderResource source, RenderResource target) {
+    uint32_t zone = _profiler.beginGpuZone(commandBuffer, "resolve");
+    VkImageResolve region {};
+    region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.extent = { _sceneExtent.width, _sceneExtent.height, 1 };
+    vkCmdResolveImage(commandBuffer, _renderGraph->getImage(source), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                      _renderGraph->getImage(target), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    if(_capture)
+        _capture->addCommand(CaptureCommandType::Resolve, _sceneExtent.width, _sceneExtent.height);
+    _profiler.endGpuZone(commandBuffer, zone);
+}
+
+//угол сцены растягивается на всё изображение кадра с билинейной фильтрацией
+void Application::recordUpscale(VkCommandBuffer commandBuffer, RenderResource source) {
+    uint32_t zone = _profiler.beginGpuZone(commandBuffer, "upscale");
+    VkImageBlit region {};
+    region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.srcOffsets[1] = { static_cast<int32_t>(_sceneExtent.width), static_cast<int32_t>(_sceneExtent.height), 1 };
+    region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.dstOffsets[1] = { static_cast<int32_t>(_swapchainExtent.width), static_cast<int32_t>(_swapchainExtent.height), 1 };
+
+    vkCmdBlitImage(commandBuffer, _renderGraph->getImage(source), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   _renderGraph->getImage(_backbuffer), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region,
+                   VK_FILTER_LINEAR);
+    if(_capture)
+        _capture->addCommand(CaptureCommandType::Upscale, _sceneExtent.width, _sceneExtent.height,
+                             _swapchainExtent.width, _swapchainExtent.height);
+    _profiler.endGpuZone(commandBuffer, zone);
+}
+
+//общее состояние отрисовки сцены для первичного и вторичных буферов; вторичные его не наследуют.
+//Отрисовки внутри не меняют ни наборы, ни push constants: объект выбирается через firstInstance
+void Application::bindScene(VkCommandBuffer commandBuffer) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelines.get(_scenePipeline));
+    _descriptors.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, _recording.frameUniforms);
+
+    DrawConstants constants {};
+    constants.objects = _objectBufferIndex;
+    constants.texture = _recording.sceneTexture;
+    vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(constants), &constants);
+
+    //вьюпорт и ножницы объявлены динамическими в graphicsPipelineInit; сцена - в разрешении кадра
+    VkViewport viewport {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(_sceneExtent.width);
+    viewport.height = static_cast<float>(_sceneExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor {};
+    scissor.offset = {0, 0};
+    scissor.extent = _sceneExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    _mesh.bind(commandBuffer, sceneAttributes);
+}
+
+//вызывается из потоков исполнителей: читает только неизменяемое во время записи состояние
+void Application::recordDraws(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end) {
+    bindScene(commandBuffer);
+    for(uint32_t i = begin; i < end; i++)
+        _mesh.draw(commandBuffer, _visibleObjects[i]);
+}
+
+void Application::recordCulling(FrameData& frame, VkCommandBuffer commandBuffer) {
+    CullingFrame& culling = frame.culling;
+    const uint32_t objectCount = static_cast<uint32_t>(_drawList.size());
+
+    //результат прошлого кадра этого слота: забор уже пройден, копия счётчика видна CPU
+    if(culling.submitted) {
+        uint32_t drawCount = *static_cast<const uint32_t*>(culling.statsReadback.allocation.get().mapped);
+        _cullStats.visible = drawCount / _submeshCount;
+        _cullStats.culled = objectCount - _cullStats.visible;
+    }
+    culling.submitted = true;
+
+    vkCmdFillBuffer(commandBuffer, culling.drawCount, 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier resetBarrier {};
+    resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+    CullingConstants constants {};
+    utils::Frustum frustum = utils::extractFrustum(_viewProjection);
+    for(int i = 0; i < 6; i++)
+        for(int j = 0; j < 4; j++)
+            constants.planes[i][j] = frustum.planes[i][j];
+    constants.objectCount = objectCount;
+    constants.submeshCount = _submeshCount;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipelineLayout, 0, 1, &culling.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, _cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (objectCount + 63) / 64, 1, 1);
+    if(_capture)
+        _capture->addCommand(CaptureCommandType::Dispatch, (objectCount + 63) / 64, 1, 1);
+
+    //копия счётчика для статистики - внутри прохода; барьер перед косвенными отрисовками ставит граф кадра
+    VkMemoryBarrier cullBarrier {};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy copy {};
+    copy.size = sizeof(uint32_t);
+    vkCmdCopyBuffer(commandBuffer, culling.drawCount, culling.statsReadback, 1, &copy);
+
+    VkMemoryBarrier hostBarrier {};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &hostBarrier, 0, nullptr, 0, nullptr);
+}
+
+VkCommandBuffer Application::beginSecondary(WorkerCommands& commands, const RenderGraph::PassContext& context) {
+    if(commands.used == commands.secondary.size()) {
+        VkCommandBufferAllocateInfo allocateInfo {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = commands.pool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if(vkAllocateCommandBuffers(_device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось выделить вторичный буфер команд!");
+        commands.secondary.push_back(commandBuffer);
+    }
+    VkCommandBuffer commandBuffer = commands.secondary[commands.used++];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = context.renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = context.framebuffer;
+    inheritanceInfo.pipelineStatistics = _profiler.getStatisticFlags(); //запрос статистики активен в первичном буфере
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось начать запись вторичного буфера команд!");
+    return commandBuffer;
+}
+
+//только после ожидания забора слота: GPU больше не выполняет его вторичные буферы
+void Application::resetWorkerCommands(FrameData& frame) {
+    for(auto& commands : frame.workers) {
+        if(commands.used == 0)
+            continue;
+        vkResetCommandPool(_device, commands.pool, 0); //сброс пула целиком дешевле сброса каждого буфера
+        commands.used = 0;
+    }
+}
+
+//замеряется только запись вторичных буферов прохода "scene" тем же кодом, что и в кадре. Первичный буфер не
+//записывается: загрузки, текстуры, отсечение на GPU и захват кадров не видят замера, следующий кадр идёт как обычно
+void Application::benchmarkRecording(uint32_t iterations, std::ostream& out) {
+    vkDeviceWaitIdle(_device); //пулы исполнителей слота 0 сбрасываются, их буферы не должны выполняться
+    FrameData& frame = _frames[0];
+
+    //кадровый буфер в наследовании необязателен: вторичные буферы не выполняются
+    RenderGraph::PassContext context {};
+    context.renderPass = _renderPass;
+    context.extent = _sceneExtent;
+
+    const Recording recording = _recording;
+    _recording.frame = &frame;
+    _recording.sceneTexture = _sceneTextures.empty() ? _textures.getFallbackDescriptorIndex()
+                                                     : _textures.getDescriptorIndex(_sceneTextures.front());
+    _visibleObjects.clear();
+    utils::cullSpheres(_objectSpheres, utils::extractFrustum(_viewProjection), _visibleObjects);
+    const uint32_t drawCount = static_cast<uint32_t>(_visibleObjects.size());
+
+    std::vector<uint32_t> threadCounts;
+    for(uint32_t threads = 1; threads < _jobs.getWorkerCount(); threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(_jobs.getWorkerCount());
+
+    out << "Запись " << drawCount << " видимых из " << _drawList.size() << " объектов во вторичные буферы, "
+        << iterations << " итераций:" << std::endl;
+    double baseline = 0.0;
+    for(uint32_t threads : threadCounts) {
+        const uint32_t rangeCount = std::max(1u, std::min(threads == 1 ? 1 : threads * 2, drawCount));
+        std::vector<VkCommandBuffer> secondary(rangeCount);
+        auto start = std::chrono::steady_clock::now();
+        for(uint32_t i = 0; i < iterations; i++) {
+            resetWorkerCommands(frame);
+            //исполнителей не больше threads: задачи берут диапазоны по очереди, остальные потоки простаивают
+            _jobs.parallelFor(drawCount, rangeCount, [&](uint32_t begin, uint32_t end, uint32_t range, uint32_t worker) {
+                secondary[range] = beginSecondary(frame.workers[worker], context);
+                recordDraws(secondary[range], begin, end);
+                vkEndCommandBuffer(secondary[range]);
+            }, threads);
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+        if(threads == 1)
+            baseline = milliseconds;
+
+        out << "  потоков: " << threads << ", " << milliseconds << " мс/кадр, "
+            << static_cast<uint64_t>(drawCount / (milliseconds / 1000.0)) << " объектов/с, ускорение x"
+            << baseline / milliseconds << std::endl;
+    }
+    resetWorkerCommands(frame);
+    _recording = recording;
+}
+
+std::vector<double> Application::benchmarkUploads(VkDeviceSize size, uint32_t iterations) {
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать буфер замера загрузок!");
+    AllocatedBuffer target;
+    target.buffer = UniqueBuffer(_device, buffer);
+    target.allocation = UniqueAllocation(&_allocator, _allocator.allocateForBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+
+    std::vector<uint8_t> data(size);
+    for(size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<uint8_t>(i * 31);
+
+    std::vector<double> milliseconds;
+    for(uint32_t i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        UploadTicket ticket = _uploads.uploadBuffer(buffer, 0, data.data(), size, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                                                    VK_ACCESS_SHADER_READ_BIT);
+        _uploads.wait(ticket);
+        milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+        //захват владения очередью графики вне замера, иначе освобождения копятся до уничтожения буфера
+        immediateSubmit([&](VkCommandBuffer commandBuffer) {
+            _uploads.recordAcquires(commandBuffer);
+        });
+    }
+    return milliseconds;
+}
+
+std::vector<double> Application::benchmarkTransforms(uint32_t nodeCount, uint32_t threads, uint32_t touched, uint32_t iterations) {
+    if(nodeCount == 0)
+        return {};
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = sizeof(glm::mat4) * nodeCount;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать буфер замера преобразований!");
+    AllocatedBuffer target;
+    target.buffer = UniqueBuffer(_device, buffer);
+    target.allocation = UniqueAllocation(&_allocator, _allocator.allocateForBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT));
+    glm::mat4* instances = static_cast<glm::mat4*>(target.allocation.get().mapped);
+
+    //лес из 64 деревьев с четырьмя детьми у узла: около восьми уровней на миллион узлов
+    const uint32_t rootCount = std::min(nodeCount, 64u);
+    TransformHierarchy hierarchy;
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        Transform local;
+        local.translation = glm::vec3(static_cast<float>(i % 7) * 0.1f, static_cast<float>(i % 5) * 0.1f, 0.0f);
+        local.scale = glm::vec3(0.9f);
+        hierarchy.add(i < rootCount ? TransformHierarchy::noParent : (i - rootCount) / 4, local);
+    }
+
+    //свой пул на замер: у _jobs число исполнителей задано при инициализации
+    JobSystem jobs;
+    jobs.init(threads);
+    hierarchy.update(&jobs, instances); //размещение узлов и первый полный пересчёт не замеряются
+    _allocator.flush(target.allocation);
+
+    std::vector<double> milliseconds;
+    for(uint32_t i = 0; i < iterations; i++) {
+        const float angle = 0.01f * static_cast<float>(i + 1);
+        Transform local;
+        local.rotation = glm::quat(std::cos(angle), 0.0f, 0.0f, std::sin(angle));
+        local.scale = glm::vec3(0.9f);
+
+        auto start = std::chrono::steady_clock::now();
+        if(touched == 0)
+            for(NodeId node = 0; node < rootCount; node++)
+                hierarchy.setLocal(node, local);
+        else //мультипликативный хеш разбрасывает затронутые узлы по уровням и поддеревьям
+            for(uint32_t j = 0; j < touched; j++)
+                hierarchy.setLocal(static_cast<NodeId>((static_cast<uint64_t>(j) * 2654435761u + i) % nodeCount), local);
+        hierarchy.update(&jobs, instances);
+        _allocator.flush(target.allocation);
+        milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    jobs.shutdown();
+    return milliseconds;
+}
+
+bool Application::runComputeSamples(std::ostream& out) {
+    samples::PrefixSum prefixSum;
+    prefixSum.init(_compute, loadShader("prefixSum.comp"), loadShader("prefixSumAdd.comp"));
+
+    out << "Вычисления: рабочая группа " << _compute.getLocalSize() << ", семейство очереди " << _computeFamily << std::endl;
+    //длины не кратны рабочей группе, самая длинная требует трёх уровней сканирования
+    bool passed = samples::runPrefixSum(_compute, prefixSum, 1000, out);
+    passed = samples::runPrefixSum(_compute, prefixSum, 3000000, out) && passed;
+    passed = samples::runParticles(_compute, loadShader("particles.comp"), 100000, 120, out) && passed;
+
+    prefixSum.destroy();
+    return passed;
+}
+
+void Application::drawFrame() {
+    //изменение размера окна или SUBOPTIMAL / OUT_OF_DATE прошлого кадра
+    if(!_headless && (_window->consumeResize() || _swapchainDirty || _surfaceLost) && !recreateSwapchain()) {
+        _hasPreviousFrame = false; //время в свёрнутом состоянии не входит в статистику кадров
+        return;
+    }
+
+    auto frameStart = std::chrono::steady_clock::now();
+    if(_hasPreviousFrame)
+        _frameStats.addSample(std::chrono::duration<double, std::milli>(frameStart - _previousFrameStart).count());
+    _previousFrameStart = frameStart;
+    _hasPreviousFrame = true;
+
+    FrameData& frame = _frames[_currentFrame];
+    _profiler.beginFrame(_currentFrame, _frameNumber);
+
+    //ждём только слот, который собираемся переиспользовать; остальные кадры продолжают выполняться на GPU
+    _profiler.beginCpuZone("wait slot");
+    auto waitStart = std::chrono::steady_clock::now();
+    vkWaitForFences(_device, 1, frame.inFlight.address(), VK_TRUE, UINT64_MAX);
+    _pacer.addBlockedTime(std::chrono::steady_clock::now() - waitStart);
+    _profiler.endCpuZone();
+    _profiler.collectSlot();
+    uint64_t gpuFrame = 0;
+    double gpuDuration = 0.0;
+    const bool gpuTimed = _profiler.getLastGpuFrame(gpuFrame, gpuDuration);
+    if(_capture && gpuTimed)
+        _capture->setGpuTime(gpuFrame, gpuDuration / 1000.0);
+    //новый масштаб действует с этого кадра: изображение сцены полного размера, граф не пересобирается.
+    //Размер, заданный setSceneExtent, контроллер не меняет
+    if(_sceneScaling && !_sceneExtentPinned && gpuTimed && _resolution.update(gpuFrame, gpuDuration / 1000.0, _frameNumber)) {
+        _sceneExtent = _resolution.scaleExtent(_swapchainExtent);
+        utils::log(utils::Verbosity::Verbose) << "Разрешение сцены " << _sceneExtent.width << "x" << _sceneExtent.height
+                                              << " (масштаб " << _resolution.getScale() << ")" << std::endl;
+    }
+    _descriptors.beginFrame(_currentFrame, _frameNumber);
+    _uniforms.beginFrame(_currentFrame);
+    _deletionQueue.collect(_frameNumber);
+    if(usesGpuCulling() != _graphGpuCulling) { //конвейер отсечения готов: проход отсечения больше не отбрасывается
+        retireRenderGraph();
+        renderGraphInit();
+    }
+
+    if(_hotReload)
+        applyReloadedPipelines();
+
+    uint32_t imageIndex = _currentFrame; //в headless режиме у каждого слота своё изображение
+    if(!_headless) {
+        Profiler::CpuScope zone(_profiler, "acquire");
+        for(;;) {
+            auto acquireStart = std::chrono::steady_clock::now();
+            VkResult result = vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+            _pacer.addBlockedTime(std::chrono::steady_clock::now() - acquireStart);
+            if(result == VK_SUCCESS)
+                break;
+            if(result == VK_SUBOPTIMAL_KHR) { //изображение всё ещё можно вывести, цепочку пересоздадим к следующему кадру
+                _swapchainDirty = true;
+                break;
+            }
+
+            if(result == VK_ERROR_SURFACE_LOST_KHR)
+                _surfaceLost = true;
+            else if(result != VK_ERROR_OUT_OF_DATE_KHR)
+                throw std::runtime_error("Не удалось получить изображение цепочки обмена!");
+
+            //при ошибке семафор не сигналится и забор слота не сброшен: пересоздаём и получаем изображение заново
+            if(!recreateSwapchain()) {
+                _profiler.endFrame();
+                return;
+            }
+        }
+    }
+
+    //изображение может ещё рисоваться кадром из другого слота, если изображений больше, чем слотов
+    if(_imagesInFlight[imageIndex] != VK_NULL_HANDLE && _imagesInFlight[imageIndex] != frame.inFlight)
+        vkWaitForFences(_device, 1, &_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+    _imagesInFlight[imageIndex] = frame.inFlight;
+
+    //после получения изображения: между выбором уровней текстур и записью кадра выхода из drawFrame нет
+    _textures.beginFrame(_currentFrame, _frameNumber);
+    if(!_sceneTextures.empty())
+        _textures.markUsed(_sceneTextures.front());
+    const bool capturing = _capture && _capture->isCapturing(_frameNumber);
+    if(capturing) //спрайты - до prepare, который очищает список
+        _capture->beginFrame(_frameNumber, _viewProjection, _sceneExtent, _sprites.getPending());
+    if(_spriteCapacity > 0) { //участок вершин слота свободен: забор слота дождались
+        Profiler::CpuScope zone(_profiler, "sprites");
+        _sprites.prepare(_currentFrame, _swapchainExtent);
+    }
+
+    vkResetFences(_device, 1, frame.inFlight.address());
+
+    auto recordStart = std::chrono::steady_clock::now();
+    resetWorkerCommands(frame);
+    vkResetCommandBuffer(frame.commandBuffer, 0);
+    //два диапазона на исполнителя: перехват задач выравнивает нагрузку, если диапазоны неравны по стоимости
+    _profiler.beginCpuZone("record");
+    recordCommandBuffer(frame, imageIndex, _jobs.getWorkerCount() * 2);
+    _profiler.endCpuZone();
+    _uniforms.flush();
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<uint64_t> waitValues; //для бинарных семафоров значение игнорируется
+    if(!_headless) {
+        waitSemaphores.push_back(frame.imageAvailable);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT); //до записи цвета можно выполнять вершинную часть
+        waitValues.push_back(0);
+    }
+    if(frame.uploadWait != 0 && _uploads.usesTimelineSemaphore()) { //захват владения ждёт копирование на очереди передачи
+        waitSemaphores.push_back(_uploads.getTimelineSemaphore());
+        waitStages.push_back(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        waitValues.push_back(frame.uploadWait);
+    }
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    if(_uploads.usesTimelineSemaphore())
+        submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    if(!_headless) {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = _renderFinished[imageIndex].address();
+    }
+
+    if(vkQueueSubmit(_graphicsQueue, 1, &submitInfo, frame.inFlight) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось отправить буфер команд!");
+    _profiler.markSubmitted();
+    _textures.endFrame(_currentFrame);
+    if(capturing)
+        _capture->endFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count());
+
+    if(!_headless) {
+        Profiler::CpuScope zone(_profiler, "present");
+        VkPresentInfoKHR presentInfo {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = _renderFinished[imageIndex].address();
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = _swapchain.address();
+        presentInfo.pImageIndices = &imageIndex;
+
+        VkResult result = vkQueuePresentKHR(_presentQueue, &presentInfo);
+        _pacer.framePresented();
+        if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+            _swapchainDirty = true;
+        else if(result == VK_ERROR_SURFACE_LOST_KHR)
+            _surfaceLost = true;
+        else if(result != VK_SUCCESS)
+            throw std::runtime_error("Не удалось вывести изображение!");
+    }
+
+    if(_frameNumber == 0)
+        utils::log() << "Первый кадр отправлен через "
+                     << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _initStart).count()
+                     << " мс от начала инициализации" << std::endl;
+
+    _lastImageIndex = imageIndex;
+    _currentFrame = (_currentFrame + 1) % _framesInFlight;
+    _frameNumber++;
+    _profiler.endFrame();
+}
+
+//граница кадра: забор текущего слота уже дождались, новый кадр ещё не записан
+void Application::applyReloadedPipelines() {
+    for(const auto& reloaded : _hotReload->takeReady()) {
+        UniquePipeline pipeline(_device, reloaded.pipeline);
+        //собран до пересоздания проходов рендера: вариант с этим id теперь описывает другой ключ или не существует
+        if(reloaded.target >= _pipelines.getVariantCount() || !(_pipelines.getKey(reloaded.target) == reloaded.key))
+            continue;
+
+        //заменённый конвейер последний раз использует кадр _frameNumber - 1
+        _deletionQueue.retire(_frameNumber, _pipelines.replace(reloaded.target, std::move(pipeline)));
+        //пакет спрайтов хранит конвейеры режимов смешивания у себя
+        for(uint32_t blend = 0; _spriteCapacity > 0 && blend < static_cast<uint32_t>(SpriteBlend::Count); blend++)
+            if(_spritePipelines[blend] == reloaded.target)
+                _sprites.setPipeline(static_cast<SpriteBlend>(blend), _pipelines.get(reloaded.target));
+    }
+}
+
+//поток перезагрузки собирает конвейеры по снимкам ключей, а не читает состояние приложения
+void Application::setReloadTargets() {
+    _hotReload->setTargets(_sceneReloadId, { { _scenePipeline, _pipelines.getKey(_scenePipeline) } });
+
+    std::vector<ShaderHotReload::Target> sprites;
+    if(_spriteCapacity > 0)
+        for(PipelineId id : _spritePipelines)
+            sprites.push_back({ id, _pipelines.getKey(id) });
+    _hotReload->setTargets(_spriteReloadId, std::move(sprites));
+}
+
+void Application::setPresentPolicy(PresentPolicy policy, double fpsCap, bool allowTearing) {
+    _pacer.configure(policy, fpsCap);
+    _allowTearing = allowTearing;
+}
+
+void Application::setDynamicResolution(double targetMilliseconds, float minScale) {
+    _dynamicResolution = true;
+    _resolutionConfig.targetMilliseconds = targetMilliseconds;
+    _resolutionConfig.minScale = minScale;
+}
+
+void Application::setSceneExtent(VkExtent2D extent) {
+    if(!_sceneScaling)
+        throw std::runtime_error("Размер сцены задаётся только при динамическом разрешении");
+
+    _sceneExtentPinned = true;
+    _sceneExtent.width = std::clamp(extent.width, 1u, _swapchainExtent.width);
+    _sceneExtent.height = std::clamp(extent.height, 1u, _swapchainExtent.height);
+}
+
+void Application::enableShaderHotReload() {
+    if(!ShaderCompiler::isAvailable())
+        throw std::runtime_error("Горячая перезагрузка шейдеров недоступна: сборка без shaderc");
+
+    _shaderHotReload = true;
+}
+
+void Application::readbackFrame(std::vector<uint8_t>& rgba) {
+    if(!_headless)
+        throw std::runtime_error("readbackFrame доступен только в headless режиме");
+    if(_frameNumber == 0) //изображение кадра ещё в layout UNDEFINED
+        throw std::runtime_error("readbackFrame: ещё не нарисовано ни одного кадра");
+
+    //кадр, нарисованный в _lastImageIndex, должен завершиться до копирования
+    if(_imagesInFlight[_lastImageIndex] != VK_NULL_HANDLE)
+        vkWaitForFences(_device, 1, &_imagesInFlight[_lastImageIndex], VK_TRUE, UINT64_MAX);
+
+    VkCommandBuffer commandBuffer = _readbackCommandBuffer;
+    vkResetCommandBuffer(commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось начать запись буфера команд!");
+
+    //граф кадра оставил изображение в TRANSFER_SRC_OPTIMAL
+    VkBufferImageCopy region {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0; //данные плотно упакованы
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = { _swapchainExtent.width, _swapchainExtent.height, 1 };
+
+    vkCmdCopyImageToBuffer(commandBuffer, _swapchainImages[_lastImageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           _readbackBuffer, 1, &region);
+
+    //делаем запись видимой для чтения с хоста
+    VkBufferMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = _readbackBuffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+
+    if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось записать буфер команд!");
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    vkResetFences(_device, 1, _readbackFence.address());
+    if(vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _readbackFence) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось отправить буфер команд!");
+
+    vkWaitForFences(_device, 1, _readbackFence.address(), VK_TRUE, UINT64_MAX);
+
+    size_t size = static_cast<size_t>(_swapchainExtent.width) * _swapchainExtent.height * 4;
+    rgba.resize(size);
+    std::memcpy(rgba.data(), _readbackBuffer.allocation.get().mapped, size);
+}
+
+//после инициализации: настройки и ресурсы, от которых зависит кадр. Отложенные задачи дожидаемся: иначе первые кадры
+//отсекались бы на CPU или на GPU в зависимости от того, как быстро скомпилировался конвейер отсечения
+void Application::captureInit() {
+    _initGraph->waitDeferred();
+
+    CaptureConfig config;
+    config.width = _swapchainExtent.width;
+    config.height = _swapchainExtent.height;
+    config.framesInFlight = _framesInFlight;
+    config.samples = _sceneSamples;
+    config.drawCount = _drawCount;
+    config.gpuCulling = usesGpuCulling();
+    config.sceneScaling = _sceneScaling;
+    config.descriptorModel = static_cast<uint32_t>(_descriptorModel);
+    config.spriteCapacity = _spriteCapacity;
+    config.textureBudget = _textures.getBudget();
+    config.device = getDeviceProperties().deviceName;
+    _capture->setConfig(config);
+
+    const uint32_t variants = _pipelines.getVariantCount();
+    for(PipelineId id = 0; id < variants; id++) {
+        const PipelineKey key = _pipelines.getKey(id);
+        _capture->addPipeline({ id, key.state, key.constants });
+    }
+
+    if(!_capture->wantsResources())
+        return;
+    if(!_meshPath.empty())
+        _capture->addResourceFile(CaptureResourceType::Mesh, "mesh.vmesh", _meshPath);
+    for(const auto& path : _texturePaths)
+        _capture->addResourceFile(CaptureResourceType::Texture, path, path);
+
+    std::vector<std::string> shaders = { "shader.vert", "shader.frag" };
+    if(_spriteCapacity > 0)
+        shaders.insert(shaders.end(), { "sprite.vert", "sprite.frag" });
+    if(_gpuCulling)
+        shaders.push_back("cull.comp");
+    for(const auto& name : shaders) {
+        if(!_shaderHotReload) {
+            _capture->addResourceFile(CaptureResourceType::Shader, name, _shaderDirectory + "/" + name + ".spv");
+            continue;
+        }
+        //.spv может не быть или отставать от исходника: пишем то, что компилирует процесс
+        std::vector<uint32_t> spirv = _shaderCompiler.compileFile(_shaderDirectory + "/" + name);
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(spirv.data());
+        _capture->addResource(CaptureResourceType::Shader, name,
+                              std::vector<uint8_t>(bytes, bytes + spirv.size() * sizeof(uint32_t)));
+    }
+}
+
+void Application::setFramesInFlight(uint32_t count) {
+    if(_device != VK_NULL_HANDLE)
+        throw std::runtime_error("Количество кадров в полёте задаётся до инициализации");
+
+    _framesInFlight = std::max(count, 1u);
+}
+
+void Application::init(Window& window)
+{
+    _initStart = std::chrono::steady_clock::now();
+    if(!glfwVulkanSupported())
+        throw std::runtime_error("glfw не поддерживает Vulkan");
+
+    _window = &window;
+    glfwGetFramebufferSize(window.getWindow(), &extentWidth, &extentHeight); //только из главного потока
+    runInitGraph(&window);
+
+    if(_shaderHotReload) {
+        _hotReload = std::make_unique<ShaderHotReload>(_shaderCompiler, _shaderModules, _pipelines);
+        _sceneReloadId = _hotReload->track("shader.vert", "shader.frag");
+        _spriteReloadId = _hotReload->track("sprite.vert", "sprite.frag");
+        setReloadTargets();
+        _hotReload->start(_shaderDirectory);
+    }
+}
+
+void Application::initHeadless(uint32_t width, uint32_t height)
+{
+    _initStart = std::chrono::steady_clock::now();
+    _headless = true;
+    extentWidth = static_cast<int>(width);
+    extentHeight = static_cast<int>(height);
+
+    runInitGraph(nullptr);
+}
+
+//window == nullptr - headless
+void Application::runInitGraph(Window* window)
+{
+    _jobs.init(_workerThreads);
+    _deletionQueue.init(_framesInFlight);
+    _initGraph = std::make_unique<InitGraph>(_profiler);
+    InitGraph& graph = *_initGraph;
+    using TaskId = InitGraph::TaskId;
+
+    TaskId instance = graph.add("baseInit", [this] { baseInit(); });
+    TaskId surface = instance;
+    if(window) //surface нужен до выбора устройства: поддержка презентации входит в оценку
+        surface = graph.add("surface", [this, window] {
+            VkSurfaceKHR surface;
+            if(glfwCreateWindowSurface(_instance, window->getWindow(), nullptr, &surface) != VK_SUCCESS)
+                throw std::runtime_error("Невозможно получить поверхность окна");
+            _surface = UniqueSurfaceKHR(_instance, surface);
+        }, { instance });
+    TaskId physicalDevice = graph.add("physicalDeviceInit", [this] { physicalDeviceInit(); }, { surface });
+    TaskId device = graph.add("logicalDeviceInit", [this] { logicalDeviceInit(); }, { physicalDevice });
+
+    TaskId memory = graph.add("deviceMemory", [this] {
+        _profiler.init(_physicalDevice, _device, _graphicsFamily, _framesInFlight, _pipelineStatistics);
+        _allocator.init(_physicalDevice, _device);
+        uploadsInit();
+    }, { device });
+    TaskId pipelineCache = graph.add("pipelineCache", [this] {
+        _pipelineCache.init(_physicalDevice, _device, _pipelineCacheDirectory);
+    }, { device });
+
+    //чтение (или компиляция GLSL) шейдеров независимо; модули остаются в кэше до создания конвейеров
+    TaskId shaderModules = graph.add("shaderModules", [this] { _shaderModules.init(_device); }, { device });
+    TaskId vertShader = graph.add("shader.vert", [this] { loadShader("shader.vert"); }, { shaderModules });
+    TaskId fragShader = graph.add("shader.frag", [this] { loadShader("shader.frag"); }, { shaderModules });
+    TaskId spriteVertShader = graph.add("sprite.vert", [this] {
+        if(_spriteCapacity > 0)
+            loadShader("sprite.vert");
+    }, { shaderModules });
+    TaskId spriteFragShader = graph.add("sprite.frag", [this] {
+        if(_spriteCapacity > 0)
+            loadShader("sprite.frag");
+    }, { shaderModules });
+    TaskId cullShader = graph.add("cull.comp", [this] {
+        if(_cullingMode != CullingMode::Cpu && _indirectCountSupported)
+            loadShader("cull.comp");
+    }, { shaderModules });
+
+    TaskId images = window ? graph.add("swapChainInit", [this] { swapChainInit(); }, { device })
+                           : graph.add("offscreenInit", [this] { offscreenInit(); }, { memory });
+    TaskId imageViews = graph.add("imageViewsInit", [this] { imageViewsInit(); }, { images });
+    TaskId renderPass = graph.add("renderPassInit", [this] { renderPassInit(); }, { images });
+
+    //пул команд не потокобезопасен: его пользователи идут цепочкой syncObjectsInit -> finishUploads -> readbackInit
+    TaskId commandPool = graph.add("commandPoolInit", [this] { commandPoolInit(); }, { device });
+    TaskId syncObjects = graph.add("syncObjectsInit", [this] { syncObjectsInit(); }, { commandPool, images });
+
+    TaskId mesh = graph.add("meshInit", [this] { meshInit(); }, { memory });
+    TaskId drawList = graph.add("drawListInit", [this] { drawListInit(); }, { mesh });
+    TaskId descriptors = graph.add("descriptorsInit", [this] { descriptorsInit(); }, { memory });
+    TaskId textures = graph.add("texturesInit", [this] { texturesInit(); }, { descriptors });
+    graph.add("computeInit", [this] { computeInit(); }, { memory, pipelineCache });
+    TaskId culling = graph.add("cullingInit", [this] { cullingInit(); }, { drawList, syncObjects, descriptors });
+    graph.add("renderGraphInit", [this] { renderGraphInit(); }, { imageViews, memory, culling });
+    TaskId uploads = graph.add("finishUploads", [this] { finishUploads(); }, { mesh, culling, syncObjects });
+
+    //раскладке нужны наборы дескрипторов, конвейеру - расположение вершин меша
+    TaskId pipelineLayout = graph.add("pipelineLayoutInit", [this] { pipelineLayoutInit(); }, { descriptors });
+    TaskId pipelineLibrary = graph.add("pipelineLibraryInit", [this] { pipelineLibraryInit(); }, { pipelineCache, descriptors });
+    TaskId scenePipeline = graph.add("graphicsPipelineInit", [this] { graphicsPipelineInit(); },
+                                     { pipelineLibrary, pipelineLayout, renderPass, mesh, vertShader, fragShader });
+    TaskId sprites = graph.add("spritesInit", [this] {
+        if(_spriteCapacity > 0)
+            spritesInit();
+    }, { memory, textures, pipelineLibrary, pipelineLayout, renderPass, spriteVertShader, spriteFragShader });
+    //варианты, зарегистрированные выше, компилируются параллельно
+    graph.add("pipelinesInit", [this] { pipelinesInit(); }, { scenePipeline, sprites });
+
+    if(!window)
+        graph.add("readbackInit", [this] { readbackInit(); }, { uploads, images });
+
+    //первые кадры отсекаются на CPU, пока конвейер отсечения компилируется в фоне
+    graph.addDeferred("cullPipelineInit", [this] { cullPipelineInit(); }, { culling, pipelineCache, cullShader });
+
+    graph.run(_jobs);
+    graph.printReport(utils::log());
+    if(_capture)
+        captureInit();
+    if(_sceneScaling && !_profiler.hasGpuTimestamps())
+        utils::log() << "Нет меток времени GPU: масштаб динамического разрешения не меняется" << std::endl;
+
+    if(!_pipelineCache.isWarm()) //сохраняем сразу, чтобы следующий запуск был тёплым даже после аварийного завершения
+        _pipelineCache.save();
 }
 
 Application::~Application()
 {
-    vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
-    vkDestroyRenderPass(_device, _renderPass, nullptr);
+    if(_initGraph) //отложенные задачи инициализации ещё могут создавать объекты
+        _initGraph->waitDeferred();
 
-    for(auto& imageView : _swapchainImageViews)
-        vkDestroyImageView(_device, imageView, nullptr); //удаление явно созданных image view
+    std::vector<ShaderHotReload::Reloaded> pendingPipelines;
+    if(_hotReload) {
+        _hotReload->stop(); //поток больше не создаёт конвейеры
+        pendingPipelines = _hotReload->takeReady();
+    }
 
-    vkDestroySwapchainKHR(_device, _swapchain, nullptr);
-    vkDestroyDevice(_device, nullptr);
-    vkDestroySurfaceKHR(_instance, _surface, nullptr);
-    vkDestroyInstance(_instance, nullptr);
-    std::cout << "Приложение уничтожено\n";
+    _jobs.shutdown();
+    if(_device != VK_NULL_HANDLE)
+        vkDeviceWaitIdle(_device);
+
+    for(auto& reloaded : pendingPipelines)
+        vkDestroyPipeline(_device, reloaded.pipeline, nullptr);
+    _deletionQueue.flush();
+
+    //у подсистем свои объекты; объекты приложения уничтожают деструкторы членов в порядке, обратном объявлению,
+    //устройство и экземпляр - последними, с отчётом о не уничтоженных дочерних объектах
+    _sprites.destroy();
+    _pipelines.destroy();
+    _textures.destroy();
+    _descriptors.destroy();
+    _uniforms.destroy();
+    _compute.destroy();
+    _uploads.destroy();
+    _profiler.destroy();
+
+    _renderGraph.reset(); //до освобождения памяти временных изображений и представлений изображений кадра
+
+    _pipelineCache.save();
+    _pipelineCache.destroy();
+    _shaderModules.destroy();
+
+    if(_device != VK_NULL_HANDLE)
+        _allocator.printReport(utils::log());
+    utils::log(utils::Verbosity::Verbose) << "Приложение уничтожено\n";
 }
\ No newline at end of file
@@ -2,40 +2,399 @@
 
 #include <optional>
 #include <vector>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <ostream>
+#include <mutex>
+#include <unordered_map>
 #include <vulkan/vulkan.h>
 #include "window.h"
+#include "frameStats.h"
+#include "framePacer.h"
+#include "pipelineCache.h"
+#include "pipelineLibrary.h"
+#include "shaderCache.h"
+#include "shaderCompiler.h"
+#include "shaderHotReload.h"
+#include "memoryAllocator.h"
+#include "uploadQueue.h"
+#include "mesh.h"
+#include "jobSystem.h"
+#include "frustumCulling.h"
+#include "profiler.h"
+#include "initGraph.h"
+#include "renderGraph.h"
+#include "bindlessDescriptors.h"
+#include "uniformRing.h"
+#include "computeContext.h"
+#include "vulkanHandle.h"
+#include "deletionQueue.h"
+#include "textureStreamer.h"
+#include "spriteBatch.h"
+#include "transformHierarchy.h"
+#include "dynamicResolution.h"
+#include "frameCapture.h"
 
 
-class Application 
+//пул команд исполнителя в слоте кадра: пулы не потокобезопасны, поэтому у каждого потока свой
+struct WorkerCommands {
+    UniqueCommandPool pool;
+    std::vector<VkCommandBuffer> secondary; //переиспользуются после vkResetCommandPool
+    uint32_t used = 0;
+};
+
+//буферы отсечения на GPU одного слота кадра: compute шейдер пишет их, пока предыдущий кадр ещё рисует из своих
+struct CullingFrame {
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    AllocatedBuffer drawCommands; //VkDrawIndexedIndirectCommand на каждую видимую подсетку
+    AllocatedBuffer drawCount;
+    AllocatedBuffer statsReadback; //копия drawCount для CPU, читается после забора слота
+    bool submitted = false;
+};
+
+//ресурсы одного кадра "в полёте": пока GPU выполняет кадр N, CPU записывает кадр N + 1 в другой слот
+struct FrameData {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    std::vector<WorkerCommands> workers; //по исполнителю JobSystem
+    CullingFrame culling;
+    uint64_t uploadWait = 0; //значение timeline семафора загрузок, которого ждёт отправка кадра
+    UniqueSemaphore imageAvailable; //изображение получено из swapchain
+    UniqueFence inFlight;           //GPU закончил работу этого слота
+};
+
+//объект сцены - копия меша; элемент буфера объектов (std430), шейдеры выбирают его по gl_InstanceIndex
+struct DrawItem {
+    float offset[2];
+    float scale;
+    float padding;
+    float sphere[4]; //ограничивающая сфера в пространстве сцены: центр и радиус
+};
+
+enum class CullingMode {
+    Auto, //на GPU, если устройство поддерживает косвенные отрисовки со счётчиком
+    Gpu,
+    Cpu,
+};
+
+//uniform данные кадра (set 1), общие для всех отрисовок
+struct FrameUniforms {
+    glm::mat4 viewProjection;
+};
+
+//push constants отрисовки сцены: индексы ресурсов в массивах BindlessDescriptors
+struct DrawConstants {
+    uint32_t objects; //буфер DrawItem
+    uint32_t texture; //текстура сцены; индексы обоих массивов BindlessDescriptors
+};
+
+struct CullStats {
+    uint32_t visible = 0;
+    uint32_t culled = 0;
+};
+
+class Application
 {
 public:
+    void setFramesInFlight(uint32_t count); //вызывать до init
+    void setPipelineCacheDirectory(const std::string& directory) { _pipelineCacheDirectory = directory; }
+    void setShaderDirectory(const std::string& directory) { _shaderDirectory = directory; }
+    void setMeshPath(const std::string& path) { _meshPath = path; } //.vmesh; пусто - встроенный треугольник
+    //до init; .ktx2, уровни догружаются по ходу кадров. Первая текстура накладывается на сцену
+    void addTexture(const std::string& path) { _texturePaths.push_back(path); }
+    void setTextureBudget(VkDeviceSize bytes) { _textureBudget = bytes; } //до init; 0 - по бюджету кучи устройства
+    //до init; проход "sprites" поверх сцены, спрайты добавляются через getSprites() перед каждым drawFrame
+    void enableSprites(uint32_t capacity = 65536) { _spriteCapacity = capacity; }
+    void setWorkerThreads(uint32_t count) { _workerThreads = count; } //0 - по числу аппаратных потоков
+    void setDrawCount(uint32_t count) { _drawCount = std::max(count, 1u); } //копии меша сеткой по экрану
+    void setCullingMode(CullingMode mode) { _cullingMode = mode; }
+    //до init; Bindless без поддержки descriptor indexing заменяется на Pooled
+    void setDescriptorModel(DescriptorModel model) { _descriptorModel = model; }
+    void setViewProjection(const glm::mat4& viewProjection) { _viewProjection = viewProjection; }
+    void enableShaderHotReload(); //GLSL компилируется в процессе, изменения в директории шейдеров подхватываются на лету
+    void enablePipelineStatistics() { _pipelineStatistics = true; } //до init
+    //до init; пригодное устройство этого типа выбирается раньше остальных (CPU - lavapipe, swiftshader)
+    void preferDeviceType(VkPhysicalDeviceType type) { _preferredDeviceType = type; }
+    //до init; fpsCap действует в PowerSaving, allowTearing разрешает IMMEDIATE и FIFO_RELAXED
+    void setPresentPolicy(PresentPolicy policy, double fpsCap = 30.0, bool allowTearing = false);
+    //до init; сцена рисуется в изображение с масштабом от minScale до 1 размера кадра, масштаб подбирается
+    //по времени GPU, кадр растягивается в изображение цепочки. Нужны метки времени GPU
+    void setDynamicResolution(double targetMilliseconds, float minScale = 0.5f);
+    //до init; берётся наибольшее поддерживаемое число не больше samples
+    void setMsaaSamples(uint32_t samples) { _requestedSamples = std::max(samples, 1u); }
+    //до init; кадры с первого записываются в capture, файл сохраняет вызывающая сторона (FrameCapture::save)
+    void setCapture(FrameCapture* capture) { _capture = capture; }
     void init(Window&);
+    void initHeadless(uint32_t width, uint32_t height); //рендер во внутренние изображения устройства, без окна и surface
+
+    //вызывать перед опросом ввода окна: сон по политике вывода
+    void waitForNextFrame() { _pacer.waitForNextFrame(); }
+    void drawFrame();
+
+    //headless: дожидается последнего отрисованного кадра и копирует его в rgba (width * height * 4 байт);
+    //до первого drawFrame бросает исключение
+    void readbackFrame(std::vector<uint8_t>& rgba);
+    //воспроизведение: размер сцены при динамическом разрешении со следующего кадра, контроллер его больше не меняет
+    void setSceneExtent(VkExtent2D extent);
+    VkExtent2D getExtent() const { return _swapchainExtent; }
+    const FrameStats& getFrameStats() const { return _frameStats; }
+    const FramePacer& getFramePacer() const { return _pacer; }
+    const Profiler& getProfiler() const { return _profiler; }
+    const RenderGraph& getRenderGraph() const { return *_renderGraph; }
+    const InitGraph& getInitGraph() const { return *_initGraph; }
+    const PipelineLibrary& getPipelines() const { return _pipelines; }
+    const TextureStreamer& getTextures() const { return _textures; }
+    const DynamicResolution& getDynamicResolution() const { return _resolution; }
+    VkSampleCountFlagBits getMsaaSamples() const { return _sceneSamples; }
+    SpriteBatch& getSprites() { return _sprites; }
+    VkPhysicalDeviceProperties getDeviceProperties() const;
+    const std::string& getPipelineCachePath() const { return _pipelineCache.getPath(); }
+    //при отсечении на GPU значения отстают на число кадров в полёте
+    CullStats getCullStats() const { return _cullStats; }
+    bool isGpuCulling() const { return usesGpuCulling(); }
+
+    //время записи вторичных буферов сцены на 1..N потоках, без отправки на GPU и без следов в следующих кадрах
+    void benchmarkRecording(uint32_t iterations, std::ostream& out);
+    //мс на загрузку size байт через очередь загрузок, от копирования в staging память до завершения передачи
+    std::vector<double> benchmarkUploads(VkDeviceSize size, uint32_t iterations);
+    //мс на TransformHierarchy::update иерархии из nodeCount узлов на threads потоках, матрицы пишутся в host visible
+    //буфер устройства. touched == 0 - меняются корни и пересчитывается вся иерархия, иначе touched узлов вразброс
+    std::vector<double> benchmarkTransforms(uint32_t nodeCount, uint32_t threads, uint32_t touched, uint32_t iterations);
+    //префиксная сумма и частицы на ComputeContext против эталона на CPU; false - расхождение
+    bool runComputeSamples(std::ostream& out);
+    ComputeContext& getCompute() { return _compute; }
+
     ~Application();
 private:
     void baseInit();
     void physicalDeviceInit();
     void logicalDeviceInit();
     void swapChainInit();
+    void offscreenInit();
     void imageViewsInit();
-    void graphicsPipelineInit();
+    void pipelineLibraryInit();
+    void graphicsPipelineInit(); //только регистрирует варианты; создаёт их pipelinesInit
     void renderPassInit();
+    VkRenderPass createColorRenderPass(VkSampleCountFlagBits samples);
+    //число выборок и масштабирование сцены по возможностям устройства и формату кадра
+    void chooseSceneTarget(VkFormat format, VkImageUsageFlags backbufferUsage);
+    bool usesSceneTarget() const { return _sceneScaling || _sceneSamples != VK_SAMPLE_COUNT_1_BIT; }
+    void renderGraphInit();
+    void retireRenderGraph();
+    void commandPoolInit();
+    void readbackInit();
+    void syncObjectsInit();
+    void imageSyncInit();
+    void meshInit();
+    void drawListInit();
+    void cullingInit();
+    void cullPipelineInit();
+    void descriptorsInit();
+    void texturesInit();
+    void spritesInit();
+    void spritePipelinesInit(); //зависит от _overlayRenderPass
+    void pipelinesInit(); //создаёт зарегистрированные варианты параллельно на исполнителях JobSystem
+    void computeInit();
+    void pipelineLayoutInit();
+    void uploadsInit();
+    void runInitGraph(Window* window);
+    void captureInit();
+
+    bool recreateSwapchain(); //false - окно свёрнуто
+    void recreateSurface();
+
+    void recordCommandBuffer(FrameData& frame, uint32_t imageIndex, uint32_t rangeCount);
+    void recordDraws(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end);
+    void recordCulling(FrameData& frame, VkCommandBuffer commandBuffer);
+    bool usesGpuCulling() const { return _gpuCulling && _cullPipelineReady.load(std::memory_order_acquire); }
+    void bindScene(VkCommandBuffer commandBuffer);
+    void recordScene(VkCommandBuffer commandBuffer, const RenderGraph::PassContext& context);
+    void recordSprites(VkCommandBuffer commandBuffer, const RenderGraph::PassContext& context);
+    void recordResolve(VkCommandBuffer commandBuffer, RenderResource source, RenderResource target);
+    void recordUpscale(VkCommandBuffer commandBuffer, RenderResource source);
+    VkCommandBuffer beginSecondary(WorkerCommands& commands, const RenderGraph::PassContext& context);
+    void resetWorkerCommands(FrameData& frame);
+    void applyReloadedPipelines();
+    void setReloadTargets(); //после каждой регистрации вариантов сцены и спрайтов
+
+    //однократная отправка с ожиданием, для загрузок при инициализации
+    void immediateSubmit(const std::function<void(VkCommandBuffer)>& record);
+    UploadTicket uploadToBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size,
+                                VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+    void finishUploads(); //ждёт загрузки инициализации и захватывает буферы очередью графики
+    GpuMesh uploadMesh(const MeshData& mesh);
+
+    VkShaderModule loadShader(const std::string& name); //повторный вызов с тем же именем не читает файл заново
+    PipelineKey scenePipelineKey(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule);
+    PipelineKey spritePipelineKey(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, SpriteBlend blend);
+
+    bool _headless = false;
+
+    //владельцы объектов Vulkan уничтожаются в порядке, обратном объявлению: экземпляр, surface, устройство
+    //и аллокатор объявлены раньше всего, что создаётся от них
+    UniqueInstance _instance;
+    VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+    VkQueue _graphicsQueue = VK_NULL_HANDLE;
+    VkQueue _presentQueue = VK_NULL_HANDLE;
+    VkQueue _transferQueue = VK_NULL_HANDLE; //может совпадать с _graphicsQueue
+    VkQueue _computeQueue = VK_NULL_HANDLE;  //async compute (ComputeContext), может совпадать с _graphicsQueue
+    uint32_t _graphicsFamily = 0;
+    uint32_t _transferFamily = 0;
+    uint32_t _computeFamily = 0;
+    uint32_t _instanceApiVersion = VK_API_VERSION_1_0;
+    bool _timelineSemaphores = false;
 
-    VkInstance _instance;
-    VkPhysicalDevice _physicalDevice;
-    VkDevice _device;
-    VkQueue _graphicsQueue;
-    VkQueue _presentQueue;
+    UniqueSurfaceKHR _surface;
+    UniqueDevice _device;
+    DeviceAllocator _allocator;
 
-    VkSurfaceKHR _surface;
+    Window* _window = nullptr;
+    uint32_t _presentFamily = 0;
+    UniqueSwapchainKHR _swapchain;
+    bool _swapchainDirty = false; //SUBOPTIMAL / OUT_OF_DATE: пересоздать перед следующим кадром
+    bool _surfaceLost = false;
 
-    VkSwapchainKHR _swapchain;
-    std::vector<VkImage> _swapchainImages; //хранит дескрипторы изображений своп чейна
-    std::vector<VkImageView> _swapchainImageViews;
+    //старая цепочка, граф кадра и заменённые конвейеры живут, пока не завершатся кадры, которые могли их использовать
+    DeletionQueue _deletionQueue;
+    std::vector<VkImage> _swapchainImages; //хранит дескрипторы изображений своп чейна (или offscreen изображений в headless режиме)
+    std::vector<UniqueImageView> _swapchainImageViews;
     VkFormat _swapchainImageFormat;
     VkExtent2D _swapchainExtent;
 
-    VkRenderPass _renderPass;
-    VkPipelineLayout _pipelineLayout; //для uniform переменных в шейдерах
+    UploadQueue _uploads; //загрузки данных на GPU через очередь передачи и постоянно отображённый staging буфер
+    uint64_t _lastUpload = 0;
+
+    //offscreen изображения и их память (swapchain владеет своими изображениями сам)
+    std::vector<UniqueAllocation> _offscreenImageAllocations;
+    std::vector<UniqueImage> _offscreenImages;
+
+    AllocatedBuffer _readbackBuffer; //host visible буфер для чтения кадра с GPU
+
+    UniqueCommandPool _commandPool;
+    VkCommandBuffer _readbackCommandBuffer = VK_NULL_HANDLE;
+    UniqueFence _readbackFence;
+
+    uint32_t _framesInFlight = 2;
+    uint32_t _currentFrame = 0;
+    uint32_t _lastImageIndex = 0; //изображение последнего отправленного кадра
+    std::vector<FrameData> _frames;
+    std::vector<UniqueSemaphore> _renderFinished; //по одному на изображение swapchain: презентация держит семафор до повторного получения изображения
+    std::vector<VkFence> _imagesInFlight;     //забор кадра, который сейчас рисует в изображение
+
+    FrameStats _frameStats;
+    FramePacer _pacer;
+    bool _allowTearing = false;
+    Profiler _profiler;
+    std::unique_ptr<InitGraph> _initGraph; //живёт дольше init: отложенные задачи завершаются в фоне
+    std::chrono::steady_clock::time_point _initStart;
+    bool _pipelineStatistics = false;
+    std::optional<VkPhysicalDeviceType> _preferredDeviceType;
+    bool _hasPreviousFrame = false;
+    std::chrono::steady_clock::time_point _previousFrameStart;
+
+    //совместим с проходом "scene" графа кадра; по нему создаются конвейеры, в том числе в потоке горячей перезагрузки,
+    //поэтому он не зависит от пересборки графа
+    UniqueRenderPass _renderPass;
+    UniqueRenderPass _overlayRenderPass; //проход "sprites": всегда в изображение кадра, одна выборка
+    std::unique_ptr<RenderGraph> _renderGraph;
+    RenderResource _backbuffer;
+    bool _graphGpuCulling = false; //граф собран с отсечением на GPU
+
+    //сцена рисуется в отдельное изображение размера кадра, если включено MSAA или динамическое разрешение;
+    //при масштабе меньше 1 занят левый верхний угол _sceneExtent, поэтому смена масштаба не пересобирает граф
+    uint32_t _requestedSamples = 1;
+    VkSampleCountFlagBits _sceneSamples = VK_SAMPLE_COUNT_1_BIT;
+    bool _sceneScaling = false; //динамическое разрешение и blit с фильтрацией в изображение кадра
+    bool _dynamicResolution = false; //запрошено через setDynamicResolution
+    DynamicResolution::Config _resolutionConfig;
+    DynamicResolution _resolution;
+    VkExtent2D _sceneExtent {};
+    bool _sceneExtentPinned = false; //setSceneExtent
+
+    FrameCapture* _capture = nullptr;
+
+    //кадр, который записывает recordCommandBuffer; обработчики проходов графа читают его отсюда
+    struct Recording {
+        FrameData* frame = nullptr;
+        uint32_t rangeCount = 1;
+        uint32_t frameUniforms = 0; //динамическое смещение FrameUniforms в _uniforms
+        uint32_t sceneTexture = 0;
+    };
+    Recording _recording;
+    //массивы ресурсов и данные кадра: наборы привязываются один раз на буфер команд, отрисовки выбирают ресурсы
+    //индексами из DrawConstants
+    DescriptorModel _descriptorModel = DescriptorModel::Bindless;
+    bool _bindlessSupported = false; //descriptor indexing с обновлением после привязки
+    BindlessDescriptors _descriptors;
+    UniformRing _uniforms;
+    ComputeContext _compute; //на _computeQueue
+    uint32_t _objectBufferIndex = 0;
+    UniquePipelineLayout _pipelineLayout; //BindlessDescriptors + DrawConstants
+    //конвейеры сцены и спрайтов; при записи кадра - только выборка по PipelineId
+    PipelineLibrary _pipelines;
+    PipelineId _scenePipeline = 0;
+    static constexpr uint32_t sceneTexturedConstant = 2; //constant_id в shader.frag
+
+    //атрибуты, которые читает shader.vert
+    static constexpr uint32_t sceneAttributes = VertexPosition | VertexColor;
+    std::string _meshPath;
+    GpuMesh _mesh;
+
+    //уровни загружаются в буфере команд кадра; без текстур сцена умножается на белую заглушку
+    std::vector<std::string> _texturePaths;
+    VkDeviceSize _textureBudget = 0;
+    bool _memoryBudgetSupported = false; //VK_EXT_memory_budget
+    TextureStreamer _textures;
+    std::vector<TextureId> _sceneTextures;
+
+    //0 - спрайты выключены и проход "sprites" не добавляется в граф
+    uint32_t _spriteCapacity = 0;
+    SpriteBatch _sprites;
+    PipelineId _spritePipelines[static_cast<uint32_t>(SpriteBlend::Count)] {};
+
+    //меньше отрисовок запись в один поток дешевле, чем запуск задач и vkCmdExecuteCommands
+    static constexpr uint32_t parallelRecordingThreshold = 64;
+    JobSystem _jobs;
+    uint32_t _workerThreads = 0;
+    uint32_t _drawCount = 1;
+    std::vector<DrawItem> _drawList;
+
+    CullingMode _cullingMode = CullingMode::Auto;
+    bool _gpuCulling = false;
+    std::atomic<bool> _cullPipelineReady { false }; //конвейер отсечения компилируется отложенной задачей
+    bool _indirectCountSupported = false; //VK_KHR_draw_indirect_count + multiDrawIndirect + drawIndirectFirstInstance
+    PFN_vkCmdDrawIndexedIndirectCountKHR _cmdDrawIndexedIndirectCount = nullptr;
+    glm::mat4 _viewProjection = glm::mat4(1.0f);
+    utils::SphereSoA _objectSpheres;  //для отсечения на CPU
+    std::vector<uint32_t> _visibleObjects;
+    CullStats _cullStats;
+
+    UniqueDescriptorSetLayout _sceneSetLayout; //отсечение: объекты, подсетки, команды и счётчик отрисовок
+    UniqueDescriptorPool _descriptorPool;
+    UniquePipelineLayout _cullPipelineLayout;
+    UniquePipeline _cullPipeline;
+    AllocatedBuffer _objectBuffer;
+    AllocatedBuffer _submeshBuffer;
+    uint32_t _submeshCount = 1;
+
+    PipelineCache _pipelineCache;
+    ShaderModuleCache _shaderModules;
+    std::mutex _loadedShadersMutex; //шейдеры загружают параллельные задачи инициализации
+    std::unordered_map<std::string, VkShaderModule> _loadedShaders; //loadShader: имя -> модуль
+    std::string _shaderDirectory = "../shaders";
+
+    bool _shaderHotReload = false;
+    ShaderCompiler _shaderCompiler;
+    std::unique_ptr<ShaderHotReload> _hotReload;
+    uint32_t _sceneReloadId = 0;
+    uint32_t _spriteReloadId = 0;
+
+    uint64_t _frameNumber = 0;
+    std::string _pipelineCacheDirectory; //пусто - текущая директория
 
     int extentWidth, extentHeight;
-};
\ No newline at end of file
+};
@@ -0,0 +1,350 @@
+#include "bindlessDescriptors.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+
+namespace {
+    //верхние границы массивов: лимиты устройств обычно больше, а каждый элемент стоит памяти пула
+    const uint32_t bindlessBuffers = 4096;
+    const uint32_t bindlessTextures = 16384;
+    const uint32_t pooledBuffers = 32;
+    const uint32_t pooledTextures = 64;
+    //ресурсы стадии вне set 0: uniform данные кадра, вложения прохода, наборы отдельных конвейеров
+    const uint32_t reservedStageResources = 16;
+
+    const VkShaderStageFlags allStages = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+}
+
+const char* toString(DescriptorModel model) {
+    switch(model) {
+        case DescriptorModel::Bindless: return "bindless";
+        case DescriptorModel::Pooled: return "pooled";
+    }
+    return "unknown";
+}
+
+void BindlessDescriptors::init(VkPhysicalDevice physicalDevice, VkDevice device, DescriptorModel model, uint32_t frameSlots) {
+    _device = device;
+    _model = model;
+    _frameSlots = std::max(frameSlots, 1u);
+    const bool bindless = model == DescriptorModel::Bindless;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkPhysicalDeviceLimits& limits = properties.limits;
+
+    uint32_t bufferCount = 0;
+    uint32_t textureCount = 0;
+    if(bindless) { //для наборов с обновлением после привязки действуют отдельные лимиты
+        VkPhysicalDeviceVulkan12Properties vulkan12Properties {};
+        vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2 {};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &vulkan12Properties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+        bufferCount = std::min({ bindlessBuffers, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                                 vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers });
+        textureCount = std::min({ bindlessTextures, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                  vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                  vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                  vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers });
+        //оба массива видны каждой стадии и вместе входят в её лимит ресурсов
+        const uint32_t stageResources = vulkan12Properties.maxPerStageUpdateAfterBindResources;
+        if(bufferCount + textureCount + reservedStageResources > stageResources)
+            textureCount = std::max(stageResources - std::min(stageResources, bufferCount + reservedStageResources), 1u);
+    } else {
+        bufferCount = std::min({ pooledBuffers, limits.maxPerStageDescriptorStorageBuffers, limits.maxDescriptorSetStorageBuffers });
+        textureCount = std::min({ pooledTextures, limits.maxPerStageDescriptorSampledImages, limits.maxPerStageDescriptorSamplers,
+                                  limits.maxDescriptorSetSampledImages, limits.maxDescriptorSetSamplers });
+    }
+
+    //без динамической индексации массивов шейдер может обращаться только к элементу с константным индексом
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    if(!features.shaderStorageBufferArrayDynamicIndexing)
+        bufferCount = 1;
+    if(!features.shaderSampledImageArrayDynamicIndexing)
+        textureCount = 1;
+
+    _buffers.binding = bufferBinding;
+    _buffers.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    _buffers.capacity = bufferCount;
+    _buffers.buffers.resize(bufferCount);
+    _textures.binding = textureBinding;
+    _textures.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    _textures.capacity = textureCount;
+    _textures.images.resize(textureCount);
+
+    //set 0: массивы ресурсов
+    VkDescriptorSetLayoutBinding bindings[2] {};
+    bindings[0].binding = bufferBinding;
+    bindings[0].descriptorType = _buffers.type;
+    bindings[0].descriptorCount = bufferCount;
+    bindings[0].stageFlags = allStages;
+    bindings[1].binding = textureBinding;
+    bindings[1].descriptorType = _textures.type;
+    bindings[1].descriptorCount = textureCount;
+    bindings[1].stageFlags = allStages;
+
+    //незаполненные элементы допустимы, пока шейдер к ним не обращается; свободные элементы
+    //можно переписывать, пока кадры в полёте выполняют буферы команд с этим набором
+    const VkDescriptorBindingFlags bindlessFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+                                                   | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+                                                   | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorBindingFlags bindingFlags[2] = { bindlessFlags, bindlessFlags };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo {};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = 2;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo {};
+    setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutCreateInfo.bindingCount = 2;
+    setLayoutCreateInfo.pBindings = bindings;
+    if(bindless) {
+        setLayoutCreateInfo.pNext = &bindingFlagsInfo;
+        setLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    }
+
+    if(vkCreateDescriptorSetLayout(_device, &setLayoutCreateInfo, nullptr, &_setLayouts[resourceSet]) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать раскладку набора ресурсов!");
+
+    const uint32_t setCount = bindless ? 1 : _frameSlots;
+    VkDescriptorPoolSize poolSizes[2] {};
+    poolSizes[0].type = _buffers.type;
+    poolSizes[0].descriptorCount = bufferCount * setCount;
+    poolSizes[1].type = _textures.type;
+    poolSizes[1].descriptorCount = textureCount * setCount;
+
+    VkDescriptorPoolCreateInfo poolCreateInfo {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.flags = bindless ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
+    poolCreateInfo.maxSets = setCount;
+    poolCreateInfo.poolSizeCount = 2;
+    poolCreateInfo.pPoolSizes = poolSizes;
+
+    if(vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &_resourcePool) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать пул набора ресурсов!");
+
+    std::vector<VkDescriptorSetLayout> resourceLayouts(setCount, _setLayouts[resourceSet]);
+    VkDescriptorSetAllocateInfo allocateInfo {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = _resourcePool;
+    allocateInfo.descriptorSetCount = setCount;
+    allocateInfo.pSetLayouts = resourceLayouts.data();
+
+    _resourceSets.resize(setCount);
+    if(vkAllocateDescriptorSets(_device, &allocateInfo, _resourceSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось выделить набор ресурсов!");
+
+    //set 1: uniform данные кадра, динамические дескрипторы несовместимы с обновлением после привязки
+    VkDescriptorSetLayoutBinding frameBinding {};
+    frameBinding.binding = 0;
+    frameBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    frameBinding.descriptorCount = 1;
+    frameBinding.stageFlags = allStages;
+
+    VkDescriptorSetLayoutCreateInfo frameLayoutCreateInfo {};
+    frameLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    frameLayoutCreateInfo.bindingCount = 1;
+    frameLayoutCreateInfo.pBindings = &frameBinding;
+
+    if(vkCreateDescriptorSetLayout(_device, &frameLayoutCreateInfo, nullptr, &_setLayouts[frameSet]) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать раскладку набора кадра!");
+
+    VkDescriptorPoolSize framePoolSize {};
+    framePoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    framePoolSize.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo framePoolCreateInfo {};
+    framePoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    framePoolCreateInfo.maxSets = 1;
+    framePoolCreateInfo.poolSizeCount = 1;
+    framePoolCreateInfo.pPoolSizes = &framePoolSize;
+
+    if(vkCreateDescriptorPool(_device, &framePoolCreateInfo, nullptr, &_framePool) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать пул набора кадра!");
+
+    VkDescriptorSetAllocateInfo frameAllocateInfo {};
+    frameAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    frameAllocateInfo.descriptorPool = _framePool;
+    frameAllocateInfo.descriptorSetCount = 1;
+    frameAllocateInfo.pSetLayouts = &_setLayouts[frameSet];
+
+    if(vkAllocateDescriptorSets(_device, &frameAllocateInfo, &_frameDescriptorSet) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось выделить набор кадра!");
+
+    _pending.assign(bindless ? 0 : _frameSlots, {});
+
+    _specializationData[0] = bufferCount;
+    _specializationData[1] = textureCount;
+    for(uint32_t i = 0; i < 2; i++) {
+        _specializationEntries[i].constantID = i == 0 ? bufferCountConstant : textureCountConstant;
+        _specializationEntries[i].offset = i * sizeof(uint32_t);
+        _specializationEntries[i].size = sizeof(uint32_t);
+    }
+    _specialization.mapEntryCount = 2;
+    _specialization.pMapEntries = _specializationEntries;
+    _specialization.dataSize = sizeof(_specializationData);
+    _specialization.pData = _specializationData;
+}
+
+void BindlessDescriptors::setFrameUniforms(VkBuffer buffer, VkDeviceSize range) {
+    VkDescriptorBufferInfo bufferInfo { buffer, 0, range };
+
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = _frameDescriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+}
+
+void BindlessDescriptors::destroy() {
+    if(_device == VK_NULL_HANDLE)
+        return;
+
+    //наборы освобождаются вместе с пулами
+    vkDestroyDescriptorPool(_device, _resourcePool, nullptr);
+    vkDestroyDescriptorPool(_device, _framePool, nullptr);
+    for(auto& layout : _setLayouts)
+        vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+    _device = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessDescriptors::registerBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t index = acquireIndex(_buffers);
+    _buffers.buffers[index] = { buffer, offset, range };
+
+    if(_model == DescriptorModel::Pooled && !_buffers.hasFallback) {
+        _buffers.hasFallback = true;
+        _buffers.fallbackBuffer = _buffers.buffers[index];
+        std::fill(_buffers.buffers.begin(), _buffers.buffers.end(), _buffers.fallbackBuffer);
+        writeElements(_buffers, 0, _buffers.capacity);
+    } else {
+        writeElements(_buffers, index, 1);
+    }
+    return index;
+}
+
+uint32_t BindlessDescriptors::registerTexture(VkImageView view, VkSampler sampler, VkImageLayout layout) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t index = acquireIndex(_textures);
+    _textures.images[index] = { sampler, view, layout };
+
+    if(_model == DescriptorModel::Pooled && !_textures.hasFallback) {
+        _textures.hasFallback = true;
+        _textures.fallbackImage = _textures.images[index];
+        std::fill(_textures.images.begin(), _textures.images.end(), _textures.fallbackImage);
+        writeElements(_textures, 0, _textures.capacity);
+    } else {
+        writeElements(_textures, index, 1);
+    }
+    return index;
+}
+
+void BindlessDescriptors::releaseBuffer(uint32_t index) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    release(_buffers, index);
+}
+
+void BindlessDescriptors::releaseTexture(uint32_t index) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    release(_textures, index);
+}
+
+uint32_t BindlessDescriptors::acquireIndex(Table& table) {
+    if(!table.freeIndices.empty()) {
+        uint32_t index = table.freeIndices.back();
+        table.freeIndices.pop_back();
+        return index;
+    }
+    if(table.next == table.capacity)
+        throw std::runtime_error("Массив дескрипторов заполнен: " + std::to_string(table.capacity) + " элементов");
+    return table.next++;
+}
+
+void BindlessDescriptors::release(Table& table, uint32_t index) {
+    _released.push_back({ &table, index, _frameNumber });
+
+    //в режиме bindless элемент просто не читается; в режиме пула набор должен остаться полным
+    if(_model == DescriptorModel::Pooled) {
+        if(table.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+            table.buffers[index] = table.fallbackBuffer;
+        else
+            table.images[index] = table.fallbackImage;
+        writeElements(table, index, 1);
+    }
+}
+
+void BindlessDescriptors::writeElements(Table& table, uint32_t first, uint32_t count) {
+    if(_model == DescriptorModel::Bindless) {
+        //элемент не используется ни одним кадром в полёте: его индекс выдан заново только после их завершения
+        VkWriteDescriptorSet write = makeWrite(_resourceSets[0], table, first, count);
+        vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+        return;
+    }
+
+    for(auto& pending : _pending)
+        pending.push_back({ &table, first, count });
+}
+
+VkWriteDescriptorSet BindlessDescriptors::makeWrite(VkDescriptorSet set, const Table& table, uint32_t first, uint32_t count) const {
+    VkWriteDescriptorSet write {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = table.binding;
+    write.dstArrayElement = first;
+    write.descriptorCount = count;
+    write.descriptorType = table.type;
+    if(table.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        write.pBufferInfo = &table.buffers[first];
+    else
+        write.pImageInfo = &table.images[first];
+    return write;
+}
+
+void BindlessDescriptors::beginFrame(uint32_t frameSlot, uint64_t frameNumber) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _currentSlot = frameSlot % _frameSlots;
+    _frameNumber = frameNumber;
+
+    //после ожидания забора слота завершены все кадры с номером до frameNumber - _frameSlots включительно;
+    //ресурс, освобождённый во время или после кадра N, мог читаться кадром N
+    auto finished = [this](const Release& released) {
+        return released.releasedAtFrame + _frameSlots <= _frameNumber;
+    };
+    for(const auto& released : _released)
+        if(finished(released))
+            released.table->freeIndices.push_back(released.index);
+    _released.erase(std::remove_if(_released.begin(), _released.end(), finished), _released.end());
+
+    if(_model == DescriptorModel::Pooled)
+        applyPending(_currentSlot);
+}
+
+//набор слота больше не читается GPU: записываем всё, что изменилось с прошлого кадра этого слота
+void BindlessDescriptors::applyPending(uint32_t frameSlot) {
+    std::vector<PendingWrite>& pending = _pending[frameSlot];
+    if(pending.empty())
+        return;
+
+    std::vector<VkWriteDescriptorSet> writes;
+    writes.reserve(pending.size());
+    for(const auto& write : pending)
+        writes.push_back(makeWrite(_resourceSets[frameSlot], *write.table, write.first, write.count));
+    vkUpdateDescriptorSets(_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    pending.clear();
+}
+
+void BindlessDescriptors::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout,
+                               uint32_t uniformOffset) const {
+    VkDescriptorSet sets[2] = { _resourceSets[_model == DescriptorModel::Bindless ? 0 : _currentSlot], _frameDescriptorSet };
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, resourceSet, 2, sets, 1, &uniformOffset);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+enum class DescriptorModel : uint8_t {
+    //descriptor indexing: один набор на всё приложение, большие массивы заполнены частично
+    //и обновляются после привязки без ожидания кадров в полёте
+    Bindless,
+    //без descriptor indexing: набор на слот кадра из общего пула, массивы небольшие и заполнены целиком,
+    //изменения применяются к набору слота в beginFrame, когда GPU его уже не читает
+    Pooled,
+};
+
+const char* toString(DescriptorModel model);
+
+//массивы всех буферов хранения и текстур приложения (set 0) и uniform данные кадра (set 1).
+//Отрисовка выбирает ресурсы индексами из push constants, поэтому наборы привязываются один раз на буфер команд,
+//а vkUpdateDescriptorSets вызывается только при регистрации и освобождении ресурсов
+class BindlessDescriptors
+{
+public:
+    static constexpr uint32_t resourceSet = 0;
+    static constexpr uint32_t frameSet = 1;
+    //привязки set 0, их же объявляют шейдеры
+    static constexpr uint32_t bufferBinding = 0;
+    static constexpr uint32_t textureBinding = 1;
+    //constant_id размеров массивов в шейдерах
+    static constexpr uint32_t bufferCountConstant = 0;
+    static constexpr uint32_t textureCountConstant = 1;
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, DescriptorModel model, uint32_t frameSlots);
+    //буфер UniformRing; задаётся один раз, динамическое смещение выбирает данные кадра
+    void setFrameUniforms(VkBuffer buffer, VkDeviceSize range);
+    void destroy();
+
+    //потокобезопасны: ресурсы регистрируются и задачами инициализации.
+    //В режиме пула первый зарегистрированный ресурс каждого типа заполняет свободные элементы массива,
+    //поэтому он должен жить до destroy
+    uint32_t registerBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    uint32_t registerTexture(VkImageView view, VkSampler sampler,
+                             VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    //индекс переиспользуется, когда завершатся кадры, которые могли читать ресурс; тогда же можно уничтожить и сам ресурс
+    void releaseBuffer(uint32_t index);
+    void releaseTexture(uint32_t index);
+
+    //вызывать после ожидания забора слота
+    void beginFrame(uint32_t frameSlot, uint64_t frameNumber);
+
+    //наборы ресурсов и кадра одним вызовом; раскладка должна начинаться с getSetLayouts
+    void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout,
+              uint32_t uniformOffset) const;
+
+    const VkDescriptorSetLayout* getSetLayouts() const { return _setLayouts; } //resourceSet, frameSet
+    static constexpr uint32_t getSetLayoutCount() { return 2; }
+    //размеры массивов для специализационных констант шейдеров
+    const VkSpecializationInfo* getSpecializationInfo() const { return &_specialization; }
+    DescriptorModel getModel() const { return _model; }
+    uint32_t getBufferCapacity() const { return _buffers.capacity; }
+    uint32_t getTextureCapacity() const { return _textures.capacity; }
+
+private:
+    //массив одной привязки set 0
+    struct Table {
+        uint32_t binding = 0;
+        VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        uint32_t capacity = 0;
+        uint32_t next = 0;                //первый ни разу не выданный индекс
+        std::vector<uint32_t> freeIndices;
+        //содержимое элементов; в режиме пула свободные элементы повторяют первый зарегистрированный ресурс
+        std::vector<VkDescriptorBufferInfo> buffers;
+        std::vector<VkDescriptorImageInfo> images;
+        bool hasFallback = false;
+        VkDescriptorBufferInfo fallbackBuffer {};
+        VkDescriptorImageInfo fallbackImage {};
+    };
+
+    struct Release {
+        Table* table;
+        uint32_t index;
+        uint64_t releasedAtFrame;
+    };
+
+    //элементы, которые нужно записать в набор слота
+    struct PendingWrite {
+        Table* table;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    uint32_t acquireIndex(Table& table);
+    void release(Table& table, uint32_t index);
+    void writeElements(Table& table, uint32_t first, uint32_t count); //под _mutex
+    void applyPending(uint32_t frameSlot);
+    VkWriteDescriptorSet makeWrite(VkDescriptorSet set, const Table& table, uint32_t first, uint32_t count) const;
+
+    VkDevice _device = VK_NULL_HANDLE;
+    DescriptorModel _model = DescriptorModel::Bindless;
+    uint32_t _frameSlots = 1;
+    uint32_t _currentSlot = 0;
+    uint64_t _frameNumber = 0;
+
+    VkDescriptorSetLayout _setLayouts[2] {};
+    VkDescriptorPool _resourcePool = VK_NULL_HANDLE;
+    VkDescriptorPool _framePool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> _resourceSets; //один в режиме bindless, по слоту кадра в режиме пула
+    VkDescriptorSet _frameDescriptorSet = VK_NULL_HANDLE;
+
+    uint32_t _specializationData[2] {};
+    VkSpecializationMapEntry _specializationEntries[2] {};
+    VkSpecializationInfo _specialization {};
+
+    std::mutex _mutex;
+    Table _buffers;
+    Table _textures;
+    std::vector<Release> _released;
+    std::vector<std::vector<PendingWrite>> _pending; //по слоту кадра, только в режиме пула
+};
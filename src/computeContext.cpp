@@ -0,0 +1,384 @@
+#include "computeContext.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    //наборов на пул дескрипторов пакета; при нехватке пакет заводит ещё один пул
+    const uint32_t setsPerPool = 64;
+    const uint32_t buffersPerSet = 8;
+
+    //предпочтительный размер рабочей группы: кратен ширине волны у всех производителей
+    const uint32_t preferredLocalSize = 256;
+}
+
+void ComputeContext::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, VkQueue queue,
+                          DeviceAllocator& allocator, VkPipelineCache pipelineCache) {
+    _device = device;
+    _queue = queue;
+    _allocator = &allocator;
+    _pipelineCache = pipelineCache;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkPhysicalDeviceLimits& limits = properties.limits;
+
+    //степень двойки: шейдеры сворачивают рабочую группу пополам (сканирование, редукции)
+    uint32_t localSize = std::min({ preferredLocalSize, limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupInvocations });
+    _localSize = 1;
+    while(_localSize * 2 <= localSize)
+        _localSize *= 2;
+    _maxGroupCountX = limits.maxComputeWorkGroupCount[0];
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = allocator.getMemoryProperties();
+    const VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        if((memoryProperties.memoryTypes[i].propertyFlags & cached) == cached)
+            _cachedReadback = true;
+
+    VkCommandPoolCreateInfo poolCreateInfo {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; //буфер пакета перезаписывается при переиспользовании
+    poolCreateInfo.queueFamilyIndex = queueFamily;
+
+    if(vkCreateCommandPool(_device, &poolCreateInfo, nullptr, &_commandPool) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать пул команд вычислений!");
+}
+
+void ComputeContext::destroy() {
+    if(_device == VK_NULL_HANDLE)
+        return;
+
+    for(auto& batch : _batches) {
+        if(batch->_ticket != 0 && !batch->_recording)
+            vkWaitForFences(_device, 1, &batch->_fence, VK_TRUE, UINT64_MAX);
+        for(auto pool : batch->_pools)
+            vkDestroyDescriptorPool(_device, pool, nullptr);
+        vkDestroyFence(_device, batch->_fence, nullptr);
+    }
+    _batches.clear();
+    vkDestroyCommandPool(_device, _commandPool, nullptr); //буферы команд освобождаются вместе с пулом
+
+    for(auto& pipeline : _pipelines) {
+        vkDestroyPipeline(_device, pipeline.pipeline, nullptr);
+        vkDestroyPipelineLayout(_device, pipeline.layout, nullptr);
+        vkDestroyDescriptorSetLayout(_device, pipeline.setLayout, nullptr);
+    }
+    _pipelines.clear();
+    _device = VK_NULL_HANDLE;
+}
+
+ComputePipeline ComputeContext::createPipeline(VkShaderModule module, uint32_t bufferCount, uint32_t pushConstantSize) {
+    ComputePipeline pipeline;
+    pipeline.bufferCount = bufferCount;
+    pipeline.pushConstantSize = pushConstantSize;
+    pipeline.localSize = _localSize;
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings(bufferCount);
+    for(uint32_t i = 0; i < bufferCount; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo {};
+    setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutCreateInfo.bindingCount = bufferCount;
+    setLayoutCreateInfo.pBindings = bindings.data();
+
+    if(vkCreateDescriptorSetLayout(_device, &setLayoutCreateInfo, nullptr, &pipeline.setLayout) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать раскладку набора вычислений!");
+
+    VkPushConstantRange pushRange {};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo {};
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &pipeline.setLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushRange;
+
+    if(vkCreatePipelineLayout(_device, &pipelineLayoutCreateInfo, nullptr, &pipeline.layout) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать VkPipelineLayout вычислений!");
+
+    //размер рабочей группы - специализационная константа 0 (layout(local_size_x_id = 0) in)
+    VkSpecializationMapEntry localSizeEntry {};
+    localSizeEntry.constantID = 0;
+    localSizeEntry.offset = 0;
+    localSizeEntry.size = sizeof(uint32_t);
+
+    VkSpecializationInfo specialization {};
+    specialization.mapEntryCount = 1;
+    specialization.pMapEntries = &localSizeEntry;
+    specialization.dataSize = sizeof(uint32_t);
+    specialization.pData = &_localSize;
+
+    VkComputePipelineCreateInfo pipelineCreateInfo {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineCreateInfo.stage.module = module;
+    pipelineCreateInfo.stage.pName = "main";
+    pipelineCreateInfo.stage.pSpecializationInfo = &specialization;
+    pipelineCreateInfo.layout = pipeline.layout;
+
+    if(vkCreateComputePipelines(_device, _pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать конвейер вычислений!");
+
+    _pipelines.push_back(pipeline);
+    return pipeline;
+}
+
+ComputeBuffer ComputeContext::createBuffer(VkDeviceSize size, ComputeMemory memory) {
+    ComputeBuffer buffer;
+    buffer.size = std::max<VkDeviceSize>(size, 4);
+    buffer.memory = memory;
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = buffer.size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &buffer.buffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать буфер вычислений!");
+
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if(memory == ComputeMemory::Upload)
+        properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    else if(memory == ComputeMemory::Readback) //чтение из некэшируемой памяти на порядок медленнее
+        properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | (_cachedReadback ? VK_MEMORY_PROPERTY_HOST_CACHED_BIT : 0);
+
+    buffer.allocation = _allocator->allocateForBuffer(buffer.buffer, properties);
+    return buffer;
+}
+
+void ComputeContext::destroyBuffer(ComputeBuffer& buffer) {
+    if(buffer.buffer == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyBuffer(_device, buffer.buffer, nullptr);
+    _allocator->free(buffer.allocation);
+    buffer.buffer = VK_NULL_HANDLE;
+}
+
+void ComputeContext::write(const ComputeBuffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset) {
+    if(buffer.allocation.mapped == nullptr || offset + size > buffer.size)
+        throw std::runtime_error("Запись в буфер вычислений вне отображённой памяти");
+
+    std::memcpy(static_cast<char*>(buffer.allocation.mapped) + offset, data, size);
+    _allocator->flush(buffer.allocation, offset, size);
+}
+
+void ComputeContext::read(const ComputeBuffer& buffer, void* data, VkDeviceSize size, VkDeviceSize offset) {
+    if(buffer.allocation.mapped == nullptr || offset + size > buffer.size)
+        throw std::runtime_error("Чтение буфера вычислений вне отображённой памяти");
+
+    _allocator->invalidate(buffer.allocation, offset, size);
+    std::memcpy(data, static_cast<const char*>(buffer.allocation.mapped) + offset, size);
+}
+
+ComputeContext::Batch& ComputeContext::begin() {
+    Batch* batch = nullptr;
+    for(auto& candidate : _batches) {
+        if(candidate->_recording)
+            continue;
+        if(candidate->_ticket == 0 || vkGetFenceStatus(_device, candidate->_fence) == VK_SUCCESS) {
+            batch = candidate.get();
+            break;
+        }
+    }
+
+    if(batch == nullptr) {
+        _batches.push_back(std::make_unique<Batch>());
+        batch = _batches.back().get();
+        batch->_context = this;
+
+        VkCommandBufferAllocateInfo allocateInfo {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = _commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+
+        if(vkAllocateCommandBuffers(_device, &allocateInfo, &batch->_commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось выделить буфер команд вычислений!");
+
+        VkFenceCreateInfo fenceCreateInfo {};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if(vkCreateFence(_device, &fenceCreateInfo, nullptr, &batch->_fence) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать забор вычислений!");
+    } else if(batch->_ticket != 0) { //пакет завершён: его наборы дескрипторов и буфер команд свободны
+        vkResetFences(_device, 1, &batch->_fence);
+        for(auto pool : batch->_pools)
+            vkResetDescriptorPool(_device, pool, 0);
+        vkResetCommandBuffer(batch->_commandBuffer, 0);
+    }
+
+    batch->_currentPool = 0;
+    batch->_lastStage = Batch::Stage::None;
+    batch->_recording = true;
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if(vkBeginCommandBuffer(batch->_commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось начать запись буфера команд вычислений!");
+    return *batch;
+}
+
+ComputeTicket ComputeContext::submit(Batch& batch) {
+    //результаты пакета видны CPU после забора
+    if(batch._lastStage != Batch::Stage::None) {
+        VkMemoryBarrier hostBarrier {};
+        hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(batch._commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    if(vkEndCommandBuffer(batch._commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось записать буфер команд вычислений!");
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch._commandBuffer;
+
+    if(vkQueueSubmit(_queue, 1, &submitInfo, batch._fence) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось отправить пакет вычислений!");
+
+    batch._recording = false;
+    batch._ticket = _nextTicket++;
+    return batch._ticket;
+}
+
+ComputeContext::Batch* ComputeContext::findBatch(ComputeTicket ticket) {
+    for(auto& batch : _batches)
+        if(batch->_ticket == ticket && !batch->_recording)
+            return batch.get();
+    return nullptr; //пакет уже переиспользован, значит билет завершён
+}
+
+bool ComputeContext::isComplete(ComputeTicket ticket) {
+    Batch* batch = ticket != 0 ? findBatch(ticket) : nullptr;
+    return batch == nullptr || vkGetFenceStatus(_device, batch->_fence) == VK_SUCCESS;
+}
+
+void ComputeContext::wait(ComputeTicket ticket) {
+    Batch* batch = ticket != 0 ? findBatch(ticket) : nullptr;
+    if(batch != nullptr)
+        vkWaitForFences(_device, 1, &batch->_fence, VK_TRUE, UINT64_MAX);
+}
+
+//---------------------------------------------------------------- Batch
+
+void ComputeContext::Batch::barrier(Stage next) {
+    //команды пакета могут зависеть друг от друга через любой буфер: между ними глобальный барьер памяти
+    if(_lastStage != Stage::None) {
+        VkMemoryBarrier memoryBarrier {};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memoryBarrier.srcAccessMask = _lastStage == Stage::Compute ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+        memoryBarrier.dstAccessMask = next == Stage::Compute ? VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+                                                             : VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        VkPipelineStageFlags srcStage = _lastStage == Stage::Compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        VkPipelineStageFlags dstStage = next == Stage::Compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+        vkCmdPipelineBarrier(_commandBuffer, srcStage, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+    }
+    _lastStage = next;
+}
+
+VkDescriptorSet ComputeContext::Batch::allocateSet(VkDescriptorSetLayout layout) {
+    VkDevice device = _context->_device;
+    for(;;) {
+        if(_currentPool == _pools.size()) {
+            VkDescriptorPoolSize poolSize {};
+            poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            poolSize.descriptorCount = setsPerPool * buffersPerSet;
+
+            VkDescriptorPoolCreateInfo poolCreateInfo {};
+            poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            poolCreateInfo.maxSets = setsPerPool;
+            poolCreateInfo.poolSizeCount = 1;
+            poolCreateInfo.pPoolSizes = &poolSize;
+
+            VkDescriptorPool pool;
+            if(vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+                throw std::runtime_error("Не удалось создать пул дескрипторов вычислений!");
+            _pools.push_back(pool);
+        }
+
+        VkDescriptorSetAllocateInfo allocateInfo {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = _pools[_currentPool];
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet set;
+        VkResult result = vkAllocateDescriptorSets(device, &allocateInfo, &set);
+        if(result == VK_SUCCESS)
+            return set;
+        if(result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+            throw std::runtime_error("Не удалось выделить набор дескрипторов вычислений!");
+        _currentPool++; //пул исчерпан - следующий
+    }
+}
+
+void ComputeContext::Batch::dispatch(const ComputePipeline& pipeline, std::initializer_list<const ComputeBuffer*> buffers,
+                                     const void* constants, uint32_t constantsSize, uint32_t elementCount) {
+    if(buffers.size() != pipeline.bufferCount || constantsSize != pipeline.pushConstantSize)
+        throw std::runtime_error("Буферы или push constants диспатча не совпадают с раскладкой конвейера");
+    if(elementCount == 0)
+        return;
+
+    barrier(Stage::Compute);
+
+    VkDescriptorSet set = allocateSet(pipeline.setLayout);
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    std::vector<VkWriteDescriptorSet> writes;
+    bufferInfos.reserve(buffers.size());
+    for(const ComputeBuffer* buffer : buffers)
+        bufferInfos.push_back({ buffer->buffer, 0, VK_WHOLE_SIZE });
+    for(uint32_t i = 0; i < bufferInfos.size(); i++) {
+        VkWriteDescriptorSet write {};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = i;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &bufferInfos[i];
+        writes.push_back(write);
+    }
+    vkUpdateDescriptorSets(_context->_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+    vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &set, 0, nullptr);
+    if(constantsSize > 0)
+        vkCmdPushConstants(_commandBuffer, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, constantsSize, constants);
+
+    //групп больше, чем допускает одна размерность - раскладываем по второй
+    const uint32_t groups = (elementCount + pipeline.localSize - 1) / pipeline.localSize;
+    const uint32_t groupsX = std::min(groups, _context->_maxGroupCountX);
+    const uint32_t groupsY = (groups + groupsX - 1) / groupsX;
+    vkCmdDispatch(_commandBuffer, groupsX, groupsY, 1);
+}
+
+void ComputeContext::Batch::copy(const ComputeBuffer& src, const ComputeBuffer& dst, VkDeviceSize size) {
+    barrier(Stage::Transfer);
+
+    VkBufferCopy region {};
+    region.size = size == VK_WHOLE_SIZE ? std::min(src.size, dst.size) : size;
+    vkCmdCopyBuffer(_commandBuffer, src.buffer, dst.buffer, 1, &region);
+}
+
+void ComputeContext::Batch::fill(const ComputeBuffer& buffer, uint32_t value) {
+    barrier(Stage::Transfer);
+    vkCmdFillBuffer(_commandBuffer, buffer.buffer, 0, VK_WHOLE_SIZE, value);
+}
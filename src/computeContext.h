@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <initializer_list>
+#include <vulkan/vulkan.h>
+
+#include "memoryAllocator.h"
+
+//где живёт буфер вычислений
+enum class ComputeMemory : uint8_t {
+    Device,   //только GPU
+    Upload,   //host visible: CPU пишет через write, шейдер читает напрямую
+    Readback, //host visible (по возможности cached): результат для CPU, читается через read после завершения пакета
+};
+
+struct ComputeBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation allocation;
+    VkDeviceSize size = 0;
+    ComputeMemory memory = ComputeMemory::Device;
+};
+
+//конвейер вычислений: шейдер объявляет layout(local_size_x_id = 0) и storage буферы в set 0 с привязками 0..N-1,
+//размер рабочей группы подставляется специализацией по лимитам устройства
+struct ComputePipeline {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    uint32_t bufferCount = 0;
+    uint32_t pushConstantSize = 0;
+    uint32_t localSize = 1;
+};
+
+//завершение отправленного пакета; 0 - пустой билет, всегда завершён
+using ComputeTicket = uint64_t;
+
+//вычисления общего назначения на очереди вычислений: пакеты диспатчей записываются в свои буферы команд,
+//отправляются без ожидания и проверяются по билету. Барьеры между диспатчами и копиями пакета ставятся сами.
+//Не потокобезопасен; очередь может совпадать с очередью графики, поэтому submit вызывается из потока кадра.
+//Буферы используются только семейством очереди вычислений
+class ComputeContext
+{
+public:
+    class Batch
+    {
+    public:
+        //элементы 0..elementCount-1 раскладываются по рабочим группам; при превышении maxComputeWorkGroupCount[0]
+        //группы идут второй размерностью: индекс элемента в шейдере -
+        //gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x + gl_GlobalInvocationID.x
+        void dispatch(const ComputePipeline& pipeline, std::initializer_list<const ComputeBuffer*> buffers,
+                      const void* constants, uint32_t constantsSize, uint32_t elementCount);
+        template<typename T>
+        void dispatch(const ComputePipeline& pipeline, std::initializer_list<const ComputeBuffer*> buffers,
+                      const T& constants, uint32_t elementCount) {
+            dispatch(pipeline, buffers, &constants, sizeof(T), elementCount);
+        }
+        void copy(const ComputeBuffer& src, const ComputeBuffer& dst, VkDeviceSize size = VK_WHOLE_SIZE);
+        void fill(const ComputeBuffer& buffer, uint32_t value);
+
+        VkCommandBuffer getCommandBuffer() const { return _commandBuffer; }
+
+    private:
+        friend class ComputeContext;
+        enum class Stage : uint8_t { None, Compute, Transfer };
+
+        void barrier(Stage next);
+        VkDescriptorSet allocateSet(VkDescriptorSetLayout layout);
+
+        ComputeContext* _context = nullptr;
+        VkCommandBuffer _commandBuffer = VK_NULL_HANDLE;
+        VkFence _fence = VK_NULL_HANDLE;
+        std::vector<VkDescriptorPool> _pools; //наборы дескрипторов диспатчей, сбрасываются после завершения пакета
+        uint32_t _currentPool = 0;
+        Stage _lastStage = Stage::None;
+        ComputeTicket _ticket = 0;
+        bool _recording = false;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, VkQueue queue,
+              DeviceAllocator& allocator, VkPipelineCache pipelineCache);
+    void destroy();
+
+    ComputePipeline createPipeline(VkShaderModule module, uint32_t bufferCount, uint32_t pushConstantSize = 0);
+    ComputeBuffer createBuffer(VkDeviceSize size, ComputeMemory memory);
+    void destroyBuffer(ComputeBuffer& buffer); //пакеты, которые его используют, должны быть завершены
+
+    //только Upload и Readback буферы
+    void write(const ComputeBuffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+    void read(const ComputeBuffer& buffer, void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+    //пакет переиспользуется после завершения; ссылка действительна до submit
+    Batch& begin();
+    ComputeTicket submit(Batch& batch);
+    bool isComplete(ComputeTicket ticket);
+    void wait(ComputeTicket ticket);
+
+    uint32_t getLocalSize() const { return _localSize; }
+
+private:
+    Batch* findBatch(ComputeTicket ticket);
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VkQueue _queue = VK_NULL_HANDLE;
+    DeviceAllocator* _allocator = nullptr;
+    VkPipelineCache _pipelineCache = VK_NULL_HANDLE;
+    VkCommandPool _commandPool = VK_NULL_HANDLE;
+
+    uint32_t _localSize = 64;
+    uint32_t _maxGroupCountX = 65535;
+    bool _cachedReadback = false; //есть HOST_VISIBLE | HOST_CACHED память
+
+    std::vector<std::unique_ptr<Batch>> _batches; //ссылки, выданные begin, не сдвигаются при добавлении пакетов
+    std::vector<ComputePipeline> _pipelines;
+    ComputeTicket _nextTicket = 1;
+};
@@ -0,0 +1,212 @@
+#include "computeSamples.h"
+
+#include <random>
+#include <stdexcept>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+    struct ScanConstants { //push constants shaders/prefixSum.comp, shaders/prefixSumAdd.comp
+        uint32_t count;
+    };
+
+    uint32_t groupCount(uint32_t count, uint32_t localSize) {
+        return (count + localSize - 1) / localSize;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+namespace samples {
+    void PrefixSum::init(ComputeContext& compute, VkShaderModule scanModule, VkShaderModule addModule) {
+        _compute = &compute;
+        _scan = compute.createPipeline(scanModule, 3, sizeof(ScanConstants));
+        _add = compute.createPipeline(addModule, 2, sizeof(ScanConstants));
+    }
+
+    void PrefixSum::reserve(uint32_t count) {
+        if(count <= _reserved)
+            return;
+        destroy();
+
+        const uint32_t localSize = _compute->getLocalSize();
+        uint32_t levelCount = count;
+        for(;;) {
+            Level level;
+            level.count = levelCount;
+            if(!_levels.empty())
+                level.scanned = _compute->createBuffer(levelCount * sizeof(uint32_t), ComputeMemory::Device);
+            level.blockSums = _compute->createBuffer(groupCount(levelCount, localSize) * sizeof(uint32_t), ComputeMemory::Device);
+            _levels.push_back(level);
+
+            if(levelCount <= localSize)
+                break;
+            levelCount = groupCount(levelCount, localSize);
+        }
+        _reserved = count;
+    }
+
+    void PrefixSum::destroy() {
+        for(auto& level : _levels) {
+            _compute->destroyBuffer(level.scanned);
+            _compute->destroyBuffer(level.blockSums);
+        }
+        _levels.clear();
+        _reserved = 0;
+    }
+
+    void PrefixSum::record(ComputeContext::Batch& batch, const ComputeBuffer& src, const ComputeBuffer& dst, uint32_t count) {
+        if(count > _reserved)
+            throw std::runtime_error("Префиксная сумма длиннее зарезервированной");
+
+        //вверх: каждый уровень сканирует суммы групп предыдущего, пока не останется одна группа
+        const uint32_t localSize = _compute->getLocalSize();
+        std::vector<uint32_t> counts;
+        for(uint32_t levelCount = count; ; levelCount = groupCount(levelCount, localSize)) {
+            const size_t level = counts.size();
+            const ComputeBuffer& levelSrc = level == 0 ? src : _levels[level - 1].blockSums;
+            const ComputeBuffer& levelDst = level == 0 ? dst : _levels[level].scanned;
+            batch.dispatch(_scan, { &levelSrc, &levelDst, &_levels[level].blockSums }, ScanConstants{ levelCount }, levelCount);
+            counts.push_back(levelCount);
+            if(levelCount <= localSize)
+                break;
+        }
+
+        //вниз: к элементам каждой группы добавляется просканированная сумма предыдущих групп
+        for(size_t level = counts.size() - 1; level > 0; level--) {
+            const ComputeBuffer& data = level == 1 ? dst : _levels[level - 1].scanned;
+            batch.dispatch(_add, { &data, &_levels[level].scanned }, ScanConstants{ counts[level - 1] }, counts[level - 1]);
+        }
+    }
+
+    void exclusivePrefixSum(const std::vector<uint32_t>& src, std::vector<uint32_t>& dst) {
+        dst.resize(src.size());
+        uint32_t sum = 0;
+        for(size_t i = 0; i < src.size(); i++) {
+            dst[i] = sum;
+            sum += src[i];
+        }
+    }
+
+    void integrateParticles(std::vector<Particle>& particles, const ParticleStep& step) {
+        for(auto& particle : particles)
+            for(int axis = 0; axis < 3; axis++) {
+                float velocity = particle.velocity[axis] + step.gravity[axis] * step.dt;
+                velocity = velocity * (1.0f - step.drag * step.dt);
+                particle.velocity[axis] = velocity;
+                particle.position[axis] = particle.position[axis] + velocity * step.dt;
+            }
+    }
+
+    bool runPrefixSum(ComputeContext& compute, PrefixSum& prefixSum, uint32_t count, std::ostream& out) {
+        std::vector<uint32_t> values(count);
+        std::mt19937 random(17);
+        std::uniform_int_distribution<uint32_t> distribution(0, 15);
+        for(auto& value : values)
+            value = distribution(random);
+
+        const VkDeviceSize size = count * sizeof(uint32_t);
+        ComputeBuffer upload = compute.createBuffer(size, ComputeMemory::Upload);
+        ComputeBuffer src = compute.createBuffer(size, ComputeMemory::Device);
+        ComputeBuffer dst = compute.createBuffer(size, ComputeMemory::Device);
+        ComputeBuffer readback = compute.createBuffer(size, ComputeMemory::Readback);
+        prefixSum.reserve(count);
+
+        auto gpuStart = std::chrono::steady_clock::now();
+        compute.write(upload, values.data(), size);
+        ComputeContext::Batch& batch = compute.begin();
+        batch.copy(upload, src);
+        prefixSum.record(batch, src, dst, count);
+        batch.copy(dst, readback);
+        ComputeTicket ticket = compute.submit(batch);
+
+        //эталон считается, пока GPU занят пакетом
+        auto cpuStart = std::chrono::steady_clock::now();
+        std::vector<uint32_t> expected;
+        exclusivePrefixSum(values, expected);
+        double cpuMilliseconds = millisecondsSince(cpuStart);
+
+        compute.wait(ticket);
+        double gpuMilliseconds = millisecondsSince(gpuStart);
+        std::vector<uint32_t> result(count);
+        compute.read(readback, result.data(), size);
+
+        uint32_t mismatches = 0;
+        for(uint32_t i = 0; i < count; i++)
+            if(result[i] != expected[i])
+                mismatches++;
+
+        out << "Префиксная сумма: " << count << " элементов, GPU " << gpuMilliseconds << " мс (с копированием), CPU "
+            << cpuMilliseconds << " мс, расхождений " << mismatches << std::endl;
+
+        compute.destroyBuffer(upload);
+        compute.destroyBuffer(src);
+        compute.destroyBuffer(dst);
+        compute.destroyBuffer(readback);
+        return mismatches == 0;
+    }
+
+    bool runParticles(ComputeContext& compute, VkShaderModule module, uint32_t count, uint32_t steps, std::ostream& out) {
+        std::vector<Particle> particles(count);
+        std::mt19937 random(29);
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        for(auto& particle : particles)
+            for(int axis = 0; axis < 4; axis++) {
+                particle.position[axis] = distribution(random) * 10.0f;
+                particle.velocity[axis] = distribution(random);
+            }
+
+        ParticleStep step {};
+        step.gravity[1] = -9.81f;
+        step.count = count;
+        step.dt = 1.0f / 60.0f;
+        step.drag = 0.1f;
+
+        ComputePipeline pipeline = compute.createPipeline(module, 1, sizeof(ParticleStep));
+        const VkDeviceSize size = count * sizeof(Particle);
+        ComputeBuffer upload = compute.createBuffer(size, ComputeMemory::Upload);
+        ComputeBuffer state = compute.createBuffer(size, ComputeMemory::Device);
+        ComputeBuffer readback = compute.createBuffer(size, ComputeMemory::Readback);
+
+        auto gpuStart = std::chrono::steady_clock::now();
+        compute.write(upload, particles.data(), size);
+        ComputeContext::Batch& batch = compute.begin();
+        batch.copy(upload, state);
+        for(uint32_t i = 0; i < steps; i++)
+            batch.dispatch(pipeline, { &state }, step, count);
+        batch.copy(state, readback);
+        ComputeTicket ticket = compute.submit(batch);
+
+        auto cpuStart = std::chrono::steady_clock::now();
+        std::vector<Particle> expected = particles;
+        for(uint32_t i = 0; i < steps; i++)
+            integrateParticles(expected, step);
+        double cpuMilliseconds = millisecondsSince(cpuStart);
+
+        compute.wait(ticket);
+        double gpuMilliseconds = millisecondsSince(gpuStart);
+        std::vector<Particle> result(count);
+        compute.read(readback, result.data(), size);
+
+        //GPU вправе сливать умножение и сложение (FMA), поэтому сравнение с допуском
+        float maxError = 0.0f;
+        for(uint32_t i = 0; i < count; i++)
+            for(int axis = 0; axis < 3; axis++) {
+                float position = expected[i].position[axis];
+                float error = std::abs(result[i].position[axis] - position) / std::max(1.0f, std::abs(position));
+                maxError = std::max(maxError, error);
+            }
+        const bool passed = maxError <= 1e-4f;
+
+        out << "Частицы: " << count << " x " << steps << " шагов, GPU " << gpuMilliseconds << " мс (с копированием), CPU "
+            << cpuMilliseconds << " мс, относительная ошибка " << maxError << (passed ? "" : " - РАСХОЖДЕНИЕ") << std::endl;
+
+        compute.destroyBuffer(upload);
+        compute.destroyBuffer(state);
+        compute.destroyBuffer(readback);
+        return passed;
+    }
+}
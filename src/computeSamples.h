@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+#include "computeContext.h"
+
+//примеры на ComputeContext с эталонными реализациями на CPU; в headless режиме на lavapipe служат проверкой API
+namespace samples {
+    //исключающая префиксная сумма uint любой длины: сканирование групп, рекурсивно сумм групп и сшивание
+    class PrefixSum
+    {
+    public:
+        void init(ComputeContext& compute, VkShaderModule scanModule, VkShaderModule addModule);
+        //буферы сумм групп на count элементов; вызывать до record
+        void reserve(uint32_t count);
+        void destroy();
+
+        //dst[i] = src[0] + ... + src[i - 1], count <= зарезервированного
+        void record(ComputeContext::Batch& batch, const ComputeBuffer& src, const ComputeBuffer& dst, uint32_t count);
+
+    private:
+        struct Level {
+            uint32_t count;
+            ComputeBuffer scanned;   //просканированные суммы предыдущего уровня (у нулевого уровня - dst)
+            ComputeBuffer blockSums; //суммы групп этого уровня, вход следующего
+        };
+
+        ComputeContext* _compute = nullptr;
+        ComputePipeline _scan;
+        ComputePipeline _add;
+        std::vector<Level> _levels;
+        uint32_t _reserved = 0;
+    };
+
+    struct Particle { //shaders/particles.comp
+        float position[4];
+        float velocity[4];
+    };
+
+    struct ParticleStep { //push constants shaders/particles.comp
+        float gravity[4];
+        uint32_t count;
+        float dt;
+        float drag;
+    };
+
+    void exclusivePrefixSum(const std::vector<uint32_t>& src, std::vector<uint32_t>& dst);
+    void integrateParticles(std::vector<Particle>& particles, const ParticleStep& step);
+
+    //результаты GPU сравниваются с эталоном; false - расхождение
+    bool runPrefixSum(ComputeContext& compute, PrefixSum& prefixSum, uint32_t count, std::ostream& out);
+    bool runParticles(ComputeContext& compute, VkShaderModule module, uint32_t count, uint32_t steps, std::ostream& out);
+}
@@ -0,0 +1,12 @@
+#include "deletionQueue.h"
+
+void DeletionQueue::collect(uint64_t frameNumber) {
+    //объект последний раз мог использовать кадр retiredAtFrame - 1, а завершены кадры до frameNumber - framesInFlight
+    while(!_entries.empty() && _entries.front().retiredAtFrame + _framesInFlight <= frameNumber + 1)
+        _entries.pop_front();
+}
+
+void DeletionQueue::flush() {
+    while(!_entries.empty()) //по одному: порядок уничтожения тот же, что у retire
+        _entries.pop_front();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+//объекты, которые ещё могут использовать кадры в полёте: хранятся, пока не завершатся все кадры,
+//записанные до retire, и уничтожаются на границе кадра в порядке retire - без ожидания GPU.
+//Принимает любой перемещаемый владелец (UniqueHandle, их векторы, unique_ptr); только поток кадра
+class DeletionQueue
+{
+public:
+    void init(uint32_t framesInFlight) { _framesInFlight = framesInFlight; }
+
+    //frameNumber - номер кадра, который будет записан следующим: объект могли использовать кадры до frameNumber - 1
+    template<typename T>
+    void retire(uint64_t frameNumber, T&& resource) {
+        static_assert(!std::is_lvalue_reference<T>::value, "retire забирает владение: передавайте std::move(...)");
+        _entries.push_back({ frameNumber, std::make_unique<Holder<T>>(std::move(resource)) });
+    }
+
+    //после ожидания забора слота кадра frameNumber, то есть когда завершены все кадры до frameNumber - framesInFlight
+    void collect(uint64_t frameNumber);
+    //все объекты сразу; GPU должен простаивать (завершение, потеря surface)
+    void flush();
+
+    size_t size() const { return _entries.size(); }
+
+private:
+    struct Retired {
+        virtual ~Retired() = default;
+    };
+
+    template<typename T>
+    struct Holder : Retired {
+        explicit Holder(T&& resource) : value(std::move(resource)) {}
+        T value;
+    };
+
+    struct Entry {
+        uint64_t retiredAtFrame;
+        std::unique_ptr<Retired> resource;
+    };
+
+    std::deque<Entry> _entries; //номера кадров не убывают
+    uint32_t _framesInFlight = 2;
+};
@@ -0,0 +1,74 @@
+#include "dynamicResolution.h"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    constexpr double smoothing = 0.2;      //вес нового замера в скользящем среднем
+    constexpr double raiseThreshold = 0.85; //масштаб растёт, только если кадр укладывается в эту долю цели
+}
+
+void DynamicResolution::configure(const Config& config) {
+    if(config.targetMilliseconds <= 0.0 || config.step <= 0.0f || config.minScale <= 0.0f || config.minScale > config.maxScale)
+        throw std::runtime_error("Некорректные параметры динамического разрешения");
+
+    _config = config;
+    _enabled = true;
+    _scale = config.maxScale;
+    _lowestScale = _scale;
+    _smoothed = 0.0;
+    _samples = 0;
+}
+
+bool DynamicResolution::update(uint64_t frameNumber, double gpuMilliseconds, uint64_t currentFrame) {
+    if(!_enabled || gpuMilliseconds <= 0.0 || frameNumber == _lastSample || frameNumber < _changeFrame)
+        return false;
+    _lastSample = frameNumber;
+
+    _smoothed = _samples == 0 ? gpuMilliseconds : _smoothed + smoothing * (gpuMilliseconds - _smoothed);
+    if(++_samples < _config.settleSamples)
+        return false;
+
+    float scale = _scale;
+    if(_smoothed > _config.targetMilliseconds) {
+        //оценка масштаба, при котором кадр уложится в цель, вниз до кратного шагу и хотя бы на шаг
+        const double desired = _scale * std::sqrt(_config.targetMilliseconds / _smoothed);
+        scale = std::min(static_cast<float>(std::floor(desired / _config.step) * _config.step), _scale - _config.step);
+    } else if(_smoothed < _config.targetMilliseconds * raiseThreshold) {
+        //рост по шагу: завышенная оценка сразу вернула бы перегрузку
+        const double predicted = _smoothed * std::pow((_scale + _config.step) / _scale, 2.0);
+        if(predicted < _config.targetMilliseconds)
+            scale = _scale + _config.step;
+    }
+    scale = std::clamp(scale, _config.minScale, _config.maxScale);
+    if(std::abs(scale - _scale) < _config.step * 0.5f)
+        return false;
+
+    if(scale < _scale)
+        _decreases++;
+    else
+        _increases++;
+    _scale = scale;
+    _lowestScale = std::min(_lowestScale, scale);
+    _changeFrame = currentFrame;
+    _samples = 0;
+    return true;
+}
+
+VkExtent2D DynamicResolution::scaleExtent(VkExtent2D extent) const {
+    if(!_enabled)
+        return extent;
+    return { std::max(static_cast<uint32_t>(std::lround(extent.width * _scale)), 1u),
+             std::max(static_cast<uint32_t>(std::lround(extent.height * _scale)), 1u) };
+}
+
+void DynamicResolution::printReport(std::ostream& out) const {
+    if(!_enabled) {
+        out << "Динамическое разрешение выключено" << std::endl;
+        return;
+    }
+    out << "Динамическое разрешение: масштаб " << _scale << " (наименьший " << _lowestScale << "), GPU "
+        << _smoothed << " мс при цели " << _config.targetMilliseconds << " мс, уменьшений " << _decreases
+        << ", увеличений " << _increases << std::endl;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vulkan/vulkan.h>
+
+//масштаб разрешения сцены по измеренному времени кадра на GPU. Стоимость сцены растёт с числом пикселей,
+//то есть с квадратом масштаба: при перегрузке масштаб сразу уменьшается до оценки, при запасе - растёт на шаг.
+//Замеры кадров, записанных до смены масштаба, отбрасываются: GPU отстаёт на число кадров в полёте
+class DynamicResolution
+{
+public:
+    struct Config {
+        double targetMilliseconds = 16.0; //время GPU на кадр
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        float step = 0.05f;               //масштабы кратны шагу: близкие значения не дёргают размер сцены
+        uint32_t settleSamples = 8;       //замеров после смены масштаба до следующего решения
+    };
+
+    void configure(const Config& config);
+    bool isEnabled() const { return _enabled; }
+
+    //frameNumber - кадр замера, currentFrame - записываемый кадр; true - масштаб изменился с кадра currentFrame
+    bool update(uint64_t frameNumber, double gpuMilliseconds, uint64_t currentFrame);
+
+    float getScale() const { return _scale; }
+    VkExtent2D scaleExtent(VkExtent2D extent) const; //не меньше 1x1
+    double getSmoothedMilliseconds() const { return _smoothed; }
+    void printReport(std::ostream& out) const;
+
+private:
+    Config _config;
+    bool _enabled = false;
+    float _scale = 1.0f;
+    double _smoothed = 0.0;
+    uint32_t _samples = 0;         //с последней смены масштаба
+    uint64_t _changeFrame = 0;     //первый кадр с текущим масштабом
+    uint64_t _lastSample = UINT64_MAX;
+
+    uint32_t _decreases = 0;
+    uint32_t _increases = 0;
+    float _lowestScale = 1.0f;
+};
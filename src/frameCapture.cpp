@@ -0,0 +1,423 @@
+#include "frameCapture.h"
+
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "loadBinFile.h"
+
+namespace {
+    //поля пишутся по одному: раскладка структур в памяти зависит от компилятора
+    class Writer {
+    public:
+        template<typename T>
+        void put(const T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "в захват пишутся только простые значения");
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            _data.insert(_data.end(), bytes, bytes + sizeof(T));
+        }
+        void putBytes(const std::vector<uint8_t>& bytes) {
+            put<uint64_t>(bytes.size());
+            _data.insert(_data.end(), bytes.begin(), bytes.end());
+        }
+        void putString(const std::string& text) {
+            put<uint32_t>(static_cast<uint32_t>(text.size()));
+            _data.insert(_data.end(), text.begin(), text.end());
+        }
+        const std::vector<uint8_t>& data() const { return _data; }
+
+    private:
+        std::vector<uint8_t> _data;
+    };
+
+    class Reader {
+    public:
+        Reader(const uint8_t* data, uint64_t size) : _data(data), _size(size) {}
+
+        template<typename T>
+        T get() {
+            T value;
+            std::memcpy(&value, take(sizeof(T)), sizeof(T));
+            return value;
+        }
+        std::vector<uint8_t> getBytes() {
+            const uint64_t size = get<uint64_t>();
+            const uint8_t* bytes = take(size);
+            return std::vector<uint8_t>(bytes, bytes + size);
+        }
+        //число элементов массива; elementSize - их размер в файле: повреждённое число не выделяет память сверх блока
+        uint32_t getCount(uint64_t elementSize) {
+            const uint32_t count = get<uint32_t>();
+            if(count * elementSize > _size - _offset)
+                throw std::runtime_error("Повреждённый блок захвата кадров");
+            return count;
+        }
+        std::string getString() {
+            const uint32_t size = get<uint32_t>();
+            const uint8_t* bytes = take(size);
+            return std::string(reinterpret_cast<const char*>(bytes), size);
+        }
+
+    private:
+        const uint8_t* take(uint64_t size) {
+            if(size > _size - _offset)
+                throw std::runtime_error("Повреждённый блок захвата кадров");
+            const uint8_t* bytes = _data + _offset;
+            _offset += size;
+            return bytes;
+        }
+
+        const uint8_t* _data;
+        uint64_t _size;
+        uint64_t _offset = 0;
+    };
+
+    void writeChunk(std::ofstream& file, captureformat::Chunk type, const Writer& payload) {
+        captureformat::ChunkHeader header {};
+        header.type = static_cast<uint32_t>(type);
+        header.size = payload.data().size();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(payload.data().data()), static_cast<std::streamsize>(header.size));
+    }
+
+    void putState(Writer& writer, const PipelineState& state) {
+        writer.put<uint32_t>(state.topology);
+        writer.put<uint32_t>(state.polygonMode);
+        writer.put<uint32_t>(state.cullMode);
+        writer.put<uint32_t>(state.frontFace);
+        writer.put<uint32_t>(state.samples);
+        writer.put<uint8_t>(static_cast<uint8_t>(state.blend));
+        writer.put<uint8_t>(state.keepDestinationAlpha);
+        writer.put<uint8_t>(static_cast<uint8_t>(state.depth));
+    }
+
+    PipelineState getState(Reader& reader) {
+        PipelineState state;
+        state.topology = static_cast<VkPrimitiveTopology>(reader.get<uint32_t>());
+        state.polygonMode = static_cast<VkPolygonMode>(reader.get<uint32_t>());
+        state.cullMode = reader.get<uint32_t>();
+        state.frontFace = static_cast<VkFrontFace>(reader.get<uint32_t>());
+        state.samples = static_cast<VkSampleCountFlagBits>(reader.get<uint32_t>());
+        state.blend = static_cast<BlendMode>(reader.get<uint8_t>());
+        state.keepDestinationAlpha = reader.get<uint8_t>() != 0;
+        state.depth = static_cast<DepthMode>(reader.get<uint8_t>());
+        return state;
+    }
+
+    void putSprite(Writer& writer, const Sprite& sprite) {
+        for(const glm::vec2& value : { sprite.position, sprite.size, sprite.uvMin, sprite.uvMax }) {
+            writer.put<float>(value.x);
+            writer.put<float>(value.y);
+        }
+        writer.put<uint32_t>(sprite.color);
+        writer.put<uint32_t>(sprite.texture);
+        writer.put<float>(sprite.depth);
+        writer.put<uint8_t>(sprite.layer);
+        writer.put<uint8_t>(static_cast<uint8_t>(sprite.blend));
+    }
+
+    //размеры записей putSprite и команды кадра в файле
+    constexpr uint64_t serializedSpriteSize = 8 * sizeof(float) + 2 * sizeof(uint32_t) + sizeof(float) + 2 * sizeof(uint8_t);
+    constexpr uint64_t serializedCommandSize = sizeof(uint32_t) + sizeof(CaptureCommand::args);
+
+    Sprite getSprite(Reader& reader) {
+        Sprite sprite;
+        for(glm::vec2* value : { &sprite.position, &sprite.size, &sprite.uvMin, &sprite.uvMax }) {
+            value->x = reader.get<float>();
+            value->y = reader.get<float>();
+        }
+        sprite.color = reader.get<uint32_t>();
+        sprite.texture = reader.get<uint32_t>();
+        sprite.depth = reader.get<float>();
+        sprite.layer = reader.get<uint8_t>();
+        sprite.blend = static_cast<SpriteBlend>(reader.get<uint8_t>());
+        return sprite;
+    }
+}
+
+bool CapturePipeline::operator==(const CapturePipeline& other) const {
+    return id == other.id && state == other.state && constants == other.constants;
+}
+
+bool CaptureCommand::operator==(const CaptureCommand& other) const {
+    return type == other.type && std::memcmp(args, other.args, sizeof(args)) == 0;
+}
+
+void FrameCapture::configure(const Config& config) {
+    if(config.frameCount == 0)
+        throw std::runtime_error("Захват без кадров");
+    _config = config;
+    _frames.clear();
+    _frames.reserve(config.firstFrame + config.frameCount);
+    _current = nullptr;
+}
+
+void FrameCapture::addResource(CaptureResourceType type, const std::string& name, std::vector<uint8_t> data) {
+    CaptureResource resource;
+    resource.type = type;
+    resource.name = name;
+    resource.data = std::move(data);
+    _resources.push_back(std::move(resource));
+}
+
+void FrameCapture::addResourceFile(CaptureResourceType type, const std::string& name, const std::string& path) {
+    utils::MappedFile file(path);
+    addResource(type, name, std::vector<uint8_t>(file.data(), file.data() + file.size()));
+}
+
+void FrameCapture::beginFrame(uint64_t frameNumber, const glm::mat4& viewProjection, VkExtent2D sceneExtent,
+                              const std::vector<Sprite>& sprites) {
+    CaptureFrame frame;
+    frame.number = frameNumber;
+    frame.measured = frameNumber >= _config.firstFrame;
+    frame.viewProjection = viewProjection;
+    frame.sceneExtent = sceneExtent;
+    frame.sprites = sprites;
+    _frames.push_back(std::move(frame));
+    _current = &_frames.back();
+}
+
+void FrameCapture::addCommand(CaptureCommandType type, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    if(_current == nullptr || !_current->measured)
+        return;
+
+    CaptureCommand command;
+    command.type = type;
+    command.args[0] = a;
+    command.args[1] = b;
+    command.args[2] = c;
+    command.args[3] = d;
+    _current->commands.push_back(command);
+}
+
+void FrameCapture::addInstances(PipelineId pipeline, const std::vector<uint32_t>& instances, uint32_t submeshCount) {
+    for(size_t i = 0; i < instances.size();) {
+        uint32_t run = 1;
+        while(i + run < instances.size() && instances[i + run] == instances[i] + run)
+            run++;
+        addCommand(CaptureCommandType::DrawInstances, pipeline, instances[i], run, submeshCount);
+        i += run;
+    }
+}
+
+void FrameCapture::endFrame(double cpuMilliseconds) {
+    if(_current != nullptr)
+        _current->cpuMilliseconds = cpuMilliseconds;
+    _current = nullptr;
+}
+
+CaptureFrame* FrameCapture::findFrame(uint64_t frameNumber) {
+    //кадры идут подряд с нулевого
+    if(frameNumber >= _frames.size() || _frames[frameNumber].number != frameNumber)
+        return nullptr;
+    return &_frames[frameNumber];
+}
+
+void FrameCapture::setGpuTime(uint64_t frameNumber, double milliseconds) {
+    if(CaptureFrame* frame = findFrame(frameNumber))
+        frame->gpuMilliseconds = milliseconds;
+}
+
+void FrameCapture::setImageHash(uint64_t frameNumber, uint64_t hash) {
+    if(CaptureFrame* frame = findFrame(frameNumber))
+        frame->imageHash = hash;
+}
+
+void FrameCapture::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+        throw std::runtime_error("Не удалось открыть файл для записи: " + path);
+
+    captureformat::Header header {};
+    header.magic = captureformat::magic;
+    header.version = captureformat::version;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    Writer config;
+    config.put<uint32_t>(_captureConfig.width);
+    config.put<uint32_t>(_captureConfig.height);
+    config.put<uint32_t>(_captureConfig.framesInFlight);
+    config.put<uint32_t>(_captureConfig.samples);
+    config.put<uint32_t>(_captureConfig.drawCount);
+    config.put<uint8_t>(_captureConfig.gpuCulling);
+    config.put<uint8_t>(_captureConfig.sceneScaling);
+    config.put<uint32_t>(_captureConfig.descriptorModel);
+    config.put<uint32_t>(_captureConfig.spriteCapacity);
+    config.put<uint64_t>(_captureConfig.textureBudget);
+    config.putString(_captureConfig.device);
+    writeChunk(file, captureformat::Chunk::Config, config);
+
+    for(const auto& resource : _resources) {
+        Writer chunk;
+        chunk.put<uint32_t>(static_cast<uint32_t>(resource.type));
+        chunk.putString(resource.name);
+        chunk.putBytes(resource.data);
+        writeChunk(file, captureformat::Chunk::Resource, chunk);
+    }
+
+    for(const auto& pipeline : _pipelines) {
+        Writer chunk;
+        chunk.put<uint32_t>(pipeline.id);
+        putState(chunk, pipeline.state);
+        chunk.put<uint32_t>(pipeline.constants.count);
+        for(uint32_t i = 0; i < pipeline.constants.count; i++) {
+            chunk.put<uint32_t>(pipeline.constants.ids[i]);
+            chunk.put<uint32_t>(pipeline.constants.values[i]);
+        }
+        writeChunk(file, captureformat::Chunk::Pipeline, chunk);
+    }
+
+    for(const auto& frame : _frames) {
+        Writer chunk;
+        chunk.put<uint64_t>(frame.number);
+        chunk.put<uint8_t>(frame.measured);
+        for(int column = 0; column < 4; column++)
+            for(int row = 0; row < 4; row++)
+                chunk.put<float>(frame.viewProjection[column][row]);
+        chunk.put<uint32_t>(frame.sceneExtent.width);
+        chunk.put<uint32_t>(frame.sceneExtent.height);
+        chunk.put<uint32_t>(static_cast<uint32_t>(frame.sprites.size()));
+        for(const auto& sprite : frame.sprites)
+            putSprite(chunk, sprite);
+        chunk.put<uint32_t>(static_cast<uint32_t>(frame.commands.size()));
+        for(const auto& command : frame.commands) {
+            chunk.put<uint32_t>(static_cast<uint32_t>(command.type));
+            for(uint32_t arg : command.args)
+                chunk.put<uint32_t>(arg);
+        }
+        chunk.put<double>(frame.cpuMilliseconds);
+        chunk.put<double>(frame.gpuMilliseconds);
+        chunk.put<uint64_t>(frame.imageHash);
+        writeChunk(file, captureformat::Chunk::Frame, chunk);
+    }
+
+    if(!file)
+        throw std::runtime_error("Ошибка записи файла: " + path);
+}
+
+void FrameCapture::load(const std::string& path) {
+    utils::MappedFile file(path);
+    const uint8_t* base = file.data();
+    const uint64_t fileSize = file.size();
+
+    captureformat::Header header {};
+    if(fileSize < sizeof(header))
+        throw std::runtime_error("Файл захвата слишком мал: " + path);
+    std::memcpy(&header, base, sizeof(header));
+    if(header.magic != captureformat::magic || header.version != captureformat::version)
+        throw std::runtime_error("Файл не является .vcap поддерживаемой версии: " + path);
+
+    _captureConfig = {};
+    _resources.clear();
+    _pipelines.clear();
+    _frames.clear();
+    _current = nullptr;
+
+    uint64_t offset = sizeof(header);
+    while(offset < fileSize) {
+        captureformat::ChunkHeader chunk {};
+        if(fileSize - offset < sizeof(chunk))
+            throw std::runtime_error("Обрезанный файл захвата: " + path);
+        std::memcpy(&chunk, base + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+        if(chunk.size > fileSize - offset)
+            throw std::runtime_error("Обрезанный файл захвата: " + path);
+        Reader reader(base + offset, chunk.size);
+        offset += chunk.size;
+
+        switch(static_cast<captureformat::Chunk>(chunk.type)) {
+            case captureformat::Chunk::Config: {
+                CaptureConfig& config = _captureConfig;
+                config.width = reader.get<uint32_t>();
+                config.height = reader.get<uint32_t>();
+                config.framesInFlight = reader.get<uint32_t>();
+                config.samples = reader.get<uint32_t>();
+                config.drawCount = reader.get<uint32_t>();
+                config.gpuCulling = reader.get<uint8_t>() != 0;
+                config.sceneScaling = reader.get<uint8_t>() != 0;
+                config.descriptorModel = reader.get<uint32_t>();
+                config.spriteCapacity = reader.get<uint32_t>();
+                config.textureBudget = reader.get<uint64_t>();
+                config.device = reader.getString();
+                break;
+            }
+            case captureformat::Chunk::Resource: {
+                CaptureResource resource;
+                resource.type = static_cast<CaptureResourceType>(reader.get<uint32_t>());
+                resource.name = reader.getString();
+                resource.data = reader.getBytes();
+                _resources.push_back(std::move(resource));
+                break;
+            }
+            case captureformat::Chunk::Pipeline: {
+                CapturePipeline pipeline;
+                pipeline.id = reader.get<uint32_t>();
+                pipeline.state = getState(reader);
+                const uint32_t count = reader.get<uint32_t>();
+                for(uint32_t i = 0; i < count; i++) {
+                    const uint32_t id = reader.get<uint32_t>();
+                    pipeline.constants.set(id, reader.get<uint32_t>());
+                }
+                _pipelines.push_back(pipeline);
+                break;
+            }
+            case captureformat::Chunk::Frame: {
+                CaptureFrame frame;
+                frame.number = reader.get<uint64_t>();
+                frame.measured = reader.get<uint8_t>() != 0;
+                for(int column = 0; column < 4; column++)
+                    for(int row = 0; row < 4; row++)
+                        frame.viewProjection[column][row] = reader.get<float>();
+                frame.sceneExtent.width = reader.get<uint32_t>();
+                frame.sceneExtent.height = reader.get<uint32_t>();
+                frame.sprites.resize(reader.getCount(serializedSpriteSize));
+                for(auto& sprite : frame.sprites)
+                    sprite = getSprite(reader);
+                frame.commands.resize(reader.getCount(serializedCommandSize));
+                for(auto& command : frame.commands) {
+                    command.type = static_cast<CaptureCommandType>(reader.get<uint32_t>());
+                    for(uint32_t& arg : command.args)
+                        arg = reader.get<uint32_t>();
+                }
+                frame.cpuMilliseconds = reader.get<double>();
+                frame.gpuMilliseconds = reader.get<double>();
+                frame.imageHash = reader.get<uint64_t>();
+                if(frame.number != _frames.size())
+                    throw std::runtime_error("Кадры захвата идут не подряд: " + path);
+                _frames.push_back(std::move(frame));
+                break;
+            }
+            default: //блок более новой версии
+                break;
+        }
+    }
+
+    if(_captureConfig.width == 0 || _captureConfig.height == 0)
+        throw std::runtime_error("В захвате нет настроек кадра: " + path);
+}
+
+void FrameCapture::printReport(std::ostream& out) const {
+    size_t measured = 0;
+    size_t commands = 0;
+    for(const auto& frame : _frames) {
+        measured += frame.measured;
+        commands += frame.commands.size();
+    }
+    uint64_t resourceBytes = 0;
+    for(const auto& resource : _resources)
+        resourceBytes += resource.data.size();
+
+    out << "Захват: кадров " << _frames.size() << " (замеряемых " << measured << "), " << _captureConfig.width << "x"
+        << _captureConfig.height << ", ресурсов " << _resources.size() << " (" << (resourceBytes >> 10) << " КБ), вариантов конвейеров "
+        << _pipelines.size() << ", команд " << commands << std::endl;
+}
+
+uint64_t FrameCapture::hashImage(const std::vector<uint8_t>& rgba) {
+    uint64_t hash = 14695981039346656037ull;
+    for(uint8_t byte : rgba) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash != 0 ? hash : 1;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "spriteBatch.h"
+#include "pipelineLibrary.h"
+
+//формат .vcap: заголовок и поток блоков {тип, размер}, числа little-endian как в памяти.
+//Блоки незнакомых типов читатель пропускает, поэтому новые данные не ломают старые захваты
+namespace captureformat {
+    constexpr uint32_t magic = 0x50414356; //"VCAP"
+    constexpr uint32_t version = 1;
+
+    enum class Chunk : uint32_t {
+        Config = 1,
+        Resource,
+        Pipeline,
+        Frame,
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+    };
+
+    struct ChunkHeader {
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t size; //без заголовка блока
+    };
+    static_assert(sizeof(ChunkHeader) == 16, "заголовок блока .vcap не должен зависеть от компилятора");
+}
+
+//настройки, от которых зависит содержимое кадра; фактические, после подбора по возможностям устройства
+struct CaptureConfig {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t framesInFlight = 2;
+    uint32_t samples = 1;
+    uint32_t drawCount = 1;
+    bool gpuCulling = false;
+    bool sceneScaling = false;        //динамическое разрешение: размер сцены записан в каждом кадре
+    uint32_t descriptorModel = 0;     //DescriptorModel
+    uint32_t spriteCapacity = 0;
+    VkDeviceSize textureBudget = 0;   //фактический: от него зависит порядок загрузки уровней текстур
+    std::string device;               //устройство захвата, только для отчёта
+};
+
+enum class CaptureResourceType : uint32_t {
+    Mesh,    //.vmesh; нет блока - встроенный треугольник
+    Texture, //.ktx2 в порядке загрузки
+    Shader,  //SPIR-V, имя без .spv
+};
+
+struct CaptureResource {
+    CaptureResourceType type = CaptureResourceType::Mesh;
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+//вариант конвейера без дескрипторов Vulkan: состояние и константы, по которым его создала библиотека
+struct CapturePipeline {
+    PipelineId id = 0;
+    PipelineState state;
+    SpecializationConstants constants;
+
+    bool operator==(const CapturePipeline& other) const;
+};
+
+enum class CaptureCommandType : uint32_t {
+    DrawInstances,     //pipeline, firstInstance, instanceCount, submeshCount: по vkCmdDrawIndexed на подсетку объекта
+    DrawIndirectCount, //pipeline, maxDraws
+    Dispatch,          //x, y, z
+    Sprites,           //sprites, batches, pipelineBinds
+    Resolve,           //width, height
+    Upscale,           //srcWidth, srcHeight, dstWidth, dstHeight
+};
+
+struct CaptureCommand {
+    CaptureCommandType type = CaptureCommandType::DrawInstances;
+    uint32_t args[4] {};
+
+    bool operator==(const CaptureCommand& other) const;
+    bool operator!=(const CaptureCommand& other) const { return !(*this == other); }
+};
+
+//входные данные кадра и команды, которые приложение по ним записало
+struct CaptureFrame {
+    uint64_t number = 0;
+    bool measured = true; //false - кадр до начала захвата: воспроизводится для состояния, не замеряется
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    VkExtent2D sceneExtent {};
+    std::vector<Sprite> sprites;
+    std::vector<CaptureCommand> commands; //только у замеряемых кадров
+    double cpuMilliseconds = 0.0;         //от начала записи до отправки
+    double gpuMilliseconds = 0.0;         //0 - метки времени недоступны или кадр не успел завершиться
+    uint64_t imageHash = 0;               //0 - не считался
+};
+
+//захват кадров приложения для воспроизведения без окна (tools/replay.cpp). Ресурсы сохраняются целиком,
+//кадры с первого: потоковая загрузка текстур и кольца кадров зависят от всех предыдущих кадров, поэтому кадры
+//до firstFrame пишутся без команд и воспроизводятся без замера. Команды - по записи на проход и диапазон
+//подряд идущих видимых объектов, а не на вызов Vulkan: файл остаётся маленьким при десятках тысяч отрисовок.
+//Только поток кадра
+class FrameCapture
+{
+public:
+    struct Config {
+        uint64_t firstFrame = 0;
+        uint32_t frameCount = 1;
+        bool resources = true; //false - только кадры (сравнение команд при воспроизведении)
+    };
+
+    void configure(const Config& config);
+    bool wantsResources() const { return _config.resources; }
+    bool isCapturing(uint64_t frameNumber) const { return frameNumber < _config.firstFrame + _config.frameCount; }
+
+    void setConfig(const CaptureConfig& config) { _captureConfig = config; }
+    void addResource(CaptureResourceType type, const std::string& name, std::vector<uint8_t> data);
+    void addResourceFile(CaptureResourceType type, const std::string& name, const std::string& path);
+    void addPipeline(const CapturePipeline& pipeline) { _pipelines.push_back(pipeline); }
+
+    //кадр frameNumber, пока не вызван endFrame, получает команды addCommand
+    void beginFrame(uint64_t frameNumber, const glm::mat4& viewProjection, VkExtent2D sceneExtent,
+                    const std::vector<Sprite>& sprites);
+    void addCommand(CaptureCommandType type, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0, uint32_t d = 0);
+    //instances - видимые объекты по возрастанию; подряд идущие становятся одной командой
+    void addInstances(PipelineId pipeline, const std::vector<uint32_t>& instances, uint32_t submeshCount);
+    void endFrame(double cpuMilliseconds);
+    //время GPU приходит с опозданием на число кадров в полёте
+    void setGpuTime(uint64_t frameNumber, double milliseconds);
+    void setImageHash(uint64_t frameNumber, uint64_t hash);
+
+    const CaptureConfig& getConfig() const { return _captureConfig; }
+    const std::vector<CaptureResource>& getResources() const { return _resources; }
+    const std::vector<CapturePipeline>& getPipelines() const { return _pipelines; }
+    const std::vector<CaptureFrame>& getFrames() const { return _frames; }
+
+    void save(const std::string& path) const;
+    void load(const std::string& path);
+    void printReport(std::ostream& out) const;
+
+    //FNV-1a по пикселям кадра; не бывает 0
+    static uint64_t hashImage(const std::vector<uint8_t>& rgba);
+
+private:
+    CaptureFrame* findFrame(uint64_t frameNumber);
+
+    Config _config;
+    CaptureConfig _captureConfig;
+    std::vector<CaptureResource> _resources;
+    std::vector<CapturePipeline> _pipelines;
+    std::vector<CaptureFrame> _frames;
+    CaptureFrame* _current = nullptr;
+};
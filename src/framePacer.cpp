@@ -0,0 +1,90 @@
+#include "framePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+    constexpr double smoothing = 0.1;     //вес нового замера в скользящем среднем
+    constexpr double safetyMargin = 0.15; //запас от интервала вывода на колебания времени кадра
+
+    double toMilliseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+const char* toString(PresentPolicy policy) {
+    switch(policy) {
+        case PresentPolicy::LowLatency: return "low latency";
+        case PresentPolicy::Throughput: return "throughput";
+        case PresentPolicy::PowerSaving: return "power saving";
+    }
+    return "unknown";
+}
+
+void FramePacer::configure(PresentPolicy policy, double fpsCap) {
+    _policy = policy;
+    _capInterval = fpsCap > 0.0
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fpsCap))
+            : Clock::duration::zero();
+}
+
+void FramePacer::waitForNextFrame() {
+    Clock::time_point now = Clock::now();
+
+    if(_policy == PresentPolicy::PowerSaving && _capInterval != Clock::duration::zero()) {
+        if(_nextFrame > now) {
+            std::this_thread::sleep_until(_nextFrame);
+            now = Clock::now();
+        }
+        //отстали больше чем на кадр (сворачивание, пересоздание цепочки) - не догоняем пачкой кадров
+        _nextFrame = std::max(_nextFrame + _capInterval, now);
+    }
+    else if(_policy == PresentPolicy::LowLatency && _hasPresent && _smoothedInterval > 0.0) {
+        //предсказанный следующий вывод минус работа кадра: кадр успевает к тому же vblank,
+        //но собирает ввод как можно позже вместо ожидания в очереди изображений
+        double sleep = _smoothedInterval * (1.0 - safetyMargin) - _smoothedWork - toMilliseconds(now - _lastPresent);
+        sleep = std::min(sleep, _smoothedInterval);
+        if(sleep > 0.0) {
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(sleep));
+            now = Clock::now();
+        }
+    }
+
+    _inputTime = now;
+    _blocked = Clock::duration::zero();
+    _hasInput = true;
+}
+
+void FramePacer::framePresented() {
+    Clock::time_point now = Clock::now();
+
+    if(_hasPresent) {
+        double interval = toMilliseconds(now - _lastPresent);
+        _intervals.addSample(interval);
+        _smoothedInterval = _smoothedInterval > 0.0 ? _smoothedInterval + smoothing * (interval - _smoothedInterval) : interval;
+    }
+
+    if(_hasInput) {
+        double total = toMilliseconds(now - _inputTime);
+        double work = std::max(total - toMilliseconds(_blocked), 0.0);
+        _smoothedWork = _smoothedWork > 0.0 ? _smoothedWork + smoothing * (work - _smoothedWork) : work;
+        if(_smoothedInterval > 0.0)
+            _latency.addSample(total + _smoothedInterval);
+        _hasInput = false;
+    }
+
+    _lastPresent = now;
+    _hasPresent = true;
+}
+
+void FramePacer::print(std::ostream& out) const {
+    if(_intervals.count() == 0)
+        return;
+
+    out << "Вывод (" << toString(_policy) << "): интервал " << _intervals.mean() << " мс"
+        << ", p99: " << _intervals.percentile(0.99) << " мс";
+    if(_latency.count() > 0)
+        out << "; оценка задержки ввод-вывод: " << _latency.mean() << " мс"
+            << ", p99: " << _latency.percentile(0.99) << " мс";
+    out << std::endl;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include "frameStats.h"
+
+//компромисс между задержкой ввода и пропускной способностью при выводе кадров
+enum class PresentPolicy {
+    LowLatency,  //минимум изображений, IMMEDIATE / FIFO_RELAXED при разрешённых разрывах, CPU стартует кадр впритык к выводу
+    Throughput,  //MAILBOX и лишнее изображение в цепочке: GPU не простаивает в ожидании vblank
+    PowerSaving, //FIFO и ограничение частоты кадров: CPU и GPU спят между кадрами
+};
+
+const char* toString(PresentPolicy policy);
+
+//темп кадров: меряет интервалы между выводами и оценивает задержку от опроса ввода до вывода.
+//Без VK_GOOGLE_display_timing реальный момент показа неизвестен, поэтому задержка - оценка:
+//путь от ввода до vkQueuePresentKHR плюс интервал ожидания vblank в очереди вывода
+class FramePacer
+{
+public:
+    void configure(PresentPolicy policy, double fpsCap);
+
+    //перед опросом ввода: сон отодвигает опрос к моменту, когда кадр действительно начнут записывать
+    void waitForNextFrame();
+    //ожидание забора слота и vkAcquireNextImageKHR: именно его LowLatency переносит в сон до опроса ввода,
+    //поэтому в оценку работы кадра оно не входит
+    void addBlockedTime(std::chrono::steady_clock::duration blocked) { _blocked += blocked; }
+    void framePresented(); //сразу после vkQueuePresentKHR
+
+    PresentPolicy getPolicy() const { return _policy; }
+    const FrameStats& getPresentIntervals() const { return _intervals; }
+    const FrameStats& getLatency() const { return _latency; }
+
+    void print(std::ostream& out) const;
+private:
+    using Clock = std::chrono::steady_clock;
+
+    PresentPolicy _policy = PresentPolicy::Throughput;
+    Clock::duration _capInterval {}; //0 - без ограничения
+
+    Clock::time_point _inputTime {};
+    Clock::duration _blocked {};
+    Clock::time_point _lastPresent {};
+    Clock::time_point _nextFrame {}; //PowerSaving: начало следующего кадра по ограничению частоты
+    bool _hasInput = false;
+    bool _hasPresent = false;
+
+    //скользящие средние в миллисекундах: предсказание следующего вывода для LowLatency
+    double _smoothedInterval = 0.0;
+    double _smoothedWork = 0.0; //от опроса ввода до вывода без ожиданий
+
+    FrameStats _intervals;
+    FrameStats _latency;
+};
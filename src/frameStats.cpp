@@ -0,0 +1,51 @@
+#include "frameStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+FrameStats::FrameStats(size_t capacity) : _samples(capacity > 0 ? capacity : 1) {}
+
+void FrameStats::addSample(double milliseconds) {
+    _samples[_next] = milliseconds;
+    _next = (_next + 1) % _samples.size();
+    if(_count < _samples.size())
+        _count++;
+}
+
+void FrameStats::reset() {
+    _next = 0;
+    _count = 0;
+}
+
+size_t FrameStats::count() const {
+    return _count;
+}
+
+double FrameStats::mean() const {
+    if(_count == 0)
+        return 0.0;
+
+    double sum = 0.0;
+    for(size_t i = 0; i < _count; i++)
+        sum += _samples[i];
+    return sum / static_cast<double>(_count);
+}
+
+double FrameStats::percentile(double p) const {
+    if(_count == 0)
+        return 0.0;
+
+    //копия, т.к. nth_element переставляет элементы; вызывается только для отчёта, не каждый кадр
+    std::vector<double> sorted(_samples.begin(), _samples.begin() + static_cast<std::ptrdiff_t>(_count));
+    p = std::clamp(p, 0.0, 1.0);
+    size_t index = static_cast<size_t>(std::lround(p * static_cast<double>(_count - 1)));
+    std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(index), sorted.end());
+    return sorted[index];
+}
+
+void FrameStats::print(std::ostream &out) const {
+    out << "Кадров: " << _count
+        << ", среднее: " << mean() << " мс"
+        << ", p50: " << percentile(0.5) << " мс"
+        << ", p99: " << percentile(0.99) << " мс" << std::endl;
+}
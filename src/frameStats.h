@@ -0,0 +1,28 @@
+#ifndef VULKANPROJECT_FRAMESTATS_H
+#define VULKANPROJECT_FRAMESTATS_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+//статистика времени кадра по последним capacity кадрам (кольцевой буфер, без выделений памяти в цикле)
+class FrameStats
+{
+public:
+    explicit FrameStats(size_t capacity = 4096);
+
+    void addSample(double milliseconds);
+    void reset();
+
+    size_t count() const;
+    double mean() const;
+    double percentile(double p) const; //p в диапазоне [0, 1]
+
+    void print(std::ostream &out) const;
+private:
+    std::vector<double> _samples;
+    size_t _next = 0;
+    size_t _count = 0;
+};
+
+#endif //VULKANPROJECT_FRAMESTATS_H
@@ -0,0 +1,68 @@
+#include "frustumCulling.h"
+
+namespace utils {
+    Frustum extractFrustum(const glm::mat4& viewProjection) {
+        //строки матрицы (glm хранит столбцы)
+        glm::vec4 row[4];
+        for(int i = 0; i < 4; i++)
+            row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+        Frustum frustum;
+        frustum.planes[0] = row[3] + row[0]; //-w <= x
+        frustum.planes[1] = row[3] - row[0]; //x <= w
+        frustum.planes[2] = row[3] + row[1];
+        frustum.planes[3] = row[3] - row[1];
+        frustum.planes[4] = row[2];          //0 <= z
+        frustum.planes[5] = row[3] - row[2]; //z <= w
+
+        for(auto& plane : frustum.planes) { //нормированные плоскости дают расстояние, сравнимое с радиусом
+            float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+            plane = plane / length;
+        }
+        return frustum;
+    }
+
+    void SphereSoA::resize(uint32_t sphereCount) {
+        count = sphereCount;
+        size_t padded = (sphereCount + 3) / 4 * 4;
+        x.assign(padded, 0.0f);
+        y.assign(padded, 0.0f);
+        z.assign(padded, 0.0f);
+        radius.assign(padded, -1.0f); //отрицательный радиус не проходит ни одну плоскость
+    }
+
+    void SphereSoA::set(uint32_t index, float cx, float cy, float cz, float r) {
+        x[index] = cx;
+        y[index] = cy;
+        z[index] = cz;
+        radius[index] = r;
+    }
+
+    void cullSpheres(const SphereSoA& spheres, const Frustum& frustum, std::vector<uint32_t>& visible) {
+        //коэффициенты плоскостей, размноженные на четыре полосы, считаются один раз
+        glm::vec4 nx[6], ny[6], nz[6], d[6];
+        for(int p = 0; p < 6; p++) {
+            nx[p] = glm::vec4(frustum.planes[p].x);
+            ny[p] = glm::vec4(frustum.planes[p].y);
+            nz[p] = glm::vec4(frustum.planes[p].z);
+            d[p] = glm::vec4(frustum.planes[p].w);
+        }
+
+        const size_t padded = spheres.x.size();
+        for(size_t i = 0; i < padded; i += 4) {
+            glm::vec4 cx(spheres.x[i], spheres.x[i + 1], spheres.x[i + 2], spheres.x[i + 3]);
+            glm::vec4 cy(spheres.y[i], spheres.y[i + 1], spheres.y[i + 2], spheres.y[i + 3]);
+            glm::vec4 cz(spheres.z[i], spheres.z[i + 1], spheres.z[i + 2], spheres.z[i + 3]);
+            glm::vec4 r(spheres.radius[i], spheres.radius[i + 1], spheres.radius[i + 2], spheres.radius[i + 3]);
+
+            //без ветвлений: минимум по плоскостям от (расстояние + радиус), сфера видима при >= 0
+            glm::vec4 nearest = nx[0] * cx + ny[0] * cy + nz[0] * cz + d[0] + r;
+            for(int p = 1; p < 6; p++)
+                nearest = glm::min(nearest, nx[p] * cx + ny[p] * cy + nz[p] * cz + d[p] + r);
+
+            for(int lane = 0; lane < 4; lane++)
+                if(nearest[lane] >= 0.0f && spheres.radius[i + lane] >= 0.0f)
+                    visible.push_back(static_cast<uint32_t>(i + lane));
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef VULKANPROJECT_FRUSTUMCULLING_H
+#define VULKANPROJECT_FRUSTUMCULLING_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace utils {
+    //плоскости отсечения (nx, ny, nz, d), нормали внутрь: точка видима, если dot(n, p) + d >= 0.
+    //порядок: левая, правая, нижняя, верхняя, ближняя, дальняя; глубина клип-пространства Vulkan [0, w]
+    struct Frustum {
+        glm::vec4 planes[6];
+    };
+
+    Frustum extractFrustum(const glm::mat4& viewProjection);
+
+    //ограничивающие сферы раздельными массивами, длина кратна 4 (хвост заполнен невидимыми сферами)
+    struct SphereSoA {
+        std::vector<float> x, y, z, radius;
+        uint32_t count = 0;
+
+        void resize(uint32_t sphereCount);
+        void set(uint32_t index, float cx, float cy, float cz, float r);
+    };
+
+    //по четыре сферы за итерацию в полосах glm::vec4; индексы видимых сфер дописываются в visible по возрастанию
+    void cullSpheres(const SphereSoA& spheres, const Frustum& frustum, std::vector<uint32_t>& visible);
+}
+
+#endif //VULKANPROJECT_FRUSTUMCULLING_H
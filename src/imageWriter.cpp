@@ -0,0 +1,140 @@
+#include "imageWriter.h"
+
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    std::ofstream openOutput(const std::string &filename) {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if(!file.is_open())
+            throw std::runtime_error("Не удалось открыть файл для записи: " + filename);
+        return file;
+    }
+
+    uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+        static uint32_t table[256];
+        static bool tableReady = false;
+        if(!tableReady) {
+            for(uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for(int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+            tableReady = true;
+        }
+
+        crc = ~crc;
+        for(size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void putBE32(std::vector<uint8_t> &out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void writeChunk(std::ofstream &file, const char type[4], const std::vector<uint8_t> &payload) {
+        std::vector<uint8_t> chunk;
+        putBE32(chunk, static_cast<uint32_t>(payload.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), payload.begin(), payload.end());
+        putBE32(chunk, crc32(chunk.data() + 4, payload.size() + 4)); //crc считается по типу и данным
+
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+}
+
+void utils::writePPM(const std::string &filename, uint32_t width, uint32_t height, const std::vector<uint8_t> &rgba) {
+    std::ofstream file = openOutput(filename);
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for(uint32_t y = 0; y < height; y++) {
+        const uint8_t *src = rgba.data() + static_cast<size_t>(y) * width * 4;
+        for(uint32_t x = 0; x < width; x++) { //альфа канал в PPM не хранится
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+}
+
+//PNG без сжатия: deflate поток из "stored" блоков, чтобы не тянуть zlib ради отладочных снимков
+void utils::writePNG(const std::string &filename, uint32_t width, uint32_t height, const std::vector<uint8_t> &rgba) {
+    std::ofstream file = openOutput(filename);
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), 8);
+
+    std::vector<uint8_t> header;
+    putBE32(header, width);
+    putBE32(header, height);
+    header.push_back(8); //бит на канал
+    header.push_back(6); //RGBA
+    header.push_back(0); //deflate
+    header.push_back(0); //стандартная фильтрация
+    header.push_back(0); //без чересстрочности
+    writeChunk(file, "IHDR", header);
+
+    //каждая строка начинается с байта фильтра (0 - без фильтра)
+    size_t stride = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((stride + 1) * height);
+    for(uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgba.begin() + y * stride, rgba.begin() + (y + 1) * stride);
+    }
+
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+
+    uint32_t a = 1, b = 0; //adler32
+    size_t offset = 0;
+    do {
+        size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + blockSize == raw.size();
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(blockSize));
+        zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+        zlib.push_back(static_cast<uint8_t>(~blockSize));
+        zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+
+        for(size_t i = offset; i < offset + blockSize; i++) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while(offset < raw.size());
+    putBE32(zlib, (b << 16) | a);
+
+    writeChunk(file, "IDAT", zlib);
+    writeChunk(file, "IEND", {});
+}
+
+void utils::writeRaw(const std::string &filename, const std::vector<uint8_t> &data) {
+    std::ofstream file = openOutput(filename);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+void utils::writeImage(const std::string &filename, uint32_t width, uint32_t height, const std::vector<uint8_t> &rgba) {
+    auto endsWith = [&filename](const std::string &suffix) {
+        return filename.size() >= suffix.size() && filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    if(endsWith(".ppm"))
+        writePPM(filename, width, height, rgba);
+    else if(endsWith(".png"))
+        writePNG(filename, width, height, rgba);
+    else
+        writeRaw(filename, rgba);
+}
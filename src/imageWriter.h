@@ -0,0 +1,18 @@
+#ifndef VULKANPROJECT_IMAGEWRITER_H
+#define VULKANPROJECT_IMAGEWRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace utils {
+    //rgba - плотно упакованные пиксели по 4 байта, построчно сверху вниз
+    void writePPM(const std::string &filename, uint32_t width, uint32_t height, const std::vector<uint8_t> &rgba);
+    void writePNG(const std::string &filename, uint32_t width, uint32_t height, const std::vector<uint8_t> &rgba);
+    void writeRaw(const std::string &filename, const std::vector<uint8_t> &data);
+
+    //выбирает формат по расширению файла (.ppm, .png, иначе сырые байты)
+    void writeImage(const std::string &filename, uint32_t width, uint32_t height, const std::vector<uint8_t> &rgba);
+}
+
+#endif //VULKANPROJECT_IMAGEWRITER_H
@@ -0,0 +1,203 @@
+#include "initGraph.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <iostream>
+
+InitGraph::~InitGraph() {
+    waitDeferred();
+}
+
+InitGraph::TaskId InitGraph::add(const char* name, Body body, std::initializer_list<TaskId> dependencies) {
+    return addTask(name, std::move(body), dependencies, false);
+}
+
+InitGraph::TaskId InitGraph::addDeferred(const char* name, Body body, std::initializer_list<TaskId> dependencies) {
+    return addTask(name, std::move(body), dependencies, true);
+}
+
+InitGraph::TaskId InitGraph::addTask(const char* name, Body body, std::initializer_list<TaskId> dependencies, bool deferred) {
+    const TaskId id = static_cast<TaskId>(_tasks.size());
+    _tasks.emplace_back();
+    Task& task = _tasks.back();
+    task.name = name;
+    task.body = std::move(body);
+    task.deferred = deferred;
+    task.remaining = static_cast<uint32_t>(dependencies.size());
+
+    for(TaskId dependency : dependencies) {
+        if(dependency >= id)
+            throw std::runtime_error(std::string("Зависимость задачи инициализации добавлена позже неё: ") + name);
+        if(_tasks[dependency].deferred && !deferred)
+            throw std::runtime_error(std::string("Обычная задача инициализации зависит от отложенной: ") + name);
+        _tasks[dependency].dependents.push_back(id);
+        task.dependencies.push_back(dependency);
+    }
+    return id;
+}
+
+double InitGraph::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start).count();
+}
+
+void InitGraph::run(JobSystem& jobs) {
+    _jobs = &jobs;
+    _start = std::chrono::steady_clock::now();
+
+    for(const auto& task : _tasks)
+        _deferredLeft += task.deferred ? 1 : 0;
+    if(_deferredLeft > 0)
+        _deferredThread = std::thread(&InitGraph::deferredLoop, this);
+
+    for(TaskId id = 0; id < _tasks.size(); id++)
+        if(_tasks[id].remaining == 0)
+            schedule(id);
+
+    //ожидающий поток тоже выполняет задачи
+    jobs.wait(_counter);
+    _wallTime = now();
+
+    if(_failed) {
+        waitDeferred();
+        std::rethrow_exception(_error);
+    }
+}
+
+void InitGraph::schedule(TaskId id) {
+    if(_failed)
+        return;
+
+    if(_tasks[id].deferred) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _deferredQueue.push_back(id);
+        }
+        _deferredReady.notify_one();
+        return;
+    }
+
+    _jobs->submit([this, id](uint32_t worker) { execute(id, worker); }, _counter);
+}
+
+void InitGraph::execute(TaskId id, uint32_t worker) {
+    Task& task = _tasks[id];
+    task.worker = worker;
+    task.start = now();
+    bool succeeded = true; //только своя ошибка: задачи, завершившиеся после чужой ошибки, выполнены
+    try {
+        Profiler::CpuScope zone(_profiler, task.name);
+        task.body();
+    } catch(const std::exception& e) {
+        succeeded = false;
+        //после run отложенную ошибку некому пробросить - хотя бы сообщаем о ней
+        if(task.deferred)
+            std::cerr << "Отложенная задача инициализации " << task.name << ": " << e.what() << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!_error)
+                _error = std::current_exception();
+            _failed = true;
+        }
+        _deferredReady.notify_all();
+    }
+    task.duration = now() - task.start;
+    task.done.store(succeeded, std::memory_order_release);
+
+    //зависимые задачи ставятся в очередь до выхода из этой, поэтому счётчик run не обнуляется раньше времени
+    for(TaskId dependent : task.dependents)
+        if(_tasks[dependent].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            schedule(dependent);
+}
+
+void InitGraph::deferredLoop() {
+    const uint32_t backgroundWorker = UINT32_MAX;
+    for(;;) {
+        TaskId id;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _deferredReady.wait(lock, [this] { return !_deferredQueue.empty() || _deferredLeft == 0 || _failed; });
+            if(_deferredQueue.empty())
+                return;
+            id = _deferredQueue.front();
+            _deferredQueue.pop_front();
+        }
+
+        execute(id, backgroundWorker);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _deferredLeft--;
+    }
+}
+
+void InitGraph::waitDeferred() {
+    if(!_deferredThread.joinable())
+        return;
+
+    _deferredReady.notify_all();
+    _deferredThread.join();
+}
+
+double InitGraph::getTaskMilliseconds(const std::string& name) const {
+    for(const auto& task : _tasks)
+        if(name == task.name && task.done.load(std::memory_order_acquire))
+            return task.duration / 1000.0;
+    return 0.0;
+}
+
+void InitGraph::printReport(std::ostream& out) const {
+    //критический путь: для каждой задачи самая долгая цепочка до неё включительно (задачи добавлены в порядке зависимостей)
+    std::vector<double> chain(_tasks.size(), 0.0);
+    std::vector<int64_t> previous(_tasks.size(), -1);
+    for(TaskId id = 0; id < _tasks.size(); id++) {
+        if(_tasks[id].deferred)
+            continue;
+        for(TaskId dependency : _tasks[id].dependencies) {
+            if(chain[dependency] > chain[id]) {
+                chain[id] = chain[dependency];
+                previous[id] = dependency;
+            }
+        }
+        chain[id] += _tasks[id].duration;
+    }
+
+    int64_t last = -1;
+    for(TaskId id = 0; id < _tasks.size(); id++)
+        if(!_tasks[id].deferred && (last < 0 || chain[id] > chain[last]))
+            last = id;
+
+    std::vector<TaskId> order(_tasks.size());
+    for(TaskId id = 0; id < order.size(); id++)
+        order[id] = id;
+    auto startOf = [this](TaskId id) {
+        const Task& task = _tasks[id];
+        return !task.deferred || task.done.load(std::memory_order_acquire) ? task.start : 1e300; //выполняющиеся - в конец
+    };
+    std::sort(order.begin(), order.end(), [&startOf](TaskId a, TaskId b) { return startOf(a) < startOf(b); });
+
+    const std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(2);
+    out << "Инициализация: " << _wallTime / 1000.0 << " мс, сумма задач "
+        << [this] { double sum = 0.0; for(const auto& task : _tasks) sum += task.deferred ? 0.0 : task.duration; return sum; }() / 1000.0
+        << " мс" << std::endl;
+    for(TaskId id : order) {
+        const Task& task = _tasks[id];
+        out << "  " << std::setw(22) << std::left << task.name << std::right;
+        if(task.deferred && !task.done.load(std::memory_order_acquire)) {
+            out << " фон, ещё выполняется" << std::endl;
+            continue;
+        }
+        out << " +" << std::setw(8) << task.start / 1000.0 << " мс  " << std::setw(8) << task.duration / 1000.0 << " мс  "
+            << (task.deferred ? "фон" : "исп. " + std::to_string(task.worker))
+            << (task.done ? "" : " (ошибка)") << std::endl;
+    }
+
+    std::vector<const char*> path;
+    for(int64_t id = last; id >= 0; id = previous[id])
+        path.push_back(_tasks[id].name);
+    out << "  критический путь:";
+    for(auto it = path.rbegin(); it != path.rend(); ++it)
+        out << (it == path.rbegin() ? " " : " -> ") << *it;
+    out << std::endl;
+    out.flags(flags);
+}
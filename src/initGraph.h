@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <initializer_list>
+#include <ostream>
+#include <cstdint>
+
+#include "jobSystem.h"
+#include "profiler.h"
+
+//инициализация как граф зависимостей: задача запускается на исполнителях JobSystem, как только
+//завершены все её зависимости, независимые задачи идут параллельно.
+//Отложенные задачи (несрочная компиляция конвейеров) выполняются фоновым потоком и могут закончиться
+//уже после первого кадра; обычные задачи не могут от них зависеть
+class InitGraph
+{
+public:
+    using TaskId = uint32_t;
+    using Body = std::function<void()>;
+
+    explicit InitGraph(Profiler& profiler) : _profiler(profiler) {}
+    ~InitGraph(); //дожидается отложенных задач
+
+    InitGraph(const InitGraph&) = delete;
+    InitGraph& operator=(const InitGraph&) = delete;
+
+    TaskId add(const char* name, Body body, std::initializer_list<TaskId> dependencies = {});
+    TaskId addDeferred(const char* name, Body body, std::initializer_list<TaskId> dependencies = {});
+
+    //возвращается после всех обычных задач; первое исключение задачи пробрасывается, зависящие от неё задачи не запускаются
+    void run(JobSystem& jobs);
+    void waitDeferred();
+
+    //время каждой задачи и критический путь - цепочка зависимостей, задающая общее время
+    void printReport(std::ostream& out) const;
+    //мс; 0 - задачи с таким именем нет или она ещё не завершена
+    double getTaskMilliseconds(const std::string& name) const;
+    double getWallMilliseconds() const { return _wallTime / 1000.0; }
+
+private:
+    struct Task {
+        const char* name;
+        Body body;
+        std::vector<TaskId> dependents;
+        std::vector<TaskId> dependencies;
+        bool deferred = false;
+        std::atomic<uint32_t> remaining { 0 };
+
+        //мкс от начала run
+        double start = 0.0;
+        double duration = 0.0;
+        uint32_t worker = 0;
+        std::atomic<bool> done { false }; //время отложенной задачи можно читать только после done
+    };
+
+    TaskId addTask(const char* name, Body body, std::initializer_list<TaskId> dependencies, bool deferred);
+    void schedule(TaskId id);
+    void execute(TaskId id, uint32_t worker);
+    void deferredLoop();
+    double now() const;
+
+    Profiler& _profiler;
+    std::deque<Task> _tasks; //deque: адреса задач стабильны при добавлении (atomic не перемещается)
+    JobSystem* _jobs = nullptr;
+    JobSystem::Counter _counter;
+    std::chrono::steady_clock::time_point _start;
+    double _wallTime = 0.0;
+
+    std::mutex _mutex;
+    std::condition_variable _deferredReady;
+    std::deque<TaskId> _deferredQueue;
+    uint32_t _deferredLeft = 0;
+    std::thread _deferredThread;
+    std::exception_ptr _error;
+    std::atomic<bool> _failed { false };
+};
@@ -0,0 +1,166 @@
+#include "jobSystem.h"
+
+#include <algorithm>
+
+namespace {
+    //номер исполнителя текущего потока; потоки не из пула считаются исполнителем 0
+    thread_local uint32_t currentWorker = 0;
+}
+
+JobSystem::~JobSystem() {
+    shutdown();
+}
+
+void JobSystem::init(uint32_t workerCount) {
+    if(workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    _stop = false;
+    _workers.clear();
+    for(uint32_t i = 0; i < workerCount; i++)
+        _workers.push_back(std::make_unique<Worker>());
+
+    for(uint32_t i = 1; i < workerCount; i++)
+        _threads.emplace_back(&JobSystem::run, this, i);
+}
+
+void JobSystem::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for(auto& thread : _threads)
+        thread.join();
+    _threads.clear();
+}
+
+void JobSystem::submit(Job job, Counter& counter) {
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+    if(_threads.empty()) { //однопоточный режим: без очередей и синхронизации
+        execute(job, counter, 0);
+        return;
+    }
+
+    Worker& worker = *_workers[currentWorker];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back({ std::move(job), &counter });
+    }
+    {
+        //под мьютексом сна, иначе уведомление может проскочить между проверкой и засыпанием
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    _wake.notify_one();
+}
+
+bool JobSystem::tryRunOne(uint32_t worker) {
+    Task task;
+    bool found = false;
+
+    {
+        //свои задачи берём с конца: они свежие и их данные ещё в кэше
+        Worker& own = *_workers[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    for(uint32_t i = 1; !found && i < _workers.size(); i++) {
+        Worker& victim = *_workers[(worker + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front()); //чужие - с начала, меньше спорим с владельцем
+            victim.tasks.pop_front();
+            found = true;
+            _steals.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if(!found)
+        return false;
+
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+    execute(task.job, *task.counter, worker);
+    return true;
+}
+
+//счётчик уменьшается и после исключения: иначе wait не вернётся, а ожидающий не может уйти со стека,
+//пока задачи группы ссылаются на его данные
+void JobSystem::execute(const Job& job, Counter& counter, uint32_t worker) {
+    try {
+        job(worker);
+    } catch(...) {
+        std::lock_guard<std::mutex> lock(counter.errorMutex);
+        if(!counter.error)
+            counter.error = std::current_exception();
+    }
+    counter.pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::wait(Counter& counter) {
+    while(counter.pending.load(std::memory_order_acquire) != 0) {
+        if(!tryRunOne(currentWorker))
+            std::this_thread::yield(); //оставшиеся задачи уже выполняются другими исполнителями
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter.errorMutex);
+        std::swap(error, counter.error);
+    }
+    if(error)
+        std::rethrow_exception(error);
+}
+
+void JobSystem::run(uint32_t worker) {
+    currentWorker = worker;
+    while(true) {
+        if(tryRunOne(worker))
+            continue;
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _wake.wait(lock, [this] { return _stop || _queued.load(std::memory_order_relaxed) != 0; });
+        if(_stop)
+            return;
+    }
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t rangeCount,
+                            const std::function<void(uint32_t, uint32_t, uint32_t, uint32_t)>& body,
+                            uint32_t workerLimit) {
+    rangeCount = std::max(1u, std::min(rangeCount, count));
+    if(count == 0)
+        return;
+
+    auto rangeBegin = [count, rangeCount](uint32_t range) {
+        return static_cast<uint32_t>(static_cast<uint64_t>(count) * range / rangeCount);
+    };
+
+    Counter counter;
+    if(workerLimit == 0 || workerLimit >= rangeCount) {
+        for(uint32_t range = 0; range < rangeCount; range++) {
+            uint32_t begin = rangeBegin(range);
+            uint32_t end = rangeBegin(range + 1);
+            submit([&body, begin, end, range](uint32_t worker) { body(begin, end, range, worker); }, counter);
+        }
+        wait(counter);
+        return;
+    }
+
+    //задач столько, сколько исполнителей допущено; каждая забирает следующий диапазон из общего счётчика
+    std::atomic<uint32_t> next { 0 };
+    for(uint32_t task = 0; task < workerLimit; task++)
+        submit([&](uint32_t worker) {
+            for(uint32_t range = next.fetch_add(1, std::memory_order_relaxed); range < rangeCount;
+                range = next.fetch_add(1, std::memory_order_relaxed))
+                body(rangeBegin(range), rangeBegin(range + 1), range, worker);
+        }, counter);
+    wait(counter);
+}
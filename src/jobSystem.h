@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <cstdint>
+
+//пул потоков с перехватом задач: у каждого исполнителя своя очередь, свободный исполнитель
+//забирает задачи из начала чужой. Исполнитель 0 - поток, который ждёт (обычно главный), он тоже выполняет задачи
+class JobSystem
+{
+public:
+    using Job = std::function<void(uint32_t worker)>;
+
+    //число незавершённых задач группы; wait возвращается, когда оно становится нулём.
+    //Исключение задачи не выходит за пределы исполнителя: первое сохраняется и бросается из wait
+    struct Counter {
+        std::atomic<uint32_t> pending { 0 };
+        std::mutex errorMutex;
+        std::exception_ptr error;
+    };
+
+    JobSystem() = default;
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void init(uint32_t workerCount); //0 - по числу аппаратных потоков
+    void shutdown();
+
+    void submit(Job job, Counter& counter);
+    //ждёт все задачи группы, даже если какая-то бросила исключение, затем бросает первое из них
+    void wait(Counter& counter);
+
+    //делит [0, count) на rangeCount смежных диапазонов и выполняет body(begin, end, range, worker) параллельно.
+    //workerLimit > 0 - диапазоны выполняют не больше workerLimit исполнителей (замеры масштабирования по потокам)
+    void parallelFor(uint32_t count, uint32_t rangeCount,
+                     const std::function<void(uint32_t begin, uint32_t end, uint32_t range, uint32_t worker)>& body,
+                     uint32_t workerLimit = 0);
+
+    uint32_t getWorkerCount() const { return static_cast<uint32_t>(_workers.size()); }
+    uint64_t getStealCount() const { return _steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Task {
+        Job job;
+        Counter* counter;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(uint32_t worker);
+    bool tryRunOne(uint32_t worker);
+    static void execute(const Job& job, Counter& counter, uint32_t worker);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::vector<std::thread> _threads;
+
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    std::atomic<uint32_t> _queued { 0 };
+    std::atomic<uint64_t> _steals { 0 };
+    bool _stop = false;
+};
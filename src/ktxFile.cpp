@@ -0,0 +1,107 @@
+#include "ktxFile.h"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace ktx2 {
+    FormatBlock formatBlock(VkFormat format) {
+        switch(format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+            case VK_FORMAT_BC4_SNORM_BLOCK:
+                return { 4, 4, 8 };
+            case VK_FORMAT_BC2_UNORM_BLOCK:
+            case VK_FORMAT_BC2_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+            case VK_FORMAT_BC5_SNORM_BLOCK:
+            case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+            case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                return { 4, 4, 16 };
+            case VK_FORMAT_R8_UNORM:
+                return { 1, 1, 1 };
+            case VK_FORMAT_R8G8_UNORM:
+                return { 1, 1, 2 };
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+                return { 1, 1, 4 };
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+                return { 1, 1, 8 };
+            default:
+                return {};
+        }
+    }
+
+    bool isBlockCompressed(VkFormat format) {
+        return formatBlock(format).width > 1;
+    }
+
+    uint64_t levelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level) {
+        FormatBlock block = formatBlock(format);
+        uint64_t levelWidth = std::max(1u, width >> level);
+        uint64_t levelHeight = std::max(1u, height >> level);
+        return (levelWidth + block.width - 1) / block.width * ((levelHeight + block.height - 1) / block.height) * block.bytes;
+    }
+
+    uint32_t fullMipCount(uint32_t width, uint32_t height) {
+        uint32_t count = 1;
+        for(uint32_t size = std::max(width, height); size > 1; size >>= 1)
+            count++;
+        return count;
+    }
+}
+
+void KtxFile::open(const std::string& path) {
+    _file = utils::MappedFile(path);
+    const uint8_t* base = _file.data();
+    const uint64_t fileSize = _file.size();
+
+    if(fileSize < sizeof(ktx2::Header))
+        throw std::runtime_error("Файл текстуры слишком мал: " + path);
+
+    ktx2::Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if(std::memcmp(header.identifier, ktx2::identifier, sizeof(ktx2::identifier)) != 0)
+        throw std::runtime_error("Файл не является KTX2: " + path);
+
+    const VkFormat format = static_cast<VkFormat>(header.vkFormat);
+    if(ktx2::formatBlock(format).bytes == 0)
+        throw std::runtime_error("Неподдерживаемый формат KTX2 (" + std::to_string(header.vkFormat) + "): " + path);
+    if(header.supercompressionScheme != 0)
+        throw std::runtime_error("Суперсжатие KTX2 (Basis, zstd) не поддерживается: " + path);
+    if(header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+        throw std::runtime_error("Поддерживаются только 2D текстуры без слоёв и граней: " + path);
+
+    const uint32_t levelCount = std::max(header.levelCount, 1u);
+    if(levelCount > ktx2::fullMipCount(header.pixelWidth, header.pixelHeight)
+       || sizeof(header) + levelCount * sizeof(ktx2::LevelIndex) > fileSize)
+        throw std::runtime_error("Повреждённый индекс уровней KTX2: " + path);
+
+    TextureData data;
+    data.format = format;
+    data.width = header.pixelWidth;
+    data.height = header.pixelHeight;
+    data.generateMips = header.levelCount == 0;
+
+    data.levels.resize(levelCount);
+    for(uint32_t level = 0; level < levelCount; level++) {
+        ktx2::LevelIndex index;
+        std::memcpy(&index, base + sizeof(header) + level * sizeof(index), sizeof(index));
+        if(index.byteOffset > fileSize || index.byteLength > fileSize - index.byteOffset
+           || index.byteLength != ktx2::levelSize(format, data.width, data.height, level))
+            throw std::runtime_error("Уровень " + std::to_string(level) + " KTX2 повреждён: " + path);
+
+        data.levels[level] = { base + index.byteOffset, index.byteLength };
+    }
+
+    _data = std::move(data);
+}
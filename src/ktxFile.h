@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "loadBinFile.h"
+
+//KTX2 (Khronos): формат хранится как VkFormat, уровни лежат так, как их копирует vkCmdCopyBufferToImage.
+//Поддерживаются 2D текстуры без суперсжатия (Basis/zstd) в форматах BCn и несжатых 8/16 бит на канал
+namespace ktx2 {
+    constexpr uint8_t identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    struct Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;             //0 - в файле только базовый уровень, остальные создаёт загрузчик
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "заголовок KTX2 не должен зависеть от компилятора");
+
+    //сразу после заголовка, уровень 0 (наибольший) первым
+    struct LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+    static_assert(sizeof(LevelIndex) == 24, "индекс уровней KTX2 не должен зависеть от компилятора");
+
+    //блок формата: 1x1 у несжатых; bytes == 0 - формат не поддерживается
+    struct FormatBlock {
+        uint32_t width = 1;
+        uint32_t height = 1;
+        uint32_t bytes = 0;
+    };
+    FormatBlock formatBlock(VkFormat format);
+    bool isBlockCompressed(VkFormat format);
+
+    //размер уровня level текстуры width x height, плотно упакованного по блокам
+    uint64_t levelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level);
+    //полная цепочка до 1x1
+    uint32_t fullMipCount(uint32_t width, uint32_t height);
+}
+
+struct TextureLevel {
+    const void* data = nullptr;
+    uint64_t size = 0;
+};
+
+//вид на данные текстуры: указатели в отображённый файл
+struct TextureData {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<TextureLevel> levels; //уровни из файла, 0 - наибольший
+    bool generateMips = false;        //в файле только базовый уровень (levelCount == 0)
+};
+
+//.ktx2, отображённый в память; данные действительны, пока жив объект
+class KtxFile
+{
+public:
+    void open(const std::string& path);
+    const TextureData& data() const { return _data; }
+
+private:
+    utils::MappedFile _file;
+    TextureData _data;
+};
@@ -1,18 +1,55 @@
 #include "loadBinFile.h"
 
-std::vector<char> utils::readFile(const std::string & filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-    if(!file.is_open())
-        throw std::runtime_error("Не удалось открыть файл!");
+utils::MappedFile::MappedFile(const std::string & filename) {
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        throw std::runtime_error("Не удалось открыть файл: " + filename);
 
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
+    struct stat st {};
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Не удалось получить размер файла: " + filename);
+    }
 
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+    _size = static_cast<size_t>(st.st_size);
+    if(_size > 0) { //mmap нулевой длины запрещён
+        void* mapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Не удалось отобразить файл в память: " + filename);
+        }
+        _data = static_cast<const uint8_t*>(mapped);
+    }
 
-    file.close();
+    close(fd); //отображение остаётся действительным после закрытия дескриптора
+}
 
-    return buffer;
-}
\ No newline at end of file
+utils::MappedFile::~MappedFile() {
+    release();
+}
+
+utils::MappedFile::MappedFile(MappedFile&& other) noexcept
+    : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {}
+
+utils::MappedFile& utils::MappedFile::operator=(MappedFile&& other) noexcept {
+    if(this != &other) {
+        release();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+void utils::MappedFile::release() {
+    if(_data != nullptr)
+        munmap(const_cast<uint8_t*>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+}
@@ -1,12 +1,33 @@
 #ifndef VULKANPROJECT_LOADBINFILE_H
 #define VULKANPROJECT_LOADBINFILE_H
 
-#include <fstream>
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <vector>
 
 namespace utils {
-    std::vector<char> readFile(const std::string &filename);
+    //файл, отображённый в память только для чтения (без копирования через ifstream).
+    //mmap возвращает адрес, выровненный по странице, поэтому данные можно читать как uint32_t
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string &filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        const uint8_t* data() const { return _data; }
+        size_t size() const { return _size; }
+
+    private:
+        void release();
+
+        const uint8_t* _data = nullptr;
+        size_t _size = 0;
+    };
 }
 
 #endif //VULKANPROJECT_LOADBINFILE_H
@@ -0,0 +1,75 @@
+#include "log.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <iostream>
+
+namespace {
+    std::atomic<utils::Verbosity> verbosity { utils::Verbosity::Normal };
+    std::mutex outputMutex;
+
+    //копит строку сообщения и выводит её в std::cout одной записью под мьютексом:
+    //строки задач инициализации из разных потоков не перемешиваются
+    class LineBuffer : public std::streambuf
+    {
+    public:
+        ~LineBuffer() override {
+            if(!_line.empty()) //строка без перевода в конце - при завершении потока
+                writeLine();
+        }
+
+    protected:
+        int_type overflow(int_type c) override {
+            if(traits_type::eq_int_type(c, traits_type::eof()))
+                return traits_type::not_eof(c);
+
+            const char character = traits_type::to_char_type(c);
+            _line.push_back(character);
+            if(character == '\n')
+                writeLine();
+            return c;
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize count) override {
+            for(std::streamsize i = 0; i < count; i++)
+                overflow(traits_type::to_int_type(data[i]));
+            return count;
+        }
+
+        int sync() override { //std::endl и std::flush: завершённые строки уже выведены
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout.flush();
+            return 0;
+        }
+
+    private:
+        void writeLine() {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout.write(_line.data(), static_cast<std::streamsize>(_line.size()));
+            _line.clear();
+        }
+
+        std::string _line;
+    };
+
+    //у каждого потока свои потоки вывода: состояние потока (флаги, badbit) не делится между задачами
+    struct ThreadStreams {
+        LineBuffer buffer;
+        std::ostream out { &buffer };
+        std::ostream null { nullptr }; //без буфера поток сразу в состоянии badbit и отбрасывает всё, что в него пишут
+    };
+    thread_local ThreadStreams streams;
+}
+
+void utils::setVerbosity(Verbosity level) {
+    verbosity.store(level, std::memory_order_relaxed);
+}
+
+utils::Verbosity utils::getVerbosity() {
+    return verbosity.load(std::memory_order_relaxed);
+}
+
+std::ostream& utils::log(Verbosity level) {
+    return level <= getVerbosity() ? streams.out : streams.null;
+}
@@ -0,0 +1,22 @@
+#ifndef VULKANPROJECT_LOG_H
+#define VULKANPROJECT_LOG_H
+
+#include <cstdint>
+#include <ostream>
+
+namespace utils {
+    enum class Verbosity : uint8_t {
+        Quiet,   //только ошибки (std::cerr) и итоговые отчёты
+        Normal,  //ход инициализации и отчёт по фазам
+        Verbose, //подробности устройства: расширения, свойства, возможности swapchain
+    };
+
+    void setVerbosity(Verbosity verbosity);
+    Verbosity getVerbosity();
+
+    //поток текущего потока выполнения: если уровень сообщения не выше заданного, строки уходят в std::cout
+    //целиком, по одной под мьютексом, иначе поток ничего не выводит
+    std::ostream& log(Verbosity level = Verbosity::Normal);
+}
+
+#endif //VULKANPROJECT_LOG_H
@@ -0,0 +1,577 @@
+#include "memoryAllocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+    const uint32_t dedicatedBlock = UINT32_MAX;
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) {
+        return value / alignment * alignment;
+    }
+
+    uint32_t floorLog2(VkDeviceSize value) {
+        return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+    }
+}
+
+//---------------------------------------------------------------- TLSF
+
+void DeviceAllocator::TlsfBlock::init(VkDeviceMemory blockMemory, VkDeviceSize blockSize, void* blockMapped) {
+    memory = blockMemory;
+    size = blockSize;
+    mapped = blockMapped;
+
+    for(auto& list : freeLists)
+        std::fill(std::begin(list), std::end(list), none);
+
+    uint32_t node = newNode();
+    nodes[node] = { 0, blockSize, none, none, none, none, true };
+    insertFree(node);
+}
+
+uint32_t DeviceAllocator::TlsfBlock::newNode() {
+    if(!unusedNodes.empty()) {
+        uint32_t node = unusedNodes.back();
+        unusedNodes.pop_back();
+        return node;
+    }
+    nodes.push_back({});
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void DeviceAllocator::TlsfBlock::mapping(VkDeviceSize value, uint32_t& fl, uint32_t& sl) {
+    if(value < (1ull << smallSizeLog2)) {
+        fl = 0;
+        sl = static_cast<uint32_t>(value >> (smallSizeLog2 - slLog2));
+        return;
+    }
+    uint32_t f = floorLog2(value);
+    sl = static_cast<uint32_t>(value >> (f - slLog2)) ^ slCount;
+    fl = f - smallSizeLog2 + 1;
+}
+
+void DeviceAllocator::TlsfBlock::insertFree(uint32_t node) {
+    uint32_t fl, sl;
+    mapping(nodes[node].size, fl, sl);
+
+    nodes[node].free = true;
+    nodes[node].prevFree = none;
+    nodes[node].nextFree = freeLists[fl][sl];
+    if(freeLists[fl][sl] != none)
+        nodes[freeLists[fl][sl]].prevFree = node;
+    freeLists[fl][sl] = node;
+
+    flBitmap |= 1ull << fl;
+    slBitmap[fl] |= 1u << sl;
+}
+
+void DeviceAllocator::TlsfBlock::removeFree(uint32_t node) {
+    uint32_t fl, sl;
+    mapping(nodes[node].size, fl, sl);
+
+    Node& n = nodes[node];
+    if(n.prevFree != none)
+        nodes[n.prevFree].nextFree = n.nextFree;
+    else
+        freeLists[fl][sl] = n.nextFree;
+    if(n.nextFree != none)
+        nodes[n.nextFree].prevFree = n.prevFree;
+
+    if(freeLists[fl][sl] == none) {
+        slBitmap[fl] &= ~(1u << sl);
+        if(slBitmap[fl] == 0)
+            flBitmap &= ~(1ull << fl);
+    }
+    n.free = false;
+}
+
+bool DeviceAllocator::TlsfBlock::allocate(VkDeviceSize request, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& result) {
+    //ищем с запасом на выравнивание, тогда любой найденный участок гарантированно подходит
+    VkDeviceSize search = request + alignment - 1;
+    //округление вверх до границы класса: любой участок из найденного класса не меньше search
+    if(search >= (1ull << smallSizeLog2))
+        search += (1ull << (floorLog2(search) - slLog2)) - 1;
+    else
+        search = alignUp(search, 1ull << (smallSizeLog2 - slLog2));
+    if(search > size)
+        return false;
+
+    uint32_t fl, sl;
+    mapping(search, fl, sl);
+
+    uint32_t slMap = sl < slCount ? slBitmap[fl] & (~0u << sl) : 0;
+    if(slMap == 0) {
+        uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+        if(flMap == 0)
+            return false;
+        fl = static_cast<uint32_t>(__builtin_ctzll(flMap));
+        slMap = slBitmap[fl];
+    }
+    sl = static_cast<uint32_t>(__builtin_ctz(slMap));
+
+    uint32_t node = freeLists[fl][sl];
+    removeFree(node);
+
+    //отрезаем начало до выровненного смещения в отдельный свободный участок
+    VkDeviceSize aligned = alignUp(nodes[node].offset, alignment);
+    VkDeviceSize padding = aligned - nodes[node].offset;
+    if(padding > 0) {
+        uint32_t front = newNode();
+        Node& n = nodes[node];
+        nodes[front] = { n.offset, padding, n.prevPhys, node, none, none, true };
+        if(n.prevPhys != none)
+            nodes[n.prevPhys].nextPhys = front;
+        n.prevPhys = front;
+        n.offset = aligned;
+        n.size -= padding;
+        insertFree(front);
+    }
+
+    //остаток после выделения возвращаем в свободные списки
+    if(nodes[node].size > request) {
+        uint32_t back = newNode();
+        Node& n = nodes[node];
+        nodes[back] = { n.offset + request, n.size - request, node, n.nextPhys, none, none, true };
+        if(n.nextPhys != none)
+            nodes[n.nextPhys].prevPhys = back;
+        n.nextPhys = back;
+        n.size = request;
+        insertFree(back);
+    }
+
+    used += request;
+    allocationCount++;
+    offset = nodes[node].offset;
+    result = node;
+    return true;
+}
+
+void DeviceAllocator::TlsfBlock::free(uint32_t node) {
+    used -= nodes[node].size;
+    allocationCount--;
+
+    //сливаем с соседями: у свободного участка никогда нет свободных физических соседей
+    uint32_t next = nodes[node].nextPhys;
+    if(next != none && nodes[next].free) {
+        removeFree(next);
+        nodes[node].size += nodes[next].size;
+        nodes[node].nextPhys = nodes[next].nextPhys;
+        if(nodes[next].nextPhys != none)
+            nodes[nodes[next].nextPhys].prevPhys = node;
+        unusedNodes.push_back(next);
+    }
+
+    uint32_t prev = nodes[node].prevPhys;
+    if(prev != none && nodes[prev].free) {
+        removeFree(prev);
+        nodes[prev].size += nodes[node].size;
+        nodes[prev].nextPhys = nodes[node].nextPhys;
+        if(nodes[node].nextPhys != none)
+            nodes[nodes[node].nextPhys].prevPhys = prev;
+        unusedNodes.push_back(node);
+        node = prev;
+    }
+
+    insertFree(node);
+}
+
+//---------------------------------------------------------------- DeviceAllocator
+
+void DeviceAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize) {
+    _device = device;
+    _blockSize = blockSize;
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    _bufferImageGranularity = std::max<VkDeviceSize>(props.limits.bufferImageGranularity, 1);
+    _nonCoherentAtomSize = std::max<VkDeviceSize>(props.limits.nonCoherentAtomSize, 1);
+    _maxAllocationCount = props.limits.maxMemoryAllocationCount;
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+    _types.resize(_memoryProperties.memoryTypeCount);
+}
+
+void DeviceAllocator::destroy() {
+    for(auto& type : _types)
+        for(auto& block : type.blocks)
+            if(block.memory != VK_NULL_HANDLE)
+                freeDeviceMemory(block.memory);
+    for(auto& dedicated : _dedicated)
+        if(dedicated.memory != VK_NULL_HANDLE)
+            freeDeviceMemory(dedicated.memory);
+
+    _types.clear();
+    _dedicated.clear();
+    _unusedDedicated.clear();
+}
+
+uint32_t DeviceAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for(uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++) {
+        if((typeFilter & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            return i;
+    }
+
+    throw std::runtime_error("Не найден подходящий тип памяти!");
+}
+
+bool DeviceAllocator::isCoherent(uint32_t memoryType) const {
+    return _memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+VkDeviceMemory DeviceAllocator::allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void** mapped) {
+    if(_deviceMemoryCount >= _maxAllocationCount)
+        throw std::runtime_error("Превышен maxMemoryAllocationCount");
+
+    VkMemoryAllocateInfo allocInfo {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if(vkAllocateMemory(_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось выделить память устройства!");
+    _deviceMemoryCount++;
+
+    *mapped = nullptr;
+    //host visible память отображается один раз на всё время жизни блока
+    if(_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        if(vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+            freeDeviceMemory(memory);
+            throw std::runtime_error("Не удалось отобразить память устройства!");
+        }
+
+    return memory;
+}
+
+void DeviceAllocator::freeDeviceMemory(VkDeviceMemory memory) {
+    vkFreeMemory(_device, memory, nullptr); //отображение снимается вместе с освобождением
+    _deviceMemoryCount--;
+}
+
+Allocation DeviceAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+                                     ResourceKind kind, AllocationStrategy strategy) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    //оптимальные изображения занимают целые страницы гранулярности, поэтому никогда не делят страницу с буфером
+    if(kind == ResourceKind::Optimal && _bufferImageGranularity > 1) {
+        alignment = std::max(alignment, _bufferImageGranularity);
+        size = alignUp(size, _bufferImageGranularity);
+    }
+
+    //flush/invalidate работают атомами: соседние выделения не должны делить атом
+    bool hostVisible = _memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    if(hostVisible && !isCoherent(memoryType)) {
+        alignment = std::max(alignment, _nonCoherentAtomSize);
+        size = alignUp(size, _nonCoherentAtomSize);
+    }
+
+    if(size > _blockSize / 2) //крупные ресурсы получают собственный блок, чтобы не дробить общие
+        return allocateDedicated(memoryType, size);
+
+    switch(strategy) {
+        case AllocationStrategy::Pool:
+            if(kind == ResourceKind::Linear && size <= (1ull << poolMaxLog2))
+                return allocatePool(memoryType, size, alignment);
+            return allocateGeneral(memoryType, size, alignment);
+        case AllocationStrategy::General:
+        default:
+            return allocateGeneral(memoryType, size, alignment);
+    }
+}
+
+Allocation DeviceAllocator::allocateGeneral(uint32_t memoryType, VkDeviceSize size, VkDeviceSize alignment) {
+    auto& blocks = _types[memoryType].blocks;
+
+    Allocation allocation;
+    allocation.strategy = AllocationStrategy::General;
+    allocation.memoryType = memoryType;
+    allocation.size = size;
+
+    auto place = [&](uint32_t index) {
+        TlsfBlock& block = blocks[index];
+        if(block.memory == VK_NULL_HANDLE || !block.allocate(size, alignment, allocation.offset, allocation.node))
+            return false;
+        allocation.block = index;
+        allocation.memory = block.memory;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+        return true;
+    };
+
+    for(uint32_t i = 0; i < blocks.size(); i++)
+        if(place(i))
+            return allocation;
+
+    //ни в одном блоке нет места - заводим новый на месте освобождённого: индексы блоков записаны в выделениях
+    uint32_t index = 0;
+    while(index < blocks.size() && blocks[index].memory != VK_NULL_HANDLE)
+        index++;
+    void* mapped;
+    VkDeviceMemory memory = allocateDeviceMemory(memoryType, _blockSize, &mapped);
+    if(index == blocks.size())
+        blocks.emplace_back();
+    blocks[index].init(memory, _blockSize, mapped);
+    if(place(index))
+        return allocation;
+
+    throw std::runtime_error("Не удалось разместить выделение в новом блоке памяти");
+}
+
+Allocation DeviceAllocator::allocatePool(uint32_t memoryType, VkDeviceSize size, VkDeviceSize alignment) {
+    //слот - степень двойки не меньше размера и выравнивания, тогда каждый слот в чанке выровнен
+    uint32_t log2 = std::max(poolMinLog2, floorLog2(std::max(size, alignment) * 2 - 1));
+    if(log2 > poolMaxLog2)
+        return allocateGeneral(memoryType, size, alignment);
+
+    VkDeviceSize slotSize = 1ull << log2;
+    uint32_t classIndex = log2 - poolMinLog2;
+    PoolClass& pool = _types[memoryType].pools[classIndex];
+
+    uint32_t chunkIndex = 0;
+    for(; chunkIndex < pool.chunks.size(); chunkIndex++)
+        if(pool.chunks[chunkIndex].backing.memory != VK_NULL_HANDLE && pool.chunks[chunkIndex].freeMask != 0)
+            break;
+
+    if(chunkIndex == pool.chunks.size()) {
+        //место освобождённого чанка занимается первым: индексы чанков записаны в выделениях
+        chunkIndex = 0;
+        while(chunkIndex < pool.chunks.size() && pool.chunks[chunkIndex].backing.memory != VK_NULL_HANDLE)
+            chunkIndex++;
+        if(chunkIndex == pool.chunks.size())
+            pool.chunks.emplace_back();
+        pool.chunks[chunkIndex].backing = allocateGeneral(memoryType, slotSize * 64, slotSize);
+        pool.chunks[chunkIndex].freeMask = ~0ull;
+    }
+
+    PoolChunk& chunk = pool.chunks[chunkIndex];
+    uint32_t slot = static_cast<uint32_t>(__builtin_ctzll(chunk.freeMask));
+    chunk.freeMask &= ~(1ull << slot);
+
+    Allocation allocation;
+    allocation.strategy = AllocationStrategy::Pool;
+    allocation.memoryType = memoryType;
+    allocation.memory = chunk.backing.memory;
+    allocation.offset = chunk.backing.offset + slot * slotSize;
+    allocation.size = slotSize;
+    allocation.mapped = chunk.backing.mapped ? static_cast<char*>(chunk.backing.mapped) + slot * slotSize : nullptr;
+    allocation.block = classIndex;
+    allocation.node = chunkIndex * 64 + slot;
+    return allocation;
+}
+
+Allocation DeviceAllocator::allocateDedicated(uint32_t memoryType, VkDeviceSize size) {
+    Allocation allocation;
+    allocation.strategy = AllocationStrategy::General;
+    allocation.memoryType = memoryType;
+    allocation.size = size;
+    allocation.block = dedicatedBlock;
+    allocation.memory = allocateDeviceMemory(memoryType, size, &allocation.mapped);
+
+    if(!_unusedDedicated.empty()) {
+        allocation.node = _unusedDedicated.back();
+        _unusedDedicated.pop_back();
+        _dedicated[allocation.node] = { allocation.memory, size, memoryType };
+    } else {
+        allocation.node = static_cast<uint32_t>(_dedicated.size());
+        _dedicated.push_back({ allocation.memory, size, memoryType });
+    }
+    return allocation;
+}
+
+void DeviceAllocator::free(const Allocation& allocation) {
+    if(allocation.memory == VK_NULL_HANDLE)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    switch(allocation.strategy) {
+        case AllocationStrategy::Pool: {
+            PoolClass& pool = _types[allocation.memoryType].pools[allocation.block];
+            PoolChunk& chunk = pool.chunks[allocation.node / 64];
+            chunk.freeMask |= 1ull << (allocation.node % 64);
+            if(chunk.freeMask == ~0ull) { //пустой чанк возвращается в свой блок
+                freeGeneral(chunk.backing.memoryType, chunk.backing.block, chunk.backing.node);
+                chunk.backing = Allocation {};
+            }
+            break;
+        }
+        case AllocationStrategy::General:
+        default:
+            if(allocation.block == dedicatedBlock) {
+                freeDeviceMemory(_dedicated[allocation.node].memory);
+                _dedicated[allocation.node] = { VK_NULL_HANDLE, 0, 0 };
+                _unusedDedicated.push_back(allocation.node);
+            } else {
+                freeGeneral(allocation.memoryType, allocation.block, allocation.node);
+            }
+            break;
+    }
+}
+
+//опустевший блок отдаётся драйверу, если у типа памяти есть ещё один пустой: один блок остаётся про запас,
+//чтобы создание и удаление одного ресурса не вызывало vkAllocateMemory каждый раз
+void DeviceAllocator::freeGeneral(uint32_t memoryType, uint32_t blockIndex, uint32_t node) {
+    auto& blocks = _types[memoryType].blocks;
+    blocks[blockIndex].free(node);
+    if(blocks[blockIndex].allocationCount != 0)
+        return;
+
+    for(uint32_t i = 0; i < blocks.size(); i++)
+        if(i != blockIndex && blocks[i].memory != VK_NULL_HANDLE && blocks[i].allocationCount == 0) {
+            freeDeviceMemory(blocks[blockIndex].memory);
+            blocks[blockIndex] = TlsfBlock {};
+            return;
+        }
+}
+
+Allocation DeviceAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, AllocationStrategy strategy) {
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
+
+    Allocation allocation = allocate(memRequirements, properties, ResourceKind::Linear, strategy);
+    if(vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось привязать память к буферу!");
+    return allocation;
+}
+
+Allocation DeviceAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling) {
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(_device, image, &memRequirements);
+
+    ResourceKind kind = tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::Optimal : ResourceKind::Linear;
+    Allocation allocation = allocate(memRequirements, properties, kind);
+    if(vkBindImageMemory(_device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось привязать память к изображению!");
+    return allocation;
+}
+
+VkMappedMemoryRange DeviceAllocator::atomRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const {
+    if(size == VK_WHOLE_SIZE)
+        size = allocation.size - offset;
+
+    //выделения в некогерентной памяти уже выровнены по атому, так что расширенный диапазон не выходит за них
+    VkDeviceSize begin = alignDown(allocation.offset + offset, _nonCoherentAtomSize);
+    VkDeviceSize end = alignUp(allocation.offset + offset + size, _nonCoherentAtomSize);
+
+    VkMappedMemoryRange range {};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin;
+    range.size = end - begin;
+    return range;
+}
+
+void DeviceAllocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if(isCoherent(allocation.memoryType))
+        return;
+
+    VkMappedMemoryRange range = atomRange(allocation, offset, size);
+    vkFlushMappedMemoryRanges(_device, 1, &range);
+}
+
+void DeviceAllocator::invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if(isCoherent(allocation.memoryType))
+        return;
+
+    VkMappedMemoryRange range = atomRange(allocation, offset, size);
+    vkInvalidateMappedMemoryRanges(_device, 1, &range);
+}
+
+AllocatorStats DeviceAllocator::stats(uint32_t heapIndex) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return collectStats(heapIndex);
+}
+
+AllocatorStats DeviceAllocator::collectStats(uint32_t heapIndex) const {
+    AllocatorStats stats;
+    stats.deviceMemoryCount = _deviceMemoryCount;
+    auto onHeap = [this, heapIndex](uint32_t memoryType) {
+        return heapIndex == allHeaps || _memoryProperties.memoryTypes[memoryType].heapIndex == heapIndex;
+    };
+
+    VkDeviceSize totalFree = 0;
+    for(uint32_t typeIndex = 0; typeIndex < _types.size(); typeIndex++) {
+        const auto& type = _types[typeIndex];
+        if(!onHeap(typeIndex))
+            continue;
+        for(const auto& block : type.blocks) {
+            stats.reservedBytes += block.size;
+            stats.usedBytes += block.used;
+            stats.allocationCount += block.allocationCount;
+
+            for(const auto& node : block.nodes) {
+                if(!node.free) //узлы из unusedNodes всегда помечены занятыми
+                    continue;
+                stats.freeRangeCount++;
+                totalFree += node.size;
+                stats.largestFreeRange = std::max(stats.largestFreeRange, node.size);
+            }
+        }
+    }
+    for(const auto& dedicated : _dedicated)
+        if(dedicated.memory != VK_NULL_HANDLE && onHeap(dedicated.memoryType)) {
+            stats.reservedBytes += dedicated.size;
+            stats.usedBytes += dedicated.size;
+            stats.allocationCount++;
+        }
+
+    //байты пулов уже учтены через их чанки; в количестве чанк заменяем занятыми слотами
+    for(uint32_t typeIndex = 0; typeIndex < _types.size(); typeIndex++) {
+        if(!onHeap(typeIndex))
+            continue;
+        for(const auto& pool : _types[typeIndex].pools)
+            for(const auto& chunk : pool.chunks) {
+                if(chunk.backing.memory == VK_NULL_HANDLE) //освобождён
+                    continue;
+                stats.allocationCount -= 1;
+                stats.allocationCount += 64 - static_cast<uint32_t>(__builtin_popcountll(chunk.freeMask));
+            }
+    }
+
+    stats.fragmentation = totalFree > 0 ? 1.0 - static_cast<double>(stats.largestFreeRange) / static_cast<double>(totalFree) : 0.0;
+    return stats;
+}
+
+void DeviceAllocator::printReport(std::ostream& out) const {
+    //блоки обходятся под той же блокировкой, что и сводка: параллельные задачи инициализации ещё могут выделять память
+    std::lock_guard<std::mutex> lock(_mutex);
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+
+    AllocatorStats total = collectStats(allHeaps);
+    out << "Память устройства: " << total.deviceMemoryCount << " блоков VkDeviceMemory (лимит " << _maxAllocationCount << "), "
+        << total.allocationCount << " выделений, "
+        << total.usedBytes / 1024 << " / " << total.reservedBytes / 1024 << " КБ занято" << std::endl;
+
+    for(uint32_t type = 0; type < _types.size(); type++) {
+        const auto& state = _types[type];
+        if(state.blocks.empty())
+            continue;
+
+        out << "  тип " << type << " (флаги 0x" << std::hex << _memoryProperties.memoryTypes[type].propertyFlags << std::dec << "):";
+        for(uint32_t i = 0; i < state.blocks.size(); i++) {
+            const TlsfBlock& block = state.blocks[i];
+            if(block.memory == VK_NULL_HANDLE) //отдан драйверу, индекс ждёт нового блока
+                continue;
+            out << " [блок " << i << ": " << block.allocationCount << " выд., "
+                << std::fixed << std::setprecision(1) << 100.0 * static_cast<double>(block.used) / static_cast<double>(block.size)
+                << "% занято]";
+        }
+        out << std::endl;
+    }
+
+    out << "  свободных участков: " << total.freeRangeCount
+        << ", наибольший: " << total.largestFreeRange / 1024 << " КБ"
+        << ", фрагментация: " << std::fixed << std::setprecision(1) << total.fragmentation * 100.0 << "%" << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <ostream>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+//как размещать выделение внутри больших блоков VkDeviceMemory
+enum class AllocationStrategy : uint8_t {
+    General, //TLSF: произвольные размеры и время жизни, O(1) выделение и освобождение
+    Pool,    //слоты фиксированного размера (степени двойки до 64 КБ) для мелких буферов
+};
+
+//изображения с оптимальным тайлингом не должны делить страницу bufferImageGranularity с буферами
+enum class ResourceKind : uint8_t {
+    Linear,   //буферы и изображения с VK_IMAGE_TILING_LINEAR
+    Optimal,  //изображения с VK_IMAGE_TILING_OPTIMAL
+};
+
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr; //постоянно отображённый адрес начала выделения (только host visible память)
+
+    //служебные поля для free
+    AllocationStrategy strategy = AllocationStrategy::General;
+    uint32_t memoryType = 0;
+    uint32_t block = 0;
+    uint32_t node = 0;
+};
+
+struct AllocatorStats {
+    uint32_t deviceMemoryCount = 0;   //живых vkAllocateMemory
+    uint32_t allocationCount = 0;     //живых подвыделений
+    VkDeviceSize reservedBytes = 0;   //суммарный размер блоков
+    VkDeviceSize usedBytes = 0;
+    uint32_t freeRangeCount = 0;      //в блоках TLSF
+    VkDeviceSize largestFreeRange = 0;
+    double fragmentation = 0.0;       //1 - наибольший свободный участок / всё свободное место
+};
+
+//подвыделения из больших блоков VkDeviceMemory: тысячи ресурсов не упираются в
+//maxMemoryAllocationCount и не платят за vkAllocateMemory на каждый объект.
+//Потокобезопасен: при инициализации ресурсы создаются параллельно
+class DeviceAllocator
+{
+public:
+    DeviceAllocator() = default;
+    ~DeviceAllocator() { destroy(); } //после освобождения всех выделений, до уничтожения устройства
+    DeviceAllocator(const DeviceAllocator&) = delete;
+    DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = 64ull << 20);
+    void destroy();
+
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+                        ResourceKind kind, AllocationStrategy strategy = AllocationStrategy::General);
+    void free(const Allocation& allocation);
+
+    //выделяет и привязывает память к ресурсу
+    Allocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties,
+                                 AllocationStrategy strategy = AllocationStrategy::General);
+    Allocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling);
+
+    //для памяти без HOST_COHERENT: диапазон расширяется до границ nonCoherentAtomSize
+    void flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    void invalidate(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return _memoryProperties; }
+    VkDeviceSize getNonCoherentAtomSize() const { return _nonCoherentAtomSize; }
+
+    static constexpr uint32_t allHeaps = UINT32_MAX;
+    AllocatorStats stats(uint32_t heapIndex = allHeaps) const; //heapIndex - только типы памяти этой кучи
+    void printReport(std::ostream& out) const;
+
+private:
+    //TLSF над одним блоком VkDeviceMemory
+    struct TlsfBlock {
+        static constexpr uint32_t slLog2 = 4;
+        static constexpr uint32_t slCount = 1u << slLog2;
+        static constexpr uint32_t smallSizeLog2 = 8; //размеры меньше 256 байт раскладываются линейно в fl = 0
+        static constexpr uint32_t flCount = 64 - smallSizeLog2 + 1;
+        static constexpr uint32_t none = UINT32_MAX;
+
+        struct Node {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+            uint32_t prevPhys, nextPhys;
+            uint32_t prevFree, nextFree;
+            bool free;
+        };
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+        VkDeviceSize used = 0;
+        uint32_t allocationCount = 0;
+
+        std::vector<Node> nodes;
+        std::vector<uint32_t> unusedNodes;
+        uint64_t flBitmap = 0;
+        uint32_t slBitmap[flCount] = {};
+        uint32_t freeLists[flCount][slCount];
+
+        void init(VkDeviceMemory memory, VkDeviceSize size, void* mapped);
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& node);
+        void free(uint32_t node);
+
+        uint32_t newNode();
+        void insertFree(uint32_t node);
+        void removeFree(uint32_t node);
+        static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+    };
+
+    //чанк пула: 64 слота одного размера внутри TLSF выделения; пустой чанк освобождается (backing.memory == null)
+    struct PoolChunk {
+        Allocation backing;
+        uint64_t freeMask = ~0ull;
+    };
+
+    struct PoolClass {
+        std::vector<PoolChunk> chunks;
+    };
+
+    static constexpr uint32_t poolMinLog2 = 6;  //64 байта
+    static constexpr uint32_t poolMaxLog2 = 16; //64 КБ
+    static constexpr uint32_t poolClassCount = poolMaxLog2 - poolMinLog2 + 1;
+
+    struct MemoryTypeState {
+        std::vector<TlsfBlock> blocks; //memory == VK_NULL_HANDLE - блок отдан драйверу
+        PoolClass pools[poolClassCount];
+    };
+
+    struct DedicatedMemory {
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        uint32_t memoryType;
+    };
+
+    VkDeviceMemory allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void** mapped);
+    void freeDeviceMemory(VkDeviceMemory memory);
+
+    Allocation allocateGeneral(uint32_t memoryType, VkDeviceSize size, VkDeviceSize alignment);
+    void freeGeneral(uint32_t memoryType, uint32_t blockIndex, uint32_t node);
+    Allocation allocatePool(uint32_t memoryType, VkDeviceSize size, VkDeviceSize alignment);
+    Allocation allocateDedicated(uint32_t memoryType, VkDeviceSize size);
+
+    AllocatorStats collectStats(uint32_t heapIndex) const; //под _mutex
+    VkMappedMemoryRange atomRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+    bool isCoherent(uint32_t memoryType) const;
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties _memoryProperties {};
+    VkDeviceSize _bufferImageGranularity = 1;
+    VkDeviceSize _nonCoherentAtomSize = 1;
+    uint32_t _maxAllocationCount = 4096;
+    VkDeviceSize _blockSize = 0;
+
+    mutable std::mutex _mutex;
+    uint32_t _deviceMemoryCount = 0;
+    std::vector<MemoryTypeState> _types;
+    std::vector<DedicatedMemory> _dedicated;
+    std::vector<uint32_t> _unusedDedicated;
+};
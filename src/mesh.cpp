@@ -0,0 +1,17 @@
+#include "mesh.h"
+
+void GpuMesh::bind(VkCommandBuffer commandBuffer, uint32_t used) const {
+    std::vector<VkDeviceSize> offsets = layout.bindingOffsets(used, vertexCount, 0);
+    std::vector<VkBuffer> buffers(offsets.size(), buffer);
+    vkCmdBindVertexBuffers(commandBuffer, 0, static_cast<uint32_t>(buffers.size()), buffers.data(), offsets.data());
+    vkCmdBindIndexBuffer(commandBuffer, buffer, indexOffset, indexType);
+}
+
+void GpuMesh::draw(VkCommandBuffer commandBuffer, uint32_t firstInstance) const {
+    if(submeshes.empty()) {
+        vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, firstInstance);
+        return;
+    }
+    for(const auto& submesh : submeshes)
+        vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.firstIndex, submesh.vertexOffset, firstInstance);
+}
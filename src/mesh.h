@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "meshFile.h"
+#include "memoryAllocator.h"
+#include "vulkanHandle.h"
+
+//меш в памяти устройства: вершины и индексы в одном буфере, индексы после вершин
+struct GpuMesh {
+    AllocatedBuffer buffer;
+    VertexLayout layout;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    VkDeviceSize indexOffset = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    std::vector<meshformat::Submesh> submeshes;
+    float boundsMin[3] = {};
+    float boundsMax[3] = {};
+
+    //used - атрибуты, которые читает конвейер (см. VertexLayout::inputDescription)
+    void bind(VkCommandBuffer commandBuffer, uint32_t used) const;
+    //по vkCmdDrawIndexed на подсетку; firstInstance выбирает объект в шейдере (gl_InstanceIndex)
+    void draw(VkCommandBuffer commandBuffer, uint32_t firstInstance = 0) const;
+};
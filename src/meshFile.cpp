@@ -0,0 +1,101 @@
+#include "meshFile.h"
+
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+void MeshFile::open(const std::string& path) {
+    _file = utils::MappedFile(path);
+    const uint8_t* base = _file.data();
+    const uint64_t fileSize = _file.size();
+
+    if(fileSize < sizeof(meshformat::Header))
+        throw std::runtime_error("Файл меша слишком мал: " + path);
+
+    meshformat::Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if(header.magic != meshformat::magic || header.version != meshformat::version)
+        throw std::runtime_error("Файл не является .vmesh поддерживаемой версии: " + path);
+
+    auto sectionValid = [fileSize](uint64_t offset, uint64_t size) {
+        return offset % meshformat::sectionAlignment == 0 && offset <= fileSize && size <= fileSize - offset;
+    };
+
+    MeshData data;
+    data.layout = VertexLayout(header.attributes, (header.flags & meshformat::Interleaved) != 0);
+    data.vertexCount = header.vertexCount;
+    data.indexCount = header.indexCount;
+    data.indexType = (header.flags & meshformat::Index32) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+    const uint64_t indexSize = data.indexType == VK_INDEX_TYPE_UINT32 ? 4 : 2;
+
+    if(!(header.attributes & VertexPosition)
+       || header.vertexSize != data.layout.vertexDataSize(header.vertexCount)
+       || header.indexSize != indexSize * header.indexCount
+       || !sectionValid(header.vertexOffset, header.vertexSize)
+       || !sectionValid(header.indexOffset, header.indexSize)
+       || !sectionValid(header.submeshOffset, static_cast<uint64_t>(header.submeshCount) * sizeof(meshformat::Submesh)))
+        throw std::runtime_error("Повреждённый заголовок .vmesh: " + path);
+
+    data.vertices = base + header.vertexOffset;
+    data.verticesSize = header.vertexSize;
+    data.indices = base + header.indexOffset;
+    data.indicesSize = header.indexSize;
+    std::memcpy(data.boundsMin, header.boundsMin, sizeof(data.boundsMin));
+    std::memcpy(data.boundsMax, header.boundsMax, sizeof(data.boundsMax));
+
+    data.submeshes.resize(header.submeshCount);
+    std::memcpy(data.submeshes.data(), base + header.submeshOffset, data.submeshes.size() * sizeof(meshformat::Submesh));
+    for(const auto& submesh : data.submeshes) {
+        if(static_cast<uint64_t>(submesh.firstIndex) + submesh.indexCount > header.indexCount)
+            throw std::runtime_error("Подсетка выходит за пределы индексного буфера: " + path);
+    }
+
+    _data = std::move(data);
+}
+
+namespace utils {
+    void writeMesh(const std::string& path, const MeshData& mesh) {
+        auto align = [](uint64_t offset) {
+            return (offset + meshformat::sectionAlignment - 1) / meshformat::sectionAlignment * meshformat::sectionAlignment;
+        };
+
+        meshformat::Header header {};
+        header.magic = meshformat::magic;
+        header.version = meshformat::version;
+        header.attributes = mesh.layout.getAttributes();
+        header.flags = (mesh.layout.isInterleaved() ? meshformat::Interleaved : 0u)
+                     | (mesh.indexType == VK_INDEX_TYPE_UINT32 ? meshformat::Index32 : 0u);
+        header.vertexCount = mesh.vertexCount;
+        header.indexCount = mesh.indexCount;
+        header.submeshCount = static_cast<uint32_t>(mesh.submeshes.size());
+        header.submeshOffset = align(sizeof(header));
+        header.vertexOffset = align(header.submeshOffset + mesh.submeshes.size() * sizeof(meshformat::Submesh));
+        header.vertexSize = mesh.verticesSize;
+        header.indexOffset = align(header.vertexOffset + header.vertexSize);
+        header.indexSize = mesh.indicesSize;
+        std::memcpy(header.boundsMin, mesh.boundsMin, sizeof(header.boundsMin));
+        std::memcpy(header.boundsMax, mesh.boundsMax, sizeof(header.boundsMax));
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if(!file.is_open())
+            throw std::runtime_error("Не удалось открыть файл для записи: " + path);
+
+        static const char padding[meshformat::sectionAlignment] = {};
+        auto padTo = [&file](uint64_t offset) {
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(padding, static_cast<std::streamsize>(offset - position));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        padTo(header.submeshOffset);
+        file.write(reinterpret_cast<const char*>(mesh.submeshes.data()),
+                   static_cast<std::streamsize>(mesh.submeshes.size() * sizeof(meshformat::Submesh)));
+        padTo(header.vertexOffset);
+        file.write(static_cast<const char*>(mesh.vertices), static_cast<std::streamsize>(mesh.verticesSize));
+        padTo(header.indexOffset);
+        file.write(static_cast<const char*>(mesh.indices), static_cast<std::streamsize>(mesh.indicesSize));
+
+        if(!file)
+            throw std::runtime_error("Ошибка записи файла: " + path);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "loadBinFile.h"
+#include "vertexLayout.h"
+
+//формат .vmesh: вершины и индексы хранятся ровно в том виде, в котором лежат в GPU буферах,
+//поэтому загрузка - это mmap и копирование в staging буфер, без разбора
+namespace meshformat {
+    constexpr uint32_t magic = 0x48534d56; //"VMSH"
+    constexpr uint32_t version = 1;
+    constexpr uint64_t sectionAlignment = 16;
+
+    enum Flags : uint32_t {
+        Interleaved = 1u << 0,
+        Index32     = 1u << 1, //иначе индексы 16 бит
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t attributes; //маска VertexAttribute
+        uint32_t flags;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t submeshCount;
+        uint32_t reserved;
+        uint64_t submeshOffset; //смещения от начала файла, выровнены на sectionAlignment
+        uint64_t vertexOffset;
+        uint64_t vertexSize;
+        uint64_t indexOffset;
+        uint64_t indexSize;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+    static_assert(sizeof(Header) == 96, "заголовок .vmesh не должен зависеть от компилятора");
+
+    //диапазон индексов для одного vkCmdDrawIndexed (группа или материал в исходном файле)
+    struct Submesh {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+        uint32_t material;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+    static_assert(sizeof(Submesh) == 40, "подсетка .vmesh не должна зависеть от компилятора");
+}
+
+//вид на данные меша: указатели в отображённый файл или в память вызывающего
+struct MeshData {
+    VertexLayout layout;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    const void* vertices = nullptr;
+    uint64_t verticesSize = 0;
+    const void* indices = nullptr;
+    uint64_t indicesSize = 0;
+    std::vector<meshformat::Submesh> submeshes;
+    float boundsMin[3] = {};
+    float boundsMax[3] = {};
+};
+
+//.vmesh, отображённый в память; данные действительны, пока жив объект
+class MeshFile
+{
+public:
+    void open(const std::string& path);
+    const MeshData& data() const { return _data; }
+
+private:
+    utils::MappedFile _file;
+    MeshData _data;
+};
+
+namespace utils {
+    void writeMesh(const std::string& path, const MeshData& mesh);
+}
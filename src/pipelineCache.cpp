@@ -0,0 +1,200 @@
+#include "pipelineCache.h"
+#include "log.h"
+
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <unistd.h>
+
+namespace {
+    const uint32_t cacheMagic = 0x43505056; //"VPPC"
+    const uint32_t cacheFormatVersion = 1;
+
+    //заголовок файла перед данными VkPipelineCache
+    struct CacheFileHeader {
+        uint32_t magic;
+        uint32_t formatVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum; //FNV-1a по данным
+    };
+
+    //заголовок, который сам Vulkan пишет в начало данных кэша (VkPipelineCacheHeaderVersionOne)
+    struct VulkanCacheHeader {
+        uint32_t headerSize;
+        uint32_t headerVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    };
+
+    uint64_t fnv1a(const uint8_t* data, size_t size) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for(size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& directory) {
+    _device = device;
+    vkGetPhysicalDeviceProperties(physicalDevice, &_props);
+
+    //разные устройства и версии драйвера пишут в разные файлы и не вытесняют друг друга
+    std::ostringstream name;
+    name << std::hex << std::setfill('0')
+         << "pipelines_" << std::setw(4) << _props.vendorID
+         << "_" << std::setw(4) << _props.deviceID
+         << "_" << std::setw(8) << _props.driverVersion << ".bin";
+    _path = directory.empty() ? name.str() : directory + "/" + name.str();
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> data;
+    if(!load(data))
+        data.clear();
+    _loadedSize = data.size();
+
+    VkPipelineCacheCreateInfo cacheCreateInfo {};
+    cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheCreateInfo.initialDataSize = data.size();
+    cacheCreateInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if(vkCreatePipelineCache(_device, &cacheCreateInfo, nullptr, &_cache) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать кэш конвейеров!");
+
+    if(isWarm())
+        utils::log() << "Кэш конвейеров: попадание, " << _loadedSize << " байт из " << _path
+                  << " за " << millisecondsSince(start) << " мс" << std::endl;
+    else
+        utils::log() << "Кэш конвейеров: промах (" << _path << "), "
+                  << millisecondsSince(start) << " мс" << std::endl;
+}
+
+bool PipelineCache::load(std::vector<uint8_t>& data) {
+    std::ifstream file(_path, std::ios::binary);
+    if(!file.is_open())
+        return false;
+
+    CacheFileHeader header {};
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+
+    if(header.magic != cacheMagic || header.formatVersion != cacheFormatVersion) {
+        utils::log() << "Кэш конвейеров: неизвестный формат файла, пропускаем" << std::endl;
+        return false;
+    }
+
+    if(header.vendorID != _props.vendorID || header.deviceID != _props.deviceID ||
+       header.driverVersion != _props.driverVersion ||
+       std::memcmp(header.pipelineCacheUUID, _props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        utils::log() << "Кэш конвейеров: создан другим устройством или драйвером, пропускаем" << std::endl;
+        return false;
+    }
+
+    //размер из заголовка сверяется с файлом до выделения памяти: повреждённый заголовок не должен приводить к bad_alloc
+    const std::streamoff dataOffset = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff fileSize = file.tellg();
+    if(dataOffset < 0 || fileSize < dataOffset || header.dataSize != static_cast<uint64_t>(fileSize - dataOffset)) {
+        utils::log() << "Кэш конвейеров: размер данных не совпадает с размером файла, пропускаем" << std::endl;
+        return false;
+    }
+    file.seekg(dataOffset);
+
+    data.resize(header.dataSize);
+    if(!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()))) {
+        utils::log() << "Кэш конвейеров: файл обрезан, пропускаем" << std::endl;
+        return false;
+    }
+
+    if(fnv1a(data.data(), data.size()) != header.checksum) {
+        utils::log() << "Кэш конвейеров: неверная контрольная сумма, пропускаем" << std::endl;
+        return false;
+    }
+
+    //драйвер и сам проверяет свой заголовок, но некоторые реализации падают на мусоре вместо отказа
+    VulkanCacheHeader vkHeader {};
+    if(data.size() < sizeof(vkHeader))
+        return false;
+    std::memcpy(&vkHeader, data.data(), sizeof(vkHeader));
+
+    if(vkHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+       vkHeader.vendorID != _props.vendorID || vkHeader.deviceID != _props.deviceID ||
+       std::memcmp(vkHeader.pipelineCacheUUID, _props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        utils::log() << "Кэш конвейеров: заголовок данных Vulkan не совпадает, пропускаем" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void PipelineCache::save() {
+    if(_cache == VK_NULL_HANDLE)
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t dataSize = 0;
+    if(vkGetPipelineCacheData(_device, _cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+        return;
+
+    std::vector<uint8_t> data(dataSize);
+    if(vkGetPipelineCacheData(_device, _cache, &dataSize, data.data()) != VK_SUCCESS)
+        return;
+    data.resize(dataSize);
+
+    CacheFileHeader header {};
+    header.magic = cacheMagic;
+    header.formatVersion = cacheFormatVersion;
+    header.vendorID = _props.vendorID;
+    header.deviceID = _props.deviceID;
+    header.driverVersion = _props.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, _props.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.checksum = fnv1a(data.data(), data.size());
+
+    std::string tmpPath = _path + ".tmp";
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if(file == nullptr) {
+        std::cerr << "Кэш конвейеров: не удалось открыть " << tmpPath << " для записи" << std::endl;
+        return;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = std::fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok; //данные на диске до rename, иначе после сбоя питания можно получить пустой файл
+    ok = std::fclose(file) == 0 && ok;
+
+    if(!ok || std::rename(tmpPath.c_str(), _path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        std::cerr << "Кэш конвейеров: не удалось сохранить " << _path << std::endl;
+        return;
+    }
+
+    utils::log() << "Кэш конвейеров: сохранено " << data.size() << " байт за "
+              << millisecondsSince(start) << " мс" << std::endl;
+}
+
+void PipelineCache::destroy() {
+    if(_cache == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyPipelineCache(_device, _cache, nullptr);
+    _cache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+//VkPipelineCache, сохраняемый на диск между запусками.
+//Файл привязан к устройству и драйверу (pipelineCacheUUID, vendorID, deviceID, driverVersion):
+//данные от другого драйвера отбрасываются ещё до передачи в Vulkan
+class PipelineCache
+{
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& directory);
+    void save(); //атомарно: временный файл + rename, при падении остаётся старый файл целиком
+    void destroy();
+
+    VkPipelineCache get() const { return _cache; }
+    bool isWarm() const { return _loadedSize > 0; } //данные загружены с диска (попадание)
+    const std::string& getPath() const { return _path; }
+
+private:
+    bool load(std::vector<uint8_t>& data);
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties _props {};
+    VkPipelineCache _cache = VK_NULL_HANDLE;
+    std::string _path;
+    size_t _loadedSize = 0;
+};
@@ -0,0 +1,357 @@
+#include "pipelineLibrary.h"
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    //FNV-1a, как у хэша SPIR-V в ShaderModuleCache
+    struct Hasher {
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        template<typename T>
+        void add(const T& value) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+            for(size_t i = 0; i < sizeof(T); i++) {
+                hash ^= bytes[i];
+                hash *= 0x100000001b3ull;
+            }
+        }
+    };
+
+    template<typename T>
+    bool sameElements(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+}
+
+bool PipelineState::operator==(const PipelineState& other) const {
+    return topology == other.topology && polygonMode == other.polygonMode && cullMode == other.cullMode
+        && frontFace == other.frontFace && samples == other.samples && blend == other.blend
+        && keepDestinationAlpha == other.keepDestinationAlpha && depth == other.depth;
+}
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, uint32_t value) {
+    for(uint32_t i = 0; i < count; i++)
+        if(ids[i] == id) {
+            values[i] = value;
+            return *this;
+        }
+    if(count == maxCount)
+        throw std::runtime_error("Слишком много specialization constants у варианта конвейера");
+    ids[count] = id;
+    values[count] = value;
+    count++;
+    return *this;
+}
+
+bool SpecializationConstants::operator==(const SpecializationConstants& other) const {
+    if(count != other.count)
+        return false;
+    for(uint32_t i = 0; i < count; i++)
+        if(ids[i] != other.ids[i] || values[i] != other.values[i])
+            return false;
+    return true;
+}
+
+//поля по отдельности: байты выравнивания в хэш не попадают
+uint64_t PipelineKey::hash() const {
+    Hasher hasher;
+    hasher.add(vertexShader);
+    hasher.add(fragmentShader);
+    hasher.add(layout);
+    hasher.add(renderPass);
+    hasher.add(vertexInput);
+    hasher.add(state.topology);
+    hasher.add(state.polygonMode);
+    hasher.add(state.cullMode);
+    hasher.add(state.frontFace);
+    hasher.add(state.samples);
+    hasher.add(state.blend);
+    hasher.add(state.keepDestinationAlpha);
+    hasher.add(state.depth);
+    for(uint32_t i = 0; i < constants.count; i++) {
+        hasher.add(constants.ids[i]);
+        hasher.add(constants.values[i]);
+    }
+    return hasher.hash;
+}
+
+bool PipelineKey::operator==(const PipelineKey& other) const {
+    return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader && layout == other.layout
+        && renderPass == other.renderPass && vertexInput == other.vertexInput && state == other.state
+        && constants == other.constants;
+}
+
+void PipelineLibrary::init(const Config& config) {
+    _config = config;
+    _entries = std::make_unique<Entry[]>(config.capacity);
+    _entryCount = 0;
+
+    if(config.baseSpecialization) {
+        const VkSpecializationInfo& base = *config.baseSpecialization;
+        _baseEntries.assign(base.pMapEntries, base.pMapEntries + base.mapEntryCount);
+        const uint8_t* data = static_cast<const uint8_t*>(base.pData);
+        _baseData.assign(data, data + base.dataSize);
+    }
+}
+
+void PipelineLibrary::destroy() {
+    for(uint32_t i = 0; i < _entryCount; i++) {
+        _entries[i].pipeline.store(VK_NULL_HANDLE, std::memory_order_relaxed);
+        _entries[i].owned.reset();
+    }
+    _entries.reset();
+    _entryCount = 0;
+    _ids.clear();
+    _vertexInputs.clear();
+}
+
+uint32_t PipelineLibrary::addVertexInput(const VertexInputDescription& description) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(size_t i = 0; i < _vertexInputs.size(); i++)
+        if(sameElements(_vertexInputs[i].bindings, description.bindings)
+           && sameElements(_vertexInputs[i].attributes, description.attributes))
+            return static_cast<uint32_t>(i);
+    _vertexInputs.push_back(description);
+    return static_cast<uint32_t>(_vertexInputs.size() - 1);
+}
+
+PipelineId PipelineLibrary::request(const PipelineKey& key) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _ids.find(key);
+    if(found != _ids.end()) {
+        _stats.dedupedRequests++;
+        return found->second;
+    }
+    if(_entryCount == _config.capacity)
+        throw std::runtime_error("Библиотека конвейеров заполнена");
+    if(key.vertexInput >= _vertexInputs.size())
+        throw std::runtime_error("Вариант конвейера ссылается на незарегистрированный вход вершин");
+
+    const PipelineId id = _entryCount++;
+    _entries[id].key = key;
+    _ids.emplace(key, id);
+    _stats.variants++;
+    return id;
+}
+
+VkPipeline PipelineLibrary::get(PipelineId id) {
+    Entry& entry = _entries[id];
+    VkPipeline pipeline = entry.pipeline.load(std::memory_order_acquire);
+    return pipeline != VK_NULL_HANDLE ? pipeline : create(entry, true);
+}
+
+bool PipelineLibrary::isReady(PipelineId id) const {
+    return _entries[id].pipeline.load(std::memory_order_acquire) != VK_NULL_HANDLE;
+}
+
+uint32_t PipelineLibrary::getVariantCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entryCount;
+}
+
+PipelineKey PipelineLibrary::getKey(PipelineId id) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries[id].key;
+}
+
+void PipelineLibrary::prewarm(JobSystem* jobs) {
+    std::vector<Entry*> pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(uint32_t i = 0; i < _entryCount; i++)
+            if(_entries[i].pipeline.load(std::memory_order_acquire) == VK_NULL_HANDLE)
+                pending.push_back(&_entries[i]);
+    }
+    if(pending.empty())
+        return;
+
+    //по варианту на диапазон: время компиляции вариантов сильно различается
+    const uint32_t count = static_cast<uint32_t>(pending.size());
+    if(jobs == nullptr || jobs->getWorkerCount() == 1 || count == 1) {
+        for(Entry* entry : pending)
+            create(*entry, false);
+        return;
+    }
+    jobs->parallelFor(count, count, [&](uint32_t begin, uint32_t end, uint32_t, uint32_t) {
+        for(uint32_t i = begin; i < end; i++)
+            create(*pending[i], false);
+    });
+}
+
+VkPipeline PipelineLibrary::create(Entry& entry, bool onDemand) {
+    std::lock_guard<std::mutex> createLock(entry.createMutex);
+    VkPipeline pipeline = entry.pipeline.load(std::memory_order_acquire);
+    if(pipeline != VK_NULL_HANDLE) //создан другим потоком, пока ждали
+        return pipeline;
+
+    auto start = std::chrono::steady_clock::now();
+    entry.owned = UniquePipeline(_config.device, build(entry.key));
+    pipeline = entry.owned;
+    entry.pipeline.store(pipeline, std::memory_order_release);
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.created++;
+    if(onDemand)
+        _stats.createdOnDemand++;
+    else
+        _stats.prewarmed++;
+    _stats.createMilliseconds += milliseconds;
+    return pipeline;
+}
+
+VkPipeline PipelineLibrary::build(const PipelineKey& key) const {
+    const VertexInputDescription* vertexInput;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        vertexInput = &_vertexInputs.at(key.vertexInput);
+    }
+    const PipelineState& state = key.state;
+
+    //базовые константы, кроме переопределённых вариантом, затем константы варианта
+    std::vector<VkSpecializationMapEntry> mapEntries;
+    std::vector<uint8_t> specializationData = _baseData;
+    for(const VkSpecializationMapEntry& entry : _baseEntries)
+        if(std::find(key.constants.ids, key.constants.ids + key.constants.count, entry.constantID)
+           == key.constants.ids + key.constants.count)
+            mapEntries.push_back(entry);
+    for(uint32_t i = 0; i < key.constants.count; i++) {
+        VkSpecializationMapEntry entry {};
+        entry.constantID = key.constants.ids[i];
+        entry.offset = static_cast<uint32_t>(specializationData.size());
+        entry.size = sizeof(uint32_t);
+        mapEntries.push_back(entry);
+        const uint8_t* value = reinterpret_cast<const uint8_t*>(&key.constants.values[i]);
+        specializationData.insert(specializationData.end(), value, value + sizeof(uint32_t));
+    }
+
+    VkSpecializationInfo specialization {};
+    specialization.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+    specialization.pMapEntries = mapEntries.data();
+    specialization.dataSize = specializationData.size();
+    specialization.pData = specializationData.data();
+
+    //константы, которых нет в модуле стадии, не действуют: одна структура на обе стадии
+    VkPipelineShaderStageCreateInfo shaderStages[2] {};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = key.vertexShader;
+    shaderStages[0].pName = "main";
+    shaderStages[0].pSpecializationInfo = mapEntries.empty() ? nullptr : &specialization;
+    shaderStages[1] = shaderStages[0];
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = key.fragmentShader;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = vertexInput->createInfo();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo {};
+    inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyCreateInfo.topology = state.topology;
+
+    //вьюпорт и ножницы задаются при записи: от размера кадра конвейеры не зависят
+    const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo {};
+    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateCreateInfo.dynamicStateCount = 2;
+    dynamicStateCreateInfo.pDynamicStates = dynamicStates;
+
+    VkPipelineViewportStateCreateInfo viewportState {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = state.polygonMode;
+    rasterizer.lineWidth = 1.0f; //без wideLines только 1.0
+    rasterizer.cullMode = state.cullMode;
+    rasterizer.frontFace = state.frontFace;
+
+    VkPipelineMultisampleStateCreateInfo multisampling {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = state.samples;
+    multisampling.minSampleShading = 1.0f;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = state.depth != DepthMode::Disabled;
+    depthStencil.depthWriteEnable = state.depth == DepthMode::TestWrite;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencil.maxDepthBounds = 1.0f;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment {};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = state.blend != BlendMode::Opaque;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = state.blend == BlendMode::Additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = state.keepDestinationAlpha ? VK_BLEND_FACTOR_ZERO : VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = state.keepDestinationAlpha ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo {};
+    colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendCreateInfo.logicOp = VK_LOGIC_OP_COPY;
+    colorBlendCreateInfo.attachmentCount = 1;
+    colorBlendCreateInfo.pAttachments = &colorBlendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineCreateInfo {};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stageCount = 2;
+    pipelineCreateInfo.pStages = shaderStages;
+    pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
+    pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+    pipelineCreateInfo.pViewportState = &viewportState;
+    pipelineCreateInfo.pRasterizationState = &rasterizer;
+    pipelineCreateInfo.pMultisampleState = &multisampling;
+    pipelineCreateInfo.pDepthStencilState = state.depth != DepthMode::Disabled ? &depthStencil : nullptr;
+    pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
+    pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+    pipelineCreateInfo.layout = key.layout;
+    pipelineCreateInfo.renderPass = key.renderPass;
+    pipelineCreateInfo.subpass = 0;
+    pipelineCreateInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if(vkCreateGraphicsPipelines(_config.device, _config.cache, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать графический конвейер!");
+    return pipeline;
+}
+
+UniquePipeline PipelineLibrary::replace(PipelineId id, UniquePipeline pipeline) {
+    Entry& entry = _entries[id];
+    std::lock_guard<std::mutex> createLock(entry.createMutex);
+    std::swap(entry.owned, pipeline);
+    entry.pipeline.store(entry.owned, std::memory_order_release);
+    return pipeline;
+}
+
+std::vector<UniquePipeline> PipelineLibrary::takeAll() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<UniquePipeline> pipelines;
+    for(uint32_t i = 0; i < _entryCount; i++) {
+        Entry& entry = _entries[i];
+        entry.pipeline.store(VK_NULL_HANDLE, std::memory_order_relaxed);
+        if(entry.owned != VK_NULL_HANDLE)
+            pipelines.push_back(std::move(entry.owned));
+        entry.key = {};
+    }
+    _entryCount = 0;
+    _ids.clear();
+    return pipelines;
+}
+
+PipelineLibrary::Stats PipelineLibrary::getStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void PipelineLibrary::printReport(std::ostream& out) const {
+    const Stats stats = getStats();
+    out << "Конвейеры: вариантов " << stats.variants << ", создано " << stats.created << " за "
+        << stats.createMilliseconds << " мс (заранее " << stats.prewarmed << ", при первом использовании "
+        << stats.createdOnDemand << "), повторных запросов " << stats.dedupedRequests << std::endl;
+}
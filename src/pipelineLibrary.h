@@ -0,0 +1,162 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+#include "jobSystem.h"
+#include "vertexLayout.h"
+#include "vulkanHandle.h"
+
+//смешивание единственного цветового вложения
+enum class BlendMode : uint8_t {
+    Opaque,
+    Alpha,    //src * a + dst * (1 - a)
+    Additive, //src * a + dst
+};
+
+enum class DepthMode : uint8_t {
+    Disabled,
+    TestWrite,
+    TestOnly,
+};
+
+//фиксированные стадии конвейера; литеральный тип, готовые состояния - constexpr в pipelineStates
+struct PipelineState {
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT; //как у вложений прохода
+    BlendMode blend = BlendMode::Alpha;
+    bool keepDestinationAlpha = false; //альфа вложения не меняется (оверлей поверх сцены)
+    DepthMode depth = DepthMode::Disabled;
+
+    constexpr PipelineState withTopology(VkPrimitiveTopology value) const { PipelineState state = *this; state.topology = value; return state; }
+    constexpr PipelineState withCull(VkCullModeFlags value) const { PipelineState state = *this; state.cullMode = value; return state; }
+    constexpr PipelineState withSamples(VkSampleCountFlagBits value) const { PipelineState state = *this; state.samples = value; return state; }
+    constexpr PipelineState withBlend(BlendMode value) const { PipelineState state = *this; state.blend = value; return state; }
+    constexpr PipelineState withDepth(DepthMode value) const { PipelineState state = *this; state.depth = value; return state; }
+    constexpr PipelineState withKeptAlpha() const { PipelineState state = *this; state.keepDestinationAlpha = true; return state; }
+
+    bool operator==(const PipelineState& other) const;
+};
+
+namespace pipelineStates {
+    constexpr PipelineState scene {};
+    //квады обеих ориентаций, альфа кадра остаётся от сцены
+    constexpr PipelineState overlay = PipelineState {}.withCull(VK_CULL_MODE_NONE).withKeptAlpha();
+    constexpr PipelineState additiveOverlay = overlay.withBlend(BlendMode::Additive);
+}
+
+//значения specialization constants варианта; дополняют базовые константы библиотеки и заменяют их при совпадении id
+struct SpecializationConstants {
+    static constexpr uint32_t maxCount = 4;
+
+    uint32_t count = 0;
+    uint32_t ids[maxCount] {};
+    uint32_t values[maxCount] {};
+
+    //бросает исключение, если места нет
+    SpecializationConstants& set(uint32_t id, uint32_t value);
+    bool operator==(const SpecializationConstants& other) const;
+};
+
+//полное описание конвейера: по нему конвейеры дедуплицируются
+struct PipelineKey {
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE; //прототип совместимого прохода
+    uint32_t vertexInput = 0;                 //PipelineLibrary::addVertexInput
+    PipelineState state;
+    SpecializationConstants constants;
+
+    uint64_t hash() const;
+    bool operator==(const PipelineKey& other) const;
+};
+
+struct PipelineKeyHash {
+    size_t operator()(const PipelineKey& key) const { return static_cast<size_t>(key.hash()); }
+};
+
+using PipelineId = uint32_t;
+
+//графические конвейеры по PipelineKey. request регистрирует ключ (одинаковые ключи получают один id),
+//конвейер создаётся при первом get либо заранее в prewarm. get - индекс в массиве и атомарное чтение,
+//поэтому в цикле записи кадра хэш не считается, а драйвер вызывается только для не прогретых вариантов.
+//Потокобезопасна; конвейеры уничтожает destroy или забирает takeAll
+class PipelineLibrary
+{
+public:
+    struct Config {
+        VkDevice device = VK_NULL_HANDLE;
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        const VkSpecializationInfo* baseSpecialization = nullptr; //копируется в init
+        uint32_t capacity = 256; //вариантов; место не освобождается до takeAll
+    };
+
+    struct Stats {
+        uint32_t variants = 0;
+        uint32_t created = 0;
+        uint32_t prewarmed = 0;
+        uint32_t createdOnDemand = 0; //первым get: компиляция во время кадра
+        uint32_t dedupedRequests = 0;
+        double createMilliseconds = 0.0;
+    };
+
+    void init(const Config& config);
+    void destroy();
+
+    //описание копируется; одинаковые описания получают один индекс
+    uint32_t addVertexInput(const VertexInputDescription& description);
+
+    PipelineId request(const PipelineKey& key);
+    VkPipeline get(PipelineId id);
+    bool isReady(PipelineId id) const;
+    uint32_t getVariantCount() const;
+    PipelineKey getKey(PipelineId id) const;
+
+    //создаёт зарегистрированные, но ещё не созданные конвейеры; jobs == nullptr - в вызывающем потоке.
+    //Можно вызывать из отложенной задачи: get того же варианта дождётся его создания
+    void prewarm(JobSystem* jobs);
+
+    //новый конвейер без регистрации (горячая перезагрузка); владеет вызывающая сторона
+    VkPipeline build(const PipelineKey& key) const;
+    //подменяет конвейер варианта; прежний возвращается, его уничтожают, когда GPU его отпустит
+    UniquePipeline replace(PipelineId id, UniquePipeline pipeline);
+    //все созданные конвейеры для отложенного уничтожения; регистрации сбрасываются (смена прохода рендера).
+    //Другие потоки в это время не должны обращаться к библиотеке
+    std::vector<UniquePipeline> takeAll();
+
+    Stats getStats() const;
+    void printReport(std::ostream& out) const;
+
+private:
+    struct Entry {
+        PipelineKey key;
+        UniquePipeline owned;                                //меняется под createMutex
+        std::atomic<VkPipeline> pipeline { VK_NULL_HANDLE }; //копия owned для чтения без блокировки
+        std::mutex createMutex;                              //один вариант не компилируется дважды
+    };
+
+    VkPipeline create(Entry& entry, bool onDemand);
+
+    Config _config;
+    std::vector<VkSpecializationMapEntry> _baseEntries;
+    std::vector<uint8_t> _baseData;
+
+    mutable std::mutex _mutex;
+    //индекс - PipelineId; массив не растёт, поэтому get читает его без блокировки
+    std::unique_ptr<Entry[]> _entries;
+    uint32_t _entryCount = 0;
+    std::unordered_map<PipelineKey, PipelineId, PipelineKeyHash> _ids;
+    std::deque<VertexInputDescription> _vertexInputs; //ссылки на элементы не меняются при добавлении
+    Stats _stats;
+};
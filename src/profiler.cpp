@@ -0,0 +1,379 @@
+#include "profiler.h"
+
+#include <map>
+#include <algorithm>
+#include <string>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+    struct OpenZone {
+        const char* name;
+        double start;
+    };
+
+    //открытые зоны CPU текущего потока
+    thread_local std::vector<OpenZone> openZones;
+    thread_local uint32_t threadSlot = UINT32_MAX;
+
+    void writeJsonString(std::ostream& out, const char* text) {
+        out << '"';
+        for(const char* c = text; *c; c++) {
+            if(*c == '"' || *c == '\\')
+                out << '\\';
+            out << *c;
+        }
+        out << '"';
+    }
+
+    void writeEvent(std::ostream& out, const ProfileZone& zone, uint32_t pid, const char* category, bool& first) {
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(out, zone.name);
+        out << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"ts\":" << zone.start << ",\"dur\":" << zone.duration
+            << ",\"pid\":" << pid << ",\"tid\":" << zone.thread << "}";
+        first = false;
+    }
+}
+
+Profiler::Profiler(size_t historySize) : _epoch(std::chrono::steady_clock::now()), _history(historySize) {}
+
+void Profiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight,
+                    bool pipelineStatistics) {
+    _device = device;
+    _slots.assign(framesInFlight, SlotQueries {});
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    _timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    //0 значащих бит - очередь не поддерживает метки времени
+    const uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+    if(validBits == 0)
+        return;
+    _timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    for(uint32_t i = 0; i < framesInFlight; i++) {
+        VkQueryPoolCreateInfo poolCreateInfo {};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolCreateInfo.queryCount = maxGpuZones * 2;
+
+        VkQueryPool pool;
+        if(vkCreateQueryPool(_device, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать пул запросов меток времени!");
+        _timestampPools.push_back(pool);
+
+        if(!pipelineStatistics)
+            continue;
+
+        poolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolCreateInfo.queryCount = 1;
+        poolCreateInfo.pipelineStatistics = statisticFlags;
+        if(vkCreateQueryPool(_device, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать пул запросов статистики конвейера!");
+        _statisticsPools.push_back(pool);
+    }
+}
+
+void Profiler::destroy() {
+    for(VkQueryPool pool : _timestampPools)
+        vkDestroyQueryPool(_device, pool, nullptr);
+    for(VkQueryPool pool : _statisticsPools)
+        vkDestroyQueryPool(_device, pool, nullptr);
+    _timestampPools.clear();
+    _statisticsPools.clear();
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _epoch).count();
+}
+
+uint32_t Profiler::threadIndex() {
+    if(threadSlot == UINT32_MAX)
+        threadSlot = _threadCount.fetch_add(1);
+    return threadSlot;
+}
+
+void Profiler::beginCpuZone(const char* name) {
+    openZones.push_back({ name, now() });
+}
+
+void Profiler::endCpuZone() {
+    ProfileZone zone;
+    zone.name = openZones.back().name;
+    zone.start = openZones.back().start;
+    zone.duration = now() - zone.start;
+    zone.thread = threadIndex();
+    openZones.pop_back();
+    zone.depth = static_cast<uint32_t>(openZones.size());
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    (_frameActive ? _current.cpuZones : _initZones).push_back(zone);
+}
+
+void Profiler::beginFrame(uint32_t frameSlot, uint64_t frameNumber) {
+    double start = now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(!_slots.empty())
+        _currentSlot = frameSlot % _slots.size();
+
+    _current = FrameProfile {};
+    _current.frameNumber = frameNumber;
+    _current.cpuStart = start;
+    _gpuDepth = 0;
+    _submitTime = start;
+    _frameActive = true;
+}
+
+void Profiler::collectSlot() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_slots.empty())
+        return;
+
+    SlotQueries& slot = _slots[_currentSlot];
+    if(slot.pending)
+        collect(slot, _currentSlot);
+    slot.zoneNames.clear();
+    slot.zoneDepths.clear();
+    slot.statisticsWritten = false;
+}
+
+void Profiler::markSubmitted() {
+    double submitted = now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _submitTime = submitted;
+}
+
+void Profiler::endFrame() {
+    double end = now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _frameActive = false;
+    _current.cpuDuration = end - _current.cpuStart;
+
+    if(_slots.empty()) { //без GPU части кадр завершён сразу
+        pushHistory(std::move(_current));
+        return;
+    }
+
+    //профиль ждёт результатов запросов до следующего использования слота
+    SlotQueries& slot = _slots[_currentSlot];
+    slot.frame = std::move(_current);
+    slot.submitTime = _submitTime;
+    slot.pending = true;
+}
+
+void Profiler::collect(SlotQueries& slot, uint32_t frameSlot) {
+    slot.pending = false;
+    FrameProfile& frame = slot.frame;
+    const uint32_t zoneCount = static_cast<uint32_t>(slot.zoneNames.size());
+
+    if(!_timestampPools.empty() && zoneCount > 0) {
+        //пара (значение, доступность) на запрос; без VK_QUERY_RESULT_WAIT_BIT вызов не блокирует
+        std::vector<uint64_t> results(zoneCount * 4);
+        VkResult result = vkGetQueryPoolResults(_device, _timestampPools[frameSlot], 0, zoneCount * 2,
+                                                results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        if(result == VK_SUCCESS || result == VK_NOT_READY) {
+            const uint64_t origin = results[0] & _timestampMask;
+            double last = 0.0;
+            for(uint32_t i = 0; i < zoneCount; i++) {
+                if(results[i * 4 + 1] == 0 || results[i * 4 + 3] == 0) //зона ещё не выполнена
+                    continue;
+
+                //разность по маске корректна и при переполнении счётчика
+                const uint64_t begin = ((results[i * 4] & _timestampMask) - origin) & _timestampMask;
+                const uint64_t end = ((results[i * 4 + 2] & _timestampMask) - origin) & _timestampMask;
+
+                //часы GPU не связаны с часами CPU: начало первой зоны совмещаем с моментом отправки кадра
+                ProfileZone zone;
+                zone.name = slot.zoneNames[i];
+                zone.depth = slot.zoneDepths[i];
+                zone.start = slot.submitTime + begin * _timestampPeriod / 1000.0;
+                zone.duration = (end - begin) * _timestampPeriod / 1000.0;
+                frame.gpuZones.push_back(zone);
+                last = std::max(last, end * _timestampPeriod / 1000.0);
+            }
+            frame.gpuDuration = last;
+            if(last > 0.0) {
+                _lastGpuFrame = frame.frameNumber;
+                _lastGpuDuration = last;
+            }
+        }
+    }
+
+    if(slot.statisticsWritten) {
+        uint64_t values[6] = {}; //5 счётчиков в порядке битов statisticFlags и доступность
+        VkResult result = vkGetQueryPoolResults(_device, _statisticsPools[frameSlot], 0, 1, sizeof(values), values,
+                                                sizeof(values), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if(result == VK_SUCCESS && values[5] != 0) {
+            frame.statistics.inputVertices = values[0];
+            frame.statistics.inputPrimitives = values[1];
+            frame.statistics.vertexInvocations = values[2];
+            frame.statistics.clippingPrimitives = values[3];
+            frame.statistics.fragmentInvocations = values[4];
+            frame.statistics.valid = true;
+        }
+    }
+
+    pushHistory(std::move(frame));
+}
+
+void Profiler::pushHistory(FrameProfile&& frame) {
+    _history[_next] = std::move(frame);
+    _next = (_next + 1) % _history.size();
+    _count = std::min(_count + 1, _history.size());
+}
+
+void Profiler::resetQueries(VkCommandBuffer commandBuffer) {
+    if(!_frameActive || _timestampPools.empty())
+        return;
+
+    vkCmdResetQueryPool(commandBuffer, _timestampPools[_currentSlot], 0, maxGpuZones * 2);
+    if(!_statisticsPools.empty())
+        vkCmdResetQueryPool(commandBuffer, _statisticsPools[_currentSlot], 0, 1);
+}
+
+uint32_t Profiler::beginGpuZone(VkCommandBuffer commandBuffer, const char* name) {
+    //вне кадра (например, при замере записи) буфер не отправляется, и метки некому прочитать
+    if(!_frameActive || _timestampPools.empty())
+        return invalidZone;
+
+    SlotQueries& slot = _slots[_currentSlot];
+    if(slot.zoneNames.size() >= maxGpuZones)
+        return invalidZone;
+
+    const uint32_t zone = static_cast<uint32_t>(slot.zoneNames.size());
+    slot.zoneNames.push_back(name);
+    slot.zoneDepths.push_back(_gpuDepth++);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _timestampPools[_currentSlot], zone * 2);
+    return zone;
+}
+
+void Profiler::endGpuZone(VkCommandBuffer commandBuffer, uint32_t zone) {
+    if(zone == invalidZone)
+        return;
+
+    _gpuDepth--;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _timestampPools[_currentSlot], zone * 2 + 1);
+}
+
+void Profiler::beginStatistics(VkCommandBuffer commandBuffer) {
+    if(!_frameActive || _statisticsPools.empty())
+        return;
+
+    vkCmdBeginQuery(commandBuffer, _statisticsPools[_currentSlot], 0, 0);
+    _slots[_currentSlot].statisticsWritten = true;
+}
+
+void Profiler::endStatistics(VkCommandBuffer commandBuffer) {
+    if(!_frameActive || _statisticsPools.empty())
+        return;
+
+    vkCmdEndQuery(commandBuffer, _statisticsPools[_currentSlot], 0);
+}
+
+std::vector<FrameProfile> Profiler::recentFrames() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<FrameProfile> frames;
+    frames.reserve(_count);
+    for(size_t i = 0; i < _count; i++)
+        frames.push_back(_history[(_next + _history.size() - _count + i) % _history.size()]);
+    return frames;
+}
+
+bool Profiler::getLastGpuFrame(uint64_t& frameNumber, double& gpuDuration) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_lastGpuFrame == UINT64_MAX)
+        return false;
+    frameNumber = _lastGpuFrame;
+    gpuDuration = _lastGpuDuration;
+    return true;
+}
+
+std::vector<ProfileZone> Profiler::initZones() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _initZones;
+}
+
+void Profiler::writeChromeTrace(std::ostream& out) const {
+    std::vector<FrameProfile> frames = recentFrames();
+    std::vector<ProfileZone> init = initZones();
+
+    //pid 1 - потоки CPU, pid 2 - очередь графики
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}}";
+    out << ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}";
+    bool first = false;
+
+    for(const auto& zone : init)
+        writeEvent(out, zone, 1, "init", first);
+
+    for(const auto& frame : frames) {
+        ProfileZone frameZone;
+        frameZone.name = "frame";
+        frameZone.start = frame.cpuStart;
+        frameZone.duration = frame.cpuDuration;
+        writeEvent(out, frameZone, 1, "frame", first);
+
+        for(const auto& zone : frame.cpuZones)
+            writeEvent(out, zone, 1, "cpu", first);
+        for(const auto& zone : frame.gpuZones)
+            writeEvent(out, zone, 2, "gpu", first);
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void Profiler::printSummary(std::ostream& out) const {
+    std::vector<FrameProfile> frames = recentFrames();
+    if(frames.empty())
+        return;
+
+    struct Total {
+        double sum = 0.0;
+        uint32_t count = 0;
+    };
+    std::map<std::string, Total> cpu, gpu;
+    for(const auto& frame : frames) {
+        for(const auto& zone : frame.cpuZones) {
+            cpu[zone.name].sum += zone.duration;
+            cpu[zone.name].count++;
+        }
+        for(const auto& zone : frame.gpuZones) {
+            gpu[zone.name].sum += zone.duration;
+            gpu[zone.name].count++;
+        }
+    }
+
+    //среднее на кадр: зоны исполнителей встречаются в кадре несколько раз
+    const double frameCount = static_cast<double>(frames.size());
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "Профиль по " << frames.size() << " кадрам, мс на кадр:" << std::endl;
+    for(const auto& [name, total] : cpu)
+        out << "  CPU " << name << ": " << total.sum / frameCount / 1000.0 << " (x" << total.count / frameCount << ")" << std::endl;
+    for(const auto& [name, total] : gpu)
+        out << "  GPU " << name << ": " << total.sum / frameCount / 1000.0 << std::endl;
+
+    const PipelineStatistics& statistics = frames.back().statistics;
+    if(statistics.valid)
+        out << "  Статистика конвейера: вершин " << statistics.inputVertices << ", примитивов " << statistics.inputPrimitives
+            << ", вызовов вершинного шейдера " << statistics.vertexInvocations << ", после отсечения "
+            << statistics.clippingPrimitives << ", вызовов фрагментного шейдера " << statistics.fragmentInvocations << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
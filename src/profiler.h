@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vulkan/vulkan.h>
+
+//интервал профилирования; время в микросекундах от создания профилировщика
+struct ProfileZone {
+    const char* name = nullptr; //строковый литерал: зоны хранят только указатель
+    uint32_t thread = 0;        //порядковый номер потока CPU (0 - первый записавший поток), для GPU - 0
+    uint32_t depth = 0;         //вложенность в пределах потока
+    double start = 0.0;
+    double duration = 0.0;
+};
+
+//счётчики конвейера за проход сцены (VK_QUERY_TYPE_PIPELINE_STATISTICS)
+struct PipelineStatistics {
+    uint64_t inputVertices = 0;
+    uint64_t inputPrimitives = 0;
+    uint64_t vertexInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentInvocations = 0;
+    bool valid = false;
+};
+
+struct FrameProfile {
+    uint64_t frameNumber = 0;
+    double cpuStart = 0.0;
+    double cpuDuration = 0.0;
+    std::vector<ProfileZone> cpuZones;
+    std::vector<ProfileZone> gpuZones; //start выровнен по моменту отправки кадра, см. collect
+    double gpuDuration = 0.0;          //от первой до последней метки кадра
+    PipelineStatistics statistics;
+};
+
+//зоны CPU (любой поток) и GPU (метки времени VkQueryPool) с экспортом в Chrome trace / Perfetto JSON.
+//Результаты запросов читаются без ожидания, когда слот кадра снова используется, то есть после его забора
+class Profiler
+{
+public:
+    static constexpr uint32_t maxGpuZones = 64; //на кадр
+    static constexpr uint32_t invalidZone = UINT32_MAX;
+
+    Profiler(size_t historySize = 256);
+
+    //GPU часть; без init работают только зоны CPU
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t framesInFlight,
+              bool pipelineStatistics);
+    void destroy();
+
+    //зоны CPU: вне кадра попадают в зоны инициализации
+    void beginCpuZone(const char* name);
+    void endCpuZone();
+
+    class CpuScope {
+    public:
+        CpuScope(Profiler& profiler, const char* name) : _profiler(profiler) { _profiler.beginCpuZone(name); }
+        ~CpuScope() { _profiler.endCpuZone(); }
+        CpuScope(const CpuScope&) = delete;
+        CpuScope& operator=(const CpuScope&) = delete;
+    private:
+        Profiler& _profiler;
+    };
+
+    //в начале кадра, до ожидания забора слота: зоны CPU дальше относятся к этому кадру
+    void beginFrame(uint32_t frameSlot, uint64_t frameNumber);
+    //после ожидания забора слота: забирает результаты запросов прошлого кадра слота
+    void collectSlot();
+    void markSubmitted(); //сразу после vkQueueSubmit: к этому моменту привязываются зоны GPU кадра
+    //в конце кадра, после презентации
+    void endFrame();
+    bool isFrameActive() const { return _frameActive; }
+
+    //в начале буфера команд кадра, вне прохода рендера
+    void resetQueries(VkCommandBuffer commandBuffer);
+    //метки пишутся в первичный буфер вне прохода рендера либо внутри прохода с INLINE содержимым
+    uint32_t beginGpuZone(VkCommandBuffer commandBuffer, const char* name);
+    void endGpuZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+    class GpuScope {
+    public:
+        GpuScope(Profiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+            : _profiler(profiler), _commandBuffer(commandBuffer), _zone(profiler.beginGpuZone(commandBuffer, name)) {}
+        ~GpuScope() { _profiler.endGpuZone(_commandBuffer, _zone); }
+        GpuScope(const GpuScope&) = delete;
+        GpuScope& operator=(const GpuScope&) = delete;
+    private:
+        Profiler& _profiler;
+        VkCommandBuffer _commandBuffer;
+        uint32_t _zone;
+    };
+
+    //статистика конвейера для одного прохода за кадр; вторичные буферы внутри наследуют запрос
+    void beginStatistics(VkCommandBuffer commandBuffer);
+    void endStatistics(VkCommandBuffer commandBuffer);
+    VkQueryPipelineStatisticFlags getStatisticFlags() const { return _statisticsPools.empty() ? 0 : statisticFlags; }
+
+    bool hasGpuTimestamps() const { return !_timestampPools.empty(); }
+    //время GPU последнего кадра, чьи метки прочитаны, в микросекундах; false - таких кадров ещё не было.
+    //Без копирования истории, для решений каждый кадр
+    bool getLastGpuFrame(uint64_t& frameNumber, double& gpuDuration) const;
+
+    //последние завершённые кадры, от старых к новым
+    std::vector<FrameProfile> recentFrames() const;
+    std::vector<ProfileZone> initZones() const;
+
+    void writeChromeTrace(std::ostream& out) const;
+    void printSummary(std::ostream& out) const; //среднее время зон по истории
+
+private:
+    static constexpr VkQueryPipelineStatisticFlags statisticFlags =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    //запросы слота кадра и незавершённый профиль кадра, который их записал
+    struct SlotQueries {
+        std::vector<const char*> zoneNames;
+        std::vector<uint32_t> zoneDepths;
+        bool statisticsWritten = false;
+        bool pending = false;
+        double submitTime = 0.0;
+        FrameProfile frame;
+    };
+
+    double now() const;
+    uint32_t threadIndex();
+    void collect(SlotQueries& slot, uint32_t frameSlot);
+    void pushHistory(FrameProfile&& frame);
+
+    std::chrono::steady_clock::time_point _epoch;
+
+    VkDevice _device = VK_NULL_HANDLE;
+    double _timestampPeriod = 1.0; //наносекунд на тик
+    uint64_t _timestampMask = 0;
+    std::vector<VkQueryPool> _timestampPools;  //по слоту кадра, 2 запроса на зону
+    std::vector<VkQueryPool> _statisticsPools; //по слоту кадра, пусто - статистика выключена
+    std::vector<SlotQueries> _slots;
+    uint32_t _currentSlot = 0;
+    uint32_t _gpuDepth = 0;
+    double _submitTime = 0.0; //под _mutex, как и профиль текущего кадра
+
+    mutable std::mutex _mutex; //зоны CPU пишут исполнители JobSystem
+    std::atomic<uint32_t> _threadCount { 0 };
+    bool _frameActive = false;
+    FrameProfile _current;
+    std::vector<ProfileZone> _initZones;
+
+    std::vector<FrameProfile> _history;
+    uint64_t _lastGpuFrame = UINT64_MAX;
+    double _lastGpuDuration = 0.0;
+    size_t _next = 0;
+    size_t _count = 0;
+};
@@ -0,0 +1,49 @@
+#include "radixSort.h"
+
+#include <cstring>
+#include <utility>
+
+namespace utils {
+    void radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch) {
+        const size_t count = items.size();
+        if(count < 2)
+            return;
+        scratch.resize(count);
+
+        constexpr uint32_t digits = sizeof(uint64_t);
+        uint32_t histograms[digits][256] = {};
+        for(const SortItem& item : items)
+            for(uint32_t digit = 0; digit < digits; digit++)
+                histograms[digit][(item.key >> (digit * 8)) & 0xFF]++;
+
+        SortItem* source = items.data();
+        SortItem* target = scratch.data();
+        for(uint32_t digit = 0; digit < digits; digit++) {
+            const uint32_t shift = digit * 8;
+            uint32_t* histogram = histograms[digit];
+            //число ключей с данным байтом от порядка не зависит: проверяем по любому ключу
+            if(histogram[(source[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            uint32_t offset = 0; //начала корзин
+            for(uint32_t bucket = 0; bucket < 256; bucket++) {
+                const uint32_t bucketSize = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketSize;
+            }
+            for(size_t i = 0; i < count; i++)
+                target[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+            std::swap(source, target);
+        }
+
+        if(source != items.data())
+            items.swap(scratch);
+    }
+
+    uint32_t orderedFloatBits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        //у отрицательных обратный порядок модулей - инвертируем все биты, у положительных поднимаем знаковый
+        return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    }
+}
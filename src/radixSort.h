@@ -0,0 +1,23 @@
+#ifndef VULKANPROJECT_RADIXSORT_H
+#define VULKANPROJECT_RADIXSORT_H
+
+#include <vector>
+#include <cstdint>
+
+namespace utils {
+    //ключ сортировки и индекс элемента, к которому он относится
+    struct SortItem {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    //поразрядная сортировка LSD по байтам ключа: устойчивая, O(n) на разряд. Гистограммы всех разрядов
+    //считаются за один проход, разряды с одинаковым у всех ключей байтом пропускаются - ключи, где заняты
+    //не все поля, сортируются за меньшее число проходов. scratch - рабочий буфер, результат остаётся в items
+    void radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch);
+
+    //float в uint32_t с тем же порядком: отрицательные меньше положительных
+    uint32_t orderedFloatBits(float value);
+}
+
+#endif //VULKANPROJECT_RADIXSORT_H
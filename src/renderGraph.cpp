@@ -0,0 +1,810 @@
+#include "renderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    bool isDepthFormat(VkFormat format) {
+        switch(format) {
+            case VK_FORMAT_D16_UNORM:
+            case VK_FORMAT_X8_D24_UNORM_PACK32:
+            case VK_FORMAT_D32_SFLOAT:
+            case VK_FORMAT_D16_UNORM_S8_UINT:
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool hasStencil(VkFormat format) {
+        return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+               format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    }
+
+    template<typename Flags>
+    struct FlagName {
+        Flags bit;
+        const char* name;
+    };
+
+    const FlagName<VkPipelineStageFlags> stageNames[] = {
+            { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, "TOP_OF_PIPE" },
+            { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, "DRAW_INDIRECT" },
+            { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, "VERTEX_INPUT" },
+            { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, "VERTEX_SHADER" },
+            { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, "FRAGMENT_SHADER" },
+            { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, "EARLY_FRAGMENT_TESTS" },
+            { VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, "LATE_FRAGMENT_TESTS" },
+            { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, "COLOR_ATTACHMENT_OUTPUT" },
+            { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "COMPUTE_SHADER" },
+            { VK_PIPELINE_STAGE_TRANSFER_BIT, "TRANSFER" },
+            { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, "BOTTOM_OF_PIPE" },
+            { VK_PIPELINE_STAGE_HOST_BIT, "HOST" },
+            { VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, "ALL_GRAPHICS" },
+            { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, "ALL_COMMANDS" },
+    };
+
+    const FlagName<VkAccessFlags> accessNames[] = {
+            { VK_ACCESS_INDIRECT_COMMAND_READ_BIT, "INDIRECT_COMMAND_READ" },
+            { VK_ACCESS_INDEX_READ_BIT, "INDEX_READ" },
+            { VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, "VERTEX_ATTRIBUTE_READ" },
+            { VK_ACCESS_UNIFORM_READ_BIT, "UNIFORM_READ" },
+            { VK_ACCESS_SHADER_READ_BIT, "SHADER_READ" },
+            { VK_ACCESS_SHADER_WRITE_BIT, "SHADER_WRITE" },
+            { VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, "COLOR_ATTACHMENT_READ" },
+            { VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, "COLOR_ATTACHMENT_WRITE" },
+            { VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, "DEPTH_STENCIL_ATTACHMENT_READ" },
+            { VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, "DEPTH_STENCIL_ATTACHMENT_WRITE" },
+            { VK_ACCESS_TRANSFER_READ_BIT, "TRANSFER_READ" },
+            { VK_ACCESS_TRANSFER_WRITE_BIT, "TRANSFER_WRITE" },
+            { VK_ACCESS_HOST_READ_BIT, "HOST_READ" },
+            { VK_ACCESS_HOST_WRITE_BIT, "HOST_WRITE" },
+            { VK_ACCESS_MEMORY_READ_BIT, "MEMORY_READ" },
+            { VK_ACCESS_MEMORY_WRITE_BIT, "MEMORY_WRITE" },
+    };
+
+    template<typename Flags, size_t N>
+    std::string flagsToString(Flags flags, const FlagName<Flags> (&names)[N]) {
+        if(flags == 0)
+            return "0";
+
+        std::string result;
+        for(const auto& name : names) {
+            if((flags & name.bit) == 0)
+                continue;
+            if(!result.empty())
+                result += "|";
+            result += name.name;
+        }
+        return result;
+    }
+
+    const char* layoutName(VkImageLayout layout) {
+        switch(layout) {
+            case VK_IMAGE_LAYOUT_UNDEFINED: return "UNDEFINED";
+            case VK_IMAGE_LAYOUT_GENERAL: return "GENERAL";
+            case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "COLOR_ATTACHMENT";
+            case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "DEPTH_STENCIL_ATTACHMENT";
+            case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return "DEPTH_STENCIL_READ_ONLY";
+            case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "SHADER_READ_ONLY";
+            case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "TRANSFER_SRC";
+            case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "TRANSFER_DST";
+            case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "PRESENT_SRC";
+            default: return "OTHER";
+        }
+    }
+
+    const char* loadOpName(VkAttachmentLoadOp op) {
+        switch(op) {
+            case VK_ATTACHMENT_LOAD_OP_LOAD: return "LOAD";
+            case VK_ATTACHMENT_LOAD_OP_CLEAR: return "CLEAR";
+            default: return "DONT_CARE";
+        }
+    }
+}
+
+void RenderGraph::PassBuilder::writeColor(RenderResource resource, VkAttachmentLoadOp loadOp, VkClearColorValue clear) {
+    Access access {};
+    access.resource = resource.index;
+    access.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    access.access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    if(loadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+        access.access |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+    access.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    access.write = true;
+    access.attachment = AttachmentKind::Color;
+    access.loadOp = loadOp;
+    access.clear.color = clear;
+    _graph.addAccess(_pass, access);
+}
+
+void RenderGraph::PassBuilder::writeDepth(RenderResource resource, VkAttachmentLoadOp loadOp, float clearDepth) {
+    Access access {};
+    access.resource = resource.index;
+    access.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    access.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    access.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    access.write = true;
+    access.attachment = AttachmentKind::Depth;
+    access.loadOp = loadOp;
+    access.clear.depthStencil = { clearDepth, 0 };
+    _graph.addAccess(_pass, access);
+}
+
+void RenderGraph::PassBuilder::readDepth(RenderResource resource) {
+    Access access {};
+    access.resource = resource.index;
+    access.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    access.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    access.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    access.write = false;
+    access.attachment = AttachmentKind::Depth;
+    access.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    _graph.addAccess(_pass, access);
+}
+
+void RenderGraph::PassBuilder::sampleImage(RenderResource resource, VkPipelineStageFlags stages) {
+    readImage(resource, stages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void RenderGraph::PassBuilder::readImage(RenderResource resource, VkPipelineStageFlags stages, VkAccessFlags access,
+                                         VkImageLayout layout) {
+    _graph.addAccess(_pass, { resource.index, stages, access, layout, false });
+}
+
+void RenderGraph::PassBuilder::writeImage(RenderResource resource, VkPipelineStageFlags stages, VkAccessFlags access,
+                                          VkImageLayout layout) {
+    _graph.addAccess(_pass, { resource.index, stages, access, layout, true });
+}
+
+void RenderGraph::PassBuilder::readBuffer(RenderResource resource, VkPipelineStageFlags stages, VkAccessFlags access) {
+    _graph.addAccess(_pass, { resource.index, stages, access, VK_IMAGE_LAYOUT_UNDEFINED, false });
+}
+
+void RenderGraph::PassBuilder::writeBuffer(RenderResource resource, VkPipelineStageFlags stages, VkAccessFlags access) {
+    _graph.addAccess(_pass, { resource.index, stages, access, VK_IMAGE_LAYOUT_UNDEFINED, true });
+}
+
+void RenderGraph::PassBuilder::sideEffects() {
+    _graph._passes[_pass].sideEffects = true;
+}
+
+RenderGraph::RenderGraph(VkDevice device, DeviceAllocator& allocator) : _device(device), _allocator(allocator) {}
+
+RenderGraph::~RenderGraph() {
+    destroy();
+}
+
+RenderResource RenderGraph::importImage(const std::string& name, VkFormat format, VkExtent2D extent,
+                                        const ResourceState& initial, const ResourceState& final) {
+    Resource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.output = true;
+    resource.desc.format = format;
+    resource.desc.extent = extent;
+    resource.initial = initial;
+    resource.final = final;
+    _resources.push_back(resource);
+    return { static_cast<uint32_t>(_resources.size() - 1) };
+}
+
+RenderResource RenderGraph::importBuffer(const std::string& name, const ResourceState& initial) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = false;
+    resource.imported = true;
+    resource.initial = initial;
+    _resources.push_back(resource);
+    return { static_cast<uint32_t>(_resources.size() - 1) };
+}
+
+RenderResource RenderGraph::createImage(const std::string& name, const TransientImageDesc& desc) {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    _resources.push_back(resource);
+    return { static_cast<uint32_t>(_resources.size() - 1) };
+}
+
+void RenderGraph::addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, ExecuteFunction execute) {
+    if(_compiled)
+        throw std::runtime_error("Граф кадра уже скомпилирован");
+
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    _passes.push_back(std::move(pass));
+
+    PassBuilder builder(*this, static_cast<uint32_t>(_passes.size() - 1));
+    setup(builder);
+}
+
+void RenderGraph::markOutput(RenderResource resource) {
+    _resources.at(resource.index).output = true;
+}
+
+//одно обращение на ресурс в проходе: повторные объявления объединяются
+void RenderGraph::addAccess(uint32_t pass, const Access& access) {
+    Pass& target = _passes[pass];
+    if(access.resource >= _resources.size())
+        throw std::runtime_error("Проход '" + target.name + "' обращается к несуществующему ресурсу графа");
+
+    const Resource& resource = _resources[access.resource];
+    if(resource.isImage != (access.layout != VK_IMAGE_LAYOUT_UNDEFINED))
+        throw std::runtime_error("Проход '" + target.name + "' обращается к '" + resource.name + "' не как к ресурсу его типа");
+
+    for(auto& existing : target.accesses) {
+        if(existing.resource != access.resource)
+            continue;
+        if(existing.layout != access.layout || existing.attachment != AttachmentKind::None || access.attachment != AttachmentKind::None)
+            throw std::runtime_error("Проход '" + target.name + "' обращается к '" + resource.name + "' несовместимыми способами");
+        existing.stages |= access.stages;
+        existing.access |= access.access;
+        existing.write = existing.write || access.write;
+        return;
+    }
+    target.accesses.push_back(access);
+}
+
+void RenderGraph::compile() {
+    if(_compiled)
+        throw std::runtime_error("Граф кадра уже скомпилирован");
+
+    cullPasses();
+    computeLifetimes();
+    createTransients();
+    computeBarriers();
+    createRenderPasses();
+    _compiled = true;
+}
+
+//обратный обход: проход живой, если пишет ресурс, который нужен кому-то после него
+void RenderGraph::cullPasses() {
+    std::vector<bool> needed(_resources.size());
+    for(size_t i = 0; i < _resources.size(); i++)
+        needed[i] = _resources[i].output;
+
+    for(size_t i = _passes.size(); i-- > 0;) {
+        Pass& pass = _passes[i];
+        bool live = pass.sideEffects;
+        for(const auto& access : pass.accesses)
+            live = live || (access.write && needed[access.resource]);
+        pass.culled = !live;
+        if(!live)
+            continue;
+
+        //вложение, перезаписанное целиком, не нуждается в прежнем содержимом
+        for(const auto& access : pass.accesses)
+            if(access.write && access.attachment != AttachmentKind::None && access.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD)
+                needed[access.resource] = false;
+        for(const auto& access : pass.accesses)
+            if(!access.write || access.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+                needed[access.resource] = true;
+    }
+
+    _order.clear();
+    for(uint32_t i = 0; i < _passes.size(); i++)
+        if(!_passes[i].culled)
+            _order.push_back(i);
+}
+
+void RenderGraph::computeLifetimes() {
+    for(uint32_t order = 0; order < _order.size(); order++) {
+        for(auto& access : _passes[_order[order]].accesses) {
+            Resource& resource = _resources[access.resource];
+            if(!resource.isImage)
+                continue;
+
+            switch(access.attachment) {
+                case AttachmentKind::Color: resource.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+                case AttachmentKind::Depth: resource.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+                case AttachmentKind::None:
+                    if(access.layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+                        resource.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+                    else if(access.layout == VK_IMAGE_LAYOUT_GENERAL)
+                        resource.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+                    else if(access.layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+                        resource.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                    else if(access.layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+                        resource.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+                    break;
+            }
+
+            if(resource.imported)
+                continue;
+            if(resource.firstPass == UINT32_MAX) {
+                //содержимое временного изображения до первой записи не определено
+                if(!access.write)
+                    throw std::runtime_error("Временный ресурс '" + resource.name + "' читается в проходе '" +
+                                             _passes[_order[order]].name + "' до записи");
+                if(access.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+                    access.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                resource.firstPass = order;
+            }
+            resource.lastPass = order;
+        }
+    }
+
+    //вложение сохраняется, только если его прочитают позже; иначе оно может остаться в памяти тайла
+    for(uint32_t order = 0; order < _order.size(); order++) {
+        for(auto& access : _passes[_order[order]].accesses) {
+            const Resource& resource = _resources[access.resource];
+            if(access.attachment == AttachmentKind::None)
+                continue;
+            bool keep = resource.imported || resource.output || resource.lastPass > order;
+            access.storeOp = keep ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        }
+    }
+}
+
+void RenderGraph::createTransients() {
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = _allocator.getMemoryProperties();
+    uint32_t lazyTypes = 0;
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        if(memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+            lazyTypes |= 1u << i;
+
+    std::vector<uint32_t> transients;
+    for(uint32_t i = 0; i < _resources.size(); i++) {
+        Resource& resource = _resources[i];
+        if(!resource.isImage || resource.imported || resource.firstPass == UINT32_MAX)
+            continue;
+
+        //вложение одного прохода, которое не сохраняется: на тайловых GPU память под него может не выделяться вовсе
+        const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        resource.lazy = lazyTypes != 0 && !resource.output && resource.firstPass == resource.lastPass &&
+                        (resource.usage & ~attachmentUsage) == 0;
+
+        VkImageCreateInfo imageCreateInfo {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = resource.desc.format;
+        imageCreateInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = resource.desc.samples;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.usage = resource.usage | (resource.lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if(vkCreateImage(_device, &imageCreateInfo, nullptr, &resource.image) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать временное изображение '" + resource.name + "'");
+        vkGetImageMemoryRequirements(_device, resource.image, &resource.requirements);
+        resource.lazy = resource.lazy && (resource.requirements.memoryTypeBits & lazyTypes) != 0;
+        transients.push_back(i);
+    }
+
+    //жадное назначение по первому проходу: ресурс занимает слот, чей последний пользователь уже отработал,
+    //из подходящих - наиболее близкий по размеру
+    std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) {
+        return _resources[a].firstPass < _resources[b].firstPass;
+    });
+    for(uint32_t index : transients) {
+        Resource& resource = _resources[index];
+
+        uint32_t best = UINT32_MAX;
+        if(!resource.lazy) {
+            for(uint32_t i = 0; i < _slots.size(); i++) {
+                const MemorySlot& slot = _slots[i];
+                if(slot.lazy || slot.lastPass >= resource.firstPass ||
+                   (slot.requirements.memoryTypeBits & resource.requirements.memoryTypeBits) == 0)
+                    continue;
+
+                auto waste = [&resource](const MemorySlot& candidate) {
+                    VkDeviceSize a = candidate.requirements.size, b = resource.requirements.size;
+                    return a > b ? a - b : b - a;
+                };
+                if(best == UINT32_MAX || waste(slot) < waste(_slots[best]))
+                    best = i;
+            }
+        }
+
+        if(best == UINT32_MAX) {
+            MemorySlot slot;
+            slot.requirements = resource.requirements;
+            slot.lazy = resource.lazy;
+            _slots.push_back(slot);
+            best = static_cast<uint32_t>(_slots.size() - 1);
+        }
+
+        MemorySlot& slot = _slots[best];
+        slot.requirements.size = std::max(slot.requirements.size, resource.requirements.size);
+        slot.requirements.alignment = std::max(slot.requirements.alignment, resource.requirements.alignment);
+        slot.requirements.memoryTypeBits &= resource.requirements.memoryTypeBits;
+        slot.lastPass = resource.lastPass;
+        slot.resources.push_back(index);
+        resource.slot = best;
+    }
+
+    for(auto& slot : _slots) {
+        VkMemoryPropertyFlags properties = slot.lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        slot.allocation = _allocator.allocate(slot.requirements, properties, ResourceKind::Optimal);
+
+        for(uint32_t index : slot.resources) {
+            Resource& resource = _resources[index];
+            if(vkBindImageMemory(_device, resource.image, slot.allocation.memory, slot.allocation.offset) != VK_SUCCESS)
+                throw std::runtime_error("Не удалось привязать память временного изображения '" + resource.name + "'");
+
+            VkImageViewCreateInfo viewCreateInfo {};
+            viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewCreateInfo.image = resource.image;
+            viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewCreateInfo.format = resource.desc.format;
+            viewCreateInfo.subresourceRange.aspectMask = aspectMask(index);
+            viewCreateInfo.subresourceRange.levelCount = 1;
+            viewCreateInfo.subresourceRange.layerCount = 1;
+
+            if(vkCreateImageView(_device, &viewCreateInfo, nullptr, &resource.view) != VK_SUCCESS)
+                throw std::runtime_error("Не удалось создать представление временного изображения '" + resource.name + "'");
+        }
+    }
+}
+
+//два обхода: первый узнаёт, в каком состоянии кадр оставляет ресурсы, второй начинает с него.
+//Так первый проход кадра ждёт последних пользователей той же памяти в предыдущем кадре и в совмещённых ресурсах
+void RenderGraph::computeBarriers() {
+    std::vector<Tracked> initial(_resources.size());
+    for(size_t i = 0; i < _resources.size(); i++) {
+        const Resource& resource = _resources[i];
+        if(!resource.imported)
+            continue;
+        initial[i].layout = resource.initial.layout;
+        initial[i].writeStages = resource.initial.stages;
+        initial[i].writeAccess = resource.initial.access;
+    }
+
+    auto simulate = [this](std::vector<Tracked> tracked, bool record) {
+        for(uint32_t passIndex : _order) {
+            Pass& pass = _passes[passIndex];
+            BarrierBatch batch;
+            for(const auto& access : pass.accesses)
+                transition(tracked[access.resource], access, batch);
+            if(record)
+                pass.barriers = std::move(batch);
+        }
+        return tracked;
+    };
+
+    std::vector<Tracked> last = simulate(initial, false);
+    for(const auto& slot : _slots) {
+        for(size_t k = 0; k < slot.resources.size(); k++) {
+            uint32_t previous = slot.resources[(k + slot.resources.size() - 1) % slot.resources.size()];
+            Tracked& tracked = initial[slot.resources[k]];
+            tracked.layout = VK_IMAGE_LAYOUT_UNDEFINED; //содержимое предыдущего владельца памяти не нужно
+            tracked.writeStages = last[previous].writeStages | last[previous].readStages;
+            tracked.writeAccess = last[previous].writeAccess;
+        }
+    }
+    last = simulate(initial, true);
+
+    _finalBarriers = {};
+    for(uint32_t i = 0; i < _resources.size(); i++) {
+        const Resource& resource = _resources[i];
+        if(!resource.imported || !resource.isImage)
+            continue;
+
+        Access access {};
+        access.resource = i;
+        access.stages = resource.final.stages != 0 ? resource.final.stages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        access.access = resource.final.access;
+        access.layout = resource.final.layout;
+        access.write = false;
+        transition(last[i], access, _finalBarriers);
+    }
+}
+
+//добавляет в batch барьер, если обращение конфликтует с предыдущими: запись после чтения или записи,
+//чтение после записи, которой эта стадия ещё не видит, или смена layout
+void RenderGraph::transition(Tracked& tracked, const Access& access, BarrierBatch& batch) const {
+    const Resource& resource = _resources[access.resource];
+    const bool layoutChange = resource.isImage && tracked.layout != access.layout;
+
+    VkPipelineStageFlags srcStages = 0;
+    VkAccessFlags srcAccess = 0;
+    bool needed = false;
+    if(access.write || layoutChange) {
+        srcStages = tracked.writeStages | tracked.readStages;
+        srcAccess = tracked.writeAccess;
+        needed = srcStages != 0 || layoutChange;
+    } else if(tracked.writeStages != 0 && ((access.stages & ~tracked.visibleStages) || (access.access & ~tracked.visibleAccess))) {
+        srcStages = tracked.writeStages;
+        srcAccess = tracked.writeAccess;
+        needed = true;
+    }
+
+    if(needed) {
+        batch.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        batch.dstStages |= access.stages;
+        if(resource.isImage) {
+            batch.images.push_back({ access.resource, tracked.layout, access.layout, srcAccess, access.access });
+        } else {
+            batch.memoryBarrier = batch.memoryBarrier || srcAccess != 0;
+            batch.memorySrcAccess |= srcAccess;
+            batch.memoryDstAccess |= access.access;
+        }
+    }
+
+    if(access.write) {
+        tracked = {};
+        tracked.layout = access.layout;
+        tracked.writeStages = access.stages;
+        tracked.writeAccess = access.access;
+    } else if(layoutChange) { //переход layout - запись, которую стадии получателя уже видят
+        tracked = {};
+        tracked.layout = access.layout;
+        tracked.writeStages = access.stages;
+        tracked.readStages = access.stages;
+        tracked.visibleStages = access.stages;
+        tracked.visibleAccess = access.access;
+    } else {
+        tracked.readStages |= access.stages;
+        if(needed) {
+            tracked.visibleStages |= access.stages;
+            tracked.visibleAccess |= access.access;
+        }
+    }
+}
+
+//layout вложений меняют барьеры графа, поэтому внутри прохода рендеринга переходов нет
+void RenderGraph::createRenderPasses() {
+    for(uint32_t passIndex : _order) {
+        Pass& pass = _passes[passIndex];
+
+        std::vector<VkAttachmentDescription> descriptions;
+        std::vector<VkAttachmentReference> colorReferences;
+        VkAttachmentReference depthReference {};
+        bool hasDepth = false;
+
+        for(const auto& access : pass.accesses) {
+            if(access.attachment == AttachmentKind::None)
+                continue;
+            const Resource& resource = _resources[access.resource];
+
+            if(pass.attachments.empty())
+                pass.extent = resource.desc.extent;
+            else if(pass.extent.width != resource.desc.extent.width || pass.extent.height != resource.desc.extent.height)
+                throw std::runtime_error("Вложения прохода '" + pass.name + "' разного размера");
+
+            VkAttachmentDescription description {};
+            description.format = resource.desc.format;
+            description.samples = resource.desc.samples;
+            description.loadOp = access.loadOp;
+            description.storeOp = access.storeOp;
+            const bool stencil = hasStencil(resource.desc.format);
+            description.stencilLoadOp = stencil ? access.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            description.stencilStoreOp = stencil ? access.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            description.initialLayout = access.layout;
+            description.finalLayout = access.layout;
+
+            VkAttachmentReference reference {};
+            reference.attachment = static_cast<uint32_t>(descriptions.size());
+            reference.layout = access.layout;
+            if(access.attachment == AttachmentKind::Color) {
+                colorReferences.push_back(reference);
+            } else {
+                if(hasDepth)
+                    throw std::runtime_error("У прохода '" + pass.name + "' больше одного вложения глубины");
+                depthReference = reference;
+                hasDepth = true;
+            }
+
+            descriptions.push_back(description);
+            pass.attachments.push_back(access.resource);
+            pass.clearValues.push_back(access.clear);
+        }
+
+        if(descriptions.empty())
+            continue; //вычислительный проход или копирование
+
+        VkSubpassDescription subpass {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+        subpass.pColorAttachments = colorReferences.data();
+        subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+        VkRenderPassCreateInfo renderPassCreateInfo {};
+        renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+        renderPassCreateInfo.pAttachments = descriptions.data();
+        renderPassCreateInfo.subpassCount = 1;
+        renderPassCreateInfo.pSubpasses = &subpass;
+
+        if(vkCreateRenderPass(_device, &renderPassCreateInfo, nullptr, &pass.renderPass) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать проход рендеринга '" + pass.name + "'");
+    }
+}
+
+void RenderGraph::setImportedImage(RenderResource resource, VkImage image, VkImageView view) {
+    Resource& target = _resources.at(resource.index);
+    if(!target.imported || !target.isImage)
+        throw std::runtime_error("'" + target.name + "' не импортированное изображение");
+    target.image = image;
+    target.view = view;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+    if(!_compiled)
+        throw std::runtime_error("Граф кадра не скомпилирован");
+
+    for(uint32_t passIndex : _order) {
+        Pass& pass = _passes[passIndex];
+        recordBarriers(commandBuffer, pass.barriers);
+
+        PassContext context;
+        if(pass.renderPass != VK_NULL_HANDLE) {
+            context.renderPass = pass.renderPass;
+            context.framebuffer = getFramebuffer(pass);
+            context.extent = pass.extent;
+
+            context.beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            context.beginInfo.renderPass = pass.renderPass;
+            context.beginInfo.framebuffer = context.framebuffer;
+            context.beginInfo.renderArea.offset = {0, 0};
+            context.beginInfo.renderArea.extent = pass.extent;
+            context.beginInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+            context.beginInfo.pClearValues = pass.clearValues.data();
+        }
+        pass.execute(commandBuffer, context);
+    }
+    recordBarriers(commandBuffer, _finalBarriers);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) {
+    if(batch.empty())
+        return;
+
+    VkMemoryBarrier memoryBarrier {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = batch.memorySrcAccess;
+    memoryBarrier.dstAccessMask = batch.memoryDstAccess;
+
+    _imageBarriers.clear();
+    for(const auto& barrier : batch.images) {
+        const Resource& resource = _resources[barrier.resource];
+        if(resource.image == VK_NULL_HANDLE)
+            throw std::runtime_error("Изображение '" + resource.name + "' не задано через setImportedImage");
+
+        VkImageMemoryBarrier imageBarrier {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = resource.image;
+        imageBarrier.subresourceRange.aspectMask = aspectMask(barrier.resource);
+        imageBarrier.subresourceRange.levelCount = 1;
+        imageBarrier.subresourceRange.layerCount = 1;
+        _imageBarriers.push_back(imageBarrier);
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0,
+                         batch.memoryBarrier ? 1 : 0, &memoryBarrier, 0, nullptr,
+                         static_cast<uint32_t>(_imageBarriers.size()), _imageBarriers.data());
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(const Pass& pass) {
+    _framebufferKey.first = pass.renderPass;
+    _framebufferKey.second.clear();
+    for(uint32_t resource : pass.attachments) {
+        if(_resources[resource].view == VK_NULL_HANDLE)
+            throw std::runtime_error("Изображение '" + _resources[resource].name + "' не задано через setImportedImage");
+        _framebufferKey.second.push_back(_resources[resource].view);
+    }
+
+    auto found = _framebuffers.find(_framebufferKey);
+    if(found != _framebuffers.end())
+        return found->second;
+
+    VkFramebufferCreateInfo framebufferCreateInfo {};
+    framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferCreateInfo.renderPass = pass.renderPass;
+    framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(_framebufferKey.second.size());
+    framebufferCreateInfo.pAttachments = _framebufferKey.second.data();
+    framebufferCreateInfo.width = pass.extent.width;
+    framebufferCreateInfo.height = pass.extent.height;
+    framebufferCreateInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if(vkCreateFramebuffer(_device, &framebufferCreateInfo, nullptr, &framebuffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать фреймбуфер прохода '" + pass.name + "'");
+    _framebuffers.emplace(_framebufferKey, framebuffer);
+    return framebuffer;
+}
+
+VkImageAspectFlags RenderGraph::aspectMask(uint32_t resource) const {
+    VkFormat format = _resources[resource].desc.format;
+    if(!isDepthFormat(format))
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    return VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+}
+
+void RenderGraph::destroy() {
+    for(auto& framebuffer : _framebuffers)
+        vkDestroyFramebuffer(_device, framebuffer.second, nullptr);
+    _framebuffers.clear();
+
+    for(auto& pass : _passes) {
+        vkDestroyRenderPass(_device, pass.renderPass, nullptr);
+        pass.renderPass = VK_NULL_HANDLE;
+    }
+
+    for(auto& resource : _resources) {
+        if(resource.imported)
+            continue;
+        vkDestroyImageView(_device, resource.view, nullptr);
+        vkDestroyImage(_device, resource.image, nullptr);
+        resource.view = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+    }
+
+    for(auto& slot : _slots)
+        if(slot.allocation.memory != VK_NULL_HANDLE)
+            _allocator.free(slot.allocation);
+    _slots.clear();
+}
+
+void RenderGraph::printDebug(std::ostream& out) const {
+    size_t barrierCount = 0;
+    for(uint32_t passIndex : _order)
+        barrierCount += _passes[passIndex].barriers.empty() ? 0 : 1;
+    barrierCount += _finalBarriers.empty() ? 0 : 1;
+
+    out << "Граф кадра: проходов " << _order.size() << " из " << _passes.size()
+        << ", vkCmdPipelineBarrier: " << barrierCount << std::endl;
+
+    auto printBatch = [this, &out](const BarrierBatch& batch) {
+        if(batch.empty())
+            return;
+        out << "    барьер " << flagsToString(batch.srcStages, stageNames) << " -> "
+            << flagsToString(batch.dstStages, stageNames) << std::endl;
+        if(batch.memoryBarrier)
+            out << "      память: " << flagsToString(batch.memorySrcAccess, accessNames) << " -> "
+                << flagsToString(batch.memoryDstAccess, accessNames) << std::endl;
+        for(const auto& image : batch.images)
+            out << "      " << _resources[image.resource].name << ": " << layoutName(image.oldLayout) << " -> "
+                << layoutName(image.newLayout) << ", " << flagsToString(image.srcAccess, accessNames) << " -> "
+                << flagsToString(image.dstAccess, accessNames) << std::endl;
+    };
+
+    for(uint32_t i = 0; i < _passes.size(); i++) {
+        const Pass& pass = _passes[i];
+        if(pass.culled) {
+            out << "  " << pass.name << ": отброшен, результат не используется" << std::endl;
+            continue;
+        }
+
+        out << "  " << pass.name << (pass.renderPass != VK_NULL_HANDLE ? " (проход рендеринга)" : "") << std::endl;
+        printBatch(pass.barriers);
+        for(const auto& access : pass.accesses) {
+            if(access.attachment == AttachmentKind::None)
+                continue;
+            out << "    вложение " << _resources[access.resource].name << ": " << loadOpName(access.loadOp) << " / "
+                << (access.storeOp == VK_ATTACHMENT_STORE_OP_STORE ? "STORE" : "DONT_CARE") << std::endl;
+        }
+    }
+    if(!_finalBarriers.empty()) {
+        out << "  конец кадра" << std::endl;
+        printBatch(_finalBarriers);
+    }
+
+    VkDeviceSize aliased = 0, separate = 0;
+    for(uint32_t s = 0; s < _slots.size(); s++) {
+        const MemorySlot& slot = _slots[s];
+        aliased += slot.requirements.size;
+        for(uint32_t index : slot.resources) {
+            const Resource& resource = _resources[index];
+            separate += resource.requirements.size;
+            out << "  временный " << resource.name << " " << resource.desc.extent.width << "x" << resource.desc.extent.height
+                << ": проходы " << resource.firstPass << ".." << resource.lastPass << ", память " << s
+                << (slot.lazy ? " (lazily allocated)" : "") << ", " << resource.requirements.size / 1024 << " КБ" << std::endl;
+        }
+    }
+    if(!_slots.empty())
+        out << "  память временных ресурсов: " << aliased / 1024 << " КБ (без совмещения " << separate / 1024 << " КБ)" << std::endl;
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+#include <ostream>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+#include "memoryAllocator.h"
+
+//ресурс графа кадра: индекс в RenderGraph
+struct RenderResource {
+    static constexpr uint32_t invalid = UINT32_MAX;
+    uint32_t index = invalid;
+
+    bool isValid() const { return index != invalid; }
+};
+
+//состояние ресурса на границе графа: кто и как последним его трогал
+struct ResourceState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags stages = 0; //0 - синхронизирован вне графа (забор слота, ожидание устройства)
+    VkAccessFlags access = 0;
+};
+
+//временное изображение: создаётся и уничтожается графом, память делится с другими временными ресурсами
+struct TransientImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent {};
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+//граф кадра: проходы объявляют ресурсы, которые читают и пишут, а compile по этим объявлениям
+//отбрасывает проходы, чей результат никто не использует, расставляет минимальные барьеры и переходы layout,
+//совмещает память временных изображений с непересекающимся временем жизни и создаёт проходы рендеринга.
+//Порядок выполнения - порядок объявления проходов
+class RenderGraph
+{
+public:
+    //для проходов с вложениями: проход рендеринга и фреймбуфер готовы, начинает проход сам обработчик,
+    //т.к. от него зависит VK_SUBPASS_CONTENTS и зоны профилировщика вокруг прохода
+    struct PassContext {
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        VkExtent2D extent {};
+        VkRenderPassBeginInfo beginInfo {};
+    };
+    using ExecuteFunction = std::function<void(VkCommandBuffer, const PassContext&)>;
+
+    class PassBuilder
+    {
+    public:
+        void writeColor(RenderResource resource, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                        VkClearColorValue clear = {{0.0f, 0.0f, 0.0f, 1.0f}});
+        void writeDepth(RenderResource resource, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, float clearDepth = 1.0f);
+        void readDepth(RenderResource resource); //тест глубины без записи
+        void sampleImage(RenderResource resource, VkPipelineStageFlags stages);
+        //хранилища (VK_IMAGE_LAYOUT_GENERAL) и копирования (TRANSFER_SRC / TRANSFER_DST)
+        void readImage(RenderResource resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout);
+        void writeImage(RenderResource resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout);
+        void readBuffer(RenderResource resource, VkPipelineStageFlags stages, VkAccessFlags access);
+        void writeBuffer(RenderResource resource, VkPipelineStageFlags stages, VkAccessFlags access);
+        void sideEffects(); //проход не отбрасывается, даже если его результат никто не читает
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, uint32_t pass) : _graph(graph), _pass(pass) {}
+
+        RenderGraph& _graph;
+        uint32_t _pass;
+    };
+
+    RenderGraph(VkDevice device, DeviceAllocator& allocator);
+    ~RenderGraph();
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    //изображение снаружи графа (swapchain): задаётся каждый кадр через setImportedImage.
+    //final - состояние, в котором граф оставляет изображение; такие изображения считаются результатом кадра
+    RenderResource importImage(const std::string& name, VkFormat format, VkExtent2D extent,
+                               const ResourceState& initial, const ResourceState& final);
+    //барьеры для буферов глобальные, поэтому дескриптор буфера графу не нужен
+    RenderResource importBuffer(const std::string& name, const ResourceState& initial = {});
+    RenderResource createImage(const std::string& name, const TransientImageDesc& desc);
+
+    void addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, ExecuteFunction execute);
+    void markOutput(RenderResource resource); //результат кадра, который читают вне графа
+
+    void compile();
+
+    void setImportedImage(RenderResource resource, VkImage image, VkImageView view);
+    void execute(VkCommandBuffer commandBuffer);
+
+    VkImage getImage(RenderResource resource) const { return _resources[resource.index].image; }
+    VkImageView getImageView(RenderResource resource) const { return _resources[resource.index].view; }
+    void printDebug(std::ostream& out) const;
+
+private:
+    enum class AttachmentKind : uint8_t { None, Color, Depth };
+
+    struct Access {
+        uint32_t resource;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageLayout layout; //UNDEFINED для буферов
+        bool write;
+        AttachmentKind attachment = AttachmentKind::None;
+        VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE; //вычисляется в compile
+        VkClearValue clear {};
+    };
+
+    struct ImageBarrier {
+        uint32_t resource;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+    };
+
+    //все барьеры перед проходом - одним vkCmdPipelineBarrier
+    struct BarrierBatch {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkAccessFlags memorySrcAccess = 0; //глобальный барьер памяти для буферов
+        VkAccessFlags memoryDstAccess = 0;
+        bool memoryBarrier = false;
+        std::vector<ImageBarrier> images;
+
+        bool empty() const { return srcStages == 0; }
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<Access> accesses;
+        ExecuteFunction execute;
+        bool sideEffects = false;
+
+        //результат compile
+        bool culled = false;
+        BarrierBatch barriers;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        std::vector<uint32_t> attachments; //ресурсы вложений по порядку описаний прохода рендеринга
+        std::vector<VkClearValue> clearValues;
+        VkExtent2D extent {};
+    };
+
+    struct Resource {
+        std::string name;
+        bool isImage = true;
+        bool imported = false;
+        bool output = false;
+        TransientImageDesc desc;
+        ResourceState initial;
+        ResourceState final;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkImageUsageFlags usage = 0;
+
+        //результат compile, только для временных изображений
+        uint32_t firstPass = UINT32_MAX; //индексы в _order
+        uint32_t lastPass = 0;
+        bool lazy = false;
+        uint32_t slot = UINT32_MAX;
+        VkMemoryRequirements requirements {};
+    };
+
+    //общая память временных изображений с непересекающимся временем жизни
+    struct MemorySlot {
+        Allocation allocation;
+        VkMemoryRequirements requirements {};
+        std::vector<uint32_t> resources; //по возрастанию первого прохода
+        uint32_t lastPass = 0;
+        bool lazy = false;
+    };
+
+    //состояние ресурса при обходе проходов в compile
+    struct Tracked {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;   //чтения после последней записи: следующая запись ждёт их
+        VkPipelineStageFlags visibleStages = 0; //стадии, которым последняя запись уже видна
+        VkAccessFlags visibleAccess = 0;
+    };
+
+    void addAccess(uint32_t pass, const Access& access);
+    void cullPasses();
+    void computeLifetimes();
+    void createTransients();
+    void computeBarriers();
+    void createRenderPasses();
+    void transition(Tracked& tracked, const Access& access, BarrierBatch& batch) const;
+    void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+    VkFramebuffer getFramebuffer(const Pass& pass);
+    VkImageAspectFlags aspectMask(uint32_t resource) const;
+    void destroy();
+
+    VkDevice _device;
+    DeviceAllocator& _allocator;
+
+    std::vector<Resource> _resources;
+    std::vector<Pass> _passes;
+    std::vector<uint32_t> _order; //живые проходы в порядке выполнения
+    std::vector<MemorySlot> _slots;
+    BarrierBatch _finalBarriers;  //импортированные изображения в final
+    bool _compiled = false;
+
+    //фреймбуферы проходов с импортированными вложениями зависят от изображения кадра
+    using FramebufferKey = std::pair<VkRenderPass, std::vector<VkImageView>>;
+    std::map<FramebufferKey, VkFramebuffer> _framebuffers;
+    FramebufferKey _framebufferKey; //переиспользуются между кадрами: без выделений памяти при записи
+    std::vector<VkImageMemoryBarrier> _imageBarriers;
+};
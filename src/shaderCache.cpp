@@ -0,0 +1,116 @@
+#include "shaderCache.h"
+#include "loadBinFile.h"
+
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+    const uint32_t spirvMagic = 0x07230203;
+    const size_t spirvHeaderWords = 5; //magic, version, generator, bound, schema
+
+    uint64_t hashCode(const uint32_t* code, size_t size) {
+        uint64_t hash = 0xcbf29ce484222325ull ^ size;
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(code);
+        for(size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+}
+
+SpirvCode utils::validateSpirv(const uint8_t* data, size_t size, const std::string& name) {
+    if(size % 4 != 0 || size < spirvHeaderWords * 4)
+        throw std::runtime_error("Шейдер " + name + ": размер не кратен 4 байтам или меньше заголовка SPIR-V");
+
+    if(reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) != 0)
+        throw std::runtime_error("Шейдер " + name + ": данные не выровнены по 4 байта");
+
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(data);
+    if(words[0] != spirvMagic) {
+        if(words[0] == __builtin_bswap32(spirvMagic))
+            throw std::runtime_error("Шейдер " + name + ": SPIR-V с другим порядком байт");
+        throw std::runtime_error("Шейдер " + name + ": не SPIR-V (возможно, передан исходник GLSL)");
+    }
+
+    //версия: 0 | major | minor | 0
+    uint32_t major = (words[1] >> 16) & 0xFF;
+    uint32_t minor = (words[1] >> 8) & 0xFF;
+    if(major != 1 || minor > 6)
+        throw std::runtime_error("Шейдер " + name + ": неподдерживаемая версия SPIR-V " +
+                                 std::to_string(major) + "." + std::to_string(minor));
+
+    return { words, size };
+}
+
+void ShaderModuleCache::init(VkDevice device) {
+    _device = device;
+}
+
+void ShaderModuleCache::destroy() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(auto& entry : _modules)
+        vkDestroyShaderModule(_device, entry.second.module, nullptr);
+    _modules.clear();
+}
+
+VkShaderModule ShaderModuleCache::load(const std::string& path) {
+    utils::MappedFile file(path);
+    return get(utils::validateSpirv(file.data(), file.size(), path)); //модуль создан, отображение больше не нужно
+}
+
+VkShaderModule ShaderModuleCache::get(const SpirvCode& spirv) {
+    uint64_t key = hashCode(spirv.code, spirv.size);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto range = _modules.equal_range(key);
+    for(auto it = range.first; it != range.second; ++it) {
+        Module& cached = it->second;
+        if(cached.code.size() * sizeof(uint32_t) == spirv.size && std::memcmp(cached.code.data(), spirv.code, spirv.size) == 0) {
+            _hits++;
+            cached.references++;
+            return cached.module;
+        }
+    }
+
+    VkShaderModuleCreateInfo createInfo {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = spirv.size;
+    createInfo.pCode = spirv.code;
+
+    VkShaderModule shaderModule;
+    if(vkCreateShaderModule(_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать шейдерный модуль!");
+
+    Module created;
+    created.code.assign(spirv.code, spirv.code + spirv.size / sizeof(uint32_t));
+    created.module = shaderModule;
+    created.references = 1;
+    _modules.emplace(key, std::move(created));
+    return shaderModule;
+}
+
+void ShaderModuleCache::release(VkShaderModule shaderModule) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(auto it = _modules.begin(); it != _modules.end(); ++it) {
+        if(it->second.module != shaderModule)
+            continue;
+        if(--it->second.references == 0) {
+            vkDestroyShaderModule(_device, shaderModule, nullptr);
+            _modules.erase(it);
+        }
+        return;
+    }
+    throw std::runtime_error("Шейдерный модуль не принадлежит кэшу");
+}
+
+size_t ShaderModuleCache::moduleCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _modules.size();
+}
+
+size_t ShaderModuleCache::hitCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _hits;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include <vulkan/vulkan.h>
+
+//SPIR-V, проверенный validateSpirv: code выровнен по 4 байта, size кратен 4
+struct SpirvCode {
+    const uint32_t* code = nullptr;
+    size_t size = 0; //в байтах, как ожидает VkShaderModuleCreateInfo::codeSize
+};
+
+namespace utils {
+    //проверяет размер, магическое число и версию SPIR-V; name используется только в сообщении об ошибке
+    SpirvCode validateSpirv(const uint8_t* data, size_t size, const std::string& name);
+}
+
+//VkShaderModule по содержимому: один и тот же SPIR-V (даже из разных файлов) создаётся один раз,
+//сколько бы конвейеров его ни использовало. Хэш только выбирает кандидатов, код сравнивается целиком.
+//Каждый get - ссылка на модуль; модули, которые не отпускают через release, живут до destroy. Потокобезопасен
+class ShaderModuleCache
+{
+public:
+    void init(VkDevice device);
+    void destroy();
+
+    VkShaderModule load(const std::string& path); //файл отображается в память, без промежуточной копии
+    VkShaderModule get(const SpirvCode& spirv);
+    //модуль уничтожается с последней ссылкой; конвейеры, уже созданные из него, остаются рабочими
+    void release(VkShaderModule shaderModule);
+
+    size_t moduleCount() const;
+    size_t hitCount() const;
+
+private:
+    struct Module {
+        std::vector<uint32_t> code;
+        VkShaderModule module = VK_NULL_HANDLE;
+        uint32_t references = 0;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    mutable std::mutex _mutex; //модули добавляет и поток горячей перезагрузки
+    std::unordered_multimap<uint64_t, Module> _modules; //ключ - хэш содержимого с учётом размера
+    size_t _hits = 0;
+};
@@ -0,0 +1,80 @@
+#include "shaderCompiler.h"
+#include "loadBinFile.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef VULKANPROJECT_WITH_SHADERC
+#include <shaderc/shaderc.h>
+
+namespace {
+    shaderc_shader_kind shaderKind(const std::string& name) {
+        auto endsWith = [&name](const std::string &suffix) {
+            return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+
+        if(endsWith(".vert"))
+            return shaderc_vertex_shader;
+        if(endsWith(".frag"))
+            return shaderc_fragment_shader;
+        if(endsWith(".comp"))
+            return shaderc_compute_shader;
+        throw std::runtime_error("Шейдер " + name + ": неизвестная стадия (ожидается .vert, .frag или .comp)");
+    }
+}
+
+ShaderCompiler::ShaderCompiler() {
+    _compiler = shaderc_compiler_initialize();
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+    shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+    shaderc_compile_options_set_optimization_level(options, shaderc_optimization_level_performance);
+    _options = options;
+}
+
+ShaderCompiler::~ShaderCompiler() {
+    shaderc_compile_options_release(static_cast<shaderc_compile_options_t>(_options));
+    shaderc_compiler_release(static_cast<shaderc_compiler_t>(_compiler));
+}
+
+bool ShaderCompiler::isAvailable() {
+    return true;
+}
+
+std::vector<uint32_t> ShaderCompiler::compile(const std::string& source, const std::string& name) {
+    //shaderc_compiler_t потокобезопасен, поэтому один компилятор обслуживает и поток перезагрузки
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(
+            static_cast<shaderc_compiler_t>(_compiler), source.data(), source.size(),
+            shaderKind(name), name.c_str(), "main", static_cast<shaderc_compile_options_t>(_options));
+
+    if(shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success) {
+        std::string message = shaderc_result_get_error_message(result);
+        shaderc_result_release(result);
+        throw std::runtime_error("Ошибка компиляции " + name + ":\n" + message);
+    }
+
+    size_t length = shaderc_result_get_length(result);
+    std::vector<uint32_t> spirv(length / sizeof(uint32_t));
+    const char* bytes = shaderc_result_get_bytes(result);
+    std::copy(bytes, bytes + length, reinterpret_cast<char*>(spirv.data()));
+
+    shaderc_result_release(result);
+    return spirv;
+}
+#else
+ShaderCompiler::ShaderCompiler() = default;
+ShaderCompiler::~ShaderCompiler() = default;
+
+bool ShaderCompiler::isAvailable() {
+    return false;
+}
+
+std::vector<uint32_t> ShaderCompiler::compile(const std::string&, const std::string& name) {
+    throw std::runtime_error("Не удалось скомпилировать " + name + ": сборка без shaderc (VULKANPROJECT_WITH_SHADERC)");
+}
+#endif
+
+std::vector<uint32_t> ShaderCompiler::compileFile(const std::string& path) {
+    utils::MappedFile file(path);
+    std::string source(reinterpret_cast<const char*>(file.data()), file.size());
+    return compile(source, path);
+}
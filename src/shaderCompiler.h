@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//компиляция GLSL в SPIR-V внутри процесса через shaderc (сборка с VULKANPROJECT_WITH_SHADERC).
+//Стадия определяется по расширению файла: .vert, .frag, .comp
+class ShaderCompiler
+{
+public:
+    ShaderCompiler();
+    ~ShaderCompiler();
+
+    ShaderCompiler(const ShaderCompiler&) = delete;
+    ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+    static bool isAvailable();
+
+    //бросает std::runtime_error с текстом ошибки компилятора
+    std::vector<uint32_t> compileFile(const std::string& path);
+    std::vector<uint32_t> compile(const std::string& source, const std::string& name);
+
+private:
+    void* _compiler = nullptr; //shaderc_compiler_t, не тянем заголовок shaderc в остальной код
+    void* _options = nullptr;  //shaderc_compile_options_t
+};
@@ -0,0 +1,152 @@
+#include "shaderHotReload.h"
+#include "log.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <set>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+namespace {
+    const int debounceMs = 50; //редакторы сохраняют файл несколькими записями подряд
+}
+
+ShaderHotReload::~ShaderHotReload() {
+    stop();
+}
+
+uint32_t ShaderHotReload::track(const std::string& vertexSource, const std::string& fragmentSource) {
+    if(_thread.joinable())
+        throw std::runtime_error("Конвейеры для горячей перезагрузки регистрируются до start");
+
+    _tracked.push_back({ vertexSource, fragmentSource, {} });
+    return static_cast<uint32_t>(_tracked.size() - 1);
+}
+
+void ShaderHotReload::setTargets(uint32_t id, std::vector<Target> targets) {
+    std::lock_guard<std::mutex> lock(_targetsMutex);
+    _tracked.at(id).targets = std::move(targets);
+}
+
+void ShaderHotReload::start(const std::string& directory) {
+    _directory = directory;
+
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(_inotifyFd < 0)
+        throw std::runtime_error("Не удалось инициализировать inotify");
+
+    //IN_MOVED_TO: многие редакторы пишут во временный файл и переименовывают его
+    if(inotify_add_watch(_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        throw std::runtime_error("Не удалось следить за директорией шейдеров: " + directory);
+
+    if(pipe(_stopPipe) != 0)
+        throw std::runtime_error("Не удалось создать канал остановки потока перезагрузки");
+
+    _thread = std::thread(&ShaderHotReload::run, this);
+    utils::log() << "Горячая перезагрузка шейдеров: слежение за " << directory << std::endl;
+}
+
+void ShaderHotReload::stop() {
+    if(_thread.joinable()) {
+        char byte = 0;
+        if(write(_stopPipe[1], &byte, 1) != 1)
+            std::cerr << "Не удалось разбудить поток перезагрузки шейдеров" << std::endl;
+        _thread.join();
+    }
+
+    auto closeFd = [](int& fd) {
+        if(fd >= 0)
+            close(fd);
+        fd = -1;
+    };
+    closeFd(_inotifyFd);
+    closeFd(_stopPipe[0]);
+    closeFd(_stopPipe[1]);
+}
+
+std::vector<ShaderHotReload::Reloaded> ShaderHotReload::takeReady() {
+    std::lock_guard<std::mutex> lock(_readyMutex);
+    std::vector<Reloaded> ready;
+    ready.swap(_ready);
+    return ready;
+}
+
+void ShaderHotReload::run() {
+    alignas(inotify_event) char buffer[4096];
+    std::set<std::string> changed;
+
+    while(true) {
+        pollfd fds[2] = { { _inotifyFd, POLLIN, 0 }, { _stopPipe[0], POLLIN, 0 } };
+        //пока есть несобранные изменения, ждём недолго: пачка событий собирается в одну пересборку
+        int timeout = changed.empty() ? -1 : debounceMs;
+        int count = poll(fds, 2, timeout);
+
+        if(fds[1].revents & POLLIN)
+            return;
+
+        if(count == 0) { //тишина после серии событий
+            rebuild({ changed.begin(), changed.end() });
+            changed.clear();
+            continue;
+        }
+
+        if(!(fds[0].revents & POLLIN))
+            continue;
+
+        ssize_t length;
+        while((length = read(_inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for(char* ptr = buffer; ptr < buffer + length; ) {
+                auto* event = reinterpret_cast<inotify_event*>(ptr);
+                if(event->len > 0)
+                    changed.insert(event->name);
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+void ShaderHotReload::rebuild(const std::vector<std::string>& changed) {
+    //ключи с проходами рендера не меняются и не уничтожаются, пока идёт сборка
+    std::lock_guard<std::mutex> targetsLock(_targetsMutex);
+    for(uint32_t id = 0; id < _tracked.size(); id++) {
+        const Tracked& tracked = _tracked[id];
+
+        bool affected = std::find(changed.begin(), changed.end(), tracked.vertexSource) != changed.end()
+                     || std::find(changed.begin(), changed.end(), tracked.fragmentSource) != changed.end();
+        if(!affected || tracked.targets.empty())
+            continue;
+
+        VkShaderModule vertexShader = VK_NULL_HANDLE;
+        VkShaderModule fragmentShader = VK_NULL_HANDLE;
+        try {
+            std::vector<uint32_t> vertexSpirv = _compiler.compileFile(_directory + "/" + tracked.vertexSource);
+            std::vector<uint32_t> fragmentSpirv = _compiler.compileFile(_directory + "/" + tracked.fragmentSource);
+            vertexShader = _modules.get({ vertexSpirv.data(), vertexSpirv.size() * sizeof(uint32_t) });
+            fragmentShader = _modules.get({ fragmentSpirv.data(), fragmentSpirv.size() * sizeof(uint32_t) });
+
+            for(const Target& target : tracked.targets) {
+                PipelineKey key = target.key;
+                key.vertexShader = vertexShader;
+                key.fragmentShader = fragmentShader;
+                VkPipeline pipeline = _pipelines.build(key);
+
+                std::lock_guard<std::mutex> lock(_readyMutex);
+                _ready.push_back({ target.id, target.key, pipeline });
+            }
+            utils::log() << "Горячая перезагрузка: " << tracked.vertexSource << " + " << tracked.fragmentSource
+                         << ", пересобрано вариантов: " << tracked.targets.size() << std::endl;
+        } catch(const std::exception& e) {
+            //ошибка в шейдере не должна ронять приложение: продолжаем рисовать старыми конвейерами
+            std::cerr << e.what() << std::endl;
+        }
+
+        //конвейерам модули после создания не нужны: промежуточные версии шейдеров не копятся в кэше,
+        //а модули из ключей библиотеки держат свои ссылки
+        if(vertexShader != VK_NULL_HANDLE)
+            _modules.release(vertexShader);
+        if(fragmentShader != VK_NULL_HANDLE)
+            _modules.release(fragmentShader);
+    }
+}
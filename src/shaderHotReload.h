@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "shaderCompiler.h"
+#include "shaderCache.h"
+#include "pipelineLibrary.h"
+
+//следит за директорией шейдеров через inotify и в фоновом потоке пересобирает
+//только варианты конвейеров, которые используют изменённый файл. Готовые конвейеры забираются
+//takeReady() на границе кадра, старые удаляет вызывающая сторона, когда GPU их отпустит
+class ShaderHotReload
+{
+public:
+    //вариант библиотеки и снимок его ключа из главного потока; шейдеры в ключе заменяются пересобранными
+    struct Target {
+        PipelineId id;
+        PipelineKey key;
+    };
+
+    struct Reloaded {
+        PipelineId target;
+        PipelineKey key; //снимок, по которому собран конвейер: сравнивается с текущим ключом варианта
+        VkPipeline pipeline;
+    };
+
+    ShaderHotReload(ShaderCompiler& compiler, ShaderModuleCache& modules, const PipelineLibrary& pipelines)
+        : _compiler(compiler), _modules(modules), _pipelines(pipelines) {}
+    ~ShaderHotReload();
+
+    //имена файлов относительно директории шейдеров; вызывать до start
+    uint32_t track(const std::string& vertexSource, const std::string& fragmentSource);
+    //только главный поток, после каждой регистрации вариантов в библиотеке. Дожидается идущей пересборки:
+    //после возврата поток не собирает конвейеры по прежним ключам и прежние проходы рендера можно уничтожать
+    void setTargets(uint32_t id, std::vector<Target> targets);
+
+    void start(const std::string& directory);
+    void stop();
+
+    std::vector<Reloaded> takeReady(); //не блокирует
+
+private:
+    struct Tracked {
+        std::string vertexSource;
+        std::string fragmentSource;
+        std::vector<Target> targets; //под _targetsMutex
+    };
+
+    void run();
+    void rebuild(const std::vector<std::string>& changed);
+
+    ShaderCompiler& _compiler;
+    ShaderModuleCache& _modules;
+    const PipelineLibrary& _pipelines;
+    std::string _directory;
+    std::vector<Tracked> _tracked;
+    std::mutex _targetsMutex; //удерживается всю пересборку
+
+    int _inotifyFd = -1;
+    int _stopPipe[2] = { -1, -1 }; //будит поток при остановке
+    std::thread _thread;
+
+    std::mutex _readyMutex;
+    std::vector<Reloaded> _ready;
+};
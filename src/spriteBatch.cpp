@@ -0,0 +1,204 @@
+#include "spriteBatch.h"
+
+#include <chrono>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    const uint32_t verticesPerSprite = 4;
+    const uint32_t indicesPerSprite = 6;
+}
+
+void SpriteBatch::init(const Config& config, DeviceAllocator& allocator) {
+    _config = config;
+    _device = config.device;
+    _allocator = &allocator;
+    if(_config.frameSlots == 0 || _config.capacity == 0)
+        throw std::runtime_error("Пакет спрайтов без слотов кадров или без места под спрайты");
+
+    auto createBuffer = [this](VkDeviceSize size, VkBufferUsageFlags usage) {
+        VkBufferCreateInfo bufferCreateInfo {};
+        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferCreateInfo.size = size;
+        bufferCreateInfo.usage = usage;
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer;
+        if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать буфер спрайтов!");
+        AllocatedBuffer allocated;
+        allocated.buffer = UniqueBuffer(_device, buffer);
+        //буферы читаются GPU прямо из памяти хоста: вершины пишутся каждый кадр и читаются один раз
+        allocated.allocation = UniqueAllocation(_allocator, _allocator->allocateForBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT));
+        return allocated;
+    };
+
+    const VkDeviceSize regionSize = sizeof(SpriteVertex) * verticesPerSprite * _config.capacity;
+    _vertexBuffer = createBuffer(regionSize * _config.frameSlots, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    _indexBuffer = createBuffer(sizeof(uint32_t) * indicesPerSprite * _config.capacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    _vertices = static_cast<SpriteVertex*>(_vertexBuffer.allocation.get().mapped);
+
+    //квад i - вершины 4i..4i+3 участка слота
+    uint32_t* indices = static_cast<uint32_t*>(_indexBuffer.allocation.get().mapped);
+    for(uint32_t sprite = 0; sprite < _config.capacity; sprite++) {
+        const uint32_t base = sprite * verticesPerSprite;
+        const uint32_t quad[indicesPerSprite] = { base, base + 1, base + 2, base + 2, base + 3, base };
+        for(uint32_t i = 0; i < indicesPerSprite; i++)
+            indices[sprite * indicesPerSprite + i] = quad[i];
+    }
+    _allocator->flush(_indexBuffer.allocation);
+
+    _sprites.reserve(_config.capacity);
+    _keys.reserve(_config.capacity);
+    _scratch.reserve(_config.capacity);
+}
+
+void SpriteBatch::destroy() {
+    _vertices = nullptr;
+    _vertexBuffer = {};
+    _indexBuffer = {};
+    _sprites.clear();
+    _batches.clear();
+}
+
+VertexInputDescription SpriteBatch::inputDescription() {
+    VertexInputDescription description;
+
+    VkVertexInputBindingDescription binding {};
+    binding.binding = 0;
+    binding.stride = sizeof(SpriteVertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    description.bindings.push_back(binding);
+
+    VkVertexInputAttributeDescription attribute {};
+    attribute.binding = 0;
+    attribute.location = 0;
+    attribute.format = VK_FORMAT_R32G32_SFLOAT;
+    attribute.offset = offsetof(SpriteVertex, position);
+    description.attributes.push_back(attribute);
+
+    attribute.location = 1;
+    attribute.format = VK_FORMAT_R32G32_SFLOAT;
+    attribute.offset = offsetof(SpriteVertex, uv);
+    description.attributes.push_back(attribute);
+
+    attribute.location = 2;
+    attribute.format = VK_FORMAT_R8G8B8A8_UNORM;
+    attribute.offset = offsetof(SpriteVertex, color);
+    description.attributes.push_back(attribute);
+
+    return description;
+}
+
+uint64_t SpriteBatch::makeKey(const Sprite& sprite, uint32_t texture) {
+    return static_cast<uint64_t>(sprite.layer) << 56
+         | static_cast<uint64_t>(sprite.blend) << 48
+         | static_cast<uint64_t>(texture & 0xFFFF) << 32
+         | static_cast<uint64_t>(~utils::orderedFloatBits(sprite.depth));
+}
+
+void SpriteBatch::prepare(uint32_t frameSlot, VkExtent2D extent) {
+    auto start = std::chrono::steady_clock::now();
+
+    _currentSlot = frameSlot % _config.frameSlots;
+    _batches.clear();
+    _stats = {};
+
+    const uint32_t count = static_cast<uint32_t>(std::min<size_t>(_sprites.size(), _config.capacity));
+    _stats.dropped = static_cast<uint32_t>(_sprites.size() - count);
+
+    auto textureOf = [this](const Sprite& sprite) {
+        return sprite.texture == Sprite::defaultTexture ? _config.fallbackTexture : sprite.texture;
+    };
+
+    _keys.resize(count);
+    for(uint32_t i = 0; i < count; i++)
+        _keys[i] = { makeKey(_sprites[i], textureOf(_sprites[i])), i };
+    utils::radixSort(_keys, _scratch);
+
+    //пиксели в клип-пространство Vulkan: y вниз, как у окна
+    const glm::vec2 scale(2.0f / std::max(extent.width, 1u), 2.0f / std::max(extent.height, 1u));
+    SpriteVertex* out = _vertices + static_cast<size_t>(_currentSlot) * _config.capacity * verticesPerSprite;
+
+    for(uint32_t i = 0; i < count; i++) {
+        const Sprite& sprite = _sprites[_keys[i].index];
+        const uint32_t texture = textureOf(sprite);
+
+        const glm::vec2 min = sprite.position * scale - glm::vec2(1.0f);
+        const glm::vec2 max = (sprite.position + sprite.size) * scale - glm::vec2(1.0f);
+        SpriteVertex* quad = out + static_cast<size_t>(i) * verticesPerSprite;
+        quad[0] = { { min.x, min.y }, { sprite.uvMin.x, sprite.uvMin.y }, sprite.color };
+        quad[1] = { { max.x, min.y }, { sprite.uvMax.x, sprite.uvMin.y }, sprite.color };
+        quad[2] = { { max.x, max.y }, { sprite.uvMax.x, sprite.uvMax.y }, sprite.color };
+        quad[3] = { { min.x, max.y }, { sprite.uvMin.x, sprite.uvMax.y }, sprite.color };
+
+        //полный индекс текстуры сравнивается отдельно: ключ хранит только младшие биты
+        if(!_batches.empty() && _batches.back().blend == sprite.blend && _batches.back().texture == texture)
+            _batches.back().indexCount += indicesPerSprite;
+        else
+            _batches.push_back({ sprite.blend, texture, i * indicesPerSprite, indicesPerSprite });
+    }
+
+    const VkDeviceSize regionSize = sizeof(SpriteVertex) * verticesPerSprite * _config.capacity;
+    const VkDeviceSize written = sizeof(SpriteVertex) * verticesPerSprite * count;
+    if(written > 0)
+        _allocator->flush(_vertexBuffer.allocation, regionSize * _currentSlot, written);
+    _sprites.clear();
+
+    for(size_t i = 0; i < _batches.size(); i++)
+        if(i == 0 || _batches[i].blend != _batches[i - 1].blend)
+            _stats.pipelineBinds++;
+    _stats.sprites = count;
+    _stats.batches = static_cast<uint32_t>(_batches.size());
+    _stats.uploadedBytes = written;
+    _stats.prepareMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    _frames++;
+    _totalSprites += _stats.sprites;
+    _totalBatches += _stats.batches;
+    _totalBytes += _stats.uploadedBytes;
+    _totalMilliseconds += _stats.prepareMilliseconds;
+}
+
+void SpriteBatch::record(VkCommandBuffer commandBuffer, VkPipelineLayout layout) const {
+    if(_batches.empty())
+        return;
+
+    const VkDeviceSize regionOffset = sizeof(SpriteVertex) * verticesPerSprite * _config.capacity * _currentSlot;
+    VkBuffer vertexBuffer = _vertexBuffer;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &regionOffset);
+    vkCmdBindIndexBuffer(commandBuffer, _indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    const Batch* previous = nullptr;
+    for(const Batch& batch : _batches) {
+        if(previous == nullptr || previous->blend != batch.blend) {
+            VkPipeline pipeline = _pipelines[static_cast<uint32_t>(batch.blend)];
+            if(pipeline == VK_NULL_HANDLE)
+                throw std::runtime_error("Не задан конвейер для режима смешивания спрайтов");
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        }
+        if(previous == nullptr || previous->texture != batch.texture)
+            vkCmdPushConstants(commandBuffer, layout, _config.constantStages, _config.textureConstantOffset,
+                               sizeof(uint32_t), &batch.texture);
+
+        vkCmdDrawIndexed(commandBuffer, batch.indexCount, 1, batch.firstIndex, 0, 0);
+        previous = &batch;
+    }
+}
+
+void SpriteBatch::printReport(std::ostream& out) const {
+    out << "Спрайты: кадров " << _frames;
+    if(_frames == 0) {
+        out << std::endl;
+        return;
+    }
+    const double frames = static_cast<double>(_frames);
+    out << ", в среднем за кадр " << _totalSprites / frames << " спрайтов, " << _totalBatches / frames << " пакетов, "
+        << (_totalBytes / frames) / 1024.0 << " КБ вершин, подготовка " << _totalMilliseconds / frames << " мс" << std::endl;
+    out << "  последний кадр: " << _stats.sprites << " спрайтов, " << _stats.batches << " пакетов, "
+        << _stats.pipelineBinds << " смен конвейера, " << (_stats.uploadedBytes >> 10) << " КБ";
+    if(_stats.dropped > 0)
+        out << ", отброшено " << _stats.dropped;
+    out << std::endl;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include "radixSort.h"
+#include "vertexLayout.h"
+#include "memoryAllocator.h"
+#include "vulkanHandle.h"
+
+//режим смешивания; у каждого свой конвейер. Порядок значений - порядок отрисовки внутри слоя
+enum class SpriteBlend : uint8_t {
+    Alpha,
+    Additive,
+    Count,
+};
+
+//вершина квада, атрибуты sprite.vert
+struct SpriteVertex {
+    glm::vec2 position; //клип-пространство
+    glm::vec2 uv;
+    uint32_t color;     //RGBA8, R в младшем байте
+};
+
+struct Sprite {
+    static constexpr uint32_t defaultTexture = UINT32_MAX;
+
+    glm::vec2 position { 0.0f };       //пиксели, (0, 0) - левый верхний угол
+    glm::vec2 size { 1.0f };
+    glm::vec2 uvMin { 0.0f };
+    glm::vec2 uvMax { 1.0f };
+    uint32_t color = 0xFFFFFFFF;
+    uint32_t texture = defaultTexture; //индекс в массиве текстур BindlessDescriptors; по умолчанию белая заглушка
+    float depth = 0.0f;                //внутри слоя, режима и текстуры дальние (большие) рисуются раньше
+    uint8_t layer = 0;                 //слои рисуются по возрастанию
+    SpriteBlend blend = SpriteBlend::Alpha;
+};
+
+//один подготовленный кадр
+struct SpriteStats {
+    uint32_t sprites = 0;
+    uint32_t batches = 0;       //vkCmdDrawIndexed
+    uint32_t pipelineBinds = 0;
+    uint32_t dropped = 0;       //не поместились в участок слота
+    VkDeviceSize uploadedBytes = 0;
+    double prepareMilliseconds = 0.0; //сортировка и запись вершин
+};
+
+//пакетная отрисовка квадов (HUD, оверлеи). Спрайты кадра сортируются по 64-битному ключу
+//(слой, режим смешивания, текстура, глубина) поразрядной сортировкой, вершины пишутся по порядку ключей
+//в постоянно отображённый участок слота кадра, и подряд идущие спрайты с одним конвейером и текстурой
+//становятся одним vkCmdDrawIndexed. Спрайты добавляются только из потока кадра
+class SpriteBatch
+{
+public:
+    struct Config {
+        VkDevice device = VK_NULL_HANDLE;
+        uint32_t frameSlots = 2;
+        uint32_t capacity = 65536;          //спрайтов за кадр, остальные отбрасываются
+        uint32_t fallbackTexture = 0;       //для Sprite::defaultTexture
+        //куда record кладёт индекс текстуры пакета: push constants раскладки, с которой записывается проход
+        uint32_t textureConstantOffset = 0;
+        VkShaderStageFlags constantStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; //все стадии диапазона раскладки
+    };
+
+    void init(const Config& config, DeviceAllocator& allocator);
+    void destroy();
+    //конвейеры создаёт владелец прохода рендеринга; вход вершин - inputDescription
+    void setPipeline(SpriteBlend blend, VkPipeline pipeline) { _pipelines[static_cast<uint32_t>(blend)] = pipeline; }
+    static VertexInputDescription inputDescription();
+
+    void draw(const Sprite& sprite) { _sprites.push_back(sprite); }
+    size_t getPendingCount() const { return _sprites.size(); }
+    const std::vector<Sprite>& getPending() const { return _sprites; }
+
+    //после ожидания забора слота: сортирует добавленные спрайты, пишет вершины и пакеты; список спрайтов очищается
+    void prepare(uint32_t frameSlot, VkExtent2D extent);
+    //внутри прохода рендеринга, наборы дескрипторов уже привязаны
+    void record(VkCommandBuffer commandBuffer, VkPipelineLayout layout) const;
+
+    const SpriteStats& getStats() const { return _stats; }
+    void printReport(std::ostream& out) const;
+
+    //слой | режим | младшие 16 бит текстуры | глубина от дальних к ближним.
+    //Совпадение младших бит разных текстур не нарушает порядок слоёв, а только дробит пакеты
+    static uint64_t makeKey(const Sprite& sprite, uint32_t texture);
+
+private:
+    struct Batch {
+        SpriteBlend blend;
+        uint32_t texture;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    DeviceAllocator* _allocator = nullptr;
+    Config _config;
+    VkPipeline _pipelines[static_cast<uint32_t>(SpriteBlend::Count)] {};
+
+    //вершины: участок на слот кадра; индексы одни на все участки, квады в них не меняются
+    AllocatedBuffer _vertexBuffer;
+    AllocatedBuffer _indexBuffer;
+    SpriteVertex* _vertices = nullptr;
+    uint32_t _currentSlot = 0;
+
+    std::vector<Sprite> _sprites;
+    std::vector<utils::SortItem> _keys;
+    std::vector<utils::SortItem> _scratch;
+    std::vector<Batch> _batches;
+
+    SpriteStats _stats;
+    uint64_t _frames = 0;
+    uint64_t _totalSprites = 0;
+    uint64_t _totalBatches = 0;
+    uint64_t _totalBytes = 0;
+    double _totalMilliseconds = 0.0;
+};
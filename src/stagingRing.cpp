@@ -0,0 +1,75 @@
+#include "stagingRing.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+void StagingRing::init(VkDevice device, DeviceAllocator& allocator, VkDeviceSize size, uint32_t frameSlots) {
+    _device = device;
+    _allocator = &allocator;
+    _size = size;
+    _frameEnd.assign(std::max(frameSlots, 1u), 0);
+
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = size;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &_buffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать staging буфер!");
+
+    _allocation = allocator.allocateForBuffer(_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+}
+
+void StagingRing::destroy() {
+    if(_buffer == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyBuffer(_device, _buffer, nullptr);
+    _allocator->free(_allocation);
+    _buffer = VK_NULL_HANDLE;
+}
+
+StagingRing::Region StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    Region region;
+    if(!tryAllocate(size, alignment, region))
+        throw std::runtime_error("Staging буфер переполнен: загрузки кадров в полёте не помещаются");
+    return region;
+}
+
+bool StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, Region& region) {
+    //некогерентную память сбрасываем атомами, поэтому участки не должны делить атом
+    alignment = std::max(alignment, _allocator->getNonCoherentAtomSize());
+
+    uint64_t position = (_head + alignment - 1) / alignment * alignment;
+    uint64_t offset = position % _size;
+    if(offset + size > _size) { //участок не помещается до конца буфера - начинаем с нуля
+        position += _size - offset;
+        offset = 0;
+    }
+
+    if(size > _size || position + size - _tail > _size)
+        return false;
+
+    _head = position + size;
+    _uploadedBytes += size;
+
+    region.buffer = _buffer;
+    region.offset = offset;
+    region.size = size;
+    region.data = static_cast<char*>(_allocation.mapped) + offset;
+    return true;
+}
+
+void StagingRing::flush(const Region& region) {
+    _allocator->flush(_allocation, region.offset, region.size);
+}
+
+void StagingRing::beginFrame(uint32_t frameSlot) {
+    //кадр слота завершён, значит завершены и все более ранние загрузки
+    _tail = std::max(_tail, _frameEnd[frameSlot % _frameEnd.size()]);
+}
+
+void StagingRing::endFrame(uint32_t frameSlot) {
+    _frameEnd[frameSlot % _frameEnd.size()] = _head;
+}
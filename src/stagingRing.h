@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <vulkan/vulkan.h>
+
+#include "memoryAllocator.h"
+
+//кольцевой буфер для загрузок на GPU: один постоянно отображённый host visible буфер,
+//участки которого переиспользуются, как только кадр, записавший в них, завершился
+class StagingRing
+{
+public:
+    struct Region {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0; //смещение в buffer для vkCmdCopyBuffer / vkCmdCopyBufferToImage
+        VkDeviceSize size = 0;
+        void* data = nullptr;
+    };
+
+    void init(VkDevice device, DeviceAllocator& allocator, VkDeviceSize size, uint32_t frameSlots);
+    void destroy();
+
+    //бросает исключение, если свободного места не хватает до завершения кадров в полёте
+    Region allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+    bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, Region& region);
+    void flush(const Region& region); //для некогерентной памяти, до отправки копирования
+
+    //вызывать после ожидания забора слота: всё, что слот записал в прошлый раз, освобождается
+    void beginFrame(uint32_t frameSlot);
+    //вызывать после отправки кадра: запоминает, докуда кольцо занято этим слотом
+    void endFrame(uint32_t frameSlot);
+    //всё кольцо снова свободно; только когда GPU не читает ни одну выданную область (загрузки при инициализации)
+    void releaseAll() { _tail = _head; }
+
+    //для владельцев, которые отслеживают завершение сами (очередь загрузок): позиция после последней
+    //выданной области и освобождение всего, что было выдано до неё
+    uint64_t getHead() const { return _head; }
+    void releaseUpTo(uint64_t position) { _tail = std::max(_tail, position); }
+    VkDeviceSize getSize() const { return _size; }
+
+    VkDeviceSize getUploadedBytes() const { return _uploadedBytes; }
+
+private:
+    VkDevice _device = VK_NULL_HANDLE;
+    DeviceAllocator* _allocator = nullptr;
+    VkBuffer _buffer = VK_NULL_HANDLE;
+    Allocation _allocation;
+    VkDeviceSize _size = 0;
+
+    //монотонные счётчики байт: позиция в буфере = счётчик % _size
+    uint64_t _head = 0;
+    uint64_t _tail = 0;
+    std::vector<uint64_t> _frameEnd; //значение _head на момент отправки кадра слота
+    VkDeviceSize _uploadedBytes = 0;
+};
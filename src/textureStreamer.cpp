@@ -0,0 +1,532 @@
+#include "textureStreamer.h"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "log.h"
+
+namespace {
+    //уровни не больше этого размера загружаются одним шагом вместе с самым мелким
+    const uint32_t tailSize = 64;
+    //текстура, которую не рисовали столько кадров, не догружается, но и не вытесняется без нехватки памяти
+    const uint64_t hotFrames = 120;
+    //vkGetPhysicalDeviceMemoryProperties2 и статистика аллокатора обходят все блоки - не каждый кадр
+    const uint64_t budgetInterval = 30;
+    //кратно блоку любого поддерживаемого формата и 4 байтам, как требует vkCmdCopyBufferToImage
+    const VkDeviceSize uploadAlignment = 16;
+
+    VkImageMemoryBarrier imageBarrier(VkImage image, uint32_t baseLevel, uint32_t levelCount,
+                                      VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                                      VkImageLayout oldLayout, VkImageLayout newLayout) {
+        VkImageMemoryBarrier barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1 };
+        return barrier;
+    }
+
+    VkOffset3D toOffset(VkExtent3D extent) {
+        return { static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1 };
+    }
+}
+
+void TextureStreamer::init(const Config& config, DeviceAllocator& allocator, BindlessDescriptors& descriptors,
+                           DeletionQueue& deletionQueue) {
+    _config = config;
+    _device = config.device;
+    _allocator = &allocator;
+    _descriptors = &descriptors;
+    _deletionQueue = &deletionQueue;
+    _staging.init(_device, allocator, config.stagingSize, config.frameSlots);
+
+    //текстуры живут в наибольшей device local куче
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(config.physicalDevice, &memoryProperties);
+    bool found = false;
+    for(uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++)
+        if((memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+           && (!found || memoryProperties.memoryHeaps[heap].size > memoryProperties.memoryHeaps[_heapIndex].size)) {
+            _heapIndex = heap;
+            found = true;
+        }
+
+    //изображение содержит только загруженные уровни: уровень 0 вида - наибольший из них
+    VkSamplerCreateInfo samplerInfo {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    VkSampler sampler;
+    if(vkCreateSampler(_device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать сэмплер текстур!");
+    _sampler = UniqueSampler(_device, sampler);
+
+    fallbackInit();
+    updateBudget();
+    _budget = effectiveBudget();
+}
+
+void TextureStreamer::destroy() {
+    if(_device == VK_NULL_HANDLE)
+        return;
+
+    //индексы дескрипторов не освобождаются: набор уничтожается вместе с приложением
+    _changes.clear();
+    _textures.clear();
+    _fallback = Residency();
+    _sampler.reset();
+    _staging.destroy();
+    _device = VK_NULL_HANDLE;
+}
+
+void TextureStreamer::createImage(VkFormat format, VkExtent3D extent, uint32_t levelCount, VkImageUsageFlags usage,
+                                  Residency& residency) {
+    VkImageCreateInfo imageInfo {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = extent;
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkImage image;
+    if(vkCreateImage(_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать изображение текстуры!");
+    residency.image = UniqueImage(_device, image);
+    residency.allocation = UniqueAllocation(_allocator, _allocator->allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                                                     VK_IMAGE_TILING_OPTIMAL));
+    residency.bytes = residency.allocation.get().size;
+
+    VkImageViewCreateInfo viewInfo {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+    VkImageView view;
+    if(vkCreateImageView(_device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать вид текстуры!");
+    residency.view = UniqueImageView(_device, view);
+}
+
+//белая 1x1: умножение на неё не меняет цвет. В режиме пула первая текстура заполняет свободные элементы массива
+void TextureStreamer::fallbackInit() {
+    createImage(VK_FORMAT_R8G8B8A8_UNORM, { 1, 1, 1 }, 1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, _fallback);
+    _fallback.descriptor = _descriptors->registerTexture(_fallback.view, _sampler);
+    _fallbackReady = false;
+}
+
+TextureId TextureStreamer::load(const std::string& path) {
+    auto texture = std::make_unique<Texture>();
+    texture->path = path;
+    texture->file.open(path);
+    const TextureData& data = texture->file.data();
+    texture->format = data.format;
+    texture->width = data.width;
+    texture->height = data.height;
+    texture->levelCount = static_cast<uint32_t>(data.levels.size());
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(_config.physicalDevice, data.format, &properties);
+    if(!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+        throw std::runtime_error("Формат текстуры не поддерживается устройством: " + path);
+
+    //сжатые форматы не бывают приёмником blit: такие файлы без уровней остаются без мипмапов
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+                                              | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if(data.generateMips) {
+        if((properties.optimalTilingFeatures & blitFeatures) == blitFeatures) {
+            texture->generateMips = true;
+            texture->levelCount = ktx2::fullMipCount(data.width, data.height);
+        } else {
+            utils::log() << "Текстура " << path << " без уровней в файле, а формат не поддерживает blit: загружается без мипмапов" << std::endl;
+        }
+    }
+
+    texture->tailLevel = texture->levelCount - 1;
+    while(texture->tailLevel > 0 && std::max(data.width >> (texture->tailLevel - 1), data.height >> (texture->tailLevel - 1)) <= tailSize)
+        texture->tailLevel--;
+
+    //уровень должен помещаться в половину кольца, иначе его загрузка ждала бы, пока кольцо не опустеет целиком
+    const VkDeviceSize stagingLimit = _config.stagingSize / 2;
+    VkDeviceSize tailBytes = 0;
+    for(uint32_t level = texture->tailLevel; level < data.levels.size(); level++)
+        tailBytes += data.levels[level].size;
+    if(texture->generateMips)
+        tailBytes = data.levels[0].size; //хвост создаётся из уровня 0
+    if(tailBytes > stagingLimit)
+        throw std::runtime_error("Текстура " + path + " не помещается в staging кольцо: нужно "
+                                 + std::to_string(tailBytes >> 20) + " МБ за один шаг");
+
+    while(texture->finestLevel < texture->tailLevel && data.levels[texture->finestLevel].size > stagingLimit)
+        texture->finestLevel++;
+    if(texture->finestLevel > 0)
+        utils::log() << "Текстура " << path << ": уровни до " << texture->finestLevel
+                     << " больше staging кольца и не загружаются" << std::endl;
+
+    texture->residentLevel = texture->levelCount;
+    texture->lastUsed = _frameNumber;
+    _textures.push_back(std::move(texture));
+    return static_cast<TextureId>(_textures.size() - 1);
+}
+
+uint32_t TextureStreamer::getDescriptorIndex(TextureId id) const {
+    const Texture& texture = *_textures[id];
+    //новое изображение читается со следующего кадра после смены, до тех пор - прошлое
+    const Residency& visible = texture.changing ? texture.previous : texture.current;
+    return visible.descriptor != noDescriptor ? visible.descriptor : _fallback.descriptor;
+}
+
+void TextureStreamer::markUsed(TextureId id) {
+    _textures[id]->lastUsed = _frameNumber;
+}
+
+void TextureStreamer::beginFrame(uint32_t frameSlot, uint64_t frameNumber) {
+    _frameNumber = frameNumber;
+    _staging.beginFrame(frameSlot);
+
+    //прошлый кадр перевёл новые изображения в SHADER_READ_ONLY, а их дескрипторы уже записаны в наборы всех слотов
+    for(const Change& change : _changes)
+        publish(*_textures[change.texture]);
+    _changes.clear();
+
+    while(!_retired.empty() && _retired.front().first + _config.frameSlots <= frameNumber + 1) {
+        _retiredBytes -= _retired.front().second;
+        _retired.pop_front();
+    }
+
+    if(frameNumber % budgetInterval == 0)
+        updateBudget();
+    _budget = effectiveBudget();
+
+    evict();
+    stream();
+}
+
+void TextureStreamer::record(VkCommandBuffer commandBuffer) {
+    if(!_fallbackReady)
+        recordFallback(commandBuffer);
+    for(const Change& change : _changes)
+        recordChange(commandBuffer, change);
+}
+
+void TextureStreamer::endFrame(uint32_t frameSlot) {
+    _staging.endFrame(frameSlot);
+    _fallbackReady = true;
+}
+
+void TextureStreamer::updateBudget() {
+    const AllocatorStats heap = _allocator->stats(_heapIndex);
+    VkDeviceSize external = 0;
+
+    if(_config.memoryBudget) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties {};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 properties {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(_config.physicalDevice, &properties);
+
+        //запас на рост блоков аллокатора между опросами
+        _heapBudget = budgetProperties.heapBudget[_heapIndex] / 10 * 9;
+        //heapUsage включает и блоки нашего аллокатора, и память других процессов
+        const VkDeviceSize usage = budgetProperties.heapUsage[_heapIndex];
+        external = usage > heap.reservedBytes ? usage - heap.reservedBytes : 0;
+    } else {
+        //без расширения занятость кучи другими процессами не видна: берём долю её размера
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(_config.physicalDevice, &memoryProperties);
+        _heapBudget = memoryProperties.memoryHeaps[_heapIndex].size / 10 * 8;
+    }
+
+    const VkDeviceSize textureBytes = _residentBytes + _retiredBytes;
+    _otherBytes = external + (heap.usedBytes > textureBytes ? heap.usedBytes - textureBytes : 0);
+}
+
+VkDeviceSize TextureStreamer::effectiveBudget() const {
+    VkDeviceSize budget = _heapBudget > _otherBytes ? _heapBudget - _otherBytes : 0;
+    if(_config.budget != 0)
+        budget = std::min(budget, _config.budget);
+    return std::min(budget, _allocationLimit);
+}
+
+TextureId TextureStreamer::findVictim(uint64_t usedBefore) const {
+    TextureId victim = noTexture;
+    for(TextureId id = 0; id < _textures.size(); id++) {
+        const Texture& texture = *_textures[id];
+        if(texture.changing || texture.residentLevel >= texture.tailLevel || texture.lastUsed >= usedBefore)
+            continue;
+        if(victim == noTexture || texture.lastUsed < _textures[victim]->lastUsed)
+            victim = id;
+    }
+    return victim;
+}
+
+//по уровню за шаг: дольше всех не использованная текстура теряет наибольший уровень
+void TextureStreamer::evict() {
+    while(_residentBytes > _budget) {
+        TextureId victim = findVictim(UINT64_MAX);
+        if(victim == noTexture || !changeResidency(victim, _textures[victim]->residentLevel + 1))
+            break;
+        _evictedLevels++;
+    }
+}
+
+void TextureStreamer::stream() {
+    //сначала текстуры, у которых загружено меньше всего: заглушка хуже размытой текстуры
+    auto residentSize = [](const Texture& texture) {
+        if(texture.residentLevel == texture.levelCount)
+            return 0u;
+        return std::max(texture.width >> texture.residentLevel, texture.height >> texture.residentLevel);
+    };
+
+    std::vector<TextureId> candidates;
+    for(TextureId id = 0; id < _textures.size(); id++) {
+        const Texture& texture = *_textures[id];
+        if(!texture.changing && texture.residentLevel > texture.finestLevel && texture.lastUsed + hotFrames >= _frameNumber)
+            candidates.push_back(id);
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](TextureId a, TextureId b) {
+        const Texture& first = *_textures[a];
+        const Texture& second = *_textures[b];
+        if(residentSize(first) != residentSize(second))
+            return residentSize(first) < residentSize(second);
+        return first.lastUsed > second.lastUsed;
+    });
+
+    VkDeviceSize uploaded = 0;
+    for(TextureId id : candidates) {
+        Texture& texture = *_textures[id];
+        const TextureData& data = texture.file.data();
+        const bool initial = texture.residentLevel == texture.levelCount;
+        //создаваемые уровни получаются только из уровня 0, поэтому такие текстуры загружаются сразу целиком
+        const uint32_t level = texture.generateMips ? 0 : initial ? texture.tailLevel : texture.residentLevel - 1;
+
+        VkDeviceSize bytes = 0;
+        for(uint32_t fileLevel = level; fileLevel < std::min<size_t>(texture.residentLevel, data.levels.size()); fileLevel++)
+            bytes += data.levels[fileLevel].size;
+        if(uploaded > 0 && uploaded + bytes > _config.uploadBytesPerFrame)
+            continue;
+
+        //место освобождают текстуры, которые рисовались раньше этой; хвост загружается и сверх бюджета
+        const VkDeviceSize growth = imageBytes(texture, level) - (initial ? 0 : imageBytes(texture, texture.residentLevel));
+        while(_residentBytes + growth > _budget) {
+            TextureId victim = findVictim(texture.lastUsed);
+            if(victim == noTexture || !changeResidency(victim, _textures[victim]->residentLevel + 1))
+                break;
+            _evictedLevels++;
+        }
+        if(!initial && _residentBytes + growth > _budget)
+            continue;
+
+        //кольцо заполнено загрузками кадров в полёте или кончилась память устройства
+        if(!changeResidency(id, level))
+            break;
+        uploaded += bytes;
+    }
+}
+
+bool TextureStreamer::changeResidency(TextureId id, uint32_t newLevel) {
+    Texture& texture = *_textures[id];
+    const TextureData& data = texture.file.data();
+    Change change { id, texture.residentLevel, newLevel, {} };
+    if(_frameNumber < _descriptorRetryFrame)
+        return false;
+
+    //уровни, которых нет в прошлом изображении; участки, выданные до неудачного, освободятся вместе со слотом кадра
+    const uint32_t uploadEnd = std::min(texture.residentLevel, static_cast<uint32_t>(data.levels.size()));
+    for(uint32_t level = newLevel; level < uploadEnd; level++) {
+        StagingRing::Region region;
+        if(!_staging.tryAllocate(data.levels[level].size, uploadAlignment, region))
+            return false;
+        change.uploads.push_back({ level, region });
+    }
+
+    Residency residency;
+    try {
+        createImage(texture.format, levelExtent(texture, newLevel), texture.levelCount - newLevel,
+                    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, residency);
+    } catch(const std::runtime_error& error) {
+        //память кончилась раньше бюджета: текстуры больше не растут, кадры продолжаются с тем, что загружено
+        _allocationLimit = _residentBytes;
+        _budget = effectiveBudget();
+        utils::log() << "Текстуры ограничены " << (_residentBytes >> 20) << " МБ: " << error.what() << std::endl;
+        return false;
+    }
+
+    //новому изображению нужен свой индекс, пока прошлое ещё читается
+    try {
+        residency.descriptor = _descriptors->registerTexture(residency.view, _sampler);
+    } catch(const std::runtime_error& error) {
+        if(_descriptorRetryFrame == 0)
+            utils::log() << "Текстуры ждут освобождения дескрипторов: " << error.what() << std::endl;
+        _descriptorRetryFrame = _frameNumber + _config.frameSlots; //освобождённые индексы возвращаются через кадры в полёте
+        return false;
+    }
+
+    for(const auto& [level, region] : change.uploads) {
+        std::memcpy(region.data, data.levels[level].data, data.levels[level].size);
+        _staging.flush(region);
+        _uploadedBytes += region.size;
+    }
+
+    if(texture.current.image != VK_NULL_HANDLE) {
+        //память прошлого изображения вернётся, когда завершатся кадры, которые его читали, включая текущий
+        _residentBytes -= texture.current.bytes;
+        _retiredBytes += texture.current.bytes;
+        _retired.push_back({ _frameNumber + 1, texture.current.bytes });
+    }
+    _residentBytes += residency.bytes;
+
+    texture.previous = std::move(texture.current);
+    texture.current = std::move(residency);
+    texture.residentLevel = newLevel;
+    texture.changing = true;
+    _changes.push_back(std::move(change));
+    return true;
+}
+
+void TextureStreamer::publish(Texture& texture) {
+    if(texture.previous.image != VK_NULL_HANDLE) {
+        _descriptors->releaseTexture(texture.previous.descriptor);
+        _deletionQueue->retire(_frameNumber, std::move(texture.previous));
+        texture.previous = Residency();
+    }
+    texture.changing = false;
+}
+
+void TextureStreamer::recordFallback(VkCommandBuffer commandBuffer) {
+    VkImageMemoryBarrier barrier = imageBarrier(_fallback.image, 0, 1, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkClearColorValue white {};
+    white.float32[0] = white.float32[1] = white.float32[2] = white.float32[3] = 1.0f;
+    VkImageSubresourceRange range { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdClearColorImage(commandBuffer, _fallback.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &range);
+
+    barrier = imageBarrier(_fallback.image, 0, 1, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+//текстуры читают только фрагментные шейдеры
+void TextureStreamer::recordChange(VkCommandBuffer commandBuffer, const Change& change) {
+    const Texture& texture = *_textures[change.texture];
+    const VkImage newImage = texture.current.image;
+    const VkImage oldImage = texture.previous.image;
+    const uint32_t newCount = texture.levelCount - change.newLevel;
+    const uint32_t oldCount = texture.levelCount - change.oldLevel;
+    const uint32_t keptLevel = std::max(change.oldLevel, change.newLevel); //этот уровень и мельче есть в прошлом изображении
+
+    std::vector<VkImageMemoryBarrier> barriers;
+    barriers.push_back(imageBarrier(newImage, 0, newCount, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+    if(oldImage != VK_NULL_HANDLE) //после чтений прошлых кадров достаточно зависимости исполнения
+        barriers.push_back(imageBarrier(oldImage, 0, oldCount, 0, VK_ACCESS_TRANSFER_READ_BIT,
+                                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    if(oldImage != VK_NULL_HANDLE) {
+        std::vector<VkImageCopy> copies;
+        for(uint32_t level = keptLevel; level < texture.levelCount; level++) {
+            VkImageCopy copy {};
+            copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - change.oldLevel, 0, 1 };
+            copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - change.newLevel, 0, 1 };
+            copy.extent = levelExtent(texture, level);
+            copies.push_back(copy);
+        }
+        vkCmdCopyImage(commandBuffer, oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       static_cast<uint32_t>(copies.size()), copies.data());
+    }
+
+    for(const auto& [level, region] : change.uploads) {
+        VkBufferImageCopy copy {};
+        copy.bufferOffset = region.offset;
+        copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - change.newLevel, 0, 1 };
+        copy.imageExtent = levelExtent(texture, level);
+        vkCmdCopyBufferToImage(commandBuffer, region.buffer, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+    }
+
+    //недостающие уровни - blit из предыдущего; загружается только уровень 0, поэтому уровни изображения и текстуры совпадают
+    uint32_t sourceLevels = 0; //уровни [0, sourceLevels) уже в TRANSFER_SRC
+    if(texture.generateMips && !change.uploads.empty()) {
+        for(uint32_t level = 1; level < keptLevel; level++) {
+            VkImageMemoryBarrier barrier = imageBarrier(newImage, level - 1, 1, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                                                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkImageBlit blit {};
+            blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+            blit.srcOffsets[1] = toOffset(levelExtent(texture, level - 1));
+            blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+            blit.dstOffsets[1] = toOffset(levelExtent(texture, level));
+            vkCmdBlitImage(commandBuffer, newImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &blit, VK_FILTER_LINEAR);
+            sourceLevels = level;
+        }
+    }
+
+    //прошлое изображение этот кадр ещё рисует
+    barriers.clear();
+    if(sourceLevels > 0)
+        barriers.push_back(imageBarrier(newImage, 0, sourceLevels, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+    barriers.push_back(imageBarrier(newImage, sourceLevels, newCount - sourceLevels, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+    if(oldImage != VK_NULL_HANDLE)
+        barriers.push_back(imageBarrier(oldImage, 0, oldCount, 0, VK_ACCESS_SHADER_READ_BIT,
+                                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+VkDeviceSize TextureStreamer::imageBytes(const Texture& texture, uint32_t level) const {
+    VkDeviceSize bytes = 0;
+    for(; level < texture.levelCount; level++)
+        bytes += ktx2::levelSize(texture.format, texture.width, texture.height, level);
+    return bytes;
+}
+
+VkExtent3D TextureStreamer::levelExtent(const Texture& texture, uint32_t level) const {
+    return { std::max(1u, texture.width >> level), std::max(1u, texture.height >> level), 1 };
+}
+
+void TextureStreamer::printReport(std::ostream& out) const {
+    out << "Текстуры: " << _textures.size() << ", загружено " << (_residentBytes >> 10) << " / " << (_budget >> 10)
+        << " КБ бюджета, через staging " << (_uploadedBytes >> 10) << " КБ, вытеснено уровней: " << _evictedLevels << std::endl;
+
+    for(const auto& texture : _textures) {
+        out << "  " << texture->path << " (" << texture->width << "x" << texture->height << ", уровней " << texture->levelCount
+            << (texture->generateMips ? ", созданы на GPU" : "") << "): ";
+        if(texture->residentLevel == texture->levelCount) {
+            out << "не загружена" << std::endl;
+            continue;
+        }
+        VkExtent3D extent = levelExtent(*texture, texture->residentLevel);
+        out << "с уровня " << texture->residentLevel << " (" << extent.width << "x" << extent.height << "), "
+            << (texture->current.bytes >> 10) << " КБ" << std::endl;
+    }
+}
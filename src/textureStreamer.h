@@ -0,0 +1,146 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+#include <utility>
+#include <vulkan/vulkan.h>
+
+#include "ktxFile.h"
+#include "stagingRing.h"
+#include "vulkanHandle.h"
+#include "deletionQueue.h"
+#include "memoryAllocator.h"
+#include "bindlessDescriptors.h"
+
+using TextureId = uint32_t;
+
+//текстуры KTX2 с потоковой загрузкой уровней. Сначала разом загружается хвост мелких уровней, затем
+//по уровню за шаг в сторону наибольшего; при нехватке памяти давно не использованные текстуры теряют
+//наибольшие уровни. Изображение текстуры содержит только загруженные уровни, поэтому смена набора уровней -
+//новое изображение, куда копируются оставшиеся уровни старого. Все копирования и blit создания уровней
+//записываются в буфер команд кадра на очереди графики: CPU не ждёт GPU. Только поток кадра
+class TextureStreamer
+{
+public:
+    struct Config {
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkDevice device = VK_NULL_HANDLE;
+        uint32_t frameSlots = 2;
+        bool memoryBudget = false;                     //включено VK_EXT_memory_budget
+        VkDeviceSize budget = 0;                       //предел памяти текстур; 0 - по бюджету кучи
+        VkDeviceSize stagingSize = 64ull << 20;        //уровни больше кольца не загружаются
+        VkDeviceSize uploadBytesPerFrame = 8ull << 20; //но хотя бы один уровень за кадр
+    };
+
+    //регистрирует белую заглушку 1x1 первой текстурой BindlessDescriptors
+    void init(const Config& config, DeviceAllocator& allocator, BindlessDescriptors& descriptors,
+              DeletionQueue& deletionQueue);
+    void destroy(); //GPU не должен читать текстуры
+
+    //открывает файл; уровни загружаются в следующих кадрах
+    TextureId load(const std::string& path);
+    //индекс в массиве текстур BindlessDescriptors; меняется вместе с набором уровней, поэтому запрашивается
+    //каждый кадр. Пока ни один уровень не загружен - заглушка
+    uint32_t getDescriptorIndex(TextureId texture) const;
+    uint32_t getFallbackDescriptorIndex() const { return _fallback.descriptor; }
+    void markUsed(TextureId texture); //кадр читает текстуру: порядок вытеснения
+
+    //после BindlessDescriptors::beginFrame: выбор уровней для загрузки и вытеснения, копирование в staging
+    void beginFrame(uint32_t frameSlot, uint64_t frameNumber);
+    //до проходов, читающих текстуры
+    void record(VkCommandBuffer commandBuffer);
+    //после отправки кадра
+    void endFrame(uint32_t frameSlot);
+
+    size_t getTextureCount() const { return _textures.size(); }
+    VkDeviceSize getResidentBytes() const { return _residentBytes; }
+    VkDeviceSize getBudget() const { return _budget; }
+    void printReport(std::ostream& out) const;
+
+private:
+    static constexpr TextureId noTexture = UINT32_MAX;
+    static constexpr uint32_t noDescriptor = UINT32_MAX;
+
+    //изображение с набором уровней текстуры
+    struct Residency {
+        UniqueAllocation allocation;
+        UniqueImage image;
+        UniqueImageView view;
+        uint32_t descriptor = noDescriptor;
+        VkDeviceSize bytes = 0;
+    };
+
+    struct Texture {
+        std::string path;
+        KtxFile file;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levelCount = 1;    //на GPU, вместе с создаваемыми
+        bool generateMips = false;  //в файле только уровень 0, остальные создаёт blit
+        uint32_t tailLevel = 0;     //этот уровень и мельче загружаются разом и не вытесняются
+        uint32_t finestLevel = 0;   //наибольший уровень, который помещается в staging кольцо
+        uint32_t residentLevel = 0; //наибольший загруженный; levelCount - не загружено ничего
+        Residency current;
+        //прошлое изображение: текущий кадр ещё читает его, новое публикуется со следующего кадра
+        Residency previous;
+        bool changing = false;
+        uint64_t lastUsed = 0;
+    };
+
+    //смена набора уровней, которую записывает record
+    struct Change {
+        TextureId texture;
+        uint32_t oldLevel;
+        uint32_t newLevel;
+        std::vector<std::pair<uint32_t, StagingRing::Region>> uploads; //уровень текстуры и его данные
+    };
+
+    //бросает исключение, если не удалось создать изображение или выделить память
+    void createImage(VkFormat format, VkExtent3D extent, uint32_t levelCount, VkImageUsageFlags usage, Residency& residency);
+    void fallbackInit();
+    void updateBudget();
+    VkDeviceSize effectiveBudget() const;
+    void evict();
+    void stream();
+    //false - не хватило места в кольце или памяти устройства, состояние текстуры не изменилось
+    bool changeResidency(TextureId id, uint32_t newLevel);
+    TextureId findVictim(uint64_t usedBefore) const;
+    void publish(Texture& texture);
+    void recordFallback(VkCommandBuffer commandBuffer);
+    void recordChange(VkCommandBuffer commandBuffer, const Change& change);
+    VkDeviceSize imageBytes(const Texture& texture, uint32_t level) const;
+    VkExtent3D levelExtent(const Texture& texture, uint32_t level) const;
+
+    Config _config;
+    VkDevice _device = VK_NULL_HANDLE;
+    DeviceAllocator* _allocator = nullptr;
+    BindlessDescriptors* _descriptors = nullptr;
+    DeletionQueue* _deletionQueue = nullptr;
+    StagingRing _staging;
+    UniqueSampler _sampler;
+    Residency _fallback;
+    bool _fallbackReady = false; //заглушка очищена и переведена в SHADER_READ_ONLY первым кадром
+
+    std::vector<std::unique_ptr<Texture>> _textures;
+    std::vector<Change> _changes;
+    uint64_t _frameNumber = 0;
+
+    //память текстур: загруженные изображения и прошлые, которые ещё ждут завершения кадров
+    uint32_t _heapIndex = 0;
+    VkDeviceSize _residentBytes = 0;
+    VkDeviceSize _retiredBytes = 0;
+    std::deque<std::pair<uint64_t, VkDeviceSize>> _retired; //номер кадра retire и размер
+    VkDeviceSize _heapBudget = 0;    //за вычетом запаса
+    VkDeviceSize _otherBytes = 0;    //память кучи не под текстуры, в том числе других процессов
+    VkDeviceSize _allocationLimit = UINT64_MAX; //после отказа выделения текстуры не растут выше достигнутого
+    VkDeviceSize _budget = 0;
+    uint64_t _descriptorRetryFrame = 0; //массив текстур BindlessDescriptors был заполнен
+
+    uint64_t _uploadedBytes = 0;
+    uint32_t _evictedLevels = 0;
+};
@@ -0,0 +1,226 @@
+#include "transformHierarchy.h"
+
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+NodeId TransformHierarchy::add(NodeId parent, const Transform& local) {
+    const NodeId id = getNodeCount();
+    if(parent != noParent && parent >= id)
+        throw std::runtime_error("Родитель узла преобразований должен быть добавлен раньше узла");
+
+    _parentOf.push_back(parent);
+    _depthOf.push_back(parent == noParent ? 0 : _depthOf[parent] + 1);
+    _slotOf.push_back(noSlot);
+    _pending.push_back({ id, local });
+    return id;
+}
+
+void TransformHierarchy::setLocal(NodeId node, const Transform& local) {
+    const uint32_t slot = _slotOf[node];
+    if(slot == noSlot) { //ещё не размещён: узлы без места идут подряд в конце
+        _pending[node - (getNodeCount() - _pending.size())].local = local;
+        return;
+    }
+
+    storeLocal(slot, local);
+    _stamp[slot] = _generation;
+    _firstDirtyLevel = std::min(_firstDirtyLevel, _depthOf[node]);
+}
+
+void TransformHierarchy::clear() {
+    *this = TransformHierarchy();
+}
+
+void TransformHierarchy::storeLocal(uint32_t slot, const Transform& local) {
+    _tx[slot] = local.translation.x;
+    _ty[slot] = local.translation.y;
+    _tz[slot] = local.translation.z;
+    _qx[slot] = local.rotation.x;
+    _qy[slot] = local.rotation.y;
+    _qz[slot] = local.rotation.z;
+    _qw[slot] = local.rotation.w;
+    _sx[slot] = local.scale.x;
+    _sy[slot] = local.scale.y;
+    _sz[slot] = local.scale.z;
+}
+
+//устойчивая сортировка подсчётом по глубине: размещённые узлы сохраняют порядок внутри уровня, новые идут
+//за ними. Места родителей пересчитываются, все узлы считаются изменёнными
+void TransformHierarchy::sortByDepth() {
+    const uint32_t count = getNodeCount();
+    const uint32_t placed = count - static_cast<uint32_t>(_pending.size());
+
+    uint32_t levelCount = 0;
+    for(uint32_t depth : _depthOf)
+        levelCount = std::max(levelCount, depth + 1);
+    std::vector<uint32_t> levelStart(levelCount + 1, 0);
+    for(uint32_t depth : _depthOf)
+        levelStart[depth + 1]++;
+    for(uint32_t level = 0; level < levelCount; level++)
+        levelStart[level + 1] += levelStart[level];
+
+    //порядок: прежние места, затем новые узлы
+    std::vector<NodeId> order(count);
+    for(NodeId id = 0; id < placed; id++)
+        order[_slotOf[id]] = id;
+    for(uint32_t i = 0; i < _pending.size(); i++)
+        order[placed + i] = _pending[i].id;
+
+    std::vector<uint32_t> next(levelStart.begin(), levelStart.end() - 1);
+    std::vector<uint32_t> newSlot(count);
+    for(NodeId id : order)
+        newSlot[id] = next[_depthOf[id]]++;
+
+    auto reorder = [&](std::vector<float>& values, float pendingDefault) {
+        std::vector<float> sorted(count, pendingDefault);
+        for(NodeId id = 0; id < placed; id++)
+            sorted[newSlot[id]] = values[_slotOf[id]];
+        values.swap(sorted);
+    };
+    for(std::vector<float>* values : { &_tx, &_ty, &_tz, &_qx, &_qy, &_qz, &_qw, &_sx, &_sy, &_sz })
+        reorder(*values, 0.0f);
+
+    _slotOf = newSlot;
+    for(const PendingNode& node : _pending)
+        storeLocal(_slotOf[node.id], node.local);
+    _pending.clear();
+
+    _parent.resize(count);
+    for(NodeId id = 0; id < count; id++)
+        _parent[_slotOf[id]] = _parentOf[id] == noParent ? noSlot : _slotOf[_parentOf[id]];
+
+    for(auto& column : _world)
+        column.assign(count, 0.0f);
+    _stamp.assign(count, _generation);
+    _levelStart = std::move(levelStart);
+    _firstDirtyLevel = 0;
+}
+
+TransformUpdateStats TransformHierarchy::update(JobSystem* jobs, glm::mat4* instances) {
+    auto start = std::chrono::steady_clock::now();
+    TransformUpdateStats stats;
+
+    if(!_pending.empty())
+        sortByDepth();
+
+    const uint32_t levelCount = getLevelCount();
+    for(uint32_t level = _firstDirtyLevel; level < levelCount; level++) {
+        const uint32_t size = _levelStart[level + 1] - _levelStart[level];
+        const uint32_t groups = (size + 3) / 4;
+        stats.levels++;
+
+        if(jobs == nullptr || jobs->getWorkerCount() == 1 || size < parallelThreshold) {
+            stats.updated += updateGroups(level, 0, groups, instances);
+            continue;
+        }
+
+        //по несколько диапазонов на исполнителя: изменённые поддеревья распределены неравномерно
+        const uint32_t rangeCount = jobs->getWorkerCount() * 4;
+        std::vector<uint32_t> updated(rangeCount, 0);
+        jobs->parallelFor(groups, rangeCount, [&](uint32_t begin, uint32_t end, uint32_t range, uint32_t) {
+            updated[range] = updateGroups(level, begin, end, instances);
+        });
+        for(uint32_t count : updated)
+            stats.updated += count;
+        stats.parallelLevels++;
+    }
+
+    _generation++;
+    _firstDirtyLevel = UINT32_MAX;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+uint32_t TransformHierarchy::updateGroups(uint32_t level, uint32_t beginGroup, uint32_t endGroup, glm::mat4* instances) {
+    const uint32_t levelBegin = _levelStart[level];
+    const uint32_t levelEnd = _levelStart[level + 1];
+    const uint32_t generation = _generation;
+    uint32_t updated = 0;
+
+    for(uint32_t group = beginGroup; group < endGroup; group++) {
+        //неполная последняя четвёрка повторяет последний узел уровня: запись того же значения безвредна
+        const uint32_t first = levelBegin + group * 4;
+        const uint32_t slot[4] = { first, std::min(first + 1, levelEnd - 1), std::min(first + 2, levelEnd - 1),
+                                   std::min(first + 3, levelEnd - 1) };
+
+        //изменение родителя распространяется на детей: уровень родителя уже обработан
+        bool dirty = false;
+        for(uint32_t lane = 0; lane < 4; lane++) {
+            uint32_t parent = _parent[slot[lane]];
+            if(parent != noSlot && _stamp[parent] == generation)
+                _stamp[slot[lane]] = generation;
+            dirty |= _stamp[slot[lane]] == generation;
+        }
+        if(!dirty)
+            continue;
+
+        auto load = [&slot](const std::vector<float>& values) {
+            return glm::vec4(values[slot[0]], values[slot[1]], values[slot[2]], values[slot[3]]);
+        };
+
+        //локальная матрица: поворот из кватерниона, столбцы умножены на масштаб
+        const glm::vec4 qx = load(_qx), qy = load(_qy), qz = load(_qz), qw = load(_qw);
+        const glm::vec4 sx = load(_sx), sy = load(_sy), sz = load(_sz);
+        const glm::vec4 one(1.0f), two(2.0f);
+        const glm::vec4 xx = qx * qx, yy = qy * qy, zz = qz * qz;
+        const glm::vec4 xy = qx * qy, xz = qx * qz, yz = qy * qz;
+        const glm::vec4 wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+        glm::vec4 local[12];
+        local[0] = (one - two * (yy + zz)) * sx;
+        local[1] = two * (xy + wz) * sx;
+        local[2] = two * (xz - wy) * sx;
+        local[3] = two * (xy - wz) * sy;
+        local[4] = (one - two * (xx + zz)) * sy;
+        local[5] = two * (yz + wx) * sy;
+        local[6] = two * (xz + wy) * sz;
+        local[7] = two * (yz - wx) * sz;
+        local[8] = (one - two * (xx + yy)) * sz;
+        local[9] = load(_tx);
+        local[10] = load(_ty);
+        local[11] = load(_tz);
+
+        glm::vec4 world[12];
+        if(level == 0) {
+            std::copy(local, local + 12, world);
+        } else {
+            //мировая родителя * локальная, родители собираются по полосам
+            glm::vec4 parent[12];
+            for(uint32_t i = 0; i < 12; i++)
+                parent[i] = glm::vec4(_world[i][_parent[slot[0]]], _world[i][_parent[slot[1]]],
+                                      _world[i][_parent[slot[2]]], _world[i][_parent[slot[3]]]);
+
+            for(uint32_t column = 0; column < 4; column++)
+                for(uint32_t row = 0; row < 3; row++) {
+                    glm::vec4 value = parent[row] * local[column * 3] + parent[3 + row] * local[column * 3 + 1]
+                                    + parent[6 + row] * local[column * 3 + 2];
+                    world[column * 3 + row] = column == 3 ? value + parent[9 + row] : value;
+                }
+        }
+
+        for(uint32_t i = 0; i < 12; i++)
+            for(uint32_t lane = 0; lane < 4; lane++)
+                _world[i][slot[lane]] = world[i][lane];
+
+        if(instances) //подряд идущие полные матрицы: запись в память GPU без чтения
+            for(uint32_t lane = 0; lane < 4; lane++) {
+                glm::mat4& out = instances[slot[lane]];
+                out[0] = glm::vec4(world[0][lane], world[1][lane], world[2][lane], 0.0f);
+                out[1] = glm::vec4(world[3][lane], world[4][lane], world[5][lane], 0.0f);
+                out[2] = glm::vec4(world[6][lane], world[7][lane], world[8][lane], 0.0f);
+                out[3] = glm::vec4(world[9][lane], world[10][lane], world[11][lane], 1.0f);
+            }
+        updated += std::min(4u, levelEnd - first);
+    }
+    return updated;
+}
+
+glm::mat4 TransformHierarchy::getWorld(NodeId node) const {
+    const uint32_t slot = _slotOf[node];
+    glm::mat4 world(1.0f);
+    for(uint32_t column = 0; column < 4; column++)
+        world[column] = glm::vec4(_world[column * 3][slot], _world[column * 3 + 1][slot], _world[column * 3 + 2][slot],
+                                  column == 3 ? 1.0f : 0.0f);
+    return world;
+}
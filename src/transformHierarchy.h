@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "jobSystem.h"
+
+using NodeId = uint32_t;
+
+//преобразование узла относительно родителя
+struct Transform {
+    glm::vec3 translation { 0.0f };
+    glm::quat rotation { 1.0f, 0.0f, 0.0f, 0.0f }; //w, x, y, z; нормированный
+    glm::vec3 scale { 1.0f };
+};
+
+struct TransformUpdateStats {
+    uint32_t updated = 0;        //пересчитано мировых матриц, с точностью до четвёрки
+    uint32_t levels = 0;         //просмотрено уровней: уровни выше первого изменённого пропускаются
+    uint32_t parallelLevels = 0; //из них поделено между исполнителями
+    double milliseconds = 0.0;
+};
+
+//иерархия преобразований раздельными массивами (SoA), отсортированными по глубине: родитель всегда
+//лежит на уровень раньше детей, поэтому уровни считаются по порядку, а узлы внутри уровня независимы.
+//Мировые матрицы считаются по четыре узла в полосах glm::vec4 и только для изменённых узлов и их
+//поддеревьев. Изменения отмечаются номером поколения, поэтому после обновления флаги не сбрасываются
+//Сцена её пока не использует: объекты задаются DrawItem (смещение и масштаб), а не матрицами, и загружаются
+//один раз; иерархию гоняет только Application::benchmarkTransforms
+class TransformHierarchy
+{
+public:
+    static constexpr NodeId noParent = UINT32_MAX;
+    static constexpr uint32_t parallelThreshold = 8192; //узлов на уровне; меньшие уровни дешевле считать в одном потоке
+
+    //parent добавлен раньше или noParent. Новые узлы занимают место в массивах при следующем update
+    NodeId add(NodeId parent, const Transform& local);
+    void setLocal(NodeId node, const Transform& local);
+    void clear();
+
+    //пересчитывает мировые матрицы изменённых узлов уровень за уровнем; большие уровни делятся между
+    //исполнителями jobs (nullptr - в вызывающем потоке). instances - массив getNodeCount() матриц в порядке
+    //getInstanceIndex, обычно постоянно отображённый буфер GPU: пересчитанные матрицы пишутся туда напрямую
+    //и подряд, родители читаются из собственных массивов, не из памяти GPU. nullptr - только для getWorld
+    TransformUpdateStats update(JobSystem* jobs, glm::mat4* instances);
+
+    //после update. Индекс меняется, только когда добавлены узлы: тогда пересчитываются и пишутся все матрицы
+    uint32_t getInstanceIndex(NodeId node) const { return _slotOf[node]; }
+    glm::mat4 getWorld(NodeId node) const;
+    uint32_t getNodeCount() const { return static_cast<uint32_t>(_parentOf.size()); }
+    uint32_t getLevelCount() const { return _levelStart.empty() ? 0 : static_cast<uint32_t>(_levelStart.size() - 1); }
+
+private:
+    static constexpr uint32_t noSlot = UINT32_MAX;
+
+    //узел ещё не размещён в массивах
+    struct PendingNode {
+        NodeId id;
+        Transform local;
+    };
+
+    void sortByDepth();
+    void storeLocal(uint32_t slot, const Transform& local);
+    //четвёрки [beginGroup, endGroup) уровня level; возвращает число пересчитанных узлов
+    uint32_t updateGroups(uint32_t level, uint32_t beginGroup, uint32_t endGroup, glm::mat4* instances);
+
+    //по NodeId
+    std::vector<NodeId> _parentOf;
+    std::vector<uint32_t> _depthOf;
+    std::vector<uint32_t> _slotOf;
+    std::vector<PendingNode> _pending;
+
+    //по месту в массивах, уровень за уровнем
+    std::vector<uint32_t> _levelStart; //_levelStart[level]..._levelStart[level + 1]; последний - число узлов
+    std::vector<uint32_t> _parent;     //место родителя или noSlot у корней
+    std::vector<uint32_t> _stamp;      //поколение последнего изменения
+    std::vector<float> _tx, _ty, _tz;
+    std::vector<float> _qx, _qy, _qz, _qw;
+    std::vector<float> _sx, _sy, _sz;
+    std::vector<float> _world[12];     //аффинная 3x4 по столбцам: _world[column * 3 + row]
+
+    uint32_t _generation = 1; //поколение следующего update
+    uint32_t _firstDirtyLevel = UINT32_MAX;
+};
@@ -0,0 +1,68 @@
+#include "uniformRing.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+void UniformRing::init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceAllocator& allocator,
+                       VkDeviceSize sizePerFrame, uint32_t frameSlots) {
+    _device = device;
+    _allocator = &allocator;
+    _frameSlots = std::max(frameSlots, 1u);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    //участки слотов и выделения не делят атом некогерентной памяти
+    _alignment = std::max(properties.limits.minUniformBufferOffsetAlignment, allocator.getNonCoherentAtomSize());
+    _range = std::min<VkDeviceSize>(properties.limits.maxUniformBufferRange, 64 * 1024);
+    _sizePerFrame = (sizePerFrame + _alignment - 1) / _alignment * _alignment;
+
+    //дескриптор от последнего смещения участка читает ещё _range байт - они должны лежать внутри буфера
+    VkBufferCreateInfo bufferCreateInfo {};
+    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size = _sizePerFrame * _frameSlots + _range;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if(vkCreateBuffer(_device, &bufferCreateInfo, nullptr, &_buffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать буфер uniform данных кадра!");
+
+    _allocation = allocator.allocateForBuffer(_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+}
+
+void UniformRing::destroy() {
+    if(_buffer == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyBuffer(_device, _buffer, nullptr);
+    _allocator->free(_allocation);
+    _buffer = VK_NULL_HANDLE;
+}
+
+UniformRing::Region UniformRing::allocate(VkDeviceSize size) {
+    if(size > _range)
+        throw std::runtime_error("Uniform данные больше диапазона дескриптора");
+
+    const VkDeviceSize alignedSize = (size + _alignment - 1) / _alignment * _alignment;
+    const VkDeviceSize offset = _head.fetch_add(alignedSize, std::memory_order_relaxed);
+    if(offset + alignedSize > _sizePerFrame)
+        throw std::runtime_error("Буфер uniform данных кадра переполнен");
+
+    const VkDeviceSize bufferOffset = _sizePerFrame * _currentSlot + offset;
+
+    Region region;
+    region.offset = static_cast<uint32_t>(bufferOffset);
+    region.data = static_cast<char*>(_allocation.mapped) + bufferOffset;
+    return region;
+}
+
+void UniformRing::beginFrame(uint32_t frameSlot) {
+    _currentSlot = frameSlot % _frameSlots;
+    _head.store(0, std::memory_order_relaxed);
+}
+
+void UniformRing::flush() {
+    const VkDeviceSize used = std::min(_head.load(std::memory_order_relaxed), _sizePerFrame);
+    if(used != 0)
+        _allocator->flush(_allocation, _sizePerFrame * _currentSlot, used);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vulkan/vulkan.h>
+
+#include "memoryAllocator.h"
+
+//линейный распределитель uniform данных кадра: постоянно отображённый буфер, поделённый на участки по слотам кадра.
+//Шейдеры видят его через один динамический uniform дескриптор, выделение задаёт только динамическое смещение
+//в vkCmdBindDescriptorSets - наборы дескрипторов при записи кадра не меняются.
+//allocate потокобезопасен: вторичные буферы записываются исполнителями JobSystem
+class UniformRing
+{
+public:
+    struct Region {
+        uint32_t offset = 0; //динамическое смещение для vkCmdBindDescriptorSets
+        void* data = nullptr;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, DeviceAllocator& allocator,
+              VkDeviceSize sizePerFrame, uint32_t frameSlots);
+    void destroy();
+
+    //бросает исключение, если участок кадра переполнен или size больше getRange
+    Region allocate(VkDeviceSize size);
+    template<typename T>
+    Region push(const T& value) {
+        Region region = allocate(sizeof(T));
+        std::memcpy(region.data, &value, sizeof(T));
+        return region;
+    }
+
+    //вызывать после ожидания забора слота: участок слота снова свободен
+    void beginFrame(uint32_t frameSlot);
+    //вызывать до отправки кадра: для некогерентной памяти сбрасывает записанное в участок слота
+    void flush();
+
+    VkBuffer getBuffer() const { return _buffer; }
+    VkDeviceSize getRange() const { return _range; } //диапазон дескриптора: наибольшее выделение
+    VkDeviceSize getUsedBytes() const { return _head.load(std::memory_order_relaxed); }
+
+private:
+    VkDevice _device = VK_NULL_HANDLE;
+    DeviceAllocator* _allocator = nullptr;
+    VkBuffer _buffer = VK_NULL_HANDLE;
+    Allocation _allocation;
+    VkDeviceSize _sizePerFrame = 0;
+    VkDeviceSize _alignment = 256;
+    VkDeviceSize _range = 0;
+    uint32_t _frameSlots = 1;
+    uint32_t _currentSlot = 0;
+
+    std::atomic<VkDeviceSize> _head { 0 }; //смещение внутри участка текущего слота
+};
@@ -0,0 +1,278 @@
+#include "uploadQueue.h"
+
+#include <cstring>
+#include <stdexcept>
+
+void UploadQueue::init(const Config& config, DeviceAllocator& allocator) {
+    _device = config.device;
+    _queue = config.queue;
+    _queueFamily = config.queueFamily;
+    _graphicsFamily = config.graphicsFamily;
+
+    VkCommandPoolCreateInfo poolCreateInfo {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolCreateInfo.queueFamilyIndex = _queueFamily;
+
+    if(vkCreateCommandPool(_device, &poolCreateInfo, nullptr, &_commandPool) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось создать пул команд очереди загрузок!");
+
+    if(config.timelineSemaphores) {
+        _waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphores>(vkGetDeviceProcAddr(_device, "vkWaitSemaphores"));
+        _getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(
+            vkGetDeviceProcAddr(_device, "vkGetSemaphoreCounterValue"));
+    }
+
+    if(_waitSemaphores && _getSemaphoreCounterValue) {
+        VkSemaphoreTypeCreateInfo typeCreateInfo {};
+        typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo {};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+        if(vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &_timeline) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось создать timeline семафор!");
+    }
+
+    _staging.init(_device, allocator, config.stagingSize, 1);
+}
+
+void UploadQueue::destroy() {
+    if(_device == VK_NULL_HANDLE)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(!_inFlight.empty())
+            waitValue(_inFlight.back().value);
+        reclaim();
+    }
+
+    for(VkFence fence : _freeFences)
+        vkDestroyFence(_device, fence, nullptr);
+    vkDestroySemaphore(_device, _timeline, nullptr);
+    vkDestroyCommandPool(_device, _commandPool, nullptr);
+    _staging.destroy();
+    _device = VK_NULL_HANDLE;
+}
+
+uint64_t UploadQueue::completedValue() {
+    if(_timeline != VK_NULL_HANDLE) {
+        uint64_t value = 0;
+        _getSemaphoreCounterValue(_device, _timeline, &value);
+        return value;
+    }
+
+    //заборы сигналятся в порядке отправки на одной очереди
+    uint64_t value = _completed;
+    for(const auto& submission : _inFlight) {
+        if(vkGetFenceStatus(_device, submission.fence) != VK_SUCCESS)
+            break;
+        value = submission.value;
+    }
+    return value;
+}
+
+void UploadQueue::reclaim() {
+    _completed = std::max(_completed, completedValue());
+    while(!_inFlight.empty() && _inFlight.front().value <= _completed) {
+        Submission& submission = _inFlight.front();
+        _staging.releaseUpTo(submission.stagingHead);
+        _freeCommandBuffers.push_back(submission.commandBuffer);
+        if(submission.fence != VK_NULL_HANDLE) {
+            vkResetFences(_device, 1, &submission.fence);
+            _freeFences.push_back(submission.fence);
+        }
+        _inFlight.pop_front();
+    }
+}
+
+void UploadQueue::waitValue(uint64_t value) {
+    if(_timeline != VK_NULL_HANDLE) {
+        VkSemaphoreWaitInfo waitInfo {};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &_timeline;
+        waitInfo.pValues = &value;
+        _waitSemaphores(_device, &waitInfo, UINT64_MAX);
+        return;
+    }
+
+    for(const auto& submission : _inFlight)
+        if(submission.value == value)
+            vkWaitForFences(_device, 1, &submission.fence, VK_TRUE, UINT64_MAX);
+}
+
+VkCommandBuffer UploadQueue::acquireCommandBuffer() {
+    if(!_freeCommandBuffers.empty()) {
+        VkCommandBuffer commandBuffer = _freeCommandBuffers.back();
+        _freeCommandBuffers.pop_back();
+        vkResetCommandBuffer(commandBuffer, 0);
+        return commandBuffer;
+    }
+
+    VkCommandBufferAllocateInfo allocateInfo {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = _commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if(vkAllocateCommandBuffers(_device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Не удалось выделить буфер команд загрузки!");
+    return commandBuffer;
+}
+
+UploadTicket UploadQueue::uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size,
+                                       VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    reclaim();
+
+    //кусками по половине staging буфера, чтобы следующий кусок копировался на CPU, пока GPU передаёт предыдущий
+    const VkDeviceSize chunkSize = _staging.getSize() / 2;
+    const char* bytes = static_cast<const char*>(data);
+    UploadTicket ticket;
+
+    for(VkDeviceSize done = 0; done < size; done += chunkSize) {
+        const VkDeviceSize count = std::min(chunkSize, size - done);
+        const bool last = done + count >= size;
+
+        StagingRing::Region region;
+        while(!_staging.tryAllocate(count, 16, region)) { //место освободится, когда завершится самая старая отправка
+            if(_inFlight.empty())
+                throw std::runtime_error("Staging буфер очереди загрузок переполнен!");
+            waitValue(_inFlight.front().value);
+            reclaim();
+        }
+        std::memcpy(region.data, bytes + done, count);
+        _staging.flush(region);
+
+        VkCommandBuffer commandBuffer = acquireCommandBuffer();
+        VkCommandBufferBeginInfo beginInfo {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        VkBufferCopy copy {};
+        copy.srcOffset = region.offset;
+        copy.dstOffset = offset + done;
+        copy.size = count;
+        vkCmdCopyBuffer(commandBuffer, region.buffer, buffer, 1, &copy);
+
+        if(last && isDedicatedFamily()) {
+            //освобождение владения; парный захват записывается на очереди графики в recordAcquires
+            VkBufferMemoryBarrier release {};
+            release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            release.dstAccessMask = 0;
+            release.srcQueueFamilyIndex = _queueFamily;
+            release.dstQueueFamilyIndex = _graphicsFamily;
+            release.buffer = buffer;
+            release.offset = offset;
+            release.size = size;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                 0, nullptr, 1, &release, 0, nullptr);
+        }
+
+        if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось записать буфер команд загрузки!");
+
+        Submission submission {};
+        submission.value = _nextValue++;
+        submission.commandBuffer = commandBuffer;
+        submission.stagingHead = _staging.getHead();
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &submission.value;
+
+        VkSubmitInfo submitInfo {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        if(_timeline != VK_NULL_HANDLE) {
+            submitInfo.pNext = &timelineInfo;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &_timeline;
+        } else if(!_freeFences.empty()) {
+            submission.fence = _freeFences.back();
+            _freeFences.pop_back();
+        } else {
+            VkFenceCreateInfo fenceCreateInfo {};
+            fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if(vkCreateFence(_device, &fenceCreateInfo, nullptr, &submission.fence) != VK_SUCCESS)
+                throw std::runtime_error("Не удалось создать забор загрузки!");
+        }
+
+        if(vkQueueSubmit(_queue, 1, &submitInfo, submission.fence) != VK_SUCCESS)
+            throw std::runtime_error("Не удалось отправить загрузку!");
+
+        _inFlight.push_back(submission);
+        ticket.value = submission.value;
+    }
+
+    if(ticket.value != 0)
+        _pendingAcquires.push_back({ ticket.value, buffer, offset, size, dstStage, dstAccess });
+    return ticket;
+}
+
+bool UploadQueue::isComplete(UploadTicket ticket) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(ticket.value <= _completed)
+        return true;
+    reclaim();
+    return ticket.value <= _completed;
+}
+
+void UploadQueue::wait(UploadTicket ticket) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(ticket.value <= _completed)
+        return;
+    waitValue(ticket.value);
+    reclaim();
+}
+
+uint64_t UploadQueue::recordAcquires(VkCommandBuffer commandBuffer) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_pendingAcquires.empty())
+        return 0;
+    reclaim();
+
+    std::vector<VkBufferMemoryBarrier> barriers;
+    VkPipelineStageFlags dstStages = 0;
+    uint64_t acquired = 0;
+
+    auto ready = _pendingAcquires.begin();
+    for(auto it = _pendingAcquires.begin(); it != _pendingAcquires.end(); ++it) {
+        if(it->value > _completed) { //ещё копируется - захватим в одном из следующих кадров
+            *ready++ = *it;
+            continue;
+        }
+
+        //без передачи владения барьер только делает запись видимой для очереди графики
+        VkBufferMemoryBarrier acquire {};
+        acquire.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        acquire.srcAccessMask = isDedicatedFamily() ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+        acquire.dstAccessMask = it->dstAccess;
+        acquire.srcQueueFamilyIndex = isDedicatedFamily() ? _queueFamily : VK_QUEUE_FAMILY_IGNORED;
+        acquire.dstQueueFamilyIndex = isDedicatedFamily() ? _graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+        acquire.buffer = it->buffer;
+        acquire.offset = it->offset;
+        acquire.size = it->size;
+        barriers.push_back(acquire);
+
+        dstStages |= it->dstStage;
+        acquired = std::max(acquired, it->value);
+    }
+    _pendingAcquires.erase(ready, _pendingAcquires.end());
+
+    if(!barriers.empty())
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0,
+                             0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+    return acquired;
+}
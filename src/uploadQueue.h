@@ -0,0 +1,92 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "memoryAllocator.h"
+#include "stagingRing.h"
+
+//номер отправки очереди загрузок; загрузка завершена, когда счётчик очереди дошёл до value
+struct UploadTicket {
+    uint64_t value = 0; //0 - нечего ждать
+};
+
+//асинхронные загрузки в буферы через отдельную очередь (по возможности семейства только для передачи):
+//копирование идёт параллельно с рендером, а кадр не ждёт загрузку, пока не начнёт использовать её результат.
+//Завершение отслеживается timeline семафором, на устройствах без него - забором на отправку
+class UploadQueue
+{
+public:
+    struct Config {
+        VkDevice device = VK_NULL_HANDLE;
+        VkQueue queue = VK_NULL_HANDLE;
+        uint32_t queueFamily = 0;
+        uint32_t graphicsFamily = 0;  //получатель владения буферами
+        bool timelineSemaphores = false;
+        VkDeviceSize stagingSize = 32ull << 20;
+    };
+
+    void init(const Config& config, DeviceAllocator& allocator);
+    void destroy(); //дожидается всех загрузок
+
+    //данные копируются в staging память до возврата; при нехватке места ждёт завершения старых загрузок.
+    //dstStage / dstAccess - как буфер будет использоваться на очереди графики
+    UploadTicket uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size,
+                              VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    bool isComplete(UploadTicket ticket);
+    void wait(UploadTicket ticket);
+
+    //записывает в буфер команд очереди графики захват владения для завершённых загрузок; возвращает
+    //наибольший захваченный номер (0 - ничего), отправка должна ждать timeline семафор на этом значении
+    uint64_t recordAcquires(VkCommandBuffer commandBuffer);
+
+    VkSemaphore getTimelineSemaphore() const { return _timeline; }
+    bool usesTimelineSemaphore() const { return _timeline != VK_NULL_HANDLE; }
+    bool isDedicatedFamily() const { return _queueFamily != _graphicsFamily; }
+
+private:
+    struct Submission {
+        uint64_t value;
+        VkCommandBuffer commandBuffer;
+        VkFence fence;        //только без timeline семафора
+        uint64_t stagingHead; //после завершения staging память до этой позиции свободна
+    };
+
+    //захват владения ждёт, пока загрузка не завершится
+    struct PendingAcquire {
+        uint64_t value;
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        VkPipelineStageFlags dstStage;
+        VkAccessFlags dstAccess;
+    };
+
+    uint64_t completedValue();
+    void reclaim();
+    void waitValue(uint64_t value);
+    VkCommandBuffer acquireCommandBuffer();
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VkQueue _queue = VK_NULL_HANDLE;
+    uint32_t _queueFamily = 0;
+    uint32_t _graphicsFamily = 0;
+
+    VkCommandPool _commandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> _freeCommandBuffers;
+    std::vector<VkFence> _freeFences;
+    VkSemaphore _timeline = VK_NULL_HANDLE;
+    PFN_vkWaitSemaphores _waitSemaphores = nullptr;
+    PFN_vkGetSemaphoreCounterValue _getSemaphoreCounterValue = nullptr;
+
+    StagingRing _staging;
+    std::mutex _mutex;
+    uint64_t _nextValue = 1;
+    uint64_t _completed = 0;
+    std::deque<Submission> _inFlight;
+    std::vector<PendingAcquire> _pendingAcquires;
+};
@@ -0,0 +1,111 @@
+#include "vertexLayout.h"
+
+#include <stdexcept>
+
+VkPipelineVertexInputStateCreateInfo VertexInputDescription::createInfo() const {
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+    return vertexInputInfo;
+}
+
+uint32_t VertexLayout::attributeSize(uint32_t location) {
+    return location == 3 ? 2 * sizeof(float) : 3 * sizeof(float);
+}
+
+VkFormat VertexLayout::attributeFormat(uint32_t location) {
+    return location == 3 ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R32G32B32_SFLOAT;
+}
+
+uint32_t VertexLayout::vertexSize() const {
+    uint32_t size = 0;
+    for(uint32_t location = 0; location < attributeCount; location++)
+        if(_attributes & (1u << location))
+            size += attributeSize(location);
+    return size;
+}
+
+VkDeviceSize VertexLayout::vertexDataSize(uint32_t vertexCount) const {
+    if(_interleaved)
+        return static_cast<VkDeviceSize>(vertexSize()) * vertexCount;
+
+    VkDeviceSize size = 0;
+    for(uint32_t location = 0; location < attributeCount; location++)
+        if(_attributes & (1u << location)) {
+            size += static_cast<VkDeviceSize>(attributeSize(location)) * vertexCount;
+            size = (size + streamAlignment - 1) / streamAlignment * streamAlignment;
+        }
+    return size;
+}
+
+VkDeviceSize VertexLayout::attributeOffset(uint32_t location, uint32_t vertexCount) const {
+    if(!(_attributes & (1u << location)))
+        throw std::runtime_error("Атрибута нет в расположении вершин");
+
+    VkDeviceSize offset = 0;
+    for(uint32_t i = 0; i < location; i++) {
+        if(!(_attributes & (1u << i)))
+            continue;
+        if(_interleaved) {
+            offset += attributeSize(i);
+        } else {
+            offset += static_cast<VkDeviceSize>(attributeSize(i)) * vertexCount;
+            offset = (offset + streamAlignment - 1) / streamAlignment * streamAlignment;
+        }
+    }
+    return offset;
+}
+
+VertexInputDescription VertexLayout::inputDescription(uint32_t used) const {
+    if(!has(used))
+        throw std::runtime_error("Шейдер читает атрибуты, которых нет в вершинном буфере");
+
+    VertexInputDescription description;
+    if(_interleaved) {
+        //одна привязка с полным шагом: неиспользуемые атрибуты просто пропускаются
+        VkVertexInputBindingDescription binding {};
+        binding.binding = 0;
+        binding.stride = vertexSize();
+        binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        description.bindings.push_back(binding);
+    }
+
+    for(uint32_t location = 0; location < attributeCount; location++) {
+        if(!(used & (1u << location)))
+            continue;
+
+        VkVertexInputAttributeDescription attribute {};
+        attribute.location = location;
+        attribute.format = attributeFormat(location);
+        if(_interleaved) {
+            attribute.binding = 0;
+            attribute.offset = static_cast<uint32_t>(attributeOffset(location, 0));
+        } else {
+            //привязка на поток, начало потока задаётся смещением в vkCmdBindVertexBuffers
+            VkVertexInputBindingDescription binding {};
+            binding.binding = static_cast<uint32_t>(description.bindings.size());
+            binding.stride = attributeSize(location);
+            binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+            description.bindings.push_back(binding);
+
+            attribute.binding = binding.binding;
+            attribute.offset = 0;
+        }
+        description.attributes.push_back(attribute);
+    }
+    return description;
+}
+
+std::vector<VkDeviceSize> VertexLayout::bindingOffsets(uint32_t used, uint32_t vertexCount, VkDeviceSize baseOffset) const {
+    if(_interleaved)
+        return { baseOffset };
+
+    std::vector<VkDeviceSize> offsets;
+    for(uint32_t location = 0; location < attributeCount; location++)
+        if(used & (1u << location))
+            offsets.push_back(baseOffset + attributeOffset(location, vertexCount));
+    return offsets;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+//атрибуты вершины; номер бита совпадает с layout(location) в шейдерах
+enum VertexAttribute : uint32_t {
+    VertexPosition = 1u << 0, //vec3
+    VertexNormal   = 1u << 1, //vec3
+    VertexColor    = 1u << 2, //vec3
+    VertexTexCoord = 1u << 3, //vec2
+};
+
+//описание входа вершинного шейдера для VkPipelineVertexInputStateCreateInfo
+struct VertexInputDescription {
+    std::vector<VkVertexInputBindingDescription> bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+
+    VkPipelineVertexInputStateCreateInfo createInfo() const; //указывает на векторы, описание должно жить до создания конвейера
+};
+
+//расположение атрибутов в вершинном буфере: чередующееся (одна структура на вершину) или
+//раздельные потоки (массив на атрибут). Из раздельных потоков проход глубины читает только позиции
+class VertexLayout
+{
+public:
+    static constexpr uint32_t attributeCount = 4;
+    static constexpr VkDeviceSize streamAlignment = 16;
+
+    VertexLayout() = default;
+    VertexLayout(uint32_t attributes, bool interleaved) : _attributes(attributes), _interleaved(interleaved) {}
+
+    static uint32_t attributeSize(uint32_t location);
+    static VkFormat attributeFormat(uint32_t location);
+
+    uint32_t getAttributes() const { return _attributes; }
+    bool isInterleaved() const { return _interleaved; }
+    bool has(uint32_t attributes) const { return (_attributes & attributes) == attributes; }
+
+    uint32_t vertexSize() const; //сумма размеров атрибутов (шаг чередующегося буфера)
+    VkDeviceSize vertexDataSize(uint32_t vertexCount) const;
+
+    //чередующийся: смещение атрибута внутри вершины; раздельный: смещение начала потока атрибута
+    VkDeviceSize attributeOffset(uint32_t location, uint32_t vertexCount) const;
+
+    //used - атрибуты, которые читает шейдер (подмножество атрибутов буфера)
+    VertexInputDescription inputDescription(uint32_t used) const;
+    //смещения для vkCmdBindVertexBuffers, по одному на привязку из inputDescription(used)
+    std::vector<VkDeviceSize> bindingOffsets(uint32_t used, uint32_t vertexCount, VkDeviceSize baseOffset) const;
+
+private:
+    uint32_t _attributes = VertexPosition;
+    bool _interleaved = true;
+};
@@ -0,0 +1,54 @@
+#include "vulkanHandle.h"
+
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace {
+    std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    //счётчики создаются при первом объекте своего типа, из любого потока
+    std::vector<const HandleCounter*>& registry() {
+        static std::vector<const HandleCounter*> counters;
+        return counters;
+    }
+}
+
+HandleCounter::HandleCounter(const char* name, HandleScope scope) : _name(name), _scope(scope) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    registry().push_back(this);
+}
+
+HandleCounter::~HandleCounter() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    auto& counters = registry();
+    counters.erase(std::remove(counters.begin(), counters.end(), this), counters.end());
+}
+
+int64_t HandleCounter::reportLeaks(HandleScope scope, std::ostream& out) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    int64_t total = 0;
+    for(const HandleCounter* counter : registry()) {
+        if(counter->_scope != scope || counter->live() == 0)
+            continue;
+        out << "Утечка: " << counter->live() << " x " << counter->_name << std::endl;
+        total += counter->live();
+    }
+    return total;
+}
+
+void VkDeviceTraits::destroy(Owner, Handle handle) {
+    if(HandleCounter::reportLeaks(HandleScope::Device, std::cerr) != 0)
+        std::cerr << "Объекты выше не уничтожены до vkDestroyDevice" << std::endl;
+    vkDestroyDevice(handle, nullptr);
+}
+
+void VkInstanceTraits::destroy(Owner, Handle handle) {
+    if(HandleCounter::reportLeaks(HandleScope::Instance, std::cerr) != 0)
+        std::cerr << "Объекты выше не уничтожены до vkDestroyInstance" << std::endl;
+    vkDestroyInstance(handle, nullptr);
+}
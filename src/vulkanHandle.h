@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vulkan/vulkan.h>
+
+#include "memoryAllocator.h"
+
+//чей дочерний объект: живые объекты уровня проверяются перед уничтожением владельца
+enum class HandleScope : uint8_t {
+    Root,     //экземпляр и устройство
+    Instance, //surface
+    Device,   //всё, что создаётся от VkDevice, и подвыделения памяти устройства
+};
+
+//число живых объектов одного типа.
+//Счётчики общие для процесса: отчёт об утечках верен, пока устройство (экземпляр) одно
+class HandleCounter
+{
+public:
+    HandleCounter(const char* name, HandleScope scope);
+    ~HandleCounter();
+
+    HandleCounter(const HandleCounter&) = delete;
+    HandleCounter& operator=(const HandleCounter&) = delete;
+
+    void add() { _live.fetch_add(1, std::memory_order_relaxed); }
+    void remove() { _live.fetch_sub(1, std::memory_order_relaxed); }
+    int64_t live() const { return _live.load(std::memory_order_relaxed); }
+
+    //живые объекты уровня scope по типам; возвращает их общее число
+    static int64_t reportLeaks(HandleScope scope, std::ostream& out);
+
+private:
+    const char* _name;
+    HandleScope _scope;
+    std::atomic<int64_t> _live { 0 };
+};
+
+//владеющая обёртка над объектом Vulkan: только перемещение, объект уничтожается в деструкторе или reset.
+//Traits задаёт Owner (через кого уничтожать), Handle, name, scope, isNull и destroy.
+//Неявно приводится к Handle, чтобы передаваться в вызовы Vulkan как есть
+template<typename Traits>
+class UniqueHandle
+{
+public:
+    using Owner = typename Traits::Owner;
+    using Handle = typename Traits::Handle;
+
+    UniqueHandle() = default;
+    UniqueHandle(Owner owner, Handle handle) : _owner(owner), _handle(handle) {
+        if(!Traits::isNull(_handle))
+            counter().add();
+    }
+    ~UniqueHandle() { reset(); }
+
+    UniqueHandle(const UniqueHandle&) = delete;
+    UniqueHandle& operator=(const UniqueHandle&) = delete;
+
+    UniqueHandle(UniqueHandle&& other) noexcept : _owner(other._owner), _handle(std::exchange(other._handle, Handle {})) {}
+    UniqueHandle& operator=(UniqueHandle&& other) noexcept {
+        if(this != &other) {
+            reset();
+            _owner = other._owner;
+            _handle = std::exchange(other._handle, Handle {});
+        }
+        return *this;
+    }
+
+    void reset() {
+        if(Traits::isNull(_handle))
+            return;
+        Traits::destroy(_owner, _handle);
+        counter().remove();
+        _handle = Handle {};
+    }
+
+    //владение переходит вызывающему, объект больше не учитывается
+    Handle release() {
+        if(!Traits::isNull(_handle))
+            counter().remove();
+        return std::exchange(_handle, Handle {});
+    }
+
+    const Handle& get() const { return _handle; }
+    const Handle* address() const { return &_handle; } //для полей pXxx структур Vulkan с одним объектом
+    operator const Handle&() const { return _handle; }
+
+private:
+    static HandleCounter& counter() {
+        static HandleCounter counter(Traits::name, Traits::scope);
+        return counter;
+    }
+
+    Owner _owner {};
+    Handle _handle {};
+};
+
+#define VULKANPROJECT_HANDLE_TRAITS(Type, OwnerType, Scope, destroyCall) \
+    struct Vk##Type##Traits { \
+        using Owner = OwnerType; \
+        using Handle = Vk##Type; \
+        static constexpr const char* name = "Vk" #Type; \
+        static constexpr HandleScope scope = Scope; \
+        static bool isNull(Handle handle) { return handle == VK_NULL_HANDLE; } \
+        static void destroy(Owner owner, Handle handle) { destroyCall; } \
+    }; \
+    using Unique##Type = UniqueHandle<Vk##Type##Traits>;
+
+#define VULKANPROJECT_DEVICE_HANDLE(Type) \
+    VULKANPROJECT_HANDLE_TRAITS(Type, VkDevice, HandleScope::Device, vkDestroy##Type(owner, handle, nullptr))
+
+VULKANPROJECT_DEVICE_HANDLE(Buffer)
+VULKANPROJECT_DEVICE_HANDLE(Image)
+VULKANPROJECT_DEVICE_HANDLE(ImageView)
+VULKANPROJECT_DEVICE_HANDLE(Sampler)
+VULKANPROJECT_DEVICE_HANDLE(Semaphore)
+VULKANPROJECT_DEVICE_HANDLE(Fence)
+VULKANPROJECT_DEVICE_HANDLE(CommandPool)
+VULKANPROJECT_DEVICE_HANDLE(DescriptorPool)
+VULKANPROJECT_DEVICE_HANDLE(DescriptorSetLayout)
+VULKANPROJECT_DEVICE_HANDLE(PipelineLayout)
+VULKANPROJECT_DEVICE_HANDLE(Pipeline)
+VULKANPROJECT_DEVICE_HANDLE(RenderPass)
+VULKANPROJECT_DEVICE_HANDLE(Framebuffer)
+VULKANPROJECT_DEVICE_HANDLE(SwapchainKHR)
+
+VULKANPROJECT_HANDLE_TRAITS(SurfaceKHR, VkInstance, HandleScope::Instance, vkDestroySurfaceKHR(owner, handle, nullptr))
+
+#undef VULKANPROJECT_DEVICE_HANDLE
+#undef VULKANPROJECT_HANDLE_TRAITS
+
+//перед уничтожением устройства и экземпляра сообщают о дочерних объектах, которые ещё живы (vulkanHandle.cpp)
+struct VkDeviceTraits {
+    using Owner = std::nullptr_t;
+    using Handle = VkDevice;
+    static constexpr const char* name = "VkDevice";
+    static constexpr HandleScope scope = HandleScope::Root;
+    static bool isNull(Handle handle) { return handle == VK_NULL_HANDLE; }
+    static void destroy(Owner, Handle handle);
+};
+using UniqueDevice = UniqueHandle<VkDeviceTraits>;
+
+struct VkInstanceTraits {
+    using Owner = std::nullptr_t;
+    using Handle = VkInstance;
+    static constexpr const char* name = "VkInstance";
+    static constexpr HandleScope scope = HandleScope::Root;
+    static bool isNull(Handle handle) { return handle == VK_NULL_HANDLE; }
+    static void destroy(Owner, Handle handle);
+};
+using UniqueInstance = UniqueHandle<VkInstanceTraits>;
+
+//подвыделение DeviceAllocator; аллокатор должен пережить все свои выделения
+struct AllocationTraits {
+    using Owner = DeviceAllocator*;
+    using Handle = Allocation;
+    static constexpr const char* name = "Allocation";
+    static constexpr HandleScope scope = HandleScope::Device;
+    static bool isNull(const Handle& allocation) { return allocation.memory == VK_NULL_HANDLE; }
+    static void destroy(Owner allocator, const Handle& allocation) { allocator->free(allocation); }
+};
+using UniqueAllocation = UniqueHandle<AllocationTraits>;
+
+//буфер с памятью; память освобождается после уничтожения буфера
+struct AllocatedBuffer {
+    UniqueAllocation allocation;
+    UniqueBuffer buffer;
+
+    operator VkBuffer() const { return buffer; }
+};
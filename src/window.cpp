@@ -8,6 +8,33 @@ void Window::init()
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     window = glfwCreateWindow(1280, 720, "vulkanproj", nullptr, nullptr);
+
+    glfwSetWindowUserPointer(window, this);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+}
+
+void Window::framebufferSizeCallback(GLFWwindow* window, int width, int height)
+{
+    static_cast<Window*>(glfwGetWindowUserPointer(window))->_resized = true;
+}
+
+bool Window::consumeResize()
+{
+    bool resized = _resized;
+    _resized = false;
+    return resized;
+}
+
+bool Window::isMinimized()
+{
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    return width == 0 || height == 0;
+}
+
+void Window::waitEvents()
+{
+    glfwWaitEvents();
 }
 
 void Window::pollEvents()
@@ -27,6 +54,9 @@ bool Window::isShouldClose()
 
 Window::~Window()
 {
+    if(window == nullptr) //окно не создавалось (headless режим)
+        return;
+
     glfwDestroyWindow(window);
     glfwTerminate();
 }
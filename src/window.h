@@ -12,7 +12,15 @@ public:
     void swapBuffers();
     bool isShouldClose();
     GLFWwindow* getWindow();
+
+    //размер фреймбуфера изменился с прошлого вызова (флаг сбрасывается)
+    bool consumeResize();
+    bool isMinimized(); //свёрнутое окно имеет фреймбуфер 0x0, рисовать в него нельзя
+    void waitEvents();  //блокирует до следующего события, чтобы свёрнутое окно не крутило цикл впустую
     ~Window();
 private:
-    GLFWwindow* window;
+    static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+
+    GLFWwindow* window = nullptr;
+    bool _resized = false;
 };
\ No newline at end of file
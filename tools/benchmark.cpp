@@ -0,0 +1,242 @@
+//замеры vulkanproject без окна: инициализация экземпляра и устройства, загрузка шейдеров и создание конвейера
+//с холодным и тёплым кэшем конвейеров, пропускная способность загрузок по размеру передачи и кадры в секунду
+//в зависимости от числа объектов, обновление иерархии преобразований по числу потоков. Каждый замер повторяется, в JSON пишется статистика по повторам:
+//файлы двух версий рендера сравниваются по median и p95.
+//использование: vulkanproject_bench [--output=bench.json] [--samples=5] [--frames=60] [--draws=1,100,1000,10000]
+//                                   [--nodes=1000000] [--threads=1,2,4,8]
+//                                   [--shaders=../shaders] [--cache=.] [--width=640] [--height=360] [--any-device]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+
+#include "../src/app.h"
+#include "../src/log.h"
+#include "benchmarkResults.h"
+
+#ifndef VULKANPROJECT_BUILD_TYPE
+#define VULKANPROJECT_BUILD_TYPE ""
+#endif
+
+struct Options {
+    std::string output;                  //пусто - stdout
+    uint32_t samples = 5;                //запусков инициализации на замер
+    uint32_t frames = 60;                //кадров и загрузок на замер
+    std::vector<uint32_t> draws = { 1, 100, 1000, 10000 };
+    uint32_t nodes = 1000000;            //узлов иерархии преобразований
+    std::vector<uint32_t> threads;       //пусто - степени двойки до числа аппаратных потоков
+    std::string shaderDirectory = "../shaders";
+    std::string cacheDirectory = ".";    //файл кэша конвейеров удаляется перед холодными запусками
+    uint32_t width = 640;
+    uint32_t height = 360;
+    bool anyDevice = false;              //по умолчанию предпочитается программное устройство (lavapipe)
+};
+
+using bench::Metric;
+using bench::metric;
+
+namespace {
+    const uint32_t warmupFrames = 5;
+    const VkDeviceSize uploadSizes[] = { 4ull << 10, 64ull << 10, 1ull << 20, 16ull << 20 };
+
+    std::vector<uint32_t> parseList(const std::string& text) {
+        std::vector<uint32_t> values;
+        std::stringstream stream(text);
+        std::string item;
+        while(std::getline(stream, item, ','))
+            if(!item.empty())
+                values.push_back(static_cast<uint32_t>(std::stoul(item)));
+        return values;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void configure(Application& app, const Options& options) {
+        app.setShaderDirectory(options.shaderDirectory);
+        app.setPipelineCacheDirectory(options.cacheDirectory);
+        if(!options.anyDevice)
+            app.preferDeviceType(VK_PHYSICAL_DEVICE_TYPE_CPU);
+    }
+}
+
+Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&arg](const char* prefix) { return arg.substr(std::strlen(prefix)); };
+        if(arg.rfind("--output=", 0) == 0)
+            options.output = value("--output=");
+        else if(arg.rfind("--samples=", 0) == 0)
+            options.samples = std::max(1u, static_cast<uint32_t>(std::stoul(value("--samples="))));
+        else if(arg.rfind("--frames=", 0) == 0)
+            options.frames = std::max(1u, static_cast<uint32_t>(std::stoul(value("--frames="))));
+        else if(arg.rfind("--draws=", 0) == 0)
+            options.draws = parseList(value("--draws="));
+        else if(arg.rfind("--nodes=", 0) == 0)
+            options.nodes = static_cast<uint32_t>(std::stoul(value("--nodes=")));
+        else if(arg.rfind("--threads=", 0) == 0)
+            options.threads = parseList(value("--threads="));
+        else if(arg.rfind("--shaders=", 0) == 0)
+            options.shaderDirectory = value("--shaders=");
+        else if(arg.rfind("--cache=", 0) == 0)
+            options.cacheDirectory = value("--cache=");
+        else if(arg.rfind("--width=", 0) == 0)
+            options.width = static_cast<uint32_t>(std::stoul(value("--width=")));
+        else if(arg.rfind("--height=", 0) == 0)
+            options.height = static_cast<uint32_t>(std::stoul(value("--height=")));
+        else if(arg == "--any-device")
+            options.anyDevice = true;
+        else
+            std::cerr << "Неизвестный аргумент: " << arg << std::endl;
+    }
+    return options;
+}
+
+//запуски инициализации: сначала с удалённым файлом кэша конвейеров, затем с сохранённым предыдущим запуском
+void benchmarkInit(const Options& options, std::vector<Metric>& metrics, VkPhysicalDeviceProperties& properties)
+{
+    std::string cachePath;
+    { //первый запуск не считается: загрузка драйвера и файлов шейдеров в кэш ОС
+        Application app{};
+        configure(app, options);
+        app.initHeadless(options.width, options.height);
+        properties = app.getDeviceProperties();
+        cachePath = app.getPipelineCachePath();
+    }
+
+    for(const char* phase : { "cold", "warm" }) {
+        const bool cold = std::strcmp(phase, "cold") == 0;
+        for(uint32_t i = 0; i < options.samples; i++) {
+            if(cold)
+                std::remove(cachePath.c_str());
+
+            Application app{};
+            configure(app, options);
+            app.initHeadless(options.width, options.height);
+
+            const InitGraph& graph = app.getInitGraph();
+            metric(metrics, "init.instance", "ms").samples.push_back(graph.getTaskMilliseconds("baseInit"));
+            metric(metrics, "init.physicalDevice", "ms").samples.push_back(graph.getTaskMilliseconds("physicalDeviceInit"));
+            metric(metrics, "init.device", "ms").samples.push_back(graph.getTaskMilliseconds("logicalDeviceInit"));
+            metric(metrics, "init.total", "ms").samples.push_back(graph.getWallMilliseconds());
+            metric(metrics, std::string("shaders.") + phase, "ms").samples.push_back(
+                graph.getTaskMilliseconds("shader.vert") + graph.getTaskMilliseconds("shader.frag"));
+            metric(metrics, std::string("pipeline.") + phase, "ms").samples.push_back(
+                graph.getTaskMilliseconds("graphicsPipelineInit"));
+        } //деструктор сохраняет кэш: последний холодный запуск готовит файл для тёплых
+    }
+}
+
+void benchmarkUploads(const Options& options, std::vector<Metric>& metrics)
+{
+    Application app{};
+    configure(app, options);
+    app.initHeadless(options.width, options.height);
+
+    for(VkDeviceSize size : uploadSizes) {
+        Metric& bandwidth = metric(metrics, "upload." + std::to_string(size), "MiB/s");
+        for(double milliseconds : app.benchmarkUploads(size, options.frames))
+            bandwidth.samples.push_back(size / double(1 << 20) / (milliseconds / 1000.0));
+    }
+}
+
+//время drawFrame в установившемся режиме ограничено забором слота, то есть темпом GPU
+void benchmarkFrames(const Options& options, std::vector<Metric>& metrics)
+{
+    for(uint32_t draws : options.draws) {
+        Application app{};
+        configure(app, options);
+        app.setDrawCount(draws);
+        app.initHeadless(options.width, options.height);
+
+        for(uint32_t i = 0; i < warmupFrames; i++)
+            app.drawFrame();
+
+        Metric& fps = metric(metrics, "frame.draws" + std::to_string(draws), "fps");
+        for(uint32_t i = 0; i < options.frames; i++) {
+            auto start = std::chrono::steady_clock::now();
+            app.drawFrame();
+            fps.samples.push_back(1000.0 / millisecondsSince(start));
+        }
+    }
+}
+
+//полный пересчёт (меняются корни) и точечные изменения 1% узлов; масштабирование - отношение медиан по потокам
+void benchmarkTransforms(const Options& options, std::vector<Metric>& metrics)
+{
+    std::vector<uint32_t> threads = options.threads;
+    if(threads.empty()) {
+        const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+        for(uint32_t count = 1; count < hardware; count *= 2)
+            threads.push_back(count);
+        threads.push_back(hardware);
+    }
+
+    Application app{};
+    configure(app, options);
+    app.initHeadless(options.width, options.height);
+
+    for(uint32_t count : threads) {
+        metric(metrics, "transforms.full.threads" + std::to_string(count), "ms").samples =
+            app.benchmarkTransforms(options.nodes, count, 0, options.frames);
+        metric(metrics, "transforms.partial.threads" + std::to_string(count), "ms").samples =
+            app.benchmarkTransforms(options.nodes, count, std::max(1u, options.nodes / 100), options.frames);
+    }
+}
+
+void writeJson(std::ostream& out, const Options& options, const VkPhysicalDeviceProperties& properties,
+               const std::vector<Metric>& metrics)
+{
+    out << std::setprecision(6);
+    out << "{\n  \"schema\": 1,\n  \"buildType\": \"" << VULKANPROJECT_BUILD_TYPE << "\",\n";
+    bench::writeDevice(out, properties);
+    out << ",\n";
+    out << "  \"config\": {\"samples\": " << options.samples << ", \"frames\": " << options.frames
+        << ", \"width\": " << options.width << ", \"height\": " << options.height << ", \"nodes\": " << options.nodes << "},\n";
+    bench::writeResults(out, metrics);
+    out << "\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    Options options = parseOptions(argc, argv);
+    //JSON может идти в stdout: ход инициализации не выводится
+    utils::setVerbosity(utils::Verbosity::Quiet);
+    //дисковый кэш шейдеров Mesa сделал бы холодный запуск тёплым: сравниваем только VkPipelineCache
+    setenv("MESA_SHADER_CACHE_DISABLE", "true", 0);
+
+    std::vector<Metric> metrics;
+    VkPhysicalDeviceProperties properties {};
+    try {
+        benchmarkInit(options, metrics, properties);
+        benchmarkUploads(options, metrics);
+        benchmarkFrames(options, metrics);
+        benchmarkTransforms(options, metrics);
+    } catch(const std::exception& error) {
+        std::cerr << "Замер прерван: " << error.what() << std::endl;
+        return 1;
+    }
+
+    if(options.output.empty()) {
+        writeJson(std::cout, options, properties, metrics);
+        return 0;
+    }
+
+    std::ofstream file(options.output);
+    writeJson(file, options, properties, metrics);
+    std::cerr << "Результаты сохранены в " << options.output << std::endl;
+    return 0;
+}
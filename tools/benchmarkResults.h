@@ -0,0 +1,112 @@
+#pragma once
+
+//статистика повторов и JSON результатов, общие для vulkanproject_bench и vulkanproject_replay:
+//файлы обоих сравниваются одними средствами по median и p95
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <vulkan/vulkan.h>
+
+namespace bench {
+    //один замер: повторы в единицах unit
+    struct Metric {
+        std::string name;
+        std::string unit;
+        std::vector<double> samples;
+    };
+
+    struct Summary {
+        double min = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+        double median = 0.0;
+        double p95 = 0.0;
+        double stddev = 0.0;
+    };
+
+    //ближайший ранг по отсортированным повторам
+    inline double percentile(const std::vector<double>& sorted, double p) {
+        size_t index = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::min(std::max<size_t>(index, 1), sorted.size()) - 1];
+    }
+
+    inline Summary summarize(std::vector<double> samples) {
+        Summary summary;
+        if(samples.empty())
+            return summary;
+
+        std::sort(samples.begin(), samples.end());
+        summary.min = samples.front();
+        summary.max = samples.back();
+        summary.median = samples.size() % 2 ? samples[samples.size() / 2]
+                                            : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2.0;
+        summary.p95 = percentile(samples, 0.95);
+
+        double sum = 0.0;
+        for(double sample : samples)
+            sum += sample;
+        summary.mean = sum / samples.size();
+
+        double squares = 0.0;
+        for(double sample : samples)
+            squares += (sample - summary.mean) * (sample - summary.mean);
+        summary.stddev = samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1)) : 0.0;
+        return summary;
+    }
+
+    inline std::string escapeJson(const std::string& text) {
+        std::string escaped;
+        for(char c : text) {
+            if(c == '"' || c == '\\')
+                escaped += '\\';
+            if(static_cast<unsigned char>(c) < 0x20)
+                continue;
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    inline const char* deviceTypeName(VkPhysicalDeviceType type) {
+        switch(type) {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+            case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+            default: return "other";
+        }
+    }
+
+    inline Metric& metric(std::vector<Metric>& metrics, const std::string& name, const char* unit) {
+        for(auto& existing : metrics)
+            if(existing.name == name)
+                return existing;
+        metrics.push_back({ name, unit, {} });
+        return metrics.back();
+    }
+
+    //поле "device" без завершающей запятой
+    inline void writeDevice(std::ostream& out, const VkPhysicalDeviceProperties& properties) {
+        out << "  \"device\": {\"name\": \"" << escapeJson(properties.deviceName) << "\", \"type\": \""
+            << deviceTypeName(properties.deviceType) << "\", \"vendorID\": " << properties.vendorID
+            << ", \"deviceID\": " << properties.deviceID << ", \"driverVersion\": " << properties.driverVersion
+            << ", \"apiVersion\": \"" << VK_VERSION_MAJOR(properties.apiVersion) << "." << VK_VERSION_MINOR(properties.apiVersion)
+            << "." << VK_VERSION_PATCH(properties.apiVersion) << "\"}";
+    }
+
+    //поле "results" без завершающей запятой
+    inline void writeResults(std::ostream& out, const std::vector<Metric>& metrics) {
+        out << "  \"results\": [";
+        for(size_t i = 0; i < metrics.size(); i++) {
+            const Metric& result = metrics[i];
+            Summary summary = summarize(result.samples);
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << result.name << "\", \"unit\": \"" << result.unit
+                << "\", \"samples\": " << result.samples.size() << ", \"min\": " << summary.min
+                << ", \"median\": " << summary.median << ", \"mean\": " << summary.mean << ", \"p95\": " << summary.p95
+                << ", \"max\": " << summary.max << ", \"stddev\": " << summary.stddev << "}";
+        }
+        out << "\n  ]";
+    }
+}
@@ -0,0 +1,282 @@
+//конвертер OBJ -> .vmesh: разбор текста делается один раз офлайн, приложение только отображает файл в память
+//использование: vulkanproject_meshconv input.obj output.vmesh [--split] [--normalize]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include "../src/meshFile.h"
+
+struct ObjIndex {
+    int position, texCoord, normal;
+
+    bool operator==(const ObjIndex& other) const {
+        return position == other.position && texCoord == other.texCoord && normal == other.normal;
+    }
+};
+
+struct ObjIndexHash {
+    size_t operator()(const ObjIndex& index) const {
+        uint64_t hash = 1469598103934665603ull;
+        for(int value : { index.position, index.texCoord, index.normal })
+            hash = (hash ^ static_cast<uint32_t>(value)) * 1099511628211ull;
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct Vertex {
+    float position[3];
+    float normal[3];
+    float color[3];
+    float texCoord[2];
+};
+
+struct ObjMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<meshformat::Submesh> submeshes;
+    bool hasNormals = false;
+    bool hasTexCoords = false;
+};
+
+//индекс OBJ: с единицы, отрицательный - от конца списка, 0 - отсутствует
+int resolveIndex(const std::string& token, size_t count) {
+    if(token.empty())
+        return -1;
+    int index = std::stoi(token);
+    return index < 0 ? static_cast<int>(count) + index : index - 1;
+}
+
+ObjMesh loadObj(const std::string& path) {
+    std::ifstream file(path);
+    if(!file.is_open())
+        throw std::runtime_error("Не удалось открыть " + path);
+
+    std::vector<float> positions, colors, normals, texCoords;
+    std::unordered_map<ObjIndex, uint32_t, ObjIndexHash> vertexMap;
+    ObjMesh mesh;
+    bool hasColors = false;
+
+    auto startSubmesh = [&mesh]() {
+        if(!mesh.submeshes.empty() && mesh.submeshes.back().indexCount == 0)
+            return;
+        meshformat::Submesh submesh {};
+        submesh.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+        submesh.material = static_cast<uint32_t>(mesh.submeshes.size());
+        mesh.submeshes.push_back(submesh);
+    };
+    startSubmesh();
+
+    std::string line;
+    while(std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string type;
+        stream >> type;
+
+        if(type == "v") {
+            float value[6] = { 0, 0, 0, 1, 1, 1 };
+            int count = 0;
+            while(count < 6 && stream >> value[count])
+                count++;
+            positions.insert(positions.end(), value, value + 3);
+            colors.insert(colors.end(), value + 3, value + 6);
+            hasColors |= count == 6; //расширение "v x y z r g b"
+        } else if(type == "vn") {
+            float value[3] = {};
+            stream >> value[0] >> value[1] >> value[2];
+            normals.insert(normals.end(), value, value + 3);
+        } else if(type == "vt") {
+            float value[2] = {};
+            stream >> value[0] >> value[1];
+            texCoords.push_back(value[0]);
+            texCoords.push_back(1.0f - value[1]); //в Vulkan v растёт вниз
+        } else if(type == "o" || type == "g" || type == "usemtl") {
+            startSubmesh();
+        } else if(type == "f") {
+            std::vector<uint32_t> face;
+            std::string token;
+            while(stream >> token) {
+                std::string parts[3];
+                size_t part = 0;
+                for(char c : token) {
+                    if(c == '/') { if(++part > 2) break; }
+                    else parts[part] += c;
+                }
+
+                ObjIndex index { resolveIndex(parts[0], positions.size() / 3),
+                                 resolveIndex(parts[1], texCoords.size() / 2),
+                                 resolveIndex(parts[2], normals.size() / 3) };
+                if(index.position < 0 || static_cast<size_t>(index.position) >= positions.size() / 3)
+                    throw std::runtime_error("Индекс позиции вне диапазона: " + line);
+
+                auto found = vertexMap.find(index);
+                if(found == vertexMap.end()) {
+                    Vertex vertex {};
+                    std::memcpy(vertex.position, &positions[index.position * 3], sizeof(vertex.position));
+                    std::memcpy(vertex.color, &colors[index.position * 3], sizeof(vertex.color));
+                    if(index.normal >= 0 && static_cast<size_t>(index.normal) < normals.size() / 3) {
+                        std::memcpy(vertex.normal, &normals[index.normal * 3], sizeof(vertex.normal));
+                        mesh.hasNormals = true;
+                    }
+                    if(index.texCoord >= 0 && static_cast<size_t>(index.texCoord) < texCoords.size() / 2) {
+                        std::memcpy(vertex.texCoord, &texCoords[index.texCoord * 2], sizeof(vertex.texCoord));
+                        mesh.hasTexCoords = true;
+                    }
+                    found = vertexMap.emplace(index, static_cast<uint32_t>(mesh.vertices.size())).first;
+                    mesh.vertices.push_back(vertex);
+                }
+                face.push_back(found->second);
+            }
+
+            //многоугольник разбивается веером
+            for(size_t i = 2; i < face.size(); i++) {
+                mesh.indices.insert(mesh.indices.end(), { face[0], face[i - 1], face[i] });
+                mesh.submeshes.back().indexCount += 3;
+            }
+        }
+    }
+
+    mesh.submeshes.erase(std::remove_if(mesh.submeshes.begin(), mesh.submeshes.end(),
+                                        [](const meshformat::Submesh& submesh) { return submesh.indexCount == 0; }),
+                         mesh.submeshes.end());
+
+    //без цветов в файле раскрашиваем по нормали, чтобы форма была видна без освещения
+    if(!hasColors && mesh.hasNormals) {
+        for(auto& vertex : mesh.vertices)
+            for(int i = 0; i < 3; i++)
+                vertex.color[i] = vertex.normal[i] * 0.5f + 0.5f;
+    }
+    return mesh;
+}
+
+void computeBounds(const ObjMesh& mesh, uint32_t first, uint32_t count, float* boundsMin, float* boundsMax) {
+    for(int i = 0; i < 3; i++) {
+        boundsMin[i] = count ? INFINITY : 0.0f;
+        boundsMax[i] = count ? -INFINITY : 0.0f;
+    }
+    for(uint32_t i = first; i < first + count; i++) {
+        const Vertex& vertex = mesh.vertices[mesh.indices[i]];
+        for(int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = std::min(boundsMin[axis], vertex.position[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], vertex.position[axis]);
+        }
+    }
+}
+
+//вписывает меш в видимый объём без камеры: x, y в [-0.9, 0.9], z в [0.1, 0.9]
+void normalize(ObjMesh& mesh) {
+    float boundsMin[3], boundsMax[3];
+    computeBounds(mesh, 0, static_cast<uint32_t>(mesh.indices.size()), boundsMin, boundsMax);
+
+    float extent = 0.0f;
+    for(int axis = 0; axis < 3; axis++)
+        extent = std::max(extent, boundsMax[axis] - boundsMin[axis]);
+    if(extent <= 0.0f)
+        return;
+
+    const float scale = 1.8f / extent;
+    for(auto& vertex : mesh.vertices) {
+        for(int axis = 0; axis < 3; axis++)
+            vertex.position[axis] = (vertex.position[axis] - (boundsMin[axis] + boundsMax[axis]) * 0.5f) * scale;
+        vertex.position[2] = vertex.position[2] * (0.8f / 1.8f) + 0.5f;
+    }
+}
+
+//раскладывает вершины в расположение layout
+std::vector<uint8_t> packVertices(const ObjMesh& mesh, const VertexLayout& layout) {
+    const uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    std::vector<uint8_t> data(layout.vertexDataSize(vertexCount));
+
+    for(uint32_t location = 0; location < VertexLayout::attributeCount; location++) {
+        if(!layout.has(1u << location))
+            continue;
+
+        const uint32_t size = VertexLayout::attributeSize(location);
+        const uint64_t base = layout.attributeOffset(location, vertexCount);
+        const uint64_t stride = layout.isInterleaved() ? layout.vertexSize() : size;
+        for(uint32_t i = 0; i < vertexCount; i++) {
+            const Vertex& vertex = mesh.vertices[i];
+            const float* source = location == 0 ? vertex.position
+                                : location == 1 ? vertex.normal
+                                : location == 2 ? vertex.color
+                                : vertex.texCoord;
+            std::memcpy(&data[base + i * stride], source, size);
+        }
+    }
+    return data;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    bool split = false;
+    bool normalizeMesh = false;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--split")
+            split = true;
+        else if(arg == "--normalize")
+            normalizeMesh = true;
+        else
+            paths.push_back(arg);
+    }
+
+    if(paths.size() != 2) {
+        std::cerr << "Использование: " << argv[0] << " input.obj output.vmesh [--split] [--normalize]" << std::endl;
+        std::cerr << "  --split      раздельные потоки атрибутов вместо чередующихся вершин" << std::endl;
+        std::cerr << "  --normalize  вписать меш в видимый объём" << std::endl;
+        return 1;
+    }
+
+    try {
+        ObjMesh mesh = loadObj(paths[0]);
+        if(normalizeMesh)
+            normalize(mesh);
+
+        uint32_t attributes = VertexPosition | VertexColor;
+        if(mesh.hasNormals)
+            attributes |= VertexNormal;
+        if(mesh.hasTexCoords)
+            attributes |= VertexTexCoord;
+
+        MeshData data;
+        data.layout = VertexLayout(attributes, !split);
+        data.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        data.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+        std::vector<uint8_t> vertices = packVertices(mesh, data.layout);
+        data.vertices = vertices.data();
+        data.verticesSize = vertices.size();
+
+        std::vector<uint16_t> indices16;
+        if(data.vertexCount <= UINT16_MAX + 1u) { //вдвое меньше памяти и пропускной способности на индексы
+            indices16.assign(mesh.indices.begin(), mesh.indices.end());
+            data.indexType = VK_INDEX_TYPE_UINT16;
+            data.indices = indices16.data();
+            data.indicesSize = indices16.size() * sizeof(uint16_t);
+        } else {
+            data.indexType = VK_INDEX_TYPE_UINT32;
+            data.indices = mesh.indices.data();
+            data.indicesSize = mesh.indices.size() * sizeof(uint32_t);
+        }
+
+        for(auto& submesh : mesh.submeshes)
+            computeBounds(mesh, submesh.firstIndex, submesh.indexCount, submesh.boundsMin, submesh.boundsMax);
+        data.submeshes = mesh.submeshes;
+        computeBounds(mesh, 0, data.indexCount, data.boundsMin, data.boundsMax);
+
+        utils::writeMesh(paths[1], data);
+        std::cout << paths[1] << ": " << data.vertexCount << " вершин, " << data.indexCount / 3 << " треугольников, "
+                  << data.submeshes.size() << " подсеток, " << (split ? "раздельные потоки" : "чередующиеся вершины")
+                  << std::endl;
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
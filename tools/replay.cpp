@@ -0,0 +1,313 @@
+//воспроизведение захвата кадров (.vcap, vulkanproject --capture=) без окна на любом устройстве Vulkan, в том числе
+//программном. Меш, текстуры и SPIR-V берутся из захвата, кадры повторяются с теми же матрицами, спрайтами и размером
+//сцены; приложение создаётся заново на каждый повтор, поэтому загрузка уровней текстур идёт так же, как при захвате.
+//Команды первого повтора сверяются с захваченными. Время CPU и GPU замеряемых кадров по повторам пишется в JSON
+//в формате vulkanproject_bench: файлы двух версий рендера сравниваются по median и p95.
+//--hash считает хэш каждого замеряемого кадра и сверяет с эталоном из захвата; чтение кадра ждёт GPU,
+//поэтому время сравнимо только между запусками с --hash. --store-hashes записывает хэши в захват как эталон.
+//использование: vulkanproject_replay <capture.vcap> [--output=replay.json] [--repeat=3] [--hash] [--store-hashes]
+//                                    [--shaders=<директория>] [--work=<директория>] [--cache=.] [--any-device]
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+
+#include "../src/app.h"
+#include "../src/log.h"
+#include "../src/frameCapture.h"
+#include "benchmarkResults.h"
+
+#ifndef VULKANPROJECT_BUILD_TYPE
+#define VULKANPROJECT_BUILD_TYPE ""
+#endif
+
+struct Options {
+    std::string capture;
+    std::string output;         //пусто - stdout
+    uint32_t repeat = 3;        //запусков всей последовательности кадров
+    bool hash = false;
+    bool storeHashes = false;   //эталонные хэши в файл захвата
+    std::string shaderDirectory; //пусто - SPIR-V из захвата (нет в захвате - ../shaders)
+    std::string workDirectory;  //ресурсы захвата в виде файлов; пусто - <capture>.files
+    std::string cacheDirectory = ".";
+    bool anyDevice = false;     //по умолчанию предпочитается программное устройство (lavapipe)
+};
+
+//файлы, из которых приложение загружает ресурсы захвата
+struct ReplayFiles {
+    std::string mesh; //пусто - встроенный треугольник
+    std::vector<std::string> textures;
+    std::string shaderDirectory;
+};
+
+//первый повтор: расхождения с захватом
+struct Divergence {
+    uint32_t frames = 0;
+    uint64_t firstFrame = 0;
+    bool pipelines = true; //варианты конвейеров совпали
+    uint32_t hashMismatches = 0;
+};
+
+using bench::Metric;
+using bench::metric;
+
+namespace {
+    void writeFile(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if(!file)
+            throw std::runtime_error("Ошибка записи файла: " + path.string());
+    }
+
+    //текстуры нумеруются: пути захвата могут совпадать по имени файла
+    ReplayFiles extractResources(const FrameCapture& capture, const Options& options) {
+        const std::filesystem::path directory = options.workDirectory.empty() ? options.capture + ".files" : options.workDirectory;
+        std::filesystem::create_directories(directory / "shaders");
+
+        ReplayFiles files;
+        files.shaderDirectory = options.shaderDirectory;
+        bool capturedShaders = false;
+        for(const auto& resource : capture.getResources()) {
+            std::filesystem::path path;
+            switch(resource.type) {
+                case CaptureResourceType::Mesh:
+                    path = directory / "mesh.vmesh";
+                    files.mesh = path.string();
+                    break;
+                case CaptureResourceType::Texture:
+                    path = directory / ("texture" + std::to_string(files.textures.size()) + ".ktx2");
+                    files.textures.push_back(path.string());
+                    break;
+                case CaptureResourceType::Shader:
+                    if(!options.shaderDirectory.empty()) //шейдеры текущей версии вместо захваченных
+                        continue;
+                    path = directory / "shaders" / (resource.name + ".spv");
+                    capturedShaders = true;
+                    break;
+                default:
+                    continue;
+            }
+            writeFile(path, resource.data);
+        }
+        if(files.shaderDirectory.empty())
+            files.shaderDirectory = capturedShaders ? (directory / "shaders").string() : "../shaders";
+        return files;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void configure(Application& app, const FrameCapture& capture, const ReplayFiles& files, const Options& options) {
+        const CaptureConfig& config = capture.getConfig();
+        app.setFramesInFlight(config.framesInFlight);
+        app.setShaderDirectory(files.shaderDirectory);
+        app.setPipelineCacheDirectory(options.cacheDirectory);
+        app.setMeshPath(files.mesh);
+        for(const auto& texture : files.textures)
+            app.addTexture(texture);
+        app.setTextureBudget(config.textureBudget);
+        if(config.spriteCapacity > 0)
+            app.enableSprites(config.spriteCapacity);
+        if(config.sceneScaling) //размер сцены задаётся каждому кадру, цель времени не используется
+            app.setDynamicResolution(1000.0, 0.05f);
+        app.setMsaaSamples(config.samples);
+        app.setDrawCount(config.drawCount);
+        app.setCullingMode(config.gpuCulling ? CullingMode::Auto : CullingMode::Cpu);
+        app.setDescriptorModel(static_cast<DescriptorModel>(config.descriptorModel));
+        if(!options.anyDevice)
+            app.preferDeviceType(VK_PHYSICAL_DEVICE_TYPE_CPU);
+    }
+
+    //фактические настройки устройства воспроизведения могут отличаться: тогда команды не совпадут
+    void checkConfig(const Application& app, const FrameCapture& capture) {
+        const CaptureConfig& config = capture.getConfig();
+        if(app.getMsaaSamples() != config.samples)
+            std::cerr << "MSAA x" << app.getMsaaSamples() << " вместо x" << config.samples << " захвата" << std::endl;
+        if(app.isGpuCulling() != config.gpuCulling)
+            std::cerr << "Отсечение на " << (app.isGpuCulling() ? "GPU" : "CPU") << ", при захвате - на "
+                      << (config.gpuCulling ? "GPU" : "CPU") << std::endl;
+    }
+}
+
+Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&arg](const char* prefix) { return arg.substr(std::strlen(prefix)); };
+        if(arg.rfind("--output=", 0) == 0)
+            options.output = value("--output=");
+        else if(arg.rfind("--repeat=", 0) == 0)
+            options.repeat = std::max(1u, static_cast<uint32_t>(std::stoul(value("--repeat="))));
+        else if(arg == "--hash")
+            options.hash = true;
+        else if(arg == "--store-hashes")
+            options.hash = options.storeHashes = true;
+        else if(arg.rfind("--shaders=", 0) == 0)
+            options.shaderDirectory = value("--shaders=");
+        else if(arg.rfind("--work=", 0) == 0)
+            options.workDirectory = value("--work=");
+        else if(arg.rfind("--cache=", 0) == 0)
+            options.cacheDirectory = value("--cache=");
+        else if(arg == "--any-device")
+            options.anyDevice = true;
+        else if(arg.rfind("--", 0) != 0 && options.capture.empty())
+            options.capture = arg;
+        else
+            std::cerr << "Неизвестный аргумент: " << arg << std::endl;
+    }
+    return options;
+}
+
+//один повтор всей последовательности; хэши и сверка команд - только в первом
+void replay(FrameCapture& capture, const ReplayFiles& files, const Options& options, uint32_t repetition,
+            std::vector<Metric>& metrics, Divergence& divergence, VkPhysicalDeviceProperties& properties)
+{
+    const std::vector<CaptureFrame>& frames = capture.getFrames();
+    uint64_t firstMeasured = frames.size();
+    for(const auto& frame : frames)
+        if(frame.measured) {
+            firstMeasured = frame.number;
+            break;
+        }
+    if(firstMeasured >= frames.size()) //все кадры ушли на прогрев: пустой захват отклонил бы configure с чужой причиной
+        throw std::runtime_error("После прогрева не осталось кадров для замера");
+
+    FrameCapture replayed;
+    FrameCapture::Config replayConfig;
+    replayConfig.firstFrame = firstMeasured;
+    replayConfig.frameCount = static_cast<uint32_t>(frames.size() - firstMeasured);
+    replayConfig.resources = false;
+    replayed.configure(replayConfig);
+
+    Application app{};
+    configure(app, capture, files, options);
+    app.setCapture(&replayed);
+    app.initHeadless(capture.getConfig().width, capture.getConfig().height);
+    properties = app.getDeviceProperties();
+    if(repetition == 0)
+        checkConfig(app, capture);
+
+    Metric& total = metric(metrics, "replay.cpu", "ms");
+    std::vector<uint8_t> pixels;
+    auto sequenceStart = std::chrono::steady_clock::now();
+    for(const auto& frame : frames) {
+        app.setViewProjection(frame.viewProjection);
+        if(capture.getConfig().sceneScaling)
+            app.setSceneExtent(frame.sceneExtent);
+        for(const auto& sprite : frame.sprites)
+            app.getSprites().draw(sprite);
+
+        auto start = std::chrono::steady_clock::now();
+        app.drawFrame();
+        const double milliseconds = millisecondsSince(start);
+        if(!frame.measured)
+            continue;
+
+        total.samples.push_back(milliseconds);
+        metric(metrics, "frame" + std::to_string(frame.number) + ".cpu", "ms").samples.push_back(milliseconds);
+        if(options.hash && repetition == 0) {
+            app.readbackFrame(pixels);
+            const uint64_t hash = FrameCapture::hashImage(pixels);
+            replayed.setImageHash(frame.number, hash);
+            if(frame.imageHash != 0 && frame.imageHash != hash)
+                divergence.hashMismatches++;
+        }
+    }
+    metric(metrics, "replay.sequence", "ms").samples.push_back(millisecondsSince(sequenceStart));
+
+    //время GPU последних кадров в полёте не собрано: его нет и в захвате
+    for(const auto& frame : replayed.getFrames())
+        if(frame.measured && frame.gpuMilliseconds > 0.0) {
+            metric(metrics, "replay.gpu", "ms").samples.push_back(frame.gpuMilliseconds);
+            metric(metrics, "frame" + std::to_string(frame.number) + ".gpu", "ms").samples.push_back(frame.gpuMilliseconds);
+        }
+
+    if(repetition != 0)
+        return;
+
+    divergence.pipelines = replayed.getPipelines() == capture.getPipelines();
+    for(size_t i = 0; i < frames.size() && i < replayed.getFrames().size(); i++) {
+        if(!frames[i].measured || frames[i].commands == replayed.getFrames()[i].commands)
+            continue;
+        if(divergence.frames++ == 0)
+            divergence.firstFrame = frames[i].number;
+    }
+    if(options.storeHashes)
+        for(const auto& frame : replayed.getFrames())
+            capture.setImageHash(frame.number, frame.imageHash);
+}
+
+void writeJson(std::ostream& out, const Options& options, const FrameCapture& capture,
+               const VkPhysicalDeviceProperties& properties, const std::vector<Metric>& metrics,
+               const Divergence& divergence)
+{
+    const CaptureConfig& config = capture.getConfig();
+    out << std::setprecision(6);
+    out << "{\n  \"schema\": 1,\n  \"buildType\": \"" << VULKANPROJECT_BUILD_TYPE << "\",\n";
+    bench::writeDevice(out, properties);
+    out << ",\n";
+    out << "  \"capture\": {\"file\": \"" << bench::escapeJson(options.capture) << "\", \"device\": \""
+        << bench::escapeJson(config.device) << "\", \"frames\": " << capture.getFrames().size() << ", \"width\": "
+        << config.width << ", \"height\": " << config.height << ", \"repeat\": " << options.repeat << "},\n";
+    out << "  \"divergence\": {\"pipelinesMatch\": " << (divergence.pipelines ? "true" : "false") << ", \"frames\": "
+        << divergence.frames << ", \"firstFrame\": " << divergence.firstFrame << ", \"hashMismatches\": "
+        << divergence.hashMismatches << "},\n";
+    bench::writeResults(out, metrics);
+    out << "\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    Options options = parseOptions(argc, argv);
+    if(options.capture.empty()) {
+        std::cerr << "Использование: vulkanproject_replay <capture.vcap> [--output=replay.json] [--repeat=3] [--hash]" << std::endl;
+        return 1;
+    }
+    //JSON может идти в stdout: ход инициализации не выводится
+    utils::setVerbosity(utils::Verbosity::Quiet);
+
+    FrameCapture capture;
+    std::vector<Metric> metrics;
+    VkPhysicalDeviceProperties properties {};
+    Divergence divergence;
+    try {
+        capture.load(options.capture);
+        capture.printReport(std::cerr);
+        const ReplayFiles files = extractResources(capture, options);
+        for(uint32_t i = 0; i < options.repeat; i++)
+            replay(capture, files, options, i, metrics, divergence, properties);
+        if(options.storeHashes) {
+            capture.save(options.capture);
+            std::cerr << "Эталонные хэши кадров записаны в " << options.capture << std::endl;
+        }
+    } catch(const std::exception& error) {
+        std::cerr << "Воспроизведение прервано: " << error.what() << std::endl;
+        return 1;
+    }
+
+    if(!divergence.pipelines)
+        std::cerr << "Варианты конвейеров отличаются от захваченных" << std::endl;
+    if(divergence.frames > 0)
+        std::cerr << "Команды " << divergence.frames << " кадров отличаются от захваченных, первый - кадр "
+                  << divergence.firstFrame << std::endl;
+    if(divergence.hashMismatches > 0)
+        std::cerr << "Хэши " << divergence.hashMismatches << " кадров не совпали с эталоном" << std::endl;
+
+    if(options.output.empty()) {
+        writeJson(std::cout, options, capture, properties, metrics, divergence);
+    } else {
+        std::ofstream file(options.output);
+        writeJson(file, options, capture, properties, metrics, divergence);
+        std::cerr << "Результаты сохранены в " << options.output << std::endl;
+    }
+    //расхождение - не ошибка замера, но автоматическое сравнение версий должно его заметить
+    return divergence.frames > 0 || divergence.hashMismatches > 0 ? 2 : 0;
+}